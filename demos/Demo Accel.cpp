@@ -0,0 +1,55 @@
+#include "openrt.h"
+#include "core/timer.h"
+
+using namespace rt;
+
+// Compares the build and the traversal times of the acceleration structures on the bundled meshes
+int main()
+{
+	const Vec3f	bgColor = RGB(0, 0, 0);
+	const Size	resolution = Size(800, 600);
+
+	const std::vector<std::pair<std::string, std::function<ptr_accelstructure_t(void)>>> vAccelStructures = {
+		{ "BSP",			[]() { return std::make_shared<CBSPTree>(); } },
+		{ "BVH (SAH)",		[]() { return std::make_shared<CBVHTree>(BVHBuilder::SAH); } },
+		{ "BVH (LBVH)",		[]() { return std::make_shared<CBVHTree>(BVHBuilder::LBVH); } },
+		{ "BVH (SBVH)",		[]() { return std::make_shared<CBVHTree>(BVHBuilder::SBVH); } },
+		{ "Compressed BVH",	[]() { return std::make_shared<CCompressedBVHTree>(BVHBuilder::SAH); } },
+		{ "BVH4",			[]() { return std::make_shared<CBVH4Tree>(BVHBuilder::SAH); } },
+		{ "BVH8",			[]() { return std::make_shared<CBVH8Tree>(BVHBuilder::SAH); } }
+	};
+
+	for (const std::string& mesh : { "Torus Knot.obj", "teapot.obj" }) {
+		CScene scene(bgColor);
+		auto pShader = std::make_shared<CShaderEyelight>(RGB(255, 255, 255));
+		CSolid solid(pShader, dataPath + mesh);
+		scene.add(solid);
+
+		// Camera looking at the mesh from the front
+		CBoundingBox box;
+		for (const auto& pPrim : solid.getPrims())
+			box.extend(pPrim->getBoundingBox());
+		Vec3f center = box.getCenter();
+		float size = static_cast<float>(norm(box.getMaxPoint() - box.getMinPoint()));
+		scene.add(std::make_shared<CCameraPerspectiveTarget>(resolution, center + Vec3f(0, 0.3f * size, size), center, Vec3f(0, 1, 0), 60.0f));
+
+		printf("%s: %zu primitives\n", mesh.c_str(), solid.getPrims().size());
+		for (const auto& [name, createAccelStructure] : vAccelStructures) {
+			auto pAccelStructure = createAccelStructure();
+			scene.setAccelStructure(pAccelStructure);
+			Timer::start("\t" + name + " build...");
+			scene.buildAccelStructure(20, 3);
+			Timer::stop();
+			printf("\t%s memory: %zu KB\n", name.c_str(), pAccelStructure->getMemoryUsage() / 1024);
+
+			Timer::start("\t" + name + " render...");
+			scene.renderDepth();
+			Timer::stop();
+#ifdef DEBUG_PRINT_INFO
+			if (auto pBSPTree = std::dynamic_pointer_cast<CBSPTree>(pAccelStructure))
+				printf("\t%s primitive tests: %zu, redundant tests avoided by mailboxing: %zu\n", name.c_str(), pBSPTree->getNumPrimTests(), pBSPTree->getNumSkippedTests());
+#endif
+		}
+	}
+	return 0;
+}
@@ -4,23 +4,12 @@
 using namespace rt;
 
 ptr_prim_t createCompositeDice(const ptr_shader_t& shader) {
-	auto solidSphere2 = CSolidSphere(shader, Vec3f(0, -3.0f, -7), 0.2f, 24, true);
-	auto solidSphere3 = CSolidSphere(shader, Vec3f(0.5f, -3.0f, -7), 0.2f, 24, true);
-	auto solidSphere4 = CSolidSphere(shader, Vec3f(-0.5f, -3.0f, -7), 0.2f, 24, true);
-	auto solidSphere5 = CSolidSphere(shader, Vec3f(0, -2.5f, -7), 0.2f, 24, true);
-	auto solidSphere6 = CSolidSphere(shader, Vec3f(0.5f, -2.5f, -7), 0.2f, 24, true);
-	auto solidSphere7 = CSolidSphere(shader, Vec3f(-0.5f, -2.5f, -7), 0.2f, 24, true);
-	auto solidSphere8 = CSolidSphere(shader, Vec3f(0, -3.5f, -7), 0.2f, 24, true);
-	auto solidSphere9 = CSolidSphere(shader, Vec3f(0.5f, -3.5f, -7), 0.2f, 24, true);
-	auto solidSphere10 = CSolidSphere(shader, Vec3f(-0.5f, -3.5f, -7), 0.2f, 24, true);
-	ptr_prim_t temp = std::make_shared<CPrimBoolean>(solidSphere2, solidSphere3, BoolOp::Union);
-	ptr_prim_t row1 = std::make_shared<CPrimBoolean>(temp, solidSphere4, BoolOp::Union);
-	ptr_prim_t temp2 = std::make_shared<CPrimBoolean>(solidSphere5, solidSphere6, BoolOp::Union);
-	ptr_prim_t row2 = std::make_shared<CPrimBoolean>(temp2, solidSphere7, BoolOp::Union);
-	ptr_prim_t temp3 = std::make_shared<CPrimBoolean>(solidSphere8, solidSphere9, BoolOp::Union);
-	ptr_prim_t row3 = std::make_shared<CPrimBoolean>(temp3, solidSphere10, BoolOp::Union);
-	ptr_prim_t temp4 = std::make_shared<CPrimBoolean>(row1, row2, BoolOp::Union);
-	return std::make_shared<CPrimBoolean>(row3, temp4, BoolOp::Union);
+	// 3 x 3 pips combined with one n-ary union instead of a chain of binary booleans
+	std::vector<ptr_csgnode_t> vpPips;
+	for (float y : { -3.0f, -2.5f, -3.5f })
+		for (float x : { 0.0f, 0.5f, -0.5f })
+			vpPips.push_back(CPrimCSG::solid(CSolidSphere(shader, Vec3f(x, y, -7), 0.2f, 24, true)));
+	return std::make_shared<CPrimCSG>(CPrimCSG::operation(BoolOp::Union, vpPips));
 }
 
 std::shared_ptr<CScene> buildSceneEarth(const Vec3f& bgColor, const Size resolution)
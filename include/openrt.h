@@ -16,12 +16,15 @@
 
 #include "core/LightArea.h"
 #include "core/LightSky.h"
+#include "core/LightEnvironment.h"
 
 #include "core/PrimSphere.h"
 #include "core/PrimPlane.h"
 #include "core/PrimDisc.h"
 #include "core/PrimTriangle.h"
 #include "core/PrimBoolean.h"
+#include "core/PrimCSG.h"
+#include "core/PrimInstance.h"
 
 #include "core/SolidQuad.h"
 #include "core/SolidBox.h"
@@ -44,6 +47,9 @@
 #include "core/SamplerStratified.h"
 
 #include "core/Transform.h"
+#include "core/BVHTree.h"
+#include "core/CompressedBVHTree.h"
+#include "core/WideBVHTree.h"
 
 #include "core/Texture.h"
 #include "core/TextureStripes.h"
@@ -80,6 +86,12 @@ The OpenRT framework consist of the following essential blocks:
 	- <b>Directional spot light source:</b> @ref rt::CLightSpot
 	- <b>Area light source:</b> @ref rt::CLightArea
 	- <b>Skylight (ambient occlusion) light source:</b> @ref rt::CLightSky
+	- <b>Environment map light source with importance sampling:</b> @ref rt::CLightEnvironment
+	- <b>Importance sampling of many light sources:</b> @ref rt::CLightBVH
+	- <b>Culling of the light sources with limited influence:</b> @ref rt::CLightGrid
+	- <b>Reservoir-based spatiotemporal resampling of the direct illumination:</b> @ref rt::CReSTIR
+	- <b>Shadow maps of the point light sources (fast mode):</b> @ref rt::CShadowMap
+	- <b>Type-grouped SoA arrays of the point light sources:</b> @ref rt::CLightArrays
 	@todo Implement class CLightDirect
 
 @subsection sec_main_geometry Geometry
@@ -87,6 +99,9 @@ The OpenRT framework consist of the following essential blocks:
 	- <b>Plane:</b> @ref rt::CPrimPlane
 	- <b>Sphere:</b> @ref rt::CPrimSphere
 	- <b>Triangle:</b> @ref rt::CPrimTriangle
+	- <b>Instance:</b> @ref rt::CPrimInstance
+	- <b>Boolean:</b> @ref rt::CPrimBoolean
+	- <b>CSG tree:</b> @ref rt::CPrimCSG
 @subsubsection sec_main_solids Solids
  - @b Quadrilateral: @ref rt::CSolidQuad
  - @b Box: @ref rt::CSolidBox
@@ -103,6 +118,7 @@ The OpenRT framework consist of the following essential blocks:
 	- <b>Glass:</b> @ref rt::CShaderGlass
 	- <b>Mirror:</b> @ref rt::CShaderMirror
 	- <b>General Purpose Shader:</b> @ref rt::CShader
+	- <b>BRDF sampling for multiple importance sampling:</b> @ref rt::IBRDF, @ref rt::CBRDFPhong, @ref rt::CBRDFGlossy
 */
 
 /**
@@ -0,0 +1,49 @@
+#include "BRDF.h"
+#include "Sampler.h"
+
+namespace rt {
+	// ---------------- Phong BRDF ----------------
+	std::optional<Vec3f> CBRDFPhong::sample(const Vec2f& u) const
+	{
+		// choose the part with u[0] and re-use it for sampling the part
+		Vec3f res;
+		if (u[0] < m_diffuseProbability)
+			res = CSampler::transformSampleToWCS(CSampler::cosineSampleHemisphere(Vec2f(u[0] / m_diffuseProbability, u[1])), m_normal);
+		else
+			res = CSampler::transformSampleToWCS(CSampler::uniformSampleHemisphere(Vec2f((u[0] - m_diffuseProbability) / (1 - m_diffuseProbability), u[1]), m_ke), m_reflected);
+		if (res.dot(m_normal) <= 0) return std::nullopt;
+		return normalize(res);
+	}
+
+	float CBRDFPhong::pdf(const Vec3f& direction) const
+	{
+		float cosNormal = direction.dot(m_normal);
+		if (cosNormal <= 0) return 0;
+		float res = m_diffuseProbability * cosNormal / Pif;
+		float cosReflected = direction.dot(m_reflected);
+		if (cosReflected > 0 && m_diffuseProbability < 1)
+			res += (1 - m_diffuseProbability) * (m_ke + 1) / (2 * Pif) * powf(cosReflected, m_ke);
+		return res;
+	}
+
+	// ---------------- Glossy BRDF ----------------
+	std::optional<Vec3f> CBRDFGlossy::sample(const Vec2f& u) const
+	{
+		Vec3f h = CSampler::transformSampleToWCS(CSampler::uniformSampleHemisphere(u, m_m), m_normal);	// perturbed normal
+		float cosAlpha = -m_dir.dot(h);
+		if (cosAlpha <= 0) return std::nullopt;
+		Vec3f res = normalize(m_dir + 2 * cosAlpha * h);
+		if (res.dot(m_normal) <= 0) return std::nullopt;
+		return res;
+	}
+
+	float CBRDFGlossy::pdf(const Vec3f& direction) const
+	{
+		if (direction.dot(m_normal) <= 0) return 0;
+		Vec3f h = normalize(direction - m_dir);		// half-vector
+		float cosH = h.dot(m_normal);
+		float cosAlpha = -m_dir.dot(h);
+		if (cosH <= 0 || cosAlpha <= 0) return 0;
+		return (m_m + 1) / (2 * Pif) * powf(cosH, m_m) / (4 * cosAlpha);
+	}
+}
@@ -0,0 +1,107 @@
+// BRDF sampling classes
+#pragma once
+
+#include "types.h"
+
+namespace rt {
+	// ================================ BRDF Interface Class ================================
+	/**
+	 * @brief Sampling interface of the Bidirectional Reflectance Distribution Function (BRDF) at a shaded point
+	 * @details A shader creates the BRDF for the shaded point. The BRDF samples the directions of the incoming light approximately proportionally to the reflected light,
+	 * and returns the probability density of these directions. This allows to combine the BRDF sampling with the light sampling by multiple importance sampling (see CScene::illuminateMIS()):
+	 * the light sampling works well for the small light sources and the diffuse surfaces, and the BRDF sampling - for the large light sources and the glossy surfaces.
+	 * @ingroup moduleShader
+	 */
+	class IBRDF
+	{
+	public:
+		DllExport IBRDF(void) = default;
+		DllExport IBRDF(const IBRDF&) = delete;
+		DllExport virtual ~IBRDF(void) = default;
+		DllExport const IBRDF& operator=(const IBRDF&) = delete;
+
+		/**
+		 * @brief Samples the direction of the incoming light
+		 * @param u The sample from [0; 1)^2
+		 * @return The normalized direction towards the incoming light, or std::nullopt if the sampled direction points below the surface
+		 */
+		DllExport virtual std::optional<Vec3f>	sample(const Vec2f& u) const = 0;
+		/**
+		 * @brief Returns the probability density of sampling the direction with sample()
+		 * @param direction The normalized direction towards the incoming light
+		 * @return The probability density with respect to the solid angle
+		 */
+		DllExport virtual float					pdf(const Vec3f& direction) const = 0;
+	};
+
+	// ================================ Phong BRDF Class ================================
+	/**
+	 * @brief Sampling of the Phong BRDF
+	 * @details The diffuse part is sampled with the cosine-weighted density around the normal \f$ \vec{n} \f$ and the specular part - with the density \f$ \frac{k_e+1}{2\pi}\cos^{k_e}\alpha \f$,
+	 * where \f$ \alpha \f$ is the angle to the reflected direction \f$ \vec{r} \f$. The parts are chosen with the probabilities, proportional to their weights.
+	 * @ingroup moduleShader
+	 */
+	class CBRDFPhong : public IBRDF
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 * @param normal The shading normal
+		 * @param reflected The direction of the perfect reflection of the viewing ray
+		 * @param kd The weight of the diffuse part
+		 * @param ks The weight of the specular part
+		 * @param ke The shininess exponent
+		 */
+		DllExport CBRDFPhong(const Vec3f& normal, const Vec3f& reflected, float kd, float ks, float ke)
+			: m_normal(normal)
+			, m_reflected(reflected)
+			, m_diffuseProbability(kd + ks > 0 ? kd / (kd + ks) : 1.0f)
+			, m_ke(ke)
+		{}
+		DllExport virtual ~CBRDFPhong(void) = default;
+
+		DllExport virtual std::optional<Vec3f>	sample(const Vec2f& u) const override;
+		DllExport virtual float					pdf(const Vec3f& direction) const override;
+
+
+	private:
+		Vec3f	m_normal;					///< The shading normal
+		Vec3f	m_reflected;				///< The direction of the perfect reflection
+		float	m_diffuseProbability;		///< The probability of sampling the diffuse part
+		float	m_ke;						///< The shininess exponent
+	};
+
+	// ================================ Glossy BRDF Class ================================
+	/**
+	 * @brief Sampling of the glossy reflection
+	 * @details The glossy reflection is modelled as the perfect reflection at the normal, which is perturbed with the density \f$ \frac{m+1}{2\pi}\cos^{m}\theta_h \f$
+	 * around the shading normal, as used by @ref CShaderChrome and @ref CShaderGeneral. The density of the reflected directions is
+	 * \f$ \frac{m+1}{2\pi}\cos^{m}\theta_h / (4 \vec{\omega}_o \cdot \vec{h}) \f$, where \f$ \vec{h} \f$ is the half-vector
+	 * @ingroup moduleShader
+	 */
+	class CBRDFGlossy : public IBRDF
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 * @param normal The shading normal
+		 * @param dir The direction of the viewing ray
+		 * @param m The exponent of the normal perturbation (see CSampler::uniformSampleHemisphere())
+		 */
+		DllExport CBRDFGlossy(const Vec3f& normal, const Vec3f& dir, float m)
+			: m_normal(normal)
+			, m_dir(dir)
+			, m_m(m)
+		{}
+		DllExport virtual ~CBRDFGlossy(void) = default;
+
+		DllExport virtual std::optional<Vec3f>	sample(const Vec2f& u) const override;
+		DllExport virtual float					pdf(const Vec3f& direction) const override;
+
+
+	private:
+		Vec3f	m_normal;		///< The shading normal
+		Vec3f	m_dir;			///< The direction of the viewing ray
+		float	m_m;			///< The exponent of the normal perturbation
+	};
+}
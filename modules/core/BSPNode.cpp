@@ -1,36 +1,94 @@
 #include "BSPNode.h"
+#include "BoundingBox.h"
 #include "Ray.h"
 
 namespace rt {
-    bool CBSPNode::intersect(Ray& ray, double t0, double t1) const
+    bool CBSPNode::intersect(Ray& ray, const RayData& data, double t0, double t1, BSPMailbox& mailbox) const
     {
         if (isLeaf()) {
             for (auto& pPrim : m_vpPrims)
-                pPrim->intersect(ray);
+                if (mailbox.check(pPrim.get()))     // a primitive, straddling several leaves, is tested only once
+                    pPrim->intersect(ray);
             return (ray.hit && ray.t < t1 + Epsilon);
         }
         else {
             // distance from ray origin to the split plane of the current volume (may be negative)
-            double d = (m_splitVal - ray.org[m_splitDim]) / ray.dir[m_splitDim];
+            // the inverse direction is finite, thus the rays parallel to the plane get a huge distance (or zero, if they lie in the plane) instead of an infinity or a NaN
+            double d = m_splitVal * data.invDir[m_splitDim] - data.orgInvDir[m_splitDim];
 
-            auto frontNode = (ray.dir[m_splitDim] < 0) ? Right() : Left();
-            auto backNode  = (ray.dir[m_splitDim] < 0) ? Left() : Right();
+            auto frontNode = data.sign[m_splitDim] ? Right() : Left();
+            auto backNode  = data.sign[m_splitDim] ? Left() : Right();
 
             if (d <= t0) {
                 // t0..t1 is totally behind d, only go to back side
-                return backNode->intersect(ray, t0, t1);
+                return backNode->intersect(ray, data, t0, t1, mailbox);
             }
             else if (d >= t1) {
                 // t0..t1 is totally in front of d, only go to front side
-                return frontNode->intersect(ray, t0, t1);
+                return frontNode->intersect(ray, data, t0, t1, mailbox);
             }
             else {
                 // travese both children. front one first, back one last
-                if (frontNode->intersect(ray, t0, d))
+                if (frontNode->intersect(ray, data, t0, d, mailbox))
                     return true;
 
-                return backNode->intersect(ray, d, t1);
+                return backNode->intersect(ray, data, d, t1, mailbox);
             }
         }
     }
+
+    const ptr_prim_t* CBSPNode::findOccluder(const Ray& ray, const RayData& data, double t0, double t1, BSPMailbox& mailbox) const
+    {
+        if (isLeaf()) {
+            // any intersection within ray.t occludes the ray, even if it lies outside of the volume of the leaf
+            for (auto& pPrim : m_vpPrims)
+                if (mailbox.check(pPrim.get()) && pPrim->if_intersect(ray))
+                    return &pPrim;
+            return nullptr;
+        }
+
+        const double d = m_splitVal * data.invDir[m_splitDim] - data.orgInvDir[m_splitDim];
+        auto frontNode = data.sign[m_splitDim] ? Right() : Left();
+        auto backNode  = data.sign[m_splitDim] ? Left() : Right();
+        if (d <= t0) return backNode->findOccluder(ray, data, t0, t1, mailbox);
+        if (d >= t1) return frontNode->findOccluder(ray, data, t0, t1, mailbox);
+        const ptr_prim_t* res = frontNode->findOccluder(ray, data, t0, d, mailbox);
+        return res ? res : backNode->findOccluder(ray, data, d, t1, mailbox);
+    }
+
+    void CBSPNode::insert(const ptr_prim_t pPrim, const CBoundingBox& box)
+    {
+        if (isLeaf()) {
+            m_vpPrims.push_back(pPrim);
+            return;
+        }
+        auto splitBoxes = box.split(m_splitDim, m_splitVal);
+        CBoundingBox primBox = pPrim->getBoundingBox();
+        if (primBox.overlaps(splitBoxes.first))  m_pLeft->insert(pPrim, splitBoxes.first);
+        if (primBox.overlaps(splitBoxes.second)) m_pRight->insert(pPrim, splitBoxes.second);
+    }
+
+    bool CBSPNode::remove(const ptr_prim_t pPrim, const CBoundingBox& box)
+    {
+        if (isLeaf()) {
+            auto it = std::find(m_vpPrims.begin(), m_vpPrims.end(), pPrim);
+            if (it == m_vpPrims.end()) return false;
+            m_vpPrims.erase(it);
+            return true;
+        }
+        auto splitBoxes = box.split(m_splitDim, m_splitVal);
+        CBoundingBox primBox = pPrim->getBoundingBox();
+        bool res = false;
+        if (primBox.overlaps(splitBoxes.first))  res |= m_pLeft->remove(pPrim, splitBoxes.first);
+        if (primBox.overlaps(splitBoxes.second)) res |= m_pRight->remove(pPrim, splitBoxes.second);
+        return res;
+    }
+
+    size_t CBSPNode::getMemoryUsage(void) const
+    {
+        size_t res = sizeof(CBSPNode) + m_vpPrims.capacity() * sizeof(ptr_prim_t);
+        if (m_pLeft) res += m_pLeft->getMemoryUsage();
+        if (m_pRight) res += m_pRight->getMemoryUsage();
+        return res;
+    }
 }
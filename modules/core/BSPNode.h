@@ -6,6 +6,41 @@
 
 namespace rt {
 	struct Ray;
+	struct RayData;
+	class CBoundingBox;
+
+	// ================================ BSP Mailbox Structure ================================
+	/**
+	 * @brief Per-ray mailbox, which prevents repeated intersection tests of the primitives, referenced by several leaf-nodes
+	 * @details The mailbox is a small direct-mapped cache of the recently tested primitives. It lives on the stack of the tracing thread for the duration of one ray traversal,
+	 * thus it needs no synchronization. A collision in the cache only evicts an entry, which may cause a redundant test, but never a missed intersection.
+	 */
+	struct BSPMailbox
+	{
+		static const size_t	size = 32;						///< Number of entries in the cache (power of 2)
+
+		const CPrim*		vpEntries[size]	= {};			///< The recently tested primitives
+		size_t				nTests			= 0;			///< Number of performed primitive tests
+		size_t				nSkipped		= 0;			///< Number of avoided redundant primitive tests
+
+		/**
+		 * @brief Checks whether the primitive \b pPrim has already been tested with the current ray and marks it as tested
+		 * @param pPrim Pointer to the primitive
+		 * @retval true If the primitive is to be tested
+		 * @retval false If the primitive has already been tested
+		 */
+		bool check(const CPrim* pPrim)
+		{
+			const size_t idx = static_cast<size_t>((reinterpret_cast<uintptr_t>(pPrim) * 0x9E3779B97F4A7C15ull) >> 59) & (size - 1);
+			if (vpEntries[idx] == pPrim) {
+				nSkipped++;
+				return false;
+			}
+			vpEntries[idx] = pPrim;
+			nTests++;
+			return true;
+		}
+	};
     
     // ================================ BSP Node Class ================================
     /**
@@ -40,12 +75,43 @@ namespace rt {
 		 * @brief Traverses the ray \b ray and checks for intersection with a primitive
 		 * @details If the intersection is found, \b ray.t is updated
 		 * @param[in,out] ray The ray
+		 * @param[in] data The data of the ray \b ray, precomputed for the split-plane tests
 		 * @param[in] t0 The distance from ray origin at which the ray enters the scene
 		 * @param[in] t1 The distance from ray origin at which the ray leaves the scene
+		 * @param[in,out] mailbox The mailbox of the ray, which records the primitives already tested in the previously traversed leaf-nodes
 		 * @retval true If ray \b ray intersects any object
 		 * @retval false otherwise
 		 */
-        bool intersect(Ray& ray, double t0, double t1) const;
+        bool intersect(Ray& ray, const RayData& data, double t0, double t1, BSPMailbox& mailbox) const;
+		/**
+		 * @brief Traverses the ray \b ray and finds any primitive, which it intersects
+		 * @param[in] ray The ray
+		 * @param[in] data The data of the ray \b ray, precomputed for the split-plane tests
+		 * @param[in] t0 The distance from ray origin at which the ray enters the scene
+		 * @param[in] t1 The distance from ray origin at which the ray leaves the scene
+		 * @param[in,out] mailbox The mailbox of the ray, which records the primitives already tested in the previously traversed leaf-nodes
+		 * @return Pointer to the stored pointer to the intersected primitive, or \b nullptr if ray \b ray intersects no primitive
+		 */
+		const ptr_prim_t* findOccluder(const Ray& ray, const RayData& data, double t0, double t1, BSPMailbox& mailbox) const;
+		/**
+		 * @brief Adds the primitive \b pPrim to all the leaf-nodes of the sub-tree, which volumes it overlaps
+		 * @param pPrim Pointer to the primitive
+		 * @param box The bounding box of the volume covered by the current node
+		 */
+		void insert(const ptr_prim_t pPrim, const CBoundingBox& box);
+		/**
+		 * @brief Removes the primitive \b pPrim from all the leaf-nodes of the sub-tree, which volumes it overlaps
+		 * @param pPrim Pointer to the primitive
+		 * @param box The bounding box of the volume covered by the current node
+		 * @retval true If the primitive was found and removed
+		 * @retval false otherwise
+		 */
+		bool remove(const ptr_prim_t pPrim, const CBoundingBox& box);
+		/**
+		 * @brief Returns the amount of memory occupied by the sub-tree
+		 * @return The size of the sub-tree in bytes
+		 */
+		size_t getMemoryUsage(void) const;
 
 		/**
 		 * @brief Returns the pointer to the \a left child
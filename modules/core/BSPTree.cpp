@@ -26,6 +26,7 @@ namespace rt {
         m_treeBoundingBox = calcBoundingBox(vpPrims);
         m_maxDepth = maxDepth;
         m_minPrimitives = minPrimitives;
+        resetCounters();
 #ifdef DEBUG_PRINT_INFO
         std::cout << "Scene bounds are : " << m_treeBoundingBox << std::endl;
 #endif
@@ -35,13 +36,56 @@ namespace rt {
     bool CBSPTree::intersect(Ray& ray) const
     {
         RT_ASSERT(!ray.hit);
+        if (!m_root) return false;  // the tree has not been built yet
 
+        const RayData data(ray);
         double t0 = 0;
         double t1 = ray.t;
-        m_treeBoundingBox.clip(ray, t0, t1);
+        m_treeBoundingBox.clip(data, t0, t1);
         if (t1 < t0) return false;  // no intersection with the bounding box
 
-        return m_root->intersect(ray, t0, t1);
+        BSPMailbox mailbox;
+        bool res = m_root->intersect(ray, data, t0, t1, mailbox);
+#ifdef DEBUG_PRINT_INFO
+        m_nPrimTests.fetch_add(mailbox.nTests, std::memory_order_relaxed);
+        m_nSkippedTests.fetch_add(mailbox.nSkipped, std::memory_order_relaxed);
+#endif
+        return res;
+    }
+
+    const ptr_prim_t* CBSPTree::findOccluder(const Ray& ray) const
+    {
+        if (!m_root) return nullptr;
+
+        const RayData data(ray);
+        double t0 = 0;
+        double t1 = ray.t;
+        m_treeBoundingBox.clip(data, t0, t1);
+        if (t1 < t0) return nullptr;
+
+        BSPMailbox mailbox;
+        const ptr_prim_t* res = m_root->findOccluder(ray, data, t0, t1, mailbox);
+#ifdef DEBUG_PRINT_INFO
+        m_nPrimTests.fetch_add(mailbox.nTests, std::memory_order_relaxed);
+        m_nSkippedTests.fetch_add(mailbox.nSkipped, std::memory_order_relaxed);
+#endif
+        return res;
+    }
+
+    bool CBSPTree::insert(const ptr_prim_t pPrim)
+    {
+        if (!m_root) return false;
+        CBoundingBox box = pPrim->getBoundingBox();
+        for (int dim = 0; dim < 3; dim++)
+            if (box.getMinPoint()[dim] < m_treeBoundingBox.getMinPoint()[dim] || box.getMaxPoint()[dim] > m_treeBoundingBox.getMaxPoint()[dim])
+                return false;   // the primitive lies outside of the tree
+        m_root->insert(pPrim, m_treeBoundingBox);
+        return true;
+    }
+
+    bool CBSPTree::remove(const ptr_prim_t pPrim)
+    {
+        return m_root ? m_root->remove(pPrim, m_treeBoundingBox) : false;
     }
 
     ptr_bspnode_t CBSPTree::build(const CBoundingBox& box, const std::vector<ptr_prim_t>& vpPrims, size_t depth)
@@ -2,8 +2,10 @@
 // Written by Dr. Sergey G. Kosov in 2019 for Jacobs University
 #pragma once
 
+#include "IAccelStructure.h"
 #include "BSPNode.h"
 #include "BoundingBox.h"
+#include <atomic>
 
 namespace rt {
     // ================================ BSP Tree Class ================================
@@ -11,12 +13,12 @@ namespace rt {
      * @brief Binary Space Partitioning (BSP) tree class
      * @author Sergey G. Kosov, sergey.kosov@project-10.de
      */
-	class CBSPTree
+	class CBSPTree : public IAccelStructure
 	{
 	public:
 		CBSPTree(void) = default;
         CBSPTree(const CBSPTree&) = delete;
-        ~CBSPTree(void) = default;
+        virtual ~CBSPTree(void) = default;
         const CBSPTree& operator=(const CBSPTree&) = delete;
 		
 		/**
@@ -27,13 +29,42 @@ namespace rt {
 		* @param minPrimitives The minimum number of primitives in a leaf-node.
 		* This parameters should be alway above 1.
 		*/
-		void build(const std::vector<ptr_prim_t>& vpPrims, size_t maxDepth = 20, size_t minPrimitives = 3);
+		virtual void build(const std::vector<ptr_prim_t>& vpPrims, size_t maxDepth = 20, size_t minPrimitives = 3) override;
 		/**
 		 * @brief Checks whether the ray \b ray intersects a primitive.
 		 * @details If ray \b ray intersects a primitive, the \b ray.t value will be updated
 		 * @param[in,out] ray The ray
 		 */
-		bool intersect(Ray& ray) const;
+		virtual bool intersect(Ray& ray) const override;
+		virtual bool if_intersect(const Ray& ray) const override { return findOccluder(ray) != nullptr; }
+		virtual const ptr_prim_t* findOccluder(const Ray& ray) const override;
+		/**
+		 * @brief Adds the primitive to the leaf-nodes, which volumes it overlaps
+		 * @note The leaf-nodes are not split further, thus the structure should be re-built after many insertions
+		 * @param pPrim Pointer to the primitive
+		 * @retval true If the primitive has been inserted
+		 * @retval false If the primitive does not fit into the bounding box of the tree, thus the tree needs to be re-built
+		 */
+		virtual bool insert(const ptr_prim_t pPrim) override;
+		virtual bool remove(const ptr_prim_t pPrim) override;
+		virtual size_t getMemoryUsage(void) const override { return sizeof(CBSPTree) + (m_root ? m_root->getMemoryUsage() : 0); }
+		/**
+		 * @brief Returns the number of the ray-primitive intersection tests, performed since the last call of @ref resetCounters()
+		 * @note The tests are counted only if DEBUG_PRINT_INFO is defined, since the shared counters would be updated by all the render threads at every ray
+		 * @return The number of tests (0 if DEBUG_PRINT_INFO is not defined)
+		 */
+		size_t getNumPrimTests(void) const { return m_nPrimTests.load(std::memory_order_relaxed); }
+		/**
+		 * @brief Returns the number of the redundant ray-primitive intersection tests, avoided by mailboxing since the last call of @ref resetCounters()
+		 * @details A test is redundant if the primitive is referenced by several leaf-nodes, traversed by the same ray
+		 * @note The tests are counted only if DEBUG_PRINT_INFO is defined
+		 * @return The number of avoided tests (0 if DEBUG_PRINT_INFO is not defined)
+		 */
+		size_t getNumSkippedTests(void) const { return m_nSkippedTests.load(std::memory_order_relaxed); }
+		/**
+		 * @brief Resets the counters of the ray-primitive intersection tests
+		 */
+		void resetCounters(void) { m_nPrimTests = 0; m_nSkippedTests = 0; }
 
 	private:
         /**
@@ -51,5 +82,7 @@ namespace rt {
 		size_t			m_maxDepth		= 0;		///< The maximum allowed depth of the tree
 		size_t			m_minPrimitives = 0;		///< The minimum number of primitives in a leaf-node
 		ptr_bspnode_t   m_root			= nullptr;	///< Pointer to the root node of the BSP tree
+		mutable std::atomic<size_t>	m_nPrimTests	= 0;	///< Number of performed ray-primitive intersection tests
+		mutable std::atomic<size_t>	m_nSkippedTests	= 0;	///< Number of redundant ray-primitive intersection tests, avoided by mailboxing
 	};
 }
@@ -0,0 +1,1273 @@
+#include "BVHTree.h"
+#include "Prim.h"
+#include "Ray.h"
+#include "macroses.h"
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rt {
+	namespace {
+		const size_t	nBins				= 16;		// Number of bins for the binned SAH
+		const size_t	maxStackSize		= 64;		// Size of the traversal stack
+		const float		traversalCost		= 1.0f;		// SAH cost of traversing a node
+		const float		intersectionCost	= 1.0f;		// SAH cost of intersecting a primitive
+		const float		maxDuplication		= 1.0f;		// SBVH: maximal number of additional references per primitive on average
+		const float		minOverlap			= 1e-5f;	// SBVH: minimal overlap of the children of the object split relative to the root area, which triggers the search for a spatial split
+		const size_t	packetSize			= 16;		// Number of rays traversed together by the batch queries
+
+		// Returns the surface area of the bounding box
+		inline float surfaceArea(const CBoundingBox& box)
+		{
+			Vec3f d = box.getMaxPoint() - box.getMinPoint();
+			if (d[0] < 0 || d[1] < 0 || d[2] < 0) return 0;
+			return 2 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+		}
+
+		// Packet of rays in the SoA layout, prepared for the box tests
+		struct RayPacket {
+			size_t	n;							// Number of rays in the packet
+			float	org[3][packetSize];			// Origins of the rays
+			float	invDir[3][packetSize];		// Inverse directions of the rays
+			float	orgInvDir[3][packetSize];	// Origins of the rays multiplied with the inverse directions
+			float	tMax[packetSize];			// Current maximum hit distances of the rays; negative for the unused slots
+		};
+
+		// Returns the packet of the rays with indices [begin; begin + n) of the batch
+		inline RayPacket getPacket(const RayBatch& rays, size_t begin, size_t n)
+		{
+			RayPacket res;
+			res.n = n;
+			for (size_t k = 0; k < packetSize; k++) {
+				const size_t i = begin + MIN(k, n - 1);
+				for (int a = 0; a < 3; a++) {
+					res.org[a][k]		= rays.org[a][i];
+					res.invDir[a][k]	= RayData::inverse(rays.dir[a][i]);
+					res.orgInvDir[a][k]	= res.org[a][k] * res.invDir[a][k];
+				}
+				res.tMax[k] = k < n ? rays.tMax[i] : -1.0f;
+			}
+			return res;
+		}
+
+		// Tests all the rays of the packet against the box and returns the bit mask of the rays, which hit it
+		// The loop over the rays has a fixed trip count and no branches, so that it is vectorized by the compiler.
+		// The inverse directions are finite (see RayData::inverse()), thus no NaNs appear for the rays parallel to a slab
+		inline dword testPacket(const RayPacket& packet, const CBoundingBox& box)
+		{
+			const Vec3f minPoint = box.getMinPoint();
+			const Vec3f maxPoint = box.getMaxPoint();
+			if (minPoint[0] > maxPoint[0] || minPoint[1] > maxPoint[1] || minPoint[2] > maxPoint[2]) return 0;		// the slabs of an empty box enclose every ray
+			bool hit[packetSize];
+			for (size_t k = 0; k < packetSize; k++) {
+				float t0 = 0;
+				float t1 = packet.tMax[k];
+				for (int a = 0; a < 3; a++) {
+					const float ta		= minPoint[a] * packet.invDir[a][k] - packet.orgInvDir[a][k];
+					const float tb		= maxPoint[a] * packet.invDir[a][k] - packet.orgInvDir[a][k];
+					const float tNear	= ta < tb ? ta : tb;
+					const float tFar	= ta < tb ? tb : ta;
+					t0 = tNear > t0 ? tNear : t0;
+					t1 = tFar < t1 ? tFar : t1;
+				}
+				hit[k] = t0 <= t1;
+			}
+			dword res = 0;
+			for (size_t k = 0; k < packetSize; k++)
+				res |= static_cast<dword>(hit[k]) << k;
+			return res;
+		}
+
+		// Traverses the tree with the packet of rays and calls leafFunc(k, node) for every leaf node hit by the ray k
+		// The function returns true if the ray k is terminated and does not need to be traversed further
+		template <typename F>
+		void traversePacket(const std::vector<BVHNode>& vNodes, const RayPacket& packet, const Vec3f& dir, F&& leafFunc)
+		{
+			dword active = (1u << packet.n) - 1;
+			std::pair<int, dword> stack[maxStackSize];
+			size_t top = 0;
+			stack[top++] = std::make_pair(0, active);
+
+			while (top && active) {
+				auto [idx, mask] = stack[--top];
+				const BVHNode& node = vNodes[idx];
+				mask &= active;
+				if (mask) mask &= testPacket(packet, node.box);
+				if (!mask) continue;
+
+				if (node.isLeaf()) {
+					for (dword m = mask; m; m &= m - 1) {
+						const size_t k = std::countr_zero(m);
+						if (leafFunc(k, node)) active &= ~(1u << k);
+					}
+					continue;
+				}
+
+				// push the farther child first, so that the closer one is traversed first
+				if ((vNodes[node.right].box.getCenter() - vNodes[node.left].box.getCenter()).dot(dir) < 0) {
+					stack[top++] = std::make_pair(node.left, mask);
+					stack[top++] = std::make_pair(node.right, mask);
+				}
+				else {
+					stack[top++] = std::make_pair(node.right, mask);
+					stack[top++] = std::make_pair(node.left, mask);
+				}
+			}
+		}
+
+		// Header of the BVH cache file
+		struct FileHeader {
+			char	magic[8];		// File signature
+			qword	hash;			// Hash of the primitives and of the build parameters
+			qword	nNodes;			// Number of nodes
+			qword	nPrims;			// Number of primitive indices
+			float	buildCost;		// The SAH cost of the tree right after the build
+		};
+
+		// Node of the BVH as it is stored in the cache file
+		struct FileNode {
+			float	minPoint[3];
+			float	maxPoint[3];
+			int		parent;
+			int		left;
+			int		right;
+			dword	first;
+			dword	count;
+		};
+
+		// Checks that the nodes, read from a file, form a tree rooted at node 0, which traversal stays within the nodes and the traversal stack,
+		// and that the leaves reference only existing primitives. The nodes, which are not reached from the root (left by CBVHTree::remove()), are returned in vFreeNodes
+		bool isValidTree(const std::vector<BVHNode>& vNodes, const std::vector<ptr_prim_t>& vpPrims, std::vector<int>& vFreeNodes)
+		{
+			vFreeNodes.clear();
+			if (vNodes.empty()) return true;
+			const int nNodes = static_cast<int>(vNodes.size());
+			auto isValidIndex = [nNodes](int idx) { return idx == -1 || (idx >= 0 && idx < nNodes); };
+			for (const BVHNode& node : vNodes)
+				if (!isValidIndex(node.parent) || !isValidIndex(node.left) || !isValidIndex(node.right)) return false;
+			if (vNodes[0].parent != -1) return false;
+
+			// every node is reached from the root once, via the parent, which it refers to
+			std::vector<byte> vVisited(vNodes.size(), 0);
+			std::vector<std::pair<int, size_t>> stack = { std::make_pair(0, size_t(0)) };
+			vVisited[0] = 1;
+			while (!stack.empty()) {
+				auto [idx, depth] = stack.back();
+				stack.pop_back();
+				const BVHNode& node = vNodes[idx];
+				if (node.isLeaf()) {
+					if (node.right != -1) return false;
+					for (size_t i = node.first; i < node.first + node.count; i++)
+						if (!vpPrims[i]) return false;						// the traversal does not check the primitives
+					continue;
+				}
+				if (node.right < 0 || depth + 1 >= maxStackSize) return false;
+				for (int child : { node.left, node.right }) {
+					if (vVisited[child] || vNodes[child].parent != idx) return false;
+					vVisited[child] = 1;
+					stack.emplace_back(child, depth + 1);
+				}
+			}
+			for (int n = 0; n < nNodes; n++)
+				if (!vVisited[n]) vFreeNodes.push_back(n);
+			return true;
+		}
+
+		const char		fileMagic[8]	= { 'O', 'R', 'T', 'B', 'V', 'H', '0', '1' };
+		const dword		noPrim			= std::numeric_limits<dword>::max();
+
+		// Read-only memory-mapped file
+		class CMappedFile {
+		public:
+			explicit CMappedFile(const std::string& fileName)
+			{
+#ifdef _WIN32
+				m_hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (m_hFile == INVALID_HANDLE_VALUE) return;
+				LARGE_INTEGER size;
+				if (!GetFileSizeEx(m_hFile, &size) || size.QuadPart == 0) return;
+				m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (!m_hMapping) return;
+				m_pData = static_cast<const byte*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+				if (m_pData) m_size = static_cast<size_t>(size.QuadPart);
+#else
+				int fd = open(fileName.c_str(), O_RDONLY);
+				if (fd < 0) return;
+				struct stat st;
+				if (fstat(fd, &st) == 0 && st.st_size > 0) {
+					void* pData = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+					if (pData != MAP_FAILED) {
+						m_pData = static_cast<const byte*>(pData);
+						m_size = st.st_size;
+					}
+				}
+				close(fd);
+#endif
+			}
+			CMappedFile(const CMappedFile&) = delete;
+			~CMappedFile(void)
+			{
+#ifdef _WIN32
+				if (m_pData) UnmapViewOfFile(m_pData);
+				if (m_hMapping) CloseHandle(m_hMapping);
+				if (m_hFile != INVALID_HANDLE_VALUE) CloseHandle(m_hFile);
+#else
+				if (m_pData) munmap(const_cast<byte*>(m_pData), m_size);
+#endif
+			}
+			const CMappedFile& operator=(const CMappedFile&) = delete;
+
+			const byte*	data(void) const { return m_pData; }
+			size_t		size(void) const { return m_size; }
+
+		private:
+			const byte*	m_pData	= nullptr;
+			size_t		m_size	= 0;
+#ifdef _WIN32
+			HANDLE		m_hFile		= INVALID_HANDLE_VALUE;
+			HANDLE		m_hMapping	= nullptr;
+#endif
+		};
+
+		// Checks whether the bounding box is empty
+		inline bool isEmpty(const CBoundingBox& box)
+		{
+			return box.getMinPoint()[0] > box.getMaxPoint()[0];
+		}
+
+		// Extends the bounding box \b res to contain the bounding box \b box without the Epsilon margin of CBoundingBox::extend()
+		inline void merge(CBoundingBox& res, const CBoundingBox& box)
+		{
+			if (isEmpty(box)) return;
+			res.extend(box.getMinPoint());
+			res.extend(box.getMaxPoint());
+		}
+
+		// Returns the intersection of two bounding boxes
+		inline CBoundingBox intersection(const CBoundingBox& a, const CBoundingBox& b)
+		{
+			Vec3f minPoint, maxPoint;
+			for (int i = 0; i < 3; i++) {
+				minPoint[i] = MAX(a.getMinPoint()[i], b.getMinPoint()[i]);
+				maxPoint[i] = MIN(a.getMaxPoint()[i], b.getMaxPoint()[i]);
+				if (minPoint[i] > maxPoint[i]) return CBoundingBox();
+			}
+			return CBoundingBox(minPoint, maxPoint);
+		}
+
+		// Returns the index of the bin containing coordinate \b x, for nBins bins covering [minPoint; minPoint + extent]
+		inline size_t binIndex(float x, float minPoint, float extent)
+		{
+			float bin = nBins * (x - minPoint) / extent;
+			return static_cast<size_t>(MIN(MAX(bin, 0.0f), static_cast<float>(nBins - 1)));
+		}
+
+		// Candidate split of a node
+		struct Split {
+			float			cost		= Infty;	// Sum of the children's areas weighted with their primitive counts
+			int				dim			= -1;		// The splitting dimension, or -1 if no split was found
+			size_t			bin			= 0;		// Index of the first bin on the right side of the split
+			size_t			leftCount	= 0;		// Number of primitives in the left child
+			size_t			rightCount	= 0;		// Number of primitives in the right child
+			CBoundingBox	leftBox;			// Bounding box of the left child
+			CBoundingBox	rightBox;			// Bounding box of the right child
+		};
+
+		// Finds the best object split with the binned SAH among nBins - 1 candidate planes along every dimension
+		// The primitives are binned by the centroids of their boxes getBox(i), i = 0..count-1
+		template <typename F>
+		Split findObjectSplit(size_t count, const CBoundingBox& centroidBox, F getBox)
+		{
+			const Vec3f minPoint	= centroidBox.getMinPoint();
+			const Vec3f extent		= centroidBox.getMaxPoint() - minPoint;
+
+			Split res;
+			for (int dim = 0; dim < 3; dim++) {
+				if (extent[dim] <= 0) continue;
+
+				CBoundingBox	binBoxes[nBins];
+				size_t			binCounts[nBins] = { 0 };
+				for (size_t i = 0; i < count; i++) {
+					const CBoundingBox& box = getBox(i);
+					size_t bin = binIndex(box.getCenter()[dim], minPoint[dim], extent[dim]);
+					merge(binBoxes[bin], box);
+					binCounts[bin]++;
+				}
+
+				// Sweep from the right, accumulating the right-side boxes
+				CBoundingBox	rightBoxes[nBins];
+				size_t			rightCounts[nBins];
+				CBoundingBox	rightBox;
+				size_t			rightCount = 0;
+				for (size_t b = nBins - 1; b > 0; b--) {
+					merge(rightBox, binBoxes[b]);
+					rightCount += binCounts[b];
+					rightBoxes[b]	= rightBox;
+					rightCounts[b]	= rightCount;
+				}
+
+				// Sweep from the left, evaluating the cost of the plane between bins b - 1 and b
+				CBoundingBox	leftBox;
+				size_t			leftCount = 0;
+				for (size_t b = 1; b < nBins; b++) {
+					merge(leftBox, binBoxes[b - 1]);
+					leftCount += binCounts[b - 1];
+					if (leftCount == 0 || leftCount == count) continue;
+					float cost = leftCount * surfaceArea(leftBox) + rightCounts[b] * surfaceArea(rightBoxes[b]);
+					if (cost < res.cost) res = { cost, dim, b, leftCount, rightCounts[b], leftBox, rightBoxes[b] };
+				}
+			}
+			return res;
+		}
+
+		// Returns the box \b box, whose extent along dimension \b dim is limited to [minValue; maxValue]
+		inline CBoundingBox slab(const CBoundingBox& box, int dim, float minValue, float maxValue)
+		{
+			Vec3f minPoint = box.getMinPoint();
+			Vec3f maxPoint = box.getMaxPoint();
+			minPoint[dim] = MAX(minPoint[dim], minValue);
+			maxPoint[dim] = MIN(maxPoint[dim], maxValue);
+			return CBoundingBox(minPoint, maxPoint);
+		}
+
+		// Finds the best spatial split among nBins - 1 candidate planes, evenly distributed along every dimension of the node's bounding box \b box
+		// The references are clipped to the bins they overlap, thus the bins are bounded only by the parts of the primitives inside them
+		template <typename R>
+		Split findSpatialSplit(const std::vector<R>& vRefs, const CBoundingBox& box)
+		{
+			const Vec3f minPoint	= box.getMinPoint();
+			const Vec3f extent		= box.getMaxPoint() - minPoint;
+
+			Split res;
+			for (int dim = 0; dim < 3; dim++) {
+				if (extent[dim] <= 0) continue;
+				auto binPlane = [&](size_t b) { return minPoint[dim] + extent[dim] * b / nBins; };
+
+				CBoundingBox	binBoxes[nBins];
+				size_t			binEntries[nBins]	= { 0 };	// Number of references starting in the bin
+				size_t			binExits[nBins]		= { 0 };	// Number of references ending in the bin
+				for (const auto& ref : vRefs) {
+					size_t b0 = binIndex(ref.box.getMinPoint()[dim], minPoint[dim], extent[dim]);
+					size_t b1 = binIndex(ref.box.getMaxPoint()[dim], minPoint[dim], extent[dim]);
+					binEntries[b0]++;
+					binExits[b1]++;
+					if (b0 == b1) merge(binBoxes[b0], ref.box);
+					else
+						for (size_t b = b0; b <= b1; b++)
+							merge(binBoxes[b], ref.pPrim->getClippedBoundingBox(slab(ref.box, dim, binPlane(b), binPlane(b + 1))));
+				}
+
+				// Sweep from the right, accumulating the right-side boxes
+				CBoundingBox	rightBoxes[nBins];
+				size_t			rightCounts[nBins];
+				CBoundingBox	rightBox;
+				size_t			rightCount = 0;
+				for (size_t b = nBins - 1; b > 0; b--) {
+					merge(rightBox, binBoxes[b]);
+					rightCount += binExits[b];
+					rightBoxes[b]	= rightBox;
+					rightCounts[b]	= rightCount;
+				}
+
+				// Sweep from the left, evaluating the cost of the plane between bins b - 1 and b
+				CBoundingBox	leftBox;
+				size_t			leftCount = 0;
+				for (size_t b = 1; b < nBins; b++) {
+					merge(leftBox, binBoxes[b - 1]);
+					leftCount += binEntries[b - 1];
+					if (leftCount == 0 || rightCounts[b] == 0) continue;
+					float cost = leftCount * surfaceArea(leftBox) + rightCounts[b] * surfaceArea(rightBoxes[b]);
+					if (cost < res.cost) res = { cost, dim, b, leftCount, rightCounts[b], leftBox, rightBoxes[b] };
+				}
+			}
+			return res;
+		}
+
+		// Mixes the value \b value into the hash \b hash (FNV-1a step)
+		inline qword combineHash(qword hash, qword value)
+		{
+			return (hash ^ value) * 1099511628211ull;
+		}
+
+		// Calls body(begin, end) for the sub-ranges of [0; n), in parallel if parallel processing is enabled
+		template <typename F>
+		inline void parallelFor(size_t n, F&& body)
+		{
+#ifdef ENABLE_PDP
+			parallel_for_(Range(0, static_cast<int>(n)), [&](const Range& range) {
+				body(static_cast<size_t>(range.start), static_cast<size_t>(range.end));
+			});
+#else
+			body(0, n);
+#endif
+		}
+
+		// Spreads the lower 21 bits of \b v, so that there are 2 zero bits between every two bits
+		inline qword spreadBits(qword v)
+		{
+			v &= 0x1fffff;
+			v = (v | v << 32) & 0x1f00000000ffffull;
+			v = (v | v << 16) & 0x1f0000ff0000ffull;
+			v = (v | v << 8)  & 0x100f00f00f00f00full;
+			v = (v | v << 4)  & 0x10c30c30c30c30c3ull;
+			v = (v | v << 2)  & 0x1249249249249249ull;
+			return v;
+		}
+
+		// Returns the Morton code of point \b p, whose coordinates are normalized to [0; 1], with \b nBits bits per axis (nBits <= 21)
+		inline qword mortonCode(const Vec3f& p, size_t nBits)
+		{
+			const float scale = static_cast<float>((1 << nBits) - 1);
+			qword res = 0;
+			for (int i = 0; i < 3; i++) {
+				float c = MIN(MAX(p[i] * scale, 0.0f), scale);
+				res |= spreadBits(static_cast<qword>(c)) << (2 - i);
+			}
+			return res;
+		}
+
+		// Sorts the keys together with their values with the least significant digit radix sort, considering only the \b nBits lower bits of the keys
+		// Every pass computes the digit histograms of the chunks of the keys in parallel and then scatters the chunks in parallel
+		void radixSort(std::vector<qword>& vKeys, std::vector<dword>& vValues, size_t nBits)
+		{
+			const size_t	digitBits		= 8;
+			const size_t	nDigits			= 1 << digitBits;
+			const size_t	minChunkSize	= 1024;
+			const size_t	n				= vKeys.size();
+#ifdef ENABLE_PDP
+			const size_t	nChunks			= MAX(1, MIN(static_cast<size_t>(getNumThreads()), n / minChunkSize));
+#else
+			const size_t	nChunks			= 1;
+#endif
+			std::vector<qword>	vTmpKeys(n);
+			std::vector<dword>	vTmpValues(n);
+			std::vector<size_t>	vOffsets(nChunks * nDigits);
+			for (size_t shift = 0; shift < nBits; shift += digitBits) {
+				// Histograms of the digits in every chunk
+				std::fill(vOffsets.begin(), vOffsets.end(), 0);
+				parallelFor(nChunks, [&](size_t c0, size_t c1) {
+					for (size_t c = c0; c < c1; c++) {
+						size_t* pHist = vOffsets.data() + c * nDigits;
+						for (size_t i = n * c / nChunks; i < n * (c + 1) / nChunks; i++)
+							pHist[(vKeys[i] >> shift) & (nDigits - 1)]++;
+					}
+				});
+
+				// Exclusive prefix sum in the digit-major order, which keeps the sort stable
+				size_t sum = 0;
+				for (size_t d = 0; d < nDigits; d++)
+					for (size_t c = 0; c < nChunks; c++) {
+						size_t count = vOffsets[c * nDigits + d];
+						vOffsets[c * nDigits + d] = sum;
+						sum += count;
+					}
+
+				// Scatter
+				parallelFor(nChunks, [&](size_t c0, size_t c1) {
+					for (size_t c = c0; c < c1; c++) {
+						size_t* pOffsets = vOffsets.data() + c * nDigits;
+						for (size_t i = n * c / nChunks; i < n * (c + 1) / nChunks; i++) {
+							size_t dst = pOffsets[(vKeys[i] >> shift) & (nDigits - 1)]++;
+							vTmpKeys[dst]	= vKeys[i];
+							vTmpValues[dst]	= vValues[i];
+						}
+					}
+				});
+				vKeys.swap(vTmpKeys);
+				vValues.swap(vTmpValues);
+			}
+		}
+
+		// Internal node of the binary radix tree. The children are encoded as indices of the internal nodes, or as ~index of the leaves
+		struct RadixNode {
+			int		left;
+			int		right;
+			dword	first;			// The first sorted primitive covered by the node
+			dword	last;			// The last sorted primitive covered by the node
+		};
+	}
+
+	struct CBVHTree::PrimRef {
+		ptr_prim_t		pPrim;		///< Pointer to the primitive
+		CBoundingBox	box;		///< Bounds of the part of the primitive inside the node
+	};
+
+	void CBVHTree::build(const std::vector<ptr_prim_t>& vpPrims, size_t maxDepth, size_t minPrimitives)
+	{
+		RT_IF_WARNING(maxDepth >= maxStackSize, "The maximum depth of the BVH (%zu) is limited to %zu", maxDepth, maxStackSize - 1);
+		m_maxDepth		= MIN(maxDepth, maxStackSize - 1);
+		m_minPrimitives	= MAX(minPrimitives, 1);
+		m_vpPrims		= vpPrims;
+
+		m_vPrimBoxes.clear();
+		m_vPrimBoxes.reserve(m_vpPrims.size());
+		for (const auto& pPrim : m_vpPrims)
+			m_vPrimBoxes.push_back(pPrim->getBoundingBox());
+
+		m_vNodes.clear();
+		m_vFreeNodes.clear();
+		m_vNodes.reserve(2 * m_vpPrims.size());
+		m_vNodes.emplace_back();
+		m_vNodes[0].count = m_vpPrims.size();
+		switch (m_builder) {
+			case BVHBuilder::SAH:	build(0, 0); break;
+			case BVHBuilder::LBVH:	buildLBVH(); break;
+			case BVHBuilder::SBVH: {
+				std::vector<PrimRef> vRefs(m_vpPrims.size());
+				for (size_t i = 0; i < m_vpPrims.size(); i++)
+					vRefs[i] = { m_vpPrims[i], m_vPrimBoxes[i] };
+				m_nSpareRefs = static_cast<size_t>(maxDuplication * m_vpPrims.size());
+				m_vpPrims.clear();
+				buildSBVH(0, vRefs, 0);
+				break;
+			}
+		}
+		m_vPrimBoxes.clear();
+
+		m_buildCost = calcSAHCost();
+#ifdef DEBUG_PRINT_INFO
+		std::cout << "BVH: " << m_vNodes.size() << " nodes, SAH cost: " << m_buildCost << std::endl;
+#endif
+	}
+
+	bool CBVHTree::intersect(Ray& ray) const
+	{
+		if (m_vNodes.empty()) return false;
+
+		const RayData r(ray);
+		std::pair<int, double> stack[maxStackSize];
+		size_t top = 0;
+		stack[top++] = std::make_pair(0, 0.0);
+
+		bool hit = false;
+		while (top) {
+			auto [idx, tEntry] = stack[--top];
+			if (tEntry > ray.t) continue;		// a closer intersection has been found meanwhile
+
+			const BVHNode& node = m_vNodes[idx];
+			if (idx == 0) {
+				double t0 = 0;
+				double t1 = ray.t;
+				node.box.clip(r, t0, t1);
+				if (t1 < t0) continue;
+			}
+
+			if (node.isLeaf()) {
+				for (size_t i = node.first; i < node.first + node.count; i++)
+					hit |= m_vpPrims[i]->intersect(ray);
+				continue;
+			}
+
+			double tl0 = 0, tl1 = ray.t;
+			double tr0 = 0, tr1 = ray.t;
+			m_vNodes[node.left].box.clip(r, tl0, tl1);
+			m_vNodes[node.right].box.clip(r, tr0, tr1);
+			bool ifLeft		= tl0 <= tl1;
+			bool ifRight	= tr0 <= tr1;
+			// push the farther child first, so that the closer one is traversed first
+			if (ifLeft && ifRight) {
+				if (tl0 < tr0) {
+					stack[top++] = std::make_pair(node.right, tr0);
+					stack[top++] = std::make_pair(node.left, tl0);
+				}
+				else {
+					stack[top++] = std::make_pair(node.left, tl0);
+					stack[top++] = std::make_pair(node.right, tr0);
+				}
+			}
+			else if (ifLeft)	stack[top++] = std::make_pair(node.left, tl0);
+			else if (ifRight)	stack[top++] = std::make_pair(node.right, tr0);
+		}
+		return hit;
+	}
+
+	const ptr_prim_t* CBVHTree::findOccluder(const Ray& ray) const
+	{
+		if (m_vNodes.empty()) return nullptr;
+
+		const RayData r(ray);
+		int stack[maxStackSize];
+		size_t top = 0;
+		stack[top++] = 0;
+
+		while (top) {
+			const BVHNode& node = m_vNodes[stack[--top]];
+			double t0 = 0;
+			double t1 = ray.t;
+			node.box.clip(r, t0, t1);
+			if (t1 < t0) continue;
+
+			if (node.isLeaf()) {
+				for (size_t i = node.first; i < node.first + node.count; i++)
+					if (m_vpPrims[i]->if_intersect(ray)) return &m_vpPrims[i];
+			}
+			else {
+				stack[top++] = node.right;
+				stack[top++] = node.left;
+			}
+		}
+		return nullptr;
+	}
+
+	void CBVHTree::intersect(const RayBatch& rays, size_t begin, size_t end, RayHit* pHits) const
+	{
+		for (size_t p = begin; p < end; p += packetSize) {
+			const size_t n = MIN(packetSize, end - p);
+			RayPacket packet = getPacket(rays, p, n);
+			Ray vRays[packetSize];
+			for (size_t k = 0; k < n; k++)
+				vRays[k] = rays.getRay(p + k);
+
+			if (!m_vNodes.empty())
+				traversePacket(m_vNodes, packet, vRays[0].dir, [&](size_t k, const BVHNode& node) {
+					for (size_t i = node.first; i < node.first + node.count; i++)
+						m_vpPrims[i]->intersect(vRays[k]);
+					packet.tMax[k] = static_cast<float>(vRays[k].t);
+					return false;
+				});
+
+			for (size_t k = 0; k < n; k++) {
+				const Ray& ray = vRays[k];
+				if (ray.hit)	pHits[p - begin + k] = { ray.t, ray.hit, ray.instHit, ray.b1, ray.b2 };
+				else			pHits[p - begin + k] = { std::numeric_limits<double>::infinity(), nullptr, nullptr, 0, 0 };
+			}
+		}
+	}
+
+	void CBVHTree::if_intersect(const RayBatch& rays, size_t begin, size_t end, byte* pOccluded) const
+	{
+		for (size_t p = begin; p < end; p += packetSize) {
+			const size_t n = MIN(packetSize, end - p);
+			const RayPacket packet = getPacket(rays, p, n);
+			Ray vRays[packetSize];
+			for (size_t k = 0; k < n; k++) {
+				vRays[k] = rays.getRay(p + k);
+				pOccluded[p - begin + k] = 0;
+			}
+
+			if (!m_vNodes.empty())
+				traversePacket(m_vNodes, packet, vRays[0].dir, [&](size_t k, const BVHNode& node) {
+					for (size_t i = node.first; i < node.first + node.count; i++)
+						if (m_vpPrims[i]->if_intersect(vRays[k])) {
+							pOccluded[p - begin + k] = 1;
+							return true;
+						}
+					return false;
+				});
+		}
+	}
+
+	std::vector<RayHit> CBVHTree::intersectAll(const Ray& ray) const
+	{
+		std::vector<RayHit> res;
+		if (m_vNodes.empty()) return res;
+
+		const RayData r(ray);
+		int stack[maxStackSize];
+		size_t top = 0;
+		stack[top++] = 0;
+
+		while (top) {
+			const BVHNode& node = m_vNodes[stack[--top]];
+			double t0 = 0;
+			double t1 = ray.t;
+			node.box.clip(r, t0, t1);
+			if (t1 < t0) continue;
+
+			if (node.isLeaf()) {
+				for (size_t i = node.first; i < node.first + node.count; i++)
+					m_vpPrims[i]->intersectAll(ray, res);
+			}
+			else {
+				stack[top++] = node.right;
+				stack[top++] = node.left;
+			}
+		}
+
+		std::sort(res.begin(), res.end(), [](const RayHit& a, const RayHit& b) { return a.t < b.t || (a.t == b.t && a.hit < b.hit); });
+		if (m_builder == BVHBuilder::SBVH)			// a primitive referenced by several leaves is reported several times
+			res.erase(std::unique(res.begin(), res.end(), [](const RayHit& a, const RayHit& b) { return a.t == b.t && a.hit == b.hit; }), res.end());
+		return res;
+	}
+
+	bool CBVHTree::insert(const ptr_prim_t pPrim)
+	{
+		if (m_vNodes.empty()) m_vNodes.emplace_back();
+
+		// Leaf node for the new primitive
+		CBoundingBox box;
+		box.extend(pPrim->getBoundingBox());
+		if (m_vNodes[0].isLeaf() && m_vNodes[0].count == 0) {			// empty tree: the root node becomes the new leaf
+			m_vNodes[0].first	= m_vpPrims.size();
+			m_vNodes[0].count	= 1;
+			m_vNodes[0].box		= box;
+			m_vpPrims.push_back(pPrim);
+			return true;
+		}
+
+		// Descend to the leaf, whose bounding box grows least of all
+		int		sibling	= 0;
+		size_t	depth	= 0;
+		while (!m_vNodes[sibling].isLeaf()) {
+			const BVHNode& node = m_vNodes[sibling];
+			CBoundingBox lBox = m_vNodes[node.left].box;
+			CBoundingBox rBox = m_vNodes[node.right].box;
+			float lArea = surfaceArea(lBox);
+			float rArea = surfaceArea(rBox);
+			merge(lBox, box);
+			merge(rBox, box);
+			sibling = surfaceArea(lBox) - lArea <= surfaceArea(rBox) - rArea ? node.left : node.right;
+			depth++;
+		}
+		if (depth + 1 >= maxStackSize) return false;
+
+		int leaf = allocateNode();
+		m_vNodes[leaf].first	= m_vpPrims.size();
+		m_vNodes[leaf].count	= 1;
+		m_vNodes[leaf].box		= box;
+		m_vpPrims.push_back(pPrim);
+
+		// New branch node takes the place of the sibling
+		int parent;
+		if (sibling == 0) {												// the root node has to keep index 0
+			sibling = allocateNode();
+			m_vNodes[sibling] = m_vNodes[0];
+			parent = 0;
+		}
+		else {
+			parent = allocateNode();
+			int grandParent = m_vNodes[sibling].parent;
+			m_vNodes[parent].parent = grandParent;
+			if (m_vNodes[grandParent].left == sibling)	m_vNodes[grandParent].left	= parent;
+			else										m_vNodes[grandParent].right	= parent;
+		}
+		m_vNodes[parent].left	= sibling;
+		m_vNodes[parent].right	= leaf;
+		m_vNodes[parent].first	= 0;
+		m_vNodes[parent].count	= 0;
+		m_vNodes[sibling].parent = parent;
+		m_vNodes[leaf].parent	= parent;
+
+		refitAncestors(parent);
+		return true;
+	}
+
+	bool CBVHTree::remove(const ptr_prim_t pPrim)
+	{
+		if (m_builder != BVHBuilder::SBVH) return removeReference(pPrim);
+
+		// The primitive may be referenced by several leaf nodes
+		bool res = false;
+		while (removeReference(pPrim)) res = true;
+		return res;
+	}
+
+	bool CBVHTree::refit(void)
+	{
+		if (!m_vNodes.empty()) refit(0);
+		return true;
+	}
+
+	bool CBVHTree::save(const std::string& fileName, const std::vector<ptr_prim_t>& vpPrims, qword hash) const
+	{
+		std::ofstream file(fileName, std::ios::binary);
+		if (!file.is_open()) {
+			RT_WARNING("Can't open file %s for writing", fileName.c_str());
+			return false;
+		}
+
+		FileHeader header;
+		std::copy(fileMagic, fileMagic + 8, header.magic);
+		header.hash			= combineHash(hash, static_cast<qword>(m_builder));
+		header.nNodes		= m_vNodes.size();
+		header.nPrims		= m_vpPrims.size();
+		header.buildCost	= m_buildCost;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		for (const auto& node : m_vNodes) {
+			FileNode fileNode;
+			for (int i = 0; i < 3; i++) {
+				fileNode.minPoint[i] = node.box.getMinPoint()[i];
+				fileNode.maxPoint[i] = node.box.getMaxPoint()[i];
+			}
+			fileNode.parent	= node.parent;
+			fileNode.left	= node.left;
+			fileNode.right	= node.right;
+			fileNode.first	= static_cast<dword>(node.first);
+			fileNode.count	= static_cast<dword>(node.count);
+			file.write(reinterpret_cast<const char*>(&fileNode), sizeof(fileNode));
+		}
+
+		// Indices of the primitives in vpPrims
+		std::unordered_map<const CPrim*, dword> mIndices;
+		mIndices.reserve(vpPrims.size());
+		for (size_t i = 0; i < vpPrims.size(); i++)
+			mIndices[vpPrims[i].get()] = static_cast<dword>(i);
+		std::vector<dword> vIndices(m_vpPrims.size(), noPrim);
+		for (size_t i = 0; i < m_vpPrims.size(); i++) {
+			if (!m_vpPrims[i]) continue;
+			auto it = mIndices.find(m_vpPrims[i].get());
+			RT_ASSERT_MSG(it != mIndices.end(), "The primitive of the BVH is not found in the given vector");
+			vIndices[i] = it->second;
+		}
+		file.write(reinterpret_cast<const char*>(vIndices.data()), vIndices.size() * sizeof(dword));
+		return file.good();
+	}
+
+	bool CBVHTree::load(const std::string& fileName, const std::vector<ptr_prim_t>& vpPrims, qword hash)
+	{
+		CMappedFile file(fileName);
+		if (file.size() < sizeof(FileHeader)) return false;
+
+		FileHeader header;
+		std::memcpy(&header, file.data(), sizeof(header));
+		if (!std::equal(fileMagic, fileMagic + 8, header.magic) || header.hash != combineHash(hash, static_cast<qword>(m_builder))) return false;
+		if (file.size() != sizeof(FileHeader) + header.nNodes * sizeof(FileNode) + header.nPrims * sizeof(dword)) return false;
+
+		// Primitives
+		const byte* pIndices = file.data() + sizeof(FileHeader) + header.nNodes * sizeof(FileNode);
+		std::vector<ptr_prim_t> vpTreePrims(header.nPrims);
+		for (size_t i = 0; i < header.nPrims; i++) {
+			dword idx;
+			std::memcpy(&idx, pIndices + i * sizeof(dword), sizeof(dword));
+			if (idx == noPrim) continue;
+			if (idx >= vpPrims.size()) return false;
+			vpTreePrims[i] = vpPrims[idx];
+		}
+
+		// Nodes
+		const byte* pNodes = file.data() + sizeof(FileHeader);
+		std::vector<BVHNode> vNodes(header.nNodes);
+		for (size_t n = 0; n < header.nNodes; n++) {
+			FileNode fileNode;
+			std::memcpy(&fileNode, pNodes + n * sizeof(FileNode), sizeof(FileNode));
+			vNodes[n].box		= CBoundingBox(Vec3f(fileNode.minPoint), Vec3f(fileNode.maxPoint));
+			vNodes[n].parent	= fileNode.parent;
+			vNodes[n].left		= fileNode.left;
+			vNodes[n].right		= fileNode.right;
+			vNodes[n].first		= fileNode.first;
+			vNodes[n].count		= fileNode.count;
+			if (vNodes[n].first + vNodes[n].count > header.nPrims) return false;
+		}
+		std::vector<int> vFreeNodes;
+		if (!isValidTree(vNodes, vpTreePrims, vFreeNodes)) return false;
+
+		m_vNodes		= std::move(vNodes);
+		m_vpPrims		= std::move(vpTreePrims);
+		m_vFreeNodes	= std::move(vFreeNodes);
+		m_buildCost	= header.buildCost;
+		return true;
+	}
+
+	std::vector<int> CBVHTree::collapse(int node, size_t maxChildren) const
+	{
+		if (m_vNodes[node].isLeaf()) return { node };
+
+		std::vector<int> res = { m_vNodes[node].left, m_vNodes[node].right };
+		while (res.size() < maxChildren) {
+			int		best		= -1;
+			float	bestArea	= -1;
+			for (size_t c = 0; c < res.size(); c++) {
+				const BVHNode& child = m_vNodes[res[c]];
+				if (!child.isLeaf() && surfaceArea(child.box) > bestArea) {
+					best		= static_cast<int>(c);
+					bestArea	= surfaceArea(child.box);
+				}
+			}
+			if (best < 0) break;
+			const BVHNode& child = m_vNodes[res[best]];
+			res[best] = child.left;
+			res.push_back(child.right);
+		}
+		return res;
+	}
+
+	// ---------------------- private ----------------------
+	void CBVHTree::build(int node, size_t depth)
+	{
+		const size_t first = m_vNodes[node].first;
+		const size_t count = m_vNodes[node].count;
+
+		// Bounds of the primitives and of their centroids
+		CBoundingBox box;
+		CBoundingBox centroidBox;
+		for (size_t i = first; i < first + count; i++) {
+			box.extend(m_vPrimBoxes[i]);
+			centroidBox.extend(m_vPrimBoxes[i].getCenter());
+		}
+		m_vNodes[node].box = box;
+
+		// Check for stopping criteria
+		if (depth >= m_maxDepth || count <= m_minPrimitives) return;		// => Leaf node
+
+		Split split = findObjectSplit(count, centroidBox, [&](size_t i) -> const CBoundingBox& { return m_vPrimBoxes[first + i]; });
+		if (split.dim < 0) return;											// => All centroids coincide: leaf node
+
+		// Partition the primitives
+		const float minPoint	= centroidBox.getMinPoint()[split.dim];
+		const float extent		= centroidBox.getMaxPoint()[split.dim] - minPoint;
+		size_t mid = first;
+		for (size_t i = first; i < first + count; i++)
+			if (binIndex(m_vPrimBoxes[i].getCenter()[split.dim], minPoint, extent) < split.bin) {
+				std::swap(m_vpPrims[i], m_vpPrims[mid]);
+				std::swap(m_vPrimBoxes[i], m_vPrimBoxes[mid]);
+				mid++;
+			}
+
+		// Create the children
+		int left	= static_cast<int>(m_vNodes.size());
+		int right	= left + 1;
+		m_vNodes.resize(m_vNodes.size() + 2);
+		m_vNodes[left].parent	= node;
+		m_vNodes[left].first	= first;
+		m_vNodes[left].count	= mid - first;
+		m_vNodes[right].parent	= node;
+		m_vNodes[right].first	= mid;
+		m_vNodes[right].count	= first + count - mid;
+		m_vNodes[node].left		= left;
+		m_vNodes[node].right	= right;
+		m_vNodes[node].count	= 0;
+
+		// Next build recursively 2 subtrees
+		build(left, depth + 1);
+		build(right, depth + 1);
+	}
+
+	void CBVHTree::buildLBVH(void)
+	{
+		const size_t n = m_vpPrims.size();
+		if (n == 0) return;
+
+		// Morton codes of the centroids
+		CBoundingBox centroidBox;
+		for (const auto& box : m_vPrimBoxes)
+			centroidBox.extend(box.getCenter());
+		const Vec3f		minPoint	= centroidBox.getMinPoint();
+		const Vec3f		extent		= centroidBox.getMaxPoint() - minPoint;
+		const size_t	nBits		= n <= (1 << 16) ? 10 : 21;		// 30-bit codes need 4 passes of the radix sort, 63-bit codes - 8 passes
+		std::vector<qword> vCodes(n);
+		std::vector<dword> vIndices(n);
+		parallelFor(n, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				Vec3f p = m_vPrimBoxes[i].getCenter() - minPoint;
+				for (int d = 0; d < 3; d++)
+					p[d] = extent[d] > 0 ? p[d] / extent[d] : 0.5f;
+				vCodes[i]	= mortonCode(p, nBits);
+				vIndices[i]	= static_cast<dword>(i);
+			}
+		});
+		radixSort(vCodes, vIndices, 3 * nBits);
+
+		std::vector<ptr_prim_t>		vpPrims(n);
+		std::vector<CBoundingBox>	vPrimBoxes(n);
+		for (size_t i = 0; i < n; i++) {
+			vpPrims[i]		= m_vpPrims[vIndices[i]];
+			vPrimBoxes[i]	= m_vPrimBoxes[vIndices[i]];
+		}
+		m_vpPrims.swap(vpPrims);
+		m_vPrimBoxes.swap(vPrimBoxes);
+
+		// Binary radix tree: the internal nodes are independent of each other and are built in parallel
+		// delta(i, j) is the length of the common prefix of the codes i and j; duplicate codes are disambiguated by their indices
+		const int nPrims = static_cast<int>(n);
+		auto delta = [&](int i, int j) {
+			if (j < 0 || j >= nPrims) return -1;
+			if (vCodes[i] != vCodes[j]) return std::countl_zero(vCodes[i] ^ vCodes[j]);
+			return 64 + std::countl_zero(static_cast<dword>(i ^ j));
+		};
+		std::vector<RadixNode> vRadixNodes(n - 1);
+		parallelFor(n - 1, [&](size_t begin, size_t end) {
+			for (int i = static_cast<int>(begin); i < static_cast<int>(end); i++) {
+				// Direction of the range
+				const int d			= delta(i, i + 1) > delta(i, i - 1) ? 1 : -1;
+				const int deltaMin	= delta(i, i - d);
+
+				// Upper bound for the length of the range and then the other end with binary search
+				int lMax = 2;
+				while (delta(i, i + lMax * d) > deltaMin) lMax *= 2;
+				int l = 0;
+				for (int t = lMax / 2; t >= 1; t /= 2)
+					if (delta(i, i + (l + t) * d) > deltaMin) l += t;
+				const int j = i + l * d;
+
+				// Split position with binary search
+				const int deltaNode = delta(i, j);
+				int s = 0;
+				for (int t = (l + 1) / 2; ; t = (t + 1) / 2) {
+					if (delta(i, i + (s + t) * d) > deltaNode) s += t;
+					if (t == 1) break;
+				}
+				const int gamma = i + s * d + MIN(d, 0);
+
+				RadixNode& node = vRadixNodes[i];
+				node.first	= static_cast<dword>(MIN(i, j));
+				node.last	= static_cast<dword>(MAX(i, j));
+				node.left	= static_cast<int>(node.first) == gamma ? ~gamma : gamma;
+				node.right	= static_cast<int>(node.last) == gamma + 1 ? ~(gamma + 1) : gamma + 1;
+			}
+		});
+
+		// Conversion into the BVH nodes: the small and the too deep subtrees are collapsed into leaf nodes
+		// Every node is emitted after its parent, thus the bounding boxes may be computed in the reverse order
+		struct Item {
+			int		radix;		// Index of the internal node of the radix tree, or ~index of its leaf
+			int		node;		// Index of the BVH node
+			size_t	depth;		// The distance from the root node
+		};
+		std::vector<Item> vStack;
+		vStack.push_back({ n > 1 ? 0 : ~0, 0, 0 });
+		while (!vStack.empty()) {
+			Item item = vStack.back();
+			vStack.pop_back();
+
+			const bool	isRadixLeaf = item.radix < 0;
+			const dword	first		= isRadixLeaf ? ~item.radix : vRadixNodes[item.radix].first;
+			const dword	last		= isRadixLeaf ? ~item.radix : vRadixNodes[item.radix].last;
+			m_vNodes[item.node].first = first;
+			m_vNodes[item.node].count = last - first + 1;
+			if (isRadixLeaf || m_vNodes[item.node].count <= m_minPrimitives || item.depth >= m_maxDepth) continue;	// => Leaf node
+
+			int left	= static_cast<int>(m_vNodes.size());
+			int right	= left + 1;
+			m_vNodes.resize(m_vNodes.size() + 2);
+			m_vNodes[left].parent	= item.node;
+			m_vNodes[right].parent	= item.node;
+			m_vNodes[item.node].left	= left;
+			m_vNodes[item.node].right	= right;
+			m_vNodes[item.node].first	= 0;
+			m_vNodes[item.node].count	= 0;
+			vStack.push_back({ vRadixNodes[item.radix].right, right, item.depth + 1 });
+			vStack.push_back({ vRadixNodes[item.radix].left, left, item.depth + 1 });
+		}
+
+		for (size_t i = m_vNodes.size(); i-- > 0; ) {
+			BVHNode& node = m_vNodes[i];
+			if (node.isLeaf()) {
+				for (size_t p = node.first; p < node.first + node.count; p++)
+					node.box.extend(m_vPrimBoxes[p]);
+			}
+			else {
+				merge(node.box, m_vNodes[node.left].box);
+				merge(node.box, m_vNodes[node.right].box);
+			}
+		}
+	}
+
+	void CBVHTree::buildSBVH(int node, std::vector<PrimRef>& vRefs, size_t depth)
+	{
+		const size_t count = vRefs.size();
+
+		// Bounds of the references and of their centroids
+		CBoundingBox box;
+		CBoundingBox centroidBox;
+		for (const auto& ref : vRefs) {
+			box.extend(ref.box);
+			centroidBox.extend(ref.box.getCenter());
+		}
+		m_vNodes[node].box = box;
+
+		std::vector<PrimRef> vLeftRefs, vRightRefs;
+		if (depth < m_maxDepth && count > m_minPrimitives) {
+			Split split = findObjectSplit(count, centroidBox, [&](size_t i) -> const CBoundingBox& { return vRefs[i].box; });
+
+			// Spatial split is worth searching for only if the children of the object split overlap
+			Split spatialSplit;
+			if (m_nSpareRefs > 0 && (split.dim < 0 || surfaceArea(intersection(split.leftBox, split.rightBox)) > minOverlap * surfaceArea(m_vNodes[0].box)))
+				spatialSplit = findSpatialSplit(vRefs, box);
+
+			if (spatialSplit.cost < split.cost && spatialSplit.leftCount + spatialSplit.rightCount - count <= m_nSpareRefs) {
+				// Partition the references: the straddling ones are clipped and go to both children
+				const int	dim		= spatialSplit.dim;
+				const float	plane	= box.getMinPoint()[dim] + (box.getMaxPoint()[dim] - box.getMinPoint()[dim]) * spatialSplit.bin / nBins;
+				for (const auto& ref : vRefs) {
+					if (ref.box.getMaxPoint()[dim] <= plane)		vLeftRefs.push_back(ref);
+					else if (ref.box.getMinPoint()[dim] >= plane)	vRightRefs.push_back(ref);
+					else {
+						CBoundingBox leftBox	= ref.pPrim->getClippedBoundingBox(slab(ref.box, dim, -Infty, plane));
+						CBoundingBox rightBox	= ref.pPrim->getClippedBoundingBox(slab(ref.box, dim, plane, Infty));
+						if (!isEmpty(leftBox))	vLeftRefs.push_back({ ref.pPrim, leftBox });
+						if (!isEmpty(rightBox))	vRightRefs.push_back({ ref.pPrim, rightBox });
+					}
+				}
+				if (vLeftRefs.empty() || vRightRefs.empty()) {				// clipping has not separated the references: fall back to the object split
+					vLeftRefs.clear();
+					vRightRefs.clear();
+				}
+				else
+					m_nSpareRefs -= MIN(m_nSpareRefs, vLeftRefs.size() + vRightRefs.size() - count);
+			}
+
+			if (vLeftRefs.empty() && split.dim >= 0) {
+				const float minPoint	= centroidBox.getMinPoint()[split.dim];
+				const float extent		= centroidBox.getMaxPoint()[split.dim] - minPoint;
+				for (const auto& ref : vRefs)
+					if (binIndex(ref.box.getCenter()[split.dim], minPoint, extent) < split.bin)	vLeftRefs.push_back(ref);
+					else																		vRightRefs.push_back(ref);
+			}
+		}
+
+		if (vLeftRefs.empty()) {												// => Leaf node
+			m_vNodes[node].first = m_vpPrims.size();
+			m_vNodes[node].count = count;
+			for (const auto& ref : vRefs)
+				m_vpPrims.push_back(ref.pPrim);
+			return;
+		}
+		std::vector<PrimRef>().swap(vRefs);
+
+		// Create the children
+		int left	= static_cast<int>(m_vNodes.size());
+		int right	= left + 1;
+		m_vNodes.resize(m_vNodes.size() + 2);
+		m_vNodes[left].parent	= node;
+		m_vNodes[right].parent	= node;
+		m_vNodes[node].left		= left;
+		m_vNodes[node].right	= right;
+		m_vNodes[node].count	= 0;
+
+		// Next build recursively 2 subtrees
+		buildSBVH(left, vLeftRefs, depth + 1);
+		buildSBVH(right, vRightRefs, depth + 1);
+	}
+
+	bool CBVHTree::removeReference(const ptr_prim_t pPrim)
+	{
+		if (m_vNodes.empty()) return false;
+
+		// Find the leaf node containing the primitive
+		const CBoundingBox box = pPrim->getBoundingBox();
+		int		stack[maxStackSize];
+		size_t	top = 0;
+		stack[top++] = 0;
+		int		leaf = -1;
+		size_t	idx = 0;
+		while (top && leaf < 0) {
+			int n = stack[--top];
+			const BVHNode& node = m_vNodes[n];
+			if (!node.box.overlaps(box)) continue;
+			if (node.isLeaf()) {
+				for (size_t i = node.first; i < node.first + node.count; i++)
+					if (m_vpPrims[i] == pPrim) {
+						leaf	= n;
+						idx		= i;
+						break;
+					}
+			}
+			else {
+				stack[top++] = node.right;
+				stack[top++] = node.left;
+			}
+		}
+		if (leaf < 0) return false;
+
+		// Remove the primitive from the leaf node
+		size_t last = m_vNodes[leaf].first + m_vNodes[leaf].count - 1;
+		std::swap(m_vpPrims[idx], m_vpPrims[last]);
+		m_vpPrims[last] = nullptr;
+		if (--m_vNodes[leaf].count > 0 || leaf == 0) {
+			refitAncestors(leaf);
+			return true;
+		}
+
+		// Remove the empty leaf node: its sibling takes the place of their parent
+		int parent	= m_vNodes[leaf].parent;
+		int sibling	= m_vNodes[parent].left == leaf ? m_vNodes[parent].right : m_vNodes[parent].left;
+		m_vFreeNodes.push_back(leaf);
+		if (parent == 0) {												// the root node has to keep index 0
+			m_vNodes[0] = m_vNodes[sibling];
+			m_vNodes[0].parent = -1;
+			if (!m_vNodes[0].isLeaf()) {
+				m_vNodes[m_vNodes[0].left].parent	= 0;
+				m_vNodes[m_vNodes[0].right].parent	= 0;
+			}
+			m_vFreeNodes.push_back(sibling);
+		}
+		else {
+			int grandParent = m_vNodes[parent].parent;
+			if (m_vNodes[grandParent].left == parent)	m_vNodes[grandParent].left	= sibling;
+			else										m_vNodes[grandParent].right	= sibling;
+			m_vNodes[sibling].parent = grandParent;
+			m_vFreeNodes.push_back(parent);
+			refitAncestors(grandParent);
+		}
+		return true;
+	}
+
+	void CBVHTree::refit(int node)
+	{
+		BVHNode& n = m_vNodes[node];
+		n.box = CBoundingBox();
+		if (n.isLeaf()) {
+			for (size_t i = n.first; i < n.first + n.count; i++)
+				n.box.extend(m_vpPrims[i]->getBoundingBox());
+		}
+		else {
+			refit(n.left);
+			refit(n.right);
+			merge(n.box, m_vNodes[n.left].box);
+			merge(n.box, m_vNodes[n.right].box);
+		}
+	}
+
+	void CBVHTree::refitAncestors(int node)
+	{
+		for (; node >= 0; node = m_vNodes[node].parent) {
+			BVHNode& n = m_vNodes[node];
+			n.box = CBoundingBox();
+			if (n.isLeaf()) {
+				for (size_t i = n.first; i < n.first + n.count; i++)
+					n.box.extend(m_vpPrims[i]->getBoundingBox());
+			}
+			else {
+				merge(n.box, m_vNodes[n.left].box);
+				merge(n.box, m_vNodes[n.right].box);
+			}
+		}
+	}
+
+	int CBVHTree::allocateNode(void)
+	{
+		if (m_vFreeNodes.empty()) {
+			m_vNodes.emplace_back();
+			return static_cast<int>(m_vNodes.size()) - 1;
+		}
+		int res = m_vFreeNodes.back();
+		m_vFreeNodes.pop_back();
+		m_vNodes[res] = BVHNode();
+		return res;
+	}
+
+	float CBVHTree::calcSAHCost(void) const
+	{
+		if (m_vNodes.empty()) return 0;
+		float rootArea = surfaceArea(m_vNodes[0].box);
+		if (rootArea <= 0) return 0;
+
+		float res = 0;
+		int stack[maxStackSize];
+		size_t top = 0;
+		stack[top++] = 0;
+		while (top) {
+			const BVHNode& node = m_vNodes[stack[--top]];
+			float p = surfaceArea(node.box) / rootArea;				// probability of a ray hitting the root node to hit this node
+			if (node.isLeaf())
+				res += p * intersectionCost * node.count;
+			else {
+				res += p * traversalCost;
+				stack[top++] = node.left;
+				stack[top++] = node.right;
+			}
+		}
+		return res;
+	}
+}
@@ -0,0 +1,229 @@
+// Bounding Volume Hierarchy (BVH) class
+#pragma once
+
+#include "IAccelStructure.h"
+#include "BoundingBox.h"
+
+namespace rt {
+	struct RayHit;
+
+	/// Algorithms for building the BVH tree
+	enum class BVHBuilder {
+		SAH,			///< Top-down build with the binned Surface Area Heuristic: slower build, faster traversal
+		LBVH,			///< Linear BVH: primitives are sorted along the Morton curve and the hierarchy is emitted from the sorted codes. Very fast (re-)builds
+		SBVH			///< Spatial split BVH: chooses between the object splits and the spatial splits, which clip the straddling primitives. Slowest build, fastest traversal
+	};
+
+	// ================================ BVH Node Structure ================================
+	/**
+	 * @brief Bounding Volume Hierarchy (BVH) node structure
+	 * @details The nodes are stored in a flat array and refer to each other by indices
+	 */
+	struct BVHNode
+	{
+		CBoundingBox	box;				///< The bounding box of the node
+		int				parent	= -1;		///< Index of the parent node (-1 for the root node)
+		int				left	= -1;		///< Index of the left child node (-1 for leaf nodes)
+		int				right	= -1;		///< Index of the right child node (-1 for leaf nodes)
+		size_t			first	= 0;		///< Index of the first primitive of a leaf node
+		size_t			count	= 0;		///< Number of primitives in a leaf node
+
+		/**
+		 * @brief Checks whether the node is either leaf or branch node
+		 * @retval true if the node is the leaf-node
+		 * @retval false if the node is a branch-node
+		 */
+		bool isLeaf(void) const { return left < 0; }
+	};
+
+	// ================================ BVH Tree Class ================================
+	/**
+	 * @brief Bounding Volume Hierarchy (BVH) class
+	 * @details In contrast to the @ref CBSPTree, every primitive is referenced by exactly one leaf of the BVH.
+	 * Thus, when the primitives move, the tree may be refitted by recomputing the node bounds bottom-up instead of being re-built.
+	 * The tree is built with the binned Surface Area Heuristic (SAH), which also serves as the quality metric: the ratio of the current SAH cost to the cost right
+	 * after the build tells how much the tree has degraded due to refitting.
+	 * @code
+	 * scene.setAccelStructure(std::make_shared<CBVHTree>());
+	 * scene.buildAccelStructure();
+	 * for (int frame = 0; frame < nFrames; frame++) {
+	 *     solid.transform(t);
+	 *     scene.updateAccelStructure();	// refits the tree and re-builds it only if it has degraded too much
+	 *     Mat img = scene.render();
+	 * }
+	 * @endcode
+	 * For scenes which have to be re-built every frame, the tree may be built with the Linear BVH (LBVH) builder instead:
+	 * @code
+	 * scene.setAccelStructure(std::make_shared<CBVHTree>(BVHBuilder::LBVH));
+	 * @endcode
+	 * The Spatial split BVH (SBVH) builder, on the contrary, aims at the highest quality of the tree for static scenes with long, thin or overlapping primitives.
+	 * Such primitives may be split among several leaf nodes, thus in contrast to the other builders, one primitive may be referenced by more than one leaf.
+	 */
+	class CBVHTree : public IAccelStructure
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 * @param builder The algorithm used for building the tree
+		 */
+		DllExport explicit CBVHTree(BVHBuilder builder = BVHBuilder::SAH) : m_builder(builder) {}
+		DllExport CBVHTree(const CBVHTree&) = delete;
+		DllExport virtual ~CBVHTree(void) = default;
+		DllExport const CBVHTree& operator=(const CBVHTree&) = delete;
+
+		DllExport virtual void	build(const std::vector<ptr_prim_t>& vpPrims, size_t maxDepth = 20, size_t minPrimitives = 3) override;
+		DllExport virtual bool	intersect(Ray& ray) const override;
+		DllExport virtual bool	if_intersect(const Ray& ray) const override { return findOccluder(ray) != nullptr; }
+		DllExport virtual const ptr_prim_t*	findOccluder(const Ray& ray) const override;
+		/**
+		 * @brief Finds the closest intersections of the rays with indices [\b begin; \b end) of the batch \b rays
+		 * @details The rays are traversed in packets of 16: every node is tested against all the active rays of the packet at once in the SoA layout.
+		 * Coherent rays, \a e.g. the rays of a lidar sweep, share most of the visited nodes.
+		 */
+		DllExport virtual void	intersect(const RayBatch& rays, size_t begin, size_t end, RayHit* pHits) const override;
+		DllExport virtual void	if_intersect(const RayBatch& rays, size_t begin, size_t end, byte* pOccluded) const override;
+		/**
+		 * @brief Finds all the intersections between the ray \b ray and the primitives in one traversal of the tree
+		 * @details This query is used by the constructive solid geometry, which merges the intervals of the ray inside its operands
+		 * @param ray The ray. Only the intersections in the interval (epsilon; Ray::t) are reported
+		 * @return The intersections, sorted by the increasing distance from the ray origin
+		 */
+		DllExport std::vector<RayHit>	intersectAll(const Ray& ray) const;
+		/**
+		 * @brief Inserts a new primitive into the tree
+		 * @details The primitive is placed into a new leaf-node, which becomes the sibling of the node with the smallest increase of the surface area.
+		 * Only the bounding boxes of the ancestors of the new leaf-node are updated.
+		 * @param pPrim Pointer to the primitive
+		 * @retval true If the primitive has been inserted
+		 * @retval false If the tree would exceed its maximal depth, thus it needs to be re-built
+		 */
+		DllExport virtual bool	insert(const ptr_prim_t pPrim) override;
+		DllExport virtual bool	remove(const ptr_prim_t pPrim) override;
+		DllExport virtual bool	refit(void) override;
+		/**
+		 * @brief Saves the tree into a binary file
+		 * @details The file stores the nodes and the indices of the primitives in \b vpPrims, thus the tree may be restored with load() without re-building
+		 * @param fileName The full path to the file
+		 * @param vpPrims The vector of pointers to the primitives, the tree was built for
+		 * @param hash The hash of the primitives and of the build parameters, which identifies the tree
+		 * @retval true If the tree has been saved
+		 * @retval false If the file could not be written
+		 */
+		DllExport virtual bool	save(const std::string& fileName, const std::vector<ptr_prim_t>& vpPrims, qword hash) const override;
+		/**
+		 * @brief Loads the tree from a binary file, saved with save()
+		 * @details The file is memory-mapped and the nodes are decoded directly from the mapping
+		 * @param fileName The full path to the file
+		 * @param vpPrims The vector of pointers to the primitives, the tree is to be loaded for
+		 * @param hash The hash of the primitives and of the build parameters, which must match the one stored in the file
+		 * @retval true If the tree has been loaded
+		 * @retval false If the file does not exist or it does not match the primitives
+		 */
+		DllExport virtual bool	load(const std::string& fileName, const std::vector<ptr_prim_t>& vpPrims, qword hash) override;
+		DllExport virtual float	getDegradation(void) const override { return m_buildCost > 0 ? calcSAHCost() / m_buildCost : 1.0f; }
+		DllExport virtual size_t	getMemoryUsage(void) const override { return sizeof(CBVHTree) + m_vNodes.capacity() * sizeof(BVHNode) + m_vpPrims.capacity() * sizeof(ptr_prim_t); }
+
+		/**
+		 * @brief Returns the Surface Area Heuristic (SAH) cost of the tree
+		 * @details The cost is the expected number of node traversals and primitive tests for a random ray hitting the root node
+		 * @return The SAH cost of the tree
+		 */
+		DllExport float							getSAHCost(void) const { return calcSAHCost(); }
+		/**
+		 * @brief Returns the nodes of the tree
+		 * @note After removal of primitives the vector may also contain unused nodes, which are not reachable from the root node
+		 * @return The vector of nodes. The root node has index 0
+		 */
+		DllExport const std::vector<BVHNode>&	getNodes(void) const { return m_vNodes; }
+		/**
+		 * @brief Returns the primitives of the tree
+		 * @details The primitives are ordered in such a way, that the primitives of every leaf node form a continuous range.
+		 * After removal of primitives the vector may also contain unused (nullptr) entries. For the trees built with BVHBuilder::SBVH the same primitive may occur multiple times
+		 * @return The vector of pointers to the primitives
+		 */
+		DllExport const std::vector<ptr_prim_t>& getPrims(void) const { return m_vpPrims; }
+		/**
+		 * @brief Collects the descendants of the node \b node, which become its children in a wide (n-ary) tree
+		 * @details Starting with the two children of the node, the branch child with the largest surface area is repeatedly replaced by its own children,
+		 * until there are \b maxChildren children or all of them are leaf nodes. A leaf node is collapsed into itself
+		 * @param node Index of the node
+		 * @param maxChildren The maximal number of children (at least 2)
+		 * @return Indices of the collected nodes
+		 */
+		DllExport std::vector<int>				collapse(int node, size_t maxChildren) const;
+		/**
+		 * @brief Returns the algorithm used for building the tree
+		 * @return The builder of the tree
+		 */
+		DllExport BVHBuilder					getBuilder(void) const { return m_builder; }
+
+
+	private:
+		struct PrimRef;		///< Reference to a primitive together with the bounds of its part inside a node (used only during building the SBVH)
+
+		/**
+		 * @brief Recursively builds the BVH tree
+		 * @param node Index of the node covering the range [node.first; node.first + node.count) of primitives
+		 * @param depth The distance from the root node of the tree
+		 */
+		void	build(int node, size_t depth);
+		/**
+		 * @brief Builds the LBVH tree
+		 * @details The centroids of the primitives are encoded with Morton codes, which are sorted with the parallel radix sort.
+		 * The binary radix tree over the sorted codes is built in parallel as described by T. Karras in
+		 * <a href="https://research.nvidia.com/publication/2012-06_maximizing-parallelism-construction-bvhs-octrees-and-k-d-trees" target="_blank">Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees</a>,
+		 * and then converted into the nodes of the tree, whereby the subtrees with no more than \b m_minPrimitives primitives are collapsed into leaf nodes.
+		 */
+		void	buildLBVH(void);
+		/**
+		 * @brief Recursively builds the SBVH tree
+		 * @details Implements the algorithm of M. Stich et al.
+		 * <a href="https://www.nvidia.com/docs/IO/77714/sbvh.pdf" target="_blank">Spatial Splits in Bounding Volume Hierarchies</a>:
+		 * the spatial splits are evaluated only if the children of the best object split overlap, and the number of created references is limited.
+		 * The primitives of the leaf nodes are appended to \b m_vpPrims
+		 * @param node Index of the node
+		 * @param vRefs The references to the primitives, which overlap the node. The vector is consumed by the method
+		 * @param depth The distance from the root node of the tree
+		 */
+		void	buildSBVH(int node, std::vector<PrimRef>& vRefs, size_t depth);
+		/**
+		 * @brief Removes one reference to the primitive \b pPrim from the tree
+		 * @param pPrim Pointer to the primitive
+		 * @retval true If a reference has been removed
+		 * @retval false If the primitive is not referenced by the tree
+		 */
+		bool	removeReference(const ptr_prim_t pPrim);
+		/**
+		 * @brief Recursively recomputes the bounding boxes of the node \b node and its descendants
+		 * @param node Index of the node
+		 */
+		void	refit(int node);
+		/**
+		 * @brief Recomputes the bounding boxes of the node \b node and all its ancestors
+		 * @param node Index of the node
+		 */
+		void	refitAncestors(int node);
+		/**
+		 * @brief Returns a new node, reusing the unused ones if possible
+		 * @return Index of the new node
+		 */
+		int		allocateNode(void);
+		/**
+		 * @brief Computes the SAH cost of the tree
+		 * @return The SAH cost of the tree
+		 */
+		float	calcSAHCost(void) const;
+
+
+	private:
+		std::vector<BVHNode>		m_vNodes;				///< The nodes of the tree
+		std::vector<ptr_prim_t>		m_vpPrims;				///< The primitives, referenced by the leaf nodes
+		std::vector<CBoundingBox>	m_vPrimBoxes;			///< The bounding boxes of the primitives (used only during building)
+		size_t						m_maxDepth		= 0;	///< The maximum allowed depth of the tree
+		size_t						m_minPrimitives	= 0;	///< The minimum number of primitives in a leaf-node
+		size_t						m_nSpareRefs	= 0;	///< The number of additional references, which may still be created by the spatial splits (used only during building)
+		float						m_buildCost		= 0;	///< The SAH cost of the tree right after the last build
+		std::vector<int>			m_vFreeNodes;			///< Indices of the unused nodes
+		const BVHBuilder			m_builder;				///< The algorithm used for building the tree
+	};
+}
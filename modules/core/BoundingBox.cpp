@@ -1,6 +1,7 @@
 #include "BoundingBox.h"
 #include "Ray.h"
 #include "macroses.h"
+#include "simd.h"
 
 namespace rt {
 
@@ -33,6 +34,24 @@ namespace rt {
 		extend(box.m_maxPoint + Vec3f::all(Epsilon));
 	}
 
+    bool CBoundingBox::isInfinite(void) const
+    {
+        for (int i = 0; i < 3; i++)
+            if (m_minPoint[i] == -Infty || m_maxPoint[i] == Infty)
+                return true;
+        return false;
+    }
+
+    float CBoundingBox::getSquaredDistance(const Vec3f& point) const
+    {
+        float res = 0;
+        for (int i = 0; i < 3; i++) {
+            float d = MAX(MAX(m_minPoint[i] - point[i], point[i] - m_maxPoint[i]), 0.0f);
+            res += d * d;
+        }
+        return res;
+    }
+
     std::pair<CBoundingBox, CBoundingBox> CBoundingBox::split(int dim, float val) const
     {
         // Assertions
@@ -56,44 +75,20 @@ namespace rt {
 
     void CBoundingBox::clip(const Ray& ray, double& t0, double& t1) const
     {
-        float d, den;
-        if (ray.dir.val[0] != 0) {
-            den = 1.0f / ray.dir.val[0];
-            if (ray.dir.val[0] > 0) {
-                if ((d = (m_minPoint.val[0] - ray.org.val[0]) * den) > t0) t0 = d;
-                if ((d = (m_maxPoint.val[0] - ray.org.val[0]) * den) < t1) t1 = d;
-            }
-            else {
-                if ((d = (m_maxPoint.val[0] - ray.org.val[0]) * den) > t0) t0 = d;
-                if ((d = (m_minPoint.val[0] - ray.org.val[0]) * den) < t1) t1 = d;
-            }
-            if (t0 > t1) return;
-        }
-
-        if (ray.dir.val[1] != 0) {
-            den = 1.0f / ray.dir.val[1];
-            if (ray.dir.val[1] > 0) {
-                if ((d = (m_minPoint.val[1] - ray.org.val[1]) * den) > t0) t0 = d;
-                if ((d = (m_maxPoint.val[1] - ray.org.val[1]) * den) < t1) t1 = d;
-            }
-            else {
-                if ((d = (m_maxPoint.val[1] - ray.org.val[1]) * den) > t0) t0 = d;
-                if ((d = (m_minPoint.val[1] - ray.org.val[1]) * den) < t1) t1 = d;
-            }
-            if (t0 > t1) return;
-        }
+        clip(RayData(ray), t0, t1);
+    }
 
-        if (ray.dir.val[2] != 0) {
-            den = 1.0f / ray.dir.val[2];
-            if (ray.dir.val[2] > 0) {
-                if ((d = (m_minPoint.val[2] - ray.org.val[2]) * den) > t0) t0 = d;
-                if ((d = (m_maxPoint.val[2] - ray.org.val[2]) * den) < t1) t1 = d;
-            }
-            else {
-                if ((d = (m_maxPoint.val[2] - ray.org.val[2]) * den) > t0) t0 = d;
-                if ((d = (m_minPoint.val[2] - ray.org.val[2]) * den) < t1) t1 = d;
-            }
-        }
+    void CBoundingBox::clip(const RayData& ray, double& t0, double& t1) const
+    {
+        // the inverse direction is finite, thus the distances to the slab planes are never NaN
+        const simd::float4 invDir       = simd::load3(ray.invDir);
+        const simd::float4 orgInvDir    = simd::load3(ray.orgInvDir);
+        const simd::float4 tA           = simd::load3(m_minPoint) * invDir - orgInvDir;
+        const simd::float4 tB           = simd::load3(m_maxPoint) * invDir - orgInvDir;
+        // the slabs of an empty box (e.g. the default one with the minimum point at +Infty) enclose the whole ray, thus it is masked out explicitly
+        const bool empty                = simd::hmin3(simd::load3(m_maxPoint) - simd::load3(m_minPoint)) < 0;
+        t0 = empty ? std::numeric_limits<double>::infinity() : MAX(t0, static_cast<double>(simd::hmax3(simd::min(tA, tB))));
+        t1 = empty ? -std::numeric_limits<double>::infinity() : MIN(t1, static_cast<double>(simd::hmin3(simd::max(tA, tB))));
     }
 }
 
@@ -6,6 +6,7 @@
 
 namespace rt {
 	struct Ray;
+	struct RayData;
     // ================================ AABB Class ================================
     /**
      * @brief Axis-Aligned Bounding Box (AABB) class
@@ -61,6 +62,14 @@ namespace rt {
          * @param[in,out] t1 The distance from ray origin at which the ray leaves the bounding box
          */
         DllExport void clip(const Ray& ray, double& t0, double& t1) const;
+        /**
+         * @brief Clips the ray with the bounding box
+         * @details This is a faster version of clip(const Ray&, double&, double&) const for the ray data, which is precomputed once for many boxes
+         * @param[in] ray The precomputed ray data
+         * @param[in,out] t0 The distance from ray origin at which the ray enters the bounding box
+         * @param[in,out] t1 The distance from ray origin at which the ray leaves the bounding box
+         */
+        DllExport void clip(const RayData& ray, double& t0, double& t1) const;
         /**
          * @brief Returns the minimal point defying the size of the bounding box
          * @returns The minimal point defying the size of the bounding box
@@ -76,6 +85,19 @@ namespace rt {
          * @returns The point defining the centroid of the bounding box.
          */
         DllExport Vec3f getCenter(void) const { return Vec3f((m_minPoint[0] + m_maxPoint[0]) / 2, (m_minPoint[1] + m_maxPoint[1]) / 2, (m_minPoint[2] + m_maxPoint[2]) / 2); }
+        /**
+         * @brief Checks whether the bounding box is infinite along at least one axis
+         * @note An empty bounding box is not infinite
+         * @retval true If the bounding box is infinite, \a e.g. it belongs to an infinite plane
+         * @retval false otherwise
+         */
+        DllExport bool isInfinite(void) const;
+        /**
+         * @brief Computes the squared distance from the point to the bounding box
+         * @param point The point
+         * @returns The squared distance from the point \b point to the closest point of the bounding box, which is 0 for the points inside the box
+         */
+        DllExport float getSquaredDistance(const Vec3f& point) const;
 		
         
 	private:
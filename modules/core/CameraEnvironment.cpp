@@ -40,6 +40,7 @@ namespace rt
 		ray.dir = normalize(sinf(theta) * eq_dir - cosf(theta) * m_yAxis);
 		ray.t = std::numeric_limits<double>::infinity();
 		ray.hit = nullptr;
+		ray.instHit = nullptr;
 		ray.ndc = Vec2f(ndcx, ndcy);
 	}
 }
@@ -31,6 +31,7 @@ namespace rt {
 		ray.dir = m_dir;
 		ray.t	= std::numeric_limits<double>::infinity();
 		ray.hit = nullptr;
+		ray.instHit = nullptr;
 		ray.ndc = Vec2f(ndcx, ndcy);
 	}
 }
@@ -33,6 +33,7 @@ namespace rt
 		ray.dir = normalize(getAspectRatio() * sscx * m_xAxis + sscy * m_yAxis + m_focus * m_zAxis);
 		ray.t	= std::numeric_limits<double>::infinity();
 		ray.hit = nullptr;
+		ray.instHit = nullptr;
 		ray.ndc = Vec2f(ndcx, ndcy);
 	} 
 }
@@ -0,0 +1,208 @@
+#include "CompressedBVHTree.h"
+#include "Prim.h"
+#include "Ray.h"
+#include "macroses.h"
+#include <bit>
+
+namespace rt {
+	static_assert(sizeof(CompressedBVHNode) == 64, "The compressed BVH node must fit into one cache line");
+
+	namespace {
+		const size_t	maxWidth		= 4;			// Maximal number of children of a node
+		const size_t	maxStackSize	= 3 * 64 + 1;	// Size of the traversal stack: every level of the tree may postpone up to 3 children
+
+		// Returns 2^exp for exp in [-126; 127]
+		inline float pow2(int exp)
+		{
+			return std::bit_cast<float>(static_cast<dword>(exp + 127) << 23);
+		}
+
+		// Clips the ray with the box [minPoint; maxPoint]
+		inline bool clip(const RayData& r, const float* minPoint, const float* maxPoint, float tMax, float& tEntry)
+		{
+			float t0 = 0;
+			float t1 = tMax;
+			for (int i = 0; i < 3; i++) {
+				const float tNear	= (r.sign[i] ? maxPoint[i] : minPoint[i]) * r.invDir[i] - r.orgInvDir[i];
+				const float tFar	= (r.sign[i] ? minPoint[i] : maxPoint[i]) * r.invDir[i] - r.orgInvDir[i];
+				if (tNear > t0) t0 = tNear;
+				if (tFar < t1) t1 = tFar;
+			}
+			tEntry = t0;
+			return t0 <= t1;
+		}
+
+		// Entry of the traversal stack
+		struct StackEntry {
+			dword	child;		// Index of the node, or index of the first primitive for leaves
+			word	count;		// Number of primitives for leaves, 0 for nodes
+			float	tEntry;		// Distance to the entry point of the ray into the child's box
+		};
+	}
+
+	void CCompressedBVHTree::build(const std::vector<ptr_prim_t>& vpPrims, size_t maxDepth, size_t minPrimitives)
+	{
+		CBVHTree bvh(m_builder);
+		bvh.build(vpPrims, maxDepth, minPrimitives);
+		const std::vector<BVHNode>& vBinaryNodes = bvh.getNodes();
+
+		m_vpPrims		= bvh.getPrims();
+		m_boundingBox	= vBinaryNodes[0].box;
+		m_vNodes.clear();
+		if (vBinaryNodes[0].isLeaf() && vBinaryNodes[0].count == 0) return;		// empty tree
+
+		m_vNodes.reserve(vBinaryNodes.size() / 2 + 1);
+		compress(bvh, 0);
+		m_vNodes.shrink_to_fit();
+#ifdef DEBUG_PRINT_INFO
+		std::cout << "Compressed BVH: " << m_vNodes.size() << " nodes, " << getMemoryUsage() / 1024 << " KB" << std::endl;
+#endif
+	}
+
+	bool CCompressedBVHTree::intersect(Ray& ray) const
+	{
+		if (m_vNodes.empty()) return false;
+
+		const RayData r(ray);
+		double t0 = 0;
+		double t1 = ray.t;
+		m_boundingBox.clip(r, t0, t1);
+		if (t1 < t0) return false;
+
+		StackEntry stack[maxStackSize];
+		size_t top = 0;
+		stack[top++] = { 0, 0, static_cast<float>(t0) };
+
+		bool hit = false;
+		while (top) {
+			const StackEntry entry = stack[--top];
+			if (entry.tEntry > ray.t) continue;		// a closer intersection has been found meanwhile
+
+			if (entry.count) {
+				for (dword i = entry.child; i < entry.child + entry.count; i++)
+					hit |= m_vpPrims[i]->intersect(ray);
+				continue;
+			}
+
+			// Decode and test the children boxes, sorting the hit children from the farthest to the closest one
+			const CompressedBVHNode& node = m_vNodes[entry.child];
+			const float scale[3] = { pow2(node.exp[0]), pow2(node.exp[1]), pow2(node.exp[2]) };
+			StackEntry	children[maxWidth];
+			size_t		nHits = 0;
+			for (size_t c = 0; c < node.nChildren; c++) {
+				float minPoint[3], maxPoint[3];
+				for (int i = 0; i < 3; i++) {
+					minPoint[i] = node.origin[i] + node.qMin[i][c] * scale[i];
+					maxPoint[i] = node.origin[i] + node.qMax[i][c] * scale[i];
+				}
+				float tEntry;
+				if (!clip(r, minPoint, maxPoint, static_cast<float>(ray.t), tEntry)) continue;
+
+				size_t k = nHits++;
+				for (; k > 0 && children[k - 1].tEntry < tEntry; k--)
+					children[k] = children[k - 1];
+				children[k] = { node.child[c], node.count[c], tEntry };
+			}
+
+			// push the farther children first, so that the closer ones are traversed first
+			for (size_t k = 0; k < nHits; k++)
+				stack[top++] = children[k];
+		}
+		return hit;
+	}
+
+	const ptr_prim_t* CCompressedBVHTree::findOccluder(const Ray& ray) const
+	{
+		if (m_vNodes.empty()) return nullptr;
+
+		const RayData r(ray);
+		double t0 = 0;
+		double t1 = ray.t;
+		m_boundingBox.clip(r, t0, t1);
+		if (t1 < t0) return nullptr;
+
+		const float tMax = static_cast<float>(ray.t);
+
+		dword stack[maxStackSize];
+		size_t top = 0;
+		stack[top++] = 0;
+
+		while (top) {
+			const CompressedBVHNode& node = m_vNodes[stack[--top]];
+			const float scale[3] = { pow2(node.exp[0]), pow2(node.exp[1]), pow2(node.exp[2]) };
+			for (size_t c = 0; c < node.nChildren; c++) {
+				float minPoint[3], maxPoint[3];
+				for (int i = 0; i < 3; i++) {
+					minPoint[i] = node.origin[i] + node.qMin[i][c] * scale[i];
+					maxPoint[i] = node.origin[i] + node.qMax[i][c] * scale[i];
+				}
+				float tEntry;
+				if (!clip(r, minPoint, maxPoint, tMax, tEntry)) continue;
+
+				if (node.count[c]) {
+					for (dword i = node.child[c]; i < node.child[c] + node.count[c]; i++)
+						if (m_vpPrims[i]->if_intersect(ray)) return &m_vpPrims[i];
+				}
+				else stack[top++] = node.child[c];
+			}
+		}
+		return nullptr;
+	}
+
+	// ---------------------- private ----------------------
+	dword CCompressedBVHTree::compress(const CBVHTree& bvh, int node)
+	{
+		const std::vector<BVHNode>& vBinaryNodes = bvh.getNodes();
+		const std::vector<int> vChildren = bvh.collapse(node, maxWidth);
+
+		const dword res = static_cast<dword>(m_vNodes.size());
+		m_vNodes.emplace_back();
+		CompressedBVHNode qNode = {};
+
+		// Quantization grid: the smallest power-of-two cells, such that 255 cells cover the node's bounding box
+		CBoundingBox box;
+		for (int child : vChildren)
+			box.extend(vBinaryNodes[child].box);
+		for (int i = 0; i < 3; i++) {
+			const float minPoint	= box.getMinPoint()[i];
+			const float maxPoint	= box.getMaxPoint()[i];
+			int exp;
+			std::frexp((maxPoint - minPoint) / 255, &exp);
+			exp = MIN(MAX(exp, -126), 127);
+			while (exp < 127 && minPoint + 255 * pow2(exp) < maxPoint) exp++;
+			qNode.origin[i]	= minPoint;
+			qNode.exp[i]	= static_cast<int8_t>(exp);
+		}
+
+		for (int c : vChildren) {
+			const BVHNode& child = vBinaryNodes[c];
+			if (child.isLeaf() && child.count == 0) continue;				// empty leaf
+
+			// Conservative quantization of the child's box
+			const size_t k = qNode.nChildren++;
+			for (int i = 0; i < 3; i++) {
+				const float origin	= qNode.origin[i];
+				const float scale	= pow2(qNode.exp[i]);
+				const float minPoint = child.box.getMinPoint()[i];
+				const float maxPoint = child.box.getMaxPoint()[i];
+				int qMin = static_cast<int>(MIN(MAX(std::floor((minPoint - origin) / scale), 0.0f), 255.0f));
+				int qMax = static_cast<int>(MIN(MAX(std::ceil((maxPoint - origin) / scale), 0.0f), 255.0f));
+				while (qMin > 0 && origin + qMin * scale > minPoint) qMin--;
+				while (qMax < 255 && origin + qMax * scale < maxPoint) qMax++;
+				qNode.qMin[i][k] = static_cast<byte>(qMin);
+				qNode.qMax[i][k] = static_cast<byte>(qMax);
+			}
+
+			if (child.isLeaf()) {
+				RT_ASSERT_MSG(child.count <= std::numeric_limits<word>::max(), "The leaf node contains too many primitives (%zu)", child.count);
+				qNode.child[k] = static_cast<dword>(child.first);
+				qNode.count[k] = static_cast<word>(child.count);
+			}
+			else
+				qNode.child[k] = compress(bvh, c);
+		}
+
+		m_vNodes[res] = qNode;
+		return res;
+	}
+}
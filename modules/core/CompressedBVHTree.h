@@ -0,0 +1,77 @@
+// Compressed Bounding Volume Hierarchy (BVH) class
+#pragma once
+
+#include "BVHTree.h"
+
+namespace rt {
+	// ================================ Compressed BVH Node Structure ================================
+	/**
+	 * @brief Compressed 4-ary BVH node, which fits into one cache line
+	 * @details The bounding boxes of the children are quantized to 8 bits per coordinate relative to the node's local grid.
+	 * The grid starts at \b origin and its cell size along every axis is a power of two, so that the children boxes are decoded as
+	 * \f$ origin + q \cdot 2^{exp} \f$. The quantized boxes are always conservative, \a i.e. they contain the original boxes.
+	 */
+	struct alignas(64) CompressedBVHNode
+	{
+		float	origin[3];				///< The origin of the quantization grid (the minimum point of the node's bounding box)
+		int8_t	exp[3];					///< The exponents of the grid cell sizes along every axis
+		byte	nChildren;				///< Number of valid children
+		byte	qMin[3][4];				///< Quantized minimum points of the children boxes: qMin[axis][child]
+		byte	qMax[3][4];				///< Quantized maximum points of the children boxes: qMax[axis][child]
+		dword	child[4];				///< Index of the child node for branch children, or the index of the first primitive for leaf children
+		word	count[4];				///< Number of primitives for leaf children, or 0 for branch children
+	};
+
+	// ================================ Compressed BVH Tree Class ================================
+	/**
+	 * @brief Compressed Bounding Volume Hierarchy (BVH) class
+	 * @details The tree is built as the binary @ref CBVHTree, which is then collapsed into a 4-ary tree of @ref CompressedBVHNode nodes.
+	 * Every node takes 64 bytes for up to 4 children, which is several times less than the memory needed for the nodes of the binary tree.
+	 * The children boxes are decoded on the fly during traversal and the children are visited from front to back.
+	 * The compressed tree does not support refitting or incremental updates, thus it is best suited for large static scenes.
+	 * @code
+	 * scene.setAccelStructure(std::make_shared<CCompressedBVHTree>());
+	 * @endcode
+	 */
+	class CCompressedBVHTree : public IAccelStructure
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 * @param builder The algorithm used for building the underlying binary tree
+		 */
+		DllExport explicit CCompressedBVHTree(BVHBuilder builder = BVHBuilder::SAH) : m_builder(builder) {}
+		DllExport CCompressedBVHTree(const CCompressedBVHTree&) = delete;
+		DllExport virtual ~CCompressedBVHTree(void) = default;
+		DllExport const CCompressedBVHTree& operator=(const CCompressedBVHTree&) = delete;
+
+		DllExport virtual void		build(const std::vector<ptr_prim_t>& vpPrims, size_t maxDepth = 20, size_t minPrimitives = 3) override;
+		DllExport virtual bool		intersect(Ray& ray) const override;
+		DllExport virtual bool		if_intersect(const Ray& ray) const override { return findOccluder(ray) != nullptr; }
+		DllExport virtual const ptr_prim_t*	findOccluder(const Ray& ray) const override;
+		DllExport virtual size_t	getMemoryUsage(void) const override { return sizeof(CCompressedBVHTree) + m_vNodes.capacity() * sizeof(CompressedBVHNode) + m_vpPrims.capacity() * sizeof(ptr_prim_t); }
+
+		/**
+		 * @brief Returns the nodes of the tree
+		 * @return The vector of nodes. The root node has index 0
+		 */
+		DllExport const std::vector<CompressedBVHNode>&	getNodes(void) const { return m_vNodes; }
+
+
+	private:
+		/**
+		 * @brief Recursively converts the sub-tree of the binary tree into the compressed nodes
+		 * @param bvh The binary tree
+		 * @param node Index of the root node of the binary sub-tree
+		 * @return Index of the compressed node
+		 */
+		dword	compress(const CBVHTree& bvh, int node);
+
+
+	private:
+		std::vector<CompressedBVHNode>	m_vNodes;			///< The nodes of the tree
+		std::vector<ptr_prim_t>			m_vpPrims;			///< The primitives, referenced by the leaf children
+		CBoundingBox					m_boundingBox;		///< The bounding box of the root node
+		const BVHBuilder				m_builder;			///< The algorithm used for building the underlying binary tree
+	};
+}
@@ -0,0 +1,19 @@
+#include "IAccelStructure.h"
+#include "Ray.h"
+
+namespace rt {
+	void IAccelStructure::intersect(const RayBatch& rays, size_t begin, size_t end, RayHit* pHits) const
+	{
+		for (size_t i = begin; i < end; i++) {
+			Ray ray = rays.getRay(i);
+			if (intersect(ray))	pHits[i - begin] = { ray.t, ray.hit, ray.instHit, ray.b1, ray.b2 };
+			else				pHits[i - begin] = { std::numeric_limits<double>::infinity(), nullptr, nullptr, 0, 0 };
+		}
+	}
+
+	void IAccelStructure::if_intersect(const RayBatch& rays, size_t begin, size_t end, byte* pOccluded) const
+	{
+		for (size_t i = begin; i < end; i++)
+			pOccluded[i - begin] = if_intersect(rays.getRay(i)) ? 1 : 0;
+	}
+}
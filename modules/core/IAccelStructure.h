@@ -0,0 +1,131 @@
+// Acceleration Structure Abstract Interface class
+#pragma once
+
+#include "types.h"
+
+namespace rt {
+	struct Ray;
+	struct RayHit;
+	struct RayBatch;
+
+	// ================================ Acceleration Structure Interface Class ================================
+	/**
+	 * @brief Base acceleration structure abstract interface class
+	 * @details Acceleration structures organize the scene primitives spatially, so that a ray needs to be tested only against a small subset of them.
+	 */
+	class IAccelStructure
+	{
+	public:
+		DllExport IAccelStructure(void) = default;
+		DllExport IAccelStructure(const IAccelStructure&) = delete;
+		DllExport virtual ~IAccelStructure(void) = default;
+		DllExport const IAccelStructure& operator=(const IAccelStructure&) = delete;
+
+		/**
+		 * @brief Builds the acceleration structure for the primitives provided via \b vpPrims
+		 * @param vpPrims The vector of pointers to the primitives in the scene
+		 * @param maxDepth The maximum allowed depth of the structure
+		 * @param minPrimitives The minimum number of primitives in a leaf-node
+		 */
+		DllExport virtual void	build(const std::vector<ptr_prim_t>& vpPrims, size_t maxDepth = 20, size_t minPrimitives = 3) = 0;
+		/**
+		 * @brief Checks whether the ray \b ray intersects a primitive.
+		 * @details If ray \b ray intersects a primitive, the \b ray.t value will be updated
+		 * @param[in,out] ray The ray
+		 * @retval true If ray \b ray intersects any primitive
+		 * @retval false otherwise
+		 */
+		DllExport virtual bool	intersect(Ray& ray) const = 0;
+		/**
+		 * @brief Checks whether the ray \b ray intersects a primitive without modifying the ray
+		 * @details This method may return as soon as the first intersection is found, thus it may be used to check occlusions.
+		 * @param ray The ray
+		 * @retval true If ray \b ray intersects any primitive
+		 * @retval false otherwise
+		 */
+		DllExport virtual bool	if_intersect(const Ray& ray) const = 0;
+		/**
+		 * @brief Finds a primitive, intersected by the ray \b ray, without modifying the ray
+		 * @details Like if_intersect(const Ray&) const, this method returns as soon as the first intersection is found, which is not necessarily the closest one.
+		 * In contrast to Ray::hit, set by intersect(), which points to a part of the compound primitives (\a e.g. an operand of @ref CPrimBoolean), the reported primitive is the one stored in the structure
+		 * @param ray The ray
+		 * @return Pointer to the stored pointer to the intersected primitive, valid until the structure is modified, or \b nullptr if ray \b ray intersects no primitive
+		 */
+		DllExport virtual const ptr_prim_t*	findOccluder(const Ray& ray) const = 0;
+		/**
+		 * @brief Finds the closest intersections of the rays with indices [\b begin; \b end) of the batch \b rays
+		 * @details The default implementation traces the rays one by one. The structures may override it with a traversal of the ray packets.
+		 * @param rays The batch of rays
+		 * @param begin The index of the first ray
+		 * @param end The index after the last ray
+		 * @param[out] pHits Pointer to the array of (\b end - \b begin) hit records. For the rays, which hit nothing, RayHit::hit is \b nullptr and RayHit::t is infinity
+		 */
+		DllExport virtual void	intersect(const RayBatch& rays, size_t begin, size_t end, RayHit* pHits) const;
+		/**
+		 * @brief Checks whether the rays with indices [\b begin; \b end) of the batch \b rays intersect any primitive
+		 * @details The default implementation traces the rays one by one. The structures may override it with a traversal of the ray packets.
+		 * @param rays The batch of rays
+		 * @param begin The index of the first ray
+		 * @param end The index after the last ray
+		 * @param[out] pOccluded Pointer to the array of (\b end - \b begin) occlusion flags: 1 for the rays intersecting a primitive, 0 otherwise
+		 */
+		DllExport virtual void	if_intersect(const RayBatch& rays, size_t begin, size_t end, byte* pOccluded) const;
+		/**
+		 * @brief Inserts a new primitive into the already built structure
+		 * @details Only the part of the structure affected by the primitive is updated
+		 * @param pPrim Pointer to the primitive
+		 * @retval true If the primitive has been inserted
+		 * @retval false If the structure does not support insertion of this primitive and needs to be re-built
+		 */
+		DllExport virtual bool	insert(const ptr_prim_t pPrim) { return false; }
+		/**
+		 * @brief Removes the primitive from the already built structure
+		 * @details Only the part of the structure affected by the primitive is updated
+		 * @note The primitive must not be transformed since it was added to the structure (or since the last refit)
+		 * @param pPrim Pointer to the primitive
+		 * @retval true If the primitive has been removed
+		 * @retval false If the structure does not support removal of primitives or the primitive was not found, thus the structure needs to be re-built
+		 */
+		DllExport virtual bool	remove(const ptr_prim_t pPrim) { return false; }
+		/**
+		 * @brief Updates the bounds of the structure after the primitives it was built for have been transformed
+		 * @details Refitting keeps the topology of the structure and is much cheaper than a re-build, but the quality of the structure degrades with the amount of motion.
+		 * @retval true If the structure has been refitted
+		 * @retval false If the structure does not support refitting and needs to be re-built
+		 */
+		DllExport virtual bool	refit(void) { return false; }
+		/**
+		 * @brief Saves the structure into a file
+		 * @param fileName The full path to the file
+		 * @param vpPrims The vector of pointers to the primitives, the structure was built for. The file refers to the primitives by their indices in this vector
+		 * @param hash The hash of the primitives and of the build parameters, which identifies the structure
+		 * @retval true If the structure has been saved
+		 * @retval false If the structure does not support serialization or the file could not be written
+		 */
+		DllExport virtual bool	save(const std::string& fileName, const std::vector<ptr_prim_t>& vpPrims, qword hash) const { return false; }
+		/**
+		 * @brief Loads the structure from a file, saved with save()
+		 * @param fileName The full path to the file
+		 * @param vpPrims The vector of pointers to the primitives, the structure is to be loaded for
+		 * @param hash The hash of the primitives and of the build parameters, which must match the one stored in the file
+		 * @retval true If the structure has been loaded
+		 * @retval false If the structure does not support serialization, the file does not exist or it does not match the primitives
+		 */
+		DllExport virtual bool	load(const std::string& fileName, const std::vector<ptr_prim_t>& vpPrims, qword hash) { return false; }
+		/**
+		 * @brief Returns the degradation of the structure since the last build
+		 * @details The degradation is the ratio between the current estimated traversal cost of the structure and its cost right after the last build.
+		 * A freshly built structure has degradation 1; refitting after large motions increases it.
+		 * @return The degradation factor
+		 */
+		DllExport virtual float	getDegradation(void) const { return 1.0f; }
+		/**
+		 * @brief Returns the amount of memory occupied by the structure
+		 * @details The memory of the primitives themselves is not included
+		 * @return The size of the structure in bytes, or 0 if it is unknown
+		 */
+		DllExport virtual size_t	getMemoryUsage(void) const { return 0; }
+	};
+
+	using ptr_accelstructure_t = std::shared_ptr<IAccelStructure>;
+}
@@ -0,0 +1,20 @@
+#include "ILight.h"
+#include "Ray.h"
+#include "random.h"
+
+namespace rt {
+	std::optional<Vec3f> ILight::illuminate(Ray& ray, const Vec2f& u) const
+	{
+		auto res = sample(ray.org, Vec3f::all(0), u);
+		if (!res) return std::nullopt;
+		ray.dir	= res->direction;
+		ray.t	= res->distance;
+		ray.hit = nullptr;
+		return (1.0f / res->pdf) * res->radiance;
+	}
+
+	std::optional<Vec3f> ILight::illuminate(Ray& ray) const
+	{
+		return illuminate(ray, Vec2f(random::U<float>(), random::U<float>()));
+	}
+}
@@ -2,10 +2,40 @@
 // Written by Dr. Sergey Kosov in 2019 for Jacobs University
 #pragma once
 
-#include "types.h"
+#include "BoundingBox.h"
 
 namespace rt {
 	struct Ray;
+	class CScene;
+
+	// ================================ Light Bounds Structure ================================
+	/**
+	 * @brief Spatial and directional bounds of the light emission
+	 * @details The light is emitted from the points within the bounding box \b box into the directions, which deviate from the \b axis by at most \b acos(cosThetaO) + \b acos(cosThetaE):
+	 * the normals of the emitting surface lie within the cone of the angle \b acos(cosThetaO) around the \b axis, and every surface point emits within the angle \b acos(cosThetaE) around its normal.
+	 * These bounds are used for the importance sampling of many lights (@ref CLightBVH).
+	 */
+	struct LightBounds
+	{
+		CBoundingBox	box;								///< The bounding box of the emitting points
+		Vec3f			axis		= Vec3f(0, 0, 1);		///< The principal direction of the emission (normalized)
+		float			cosThetaO	= -1;					///< Cosine of the spread angle of the surface normals around the axis (-1 for the whole sphere)
+		float			cosThetaE	= 0;					///< Cosine of the emission angle around the surface normal
+		float			power		= 0;					///< The total emitted power (the maximal color component)
+	};
+
+	// ================================ Light Sample Structure ================================
+	/**
+	 * @brief Sample of the light, arriving at a point from a light source
+	 * @details The ratio \a radiance / \a pdf is the estimate of the light intensity at the point, as returned by ILight::illuminate()
+	 */
+	struct LightSample
+	{
+		Vec3f	direction;		///< The normalized direction from the point towards the sample on the light source
+		double	distance;		///< The distance from the point to the sample on the light source (the maximal hit distance of the shadow ray)
+		Vec3f	radiance;		///< The light, arriving at the point from the sample
+		float	pdf;			///< The probability density of the direction with respect to the solid angle; 1 for the point light sources
+	};
 
 	// ================================ Light Interface Class ================================
 	/**
@@ -25,18 +55,85 @@ namespace rt {
 		DllExport virtual ~ILight(void) = default;
 		DllExport const ILight& operator=(const ILight&) = delete;
 
+		/**
+		 * @brief Samples the light, arriving at a point from the light source
+		 * @details This method does not modify the light source and has no internal state, thus it may be called from several threads at once,
+		 * and the same sample \b u always gives the same result
+		 * @param point The point to be illuminated
+		 * @param normal The normal at the point. It is used only by the light sources, which sample the hemisphere around the point (@ref CLightSky)
+		 * @param u The sample from [0; 1)^2, defining the point on the light source (or the direction for the sky light). The point light sources ignore it
+		 * @return The light sample, or std::nullopt if the light source does not illuminate the point
+		 */
+		DllExport virtual std::optional<LightSample>	sample(const Vec3f& point, const Vec3f& normal, const Vec2f& u) const = 0;
+		/**
+		 * @brief Evaluates the light, arriving at a point from the given direction
+		 * @details This method is the counterpart of sample() for the directions, which were not sampled from the light source, \a e.g. the directions sampled from a BRDF (@ref IBRDF).
+		 * The returned pdf is the density, with which sample() would have produced the direction. Like sample(), this method is thread-safe.
+		 * @param point The point to be illuminated
+		 * @param normal The normal at the point
+		 * @param direction The normalized direction from the point
+		 * @return The light sample, or std::nullopt if the light source is not seen from the point in the direction \b direction. The point light sources are never seen
+		 */
+		DllExport virtual std::optional<LightSample>	evaluate(const Vec3f& point, const Vec3f& normal, const Vec3f& direction) const { return std::nullopt; }
+		/**
+		 * @brief Checks whether the light source is described by a delta distribution
+		 * @details The light of such light sources arrives at a point from one direction only, thus it may be only sampled with sample() and never found with evaluate()
+		 * @retval true If the light source is a point light source
+		 * @retval false Otherwise
+		 */
+		DllExport virtual bool							isDelta(void) const { return false; }
+		/**
+		 * @brief Calculates the light intensity at the point \b ray.org for the given sample on the light source
+		 * @details This function sets the \b ray.dir to be the the direction vector from the surface point \b ray.org to the light source and \b ray.t - to be the distance to it.
+		 * The intensity is the ratio of the radiance and the pdf of the sample (see sample()). Like sample(), this method is thread-safe.
+		 * @param[in, out] ray The ray from object point to the light source. The direction ray.dir is modified within the function
+		 * @param u The sample from [0; 1)^2, \a e.g. achieved with CSampler::stratifiedSample()
+		 * @return The intensity of light hitting the point \b ray.org
+		 */
+		DllExport virtual std::optional<Vec3f>	illuminate(Ray& ray, const Vec2f& u) const;
 		/**
 		 * @brief Calculates the light intensity, at the point \b ray.org which is to be illuminated.
 		 * @details This function sets the \b ray.dir to be the the direction vector from the surface point \b ray.org to the light source.
+		 * The sample on the light source is drawn at random
 		 * @param[in, out] ray The ray from object point to the light source. The direction ray.dir is modified within the function
 		 * @return The intensity of light hitting the point \b ray.org
 		 */
-		DllExport virtual std::optional<Vec3f>  illuminate(Ray& ray) = 0;
+		DllExport std::optional<Vec3f>			illuminate(Ray& ray) const;
 		/**
 		 * @brief Returns recommended number of samples for the particular light source implementation
 		 * @return The recommended number of samples
 		 */
 		DllExport virtual size_t				getNumSamples(void) const = 0;
+		/**
+		 * @brief Returns the number of samples, sufficient for illuminating the point
+		 * @details The light sources, which subtend a small solid angle from the point, cast narrow penumbrae and need fewer samples.
+		 * The default implementation returns getNumSamples()
+		 * @param point The point to be illuminated
+		 * @return The number of samples, not exceeding getNumSamples()
+		 */
+		DllExport virtual size_t				estimateNumSamples(const Vec3f& point) const { return getNumSamples(); }
+		/**
+		 * @brief Returns the spatial and directional bounds of the emission
+		 * @details The bounds are used for the importance sampling of many lights (@ref CLightBVH)
+		 * @retval LightBounds The bounds of the light source
+		 * @retval std::nullopt If the light source is unbounded (\a e.g. @ref CLightSky). Such lights are never culled and always illuminate the point
+		 */
+		DllExport virtual std::optional<LightBounds>	getBounds(void) const { return std::nullopt; }
+		/**
+		 * @brief Returns the bounding box of the influence volume of the light source
+		 * @details The light source does not illuminate the points outside of its influence volume. The influence volume is used for the light culling (@ref CLightGrid)
+		 * @retval CBoundingBox The bounding box of the influence volume
+		 * @retval std::nullopt If the influence of the light source is not limited in space
+		 */
+		DllExport virtual std::optional<CBoundingBox>	getInfluenceBox(void) const { return std::nullopt; }
+		/**
+		 * @brief Checks whether the light source may illuminate any point within the box
+		 * @details This test is conservative: it may return true for the boxes, which are not illuminated, but never returns false for the boxes, which are
+		 * @param box The bounding box
+		 * @retval true If the light source may illuminate some point within the box \b box
+		 * @retval false If the light source illuminates none of the points within the box \b box
+		 */
+		DllExport virtual bool							influences(const CBoundingBox& box) const { return true; }
 		/**
 		 * @brief Flag indicating if the light source casts shadow or not
 		 * @retval true If the light source casts shadow
@@ -51,10 +148,41 @@ namespace rt {
 		 * @brief Turns the shadow casting off
 		 */
 		DllExport void							turnShadowOff(void) { m_shadow = false; }
+		/**
+		 * @brief Turns the shadow map fast mode on
+		 * @details In this mode the shadows are not ray-traced for every sample: the depth shadow map is built once per frame by tracing the rays from the light source (see buildShadowMap()),
+		 * and the visibility of the shaded points is looked up in it with the percentage-closer filtering (see getShadowMapVisibility()). The shadows are approximate, but much cheaper,
+		 * which suits the preview renders.
+		 * @note Only the point light sources (@ref CLightOmni and @ref CLightSpot) support the shadow maps; the other light sources keep tracing the shadow rays
+		 * @param resolution The resolution of the shadow map (of every face of the cube map for @ref CLightOmni) in texels
+		 */
+		DllExport void							turnShadowMapOn(size_t resolution = 512) { m_shadowMapResolution = resolution; }
+		/**
+		 * @brief Turns the shadow map fast mode off
+		 */
+		DllExport void							turnShadowMapOff(void) { m_shadowMapResolution = 0; }
+		/**
+		 * @brief Returns the resolution of the shadow map
+		 * @return The resolution of the shadow map in texels; 0 if the shadow map fast mode is off
+		 */
+		DllExport size_t						getShadowMapResolution(void) const { return m_shadowMapResolution; }
+		/**
+		 * @brief Builds the shadow map of the light source, if the shadow map fast mode is on, or releases it otherwise
+		 * @note This method is called by CScene::render() once per frame. The default implementation does nothing
+		 * @param scene The scene
+		 */
+		DllExport virtual void					buildShadowMap(const CScene& scene) {}
+		/**
+		 * @brief Returns the visibility of the point from the light source, looked up in the shadow map
+		 * @param point The point
+		 * @return The visibility in [0; 1], or std::nullopt if the light source has no shadow map
+		 */
+		DllExport virtual std::optional<float>	getShadowMapVisibility(const Vec3f& point) const { return std::nullopt; }
 		
 		
 	private:
 		bool	m_shadow;
+		size_t	m_shadowMapResolution	= 0;	///< The resolution of the shadow map (0 if the shadow map fast mode is off)
 	};
 
 	using ptr_light_t = std::shared_ptr<ILight>;
@@ -2,16 +2,198 @@
 #include "Ray.h"
 
 namespace rt {
-	std::optional<Vec3f> CLightArea::illuminate(Ray& ray)
+	namespace {
+		const double minSolidAngle = 3e-4;		// Below this solid angle the spherical rectangle sampling is numerically unstable and the area sampling is used
+		const double fullSolidAngle = 0.05;		// From this solid angle on the area light is sampled with all the samples of its sampler
+
+		// Rectangular area, seen from a point, in the local coordinate system of the rectangle with the origin at the point (J. Urena et al. 2013, "An Area-Preserving Parametrization for Spherical Rectangles")
+		struct SphericalRectangle
+		{
+			Vec3f	ex, ey, ez;				// The axes of the local coordinate system
+			double	x0, x1, y0, y1, z0;		// The extent of the rectangle in the local coordinate system
+			double	b0, b1, g2g3;			// The auxiliary values for the sampling
+			double	solidAngle;				// The solid angle of the rectangle
+		};
+
+		// Returns the angle between two unit vectors
+		double angleBetween(const Vec3f& a, const Vec3f& b)
+		{
+			double cosAngle = a.dot(b);
+			return acos(MIN(MAX(cosAngle, -1.0), 1.0));
+		}
+
+		// Builds the spherical rectangle of the area org + [0; 1] * edge1 + [0; 1] * edge2 with orthogonal edges, seen from the point
+		SphericalRectangle makeSphericalRectangle(const Vec3f& org, const Vec3f& edge1, const Vec3f& edge2, const Vec3f& point)
+		{
+			SphericalRectangle res;
+			const float len1 = static_cast<float>(norm(edge1));
+			const float len2 = static_cast<float>(norm(edge2));
+			res.ex = edge1 / len1;
+			res.ey = edge2 / len2;
+			res.ez = res.ex.cross(res.ey);
+			const Vec3f d = org - point;
+			res.x0 = d.dot(res.ex);
+			res.y0 = d.dot(res.ey);
+			res.z0 = d.dot(res.ez);
+			if (res.z0 > 0) {
+				res.z0 = -res.z0;
+				res.ez = -res.ez;
+			}
+			res.x1 = res.x0 + len1;
+			res.y1 = res.y0 + len2;
+
+			// the normals of the planes through the point and the edges of the rectangle
+			const Vec3f v00(static_cast<float>(res.x0), static_cast<float>(res.y0), static_cast<float>(res.z0));
+			const Vec3f v01(static_cast<float>(res.x0), static_cast<float>(res.y1), static_cast<float>(res.z0));
+			const Vec3f v10(static_cast<float>(res.x1), static_cast<float>(res.y0), static_cast<float>(res.z0));
+			const Vec3f v11(static_cast<float>(res.x1), static_cast<float>(res.y1), static_cast<float>(res.z0));
+			const Vec3f n0 = normalize(v00.cross(v10));
+			const Vec3f n1 = normalize(v10.cross(v11));
+			const Vec3f n2 = normalize(v11.cross(v01));
+			const Vec3f n3 = normalize(v01.cross(v00));
+			const double g0 = angleBetween(-n0, n1);
+			const double g1 = angleBetween(-n1, n2);
+			const double g2 = angleBetween(-n2, n3);
+			const double g3 = angleBetween(-n3, n0);
+			res.b0			= n0[2];
+			res.b1			= n2[2];
+			res.g2g3		= g2 + g3;
+			res.solidAngle	= g0 + g1 + g2 + g3 - 2 * Pif;
+			return res;
+		}
+	}
+
+	std::optional<LightSample> CLightArea::sample(const Vec3f& point, const Vec3f&, const Vec2f& u) const
+	{
+		if ((point - m_org).dot(m_normal) <= 0) return std::nullopt;		// behind the light source
+
+		Vec3f org = m_org + u.val[0] * m_edge1 + u.val[1] * m_edge2;
+		double pdf = 0;
+		if (isRectangular()) {
+			// sampling of the solid angle, subtended by the rectangle
+			const SphericalRectangle sr = makeSphericalRectangle(m_org, m_edge1, m_edge2, point);
+			if (sr.solidAngle >= minSolidAngle) {
+				const double au = u[0] * sr.solidAngle - sr.g2g3;			// the solid angle of the sub-rectangle [x0; xu], shifted by (g2 + g3)
+				const double fu = (cos(au) * sr.b0 - sr.b1) / sin(au);
+				double cu = std::copysign(1 / sqrt(fu * fu + sr.b0 * sr.b0), fu);
+				cu = MIN(MAX(cu, -1 + 1e-7), 1 - 1e-7);
+				double xu = -(cu * sr.z0) / sqrt(1 - cu * cu);
+				xu = MIN(MAX(xu, sr.x0), sr.x1);
+				const double dd = sqrt(xu * xu + sr.z0 * sr.z0);
+				const double h0 = sr.y0 / sqrt(dd * dd + sr.y0 * sr.y0);
+				const double h1 = sr.y1 / sqrt(dd * dd + sr.y1 * sr.y1);
+				const double hv = h0 + u[1] * (h1 - h0);
+				const double yv = hv * hv < 1 - 1e-6 ? hv * dd / sqrt(1 - hv * hv) : sr.y1;
+				org = point + static_cast<float>(xu) * sr.ex + static_cast<float>(yv) * sr.ey + static_cast<float>(sr.z0) * sr.ez;
+				pdf = 1 / sr.solidAngle;
+			}
+		}
+
+		// direction towards the sampled point of the area
+		LightSample res;
+		res.direction	= org - point;
+		res.distance	= norm(res.direction);
+		if (res.distance > getRange()) return std::nullopt;		// outside of the influence volume
+		res.direction	= normalize(res.direction);
+
+		double cosN = -res.direction.dot(m_normal);
+		if (cosN <= 0) return std::nullopt;
+
+		// the uniform density over the area, converted to the solid angle measure
+		if (pdf == 0) pdf = res.distance * res.distance / (m_area * cosN);
+		res.pdf			= static_cast<float>(pdf);
+		// the area light attenuates its intensity additionally with the distance
+		res.radiance	= (1 / res.distance) * getIntensity();
+		return res;
+	}
+
+	std::optional<LightSample> CLightArea::evaluate(const Vec3f& point, const Vec3f&, const Vec3f& direction) const
 	{
-		Vec2f sample = m_pSampler->getNextSample();
-		Vec3f org = m_org + sample.val[0] * m_edge1 + sample.val[1] * m_edge2;
+		// intersection of the ray with the area
+		double cosN = -direction.dot(m_normal);
+		if (cosN <= 0) return std::nullopt;
+		double t = (point - m_org).dot(m_normal) / cosN;
+		if (t <= 0 || t > getRange()) return std::nullopt;
+		const Vec3f w = point + static_cast<float>(t) * direction - m_org;
+		const Vec3f N = m_edge1.cross(m_edge2);
+		const float denom = N.dot(N);
+		const float a = w.cross(m_edge2).dot(N) / denom;
+		const float b = m_edge1.cross(w).dot(N) / denom;
+		if (a < 0 || a > 1 || b < 0 || b > 1) return std::nullopt;
 
-		setOrigin(org);
-		auto res = CLightOmni::illuminate(ray);
+		LightSample res;
+		res.direction	= direction;
+		res.distance	= t;
+		res.radiance	= (1 / t) * getIntensity();
+		double pdf = 0;
+		if (isRectangular()) {
+			const double solidAngle = makeSphericalRectangle(m_org, m_edge1, m_edge2, point).solidAngle;
+			if (solidAngle >= minSolidAngle) pdf = 1 / solidAngle;
+		}
+		if (pdf == 0) pdf = t * t / (m_area * cosN);
+		res.pdf			= static_cast<float>(pdf);
+		return res;
+	}
+
+	size_t CLightArea::estimateNumSamples(const Vec3f& point) const
+	{
+		const size_t nSamples = getNumSamples();
+		const double distance = (point - m_org).dot(m_normal);
+		if (distance <= 0) return 1;										// behind the light source
+
+		double solidAngle;
+		if (isRectangular()) solidAngle = makeSphericalRectangle(m_org, m_edge1, m_edge2, point).solidAngle;
+		else {
+			const Vec3f toCenter = m_org + 0.5f * (m_edge1 + m_edge2) - point;
+			const double d = norm(toCenter);
+			solidAngle = m_area * distance / (d * d * d);					// area * cos / d^2
+		}
+		const double ratio = MIN(solidAngle / fullSolidAngle, 1.0);
+
+		// keep the number of samples square for the stratification
+		const size_t n = static_cast<size_t>(sqrt(static_cast<double>(nSamples)) + 0.5);
+		if (n * n == nSamples) {
+			const size_t k = static_cast<size_t>(ceil(n * sqrt(ratio)));
+			return MAX(k * k, 1);
+		}
+		return MAX(static_cast<size_t>(ceil(nSamples * ratio)), 1);
+	}
+
+	std::optional<LightBounds> CLightArea::getBounds(void) const
+	{
+		// one-sided lambertian emitter
+		const Vec3f intensity = getIntensity();
+		LightBounds res;
+		res.box.extend(m_org);
+		res.box.extend(m_org + m_edge1);
+		res.box.extend(m_org + m_edge2);
+		res.box.extend(m_org + m_edge1 + m_edge2);
+		res.axis		= m_normal;
+		res.cosThetaO	= 1;
+		res.cosThetaE	= 0;
+		res.power		= Pif * static_cast<float>(m_area) * MAX(MAX(intensity[0], intensity[1]), intensity[2]);
+		return res;
+	}
+
+	std::optional<CBoundingBox> CLightArea::getInfluenceBox(void) const
+	{
+		if (getRange() == Infty) return std::nullopt;
+		CBoundingBox res = getBounds()->box;
+		return CBoundingBox(res.getMinPoint() - Vec3f::all(getRange()), res.getMaxPoint() + Vec3f::all(getRange()));
+	}
+
+	bool CLightArea::influences(const CBoundingBox& box) const
+	{
+		// the light is emitted into the front half-space only: check the corner of the box, which is the farthest one in the direction of the normal
+		Vec3f corner;
+		for (int i = 0; i < 3; i++)
+			corner[i] = m_normal[i] > 0 ? box.getMaxPoint()[i] : box.getMinPoint()[i];
+		if ((corner - m_org).dot(m_normal) <= 0) return false;
+		if (getRange() == Infty) return true;
 
-		double cosN = -ray.dir.dot(m_normal) / ray.t;
-		if (cosN > 0)	return m_area * cosN * res.value();
-		else			return std::nullopt;
+		// the distance from the box to the bounding sphere of the area
+		Vec3f center = m_org + 0.5f * (m_edge1 + m_edge2);
+		float radius = static_cast<float>(MAX(norm(m_edge1 + m_edge2), norm(m_edge1 - m_edge2))) / 2 + getRange();
+		return box.getSquaredDistance(center) <= radius * radius;
 	}
 }
\ No newline at end of file
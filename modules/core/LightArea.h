@@ -24,7 +24,7 @@ namespace rt {
 		 * @param p1 The second point defining the quadrangular shape of the light source
 		 * @param p2 The third point defining the quadrangular shape of the light source
 		 * @param p3 The fourth point defining the quadrangular shape of the light source
-		 * @param pSampler Pointer to the sampler to be used with the area light
+		 * @param pSampler Pointer to the sampler, defining the number of samples of the area light (see getNumSamples())
 		 * @param castShadow Flag indicatin whether the light source casts shadow
 		 */
 		DllExport CLightArea(Vec3f intensity, Vec3f p0, Vec3f p1, Vec3f p2, Vec3f p3, ptr_sampler_t pSampler = std::make_shared<CSamplerStratified>(4, true), bool castShadow = true)
@@ -39,8 +39,24 @@ namespace rt {
 			m_normal = normalize(m_normal);
 		}
 
-		DllExport virtual std::optional<Vec3f>	illuminate(Ray& ray) override;
+		/**
+		 * @copydoc ILight::sample()
+		 * @details The rectangular area light sources are sampled uniformly over the solid angle, which they subtend (J. Urena et al. 2013, "An Area-Preserving Parametrization for Spherical Rectangles"),
+		 * thus the large and near light sources produce much less noise. The other ones and the ones subtending very small solid angle are sampled uniformly over the area.
+		 */
+		DllExport virtual std::optional<LightSample>	sample(const Vec3f& point, const Vec3f& normal, const Vec2f& u) const override;
+		DllExport virtual std::optional<LightSample>	evaluate(const Vec3f& point, const Vec3f& normal, const Vec3f& direction) const override;
+		DllExport virtual bool							isDelta(void) const override { return false; }
 		DllExport virtual size_t				getNumSamples(void) const override { return m_pSampler->getNumSamples(); }
+		/**
+		 * @copydoc ILight::estimateNumSamples()
+		 * @details The number of samples is proportional to the solid angle, subtended by the area light source, and reaches getNumSamples() for the solid angle of 0.05 steradian.
+		 * If getNumSamples() is a square number, the result is a square number as well, so that the samples remain stratified
+		 */
+		DllExport virtual size_t				estimateNumSamples(const Vec3f& point) const override;
+		DllExport virtual std::optional<LightBounds>	getBounds(void) const override;
+		DllExport virtual std::optional<CBoundingBox>	getInfluenceBox(void) const override;
+		DllExport virtual bool							influences(const CBoundingBox& box) const override;
 
 		/**
 		 * @brief Returns the normal of area light surface
@@ -49,12 +65,29 @@ namespace rt {
 		DllExport Vec3f getNormal(const Vec3f& position) const { return m_normal; }
 
 
+	protected:
+		/**
+		 * @copydoc CLightOmni::createShadowMap()
+		 * @details The area light source does not support the shadow maps
+		 */
+		DllExport virtual ptr_shadowmap_t	createShadowMap(size_t resolution) const override { return nullptr; }
+
+
+	private:
+		/**
+		 * @brief Checks whether the edges of the area are orthogonal
+		 * @retval true If the area is a rectangle
+		 * @retval false Otherwise
+		 */
+		bool			isRectangular(void) const { return fabs(m_edge1.dot(m_edge2)) <= 1e-4 * m_area; }
+
+
 	private:
 		Vec3f			m_org;		///< The origin of the area light source
 		Vec3f			m_edge1;	///< The vector defyning the first edge of the area
 		Vec3f			m_edge2;	///< The vector defyning the second edge of the area
 		double			m_area;		///< Area of the light source
 		Vec3f			m_normal;	///< Normal to the light source surface
-		ptr_sampler_t	m_pSampler;	///< Pointer to the sampler ref @ref CSampler
+		ptr_sampler_t	m_pSampler;	///< Pointer to the sampler ref @ref CSampler (only its number of samples is used, the samples are passed to sample())
 	};
 }
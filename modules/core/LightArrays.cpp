@@ -0,0 +1,111 @@
+#include "LightArrays.h"
+#include "LightSpotTarget.h"
+#include <typeinfo>
+
+namespace rt {
+	namespace {
+		// Appends the omnidirectional part of the light source to the arrays
+		template <typename T>
+		void push_back(T& lights, const CLightOmni& light)
+		{
+			const Vec3f org = light.getOrigin();
+			const Vec3f intensity = light.getIntensity();
+			for (int i = 0; i < 3; i++) {
+				lights.org[i].push_back(org[i]);
+				lights.intensity[i].push_back(intensity[i]);
+			}
+			lights.range.push_back(light.getRange());
+		}
+	}
+
+	void CLightArrays::build(const std::vector<ptr_light_t>& vpLights)
+	{
+		m_omni = OmniLights();
+		m_spot = SpotLights();
+		m_vpLights.clear();
+		m_vOtherLights.clear();
+
+		// only the exact types are grouped: the derived classes may sample the light differently
+		std::vector<const ILight*> vpSpotLights;
+		for (const auto& pLight : vpLights) {
+			const ILight& light = *pLight;
+			if (typeid(light) == typeid(CLightOmni)) {
+				push_back(m_omni, static_cast<const CLightOmni&>(light));
+				m_vpLights.push_back(&light);
+			}
+			else if (typeid(light) == typeid(CLightSpot) || typeid(light) == typeid(CLightSpotTarget)) {
+				const CLightSpot& spot = static_cast<const CLightSpot&>(light);
+				push_back(m_spot, spot);
+				const Vec3f dir = spot.getDirection();
+				for (int i = 0; i < 3; i++) m_spot.dir[i].push_back(dir[i]);
+				m_spot.alpha.push_back(spot.getAlpha());
+				m_spot.beta.push_back(spot.getBeta());
+				m_spot.cosAlpha.push_back(cosf(MIN(spot.getAlpha(), 180.0f) * Pif / 180));
+				m_spot.cosAlphaBeta.push_back(cosf(MIN(spot.getAlpha() + spot.getBeta(), 180.0f) * Pif / 180));
+				vpSpotLights.push_back(&light);
+			}
+			else m_vOtherLights.emplace_back(pLight.get(), 1.0f);
+		}
+		m_vpLights.insert(m_vpLights.end(), vpSpotLights.begin(), vpSpotLights.end());
+	}
+
+	void CLightArrays::illuminate(const OmniLights& lights, const Vec3f& point, LightArraySamples& samples, size_t offset)
+	{
+		const size_t n = lights.range.size();
+		const float px = point[0], py = point[1], pz = point[2];
+		float* pDirX = samples.dir[0].data() + offset;
+		float* pDirY = samples.dir[1].data() + offset;
+		float* pDirZ = samples.dir[2].data() + offset;
+		float* pDistance = samples.distance.data() + offset;
+		float* pR = samples.radiance[0].data() + offset;
+		float* pG = samples.radiance[1].data() + offset;
+		float* pB = samples.radiance[2].data() + offset;
+		for (size_t i = 0; i < n; i++) {
+			const float dx = lights.org[0][i] - px;
+			const float dy = lights.org[1][i] - py;
+			const float dz = lights.org[2][i] - pz;
+			const float d2 = dx * dx + dy * dy + dz * dz;
+			const float d = sqrtf(d2);
+			const float invD = 1 / d;
+			const float attenuation = d <= lights.range[i] ? 1 / d2 : 0;		// outside of the range there is no light
+			pDirX[i] = dx * invD;
+			pDirY[i] = dy * invD;
+			pDirZ[i] = dz * invD;
+			pDistance[i] = d;
+			pR[i] = attenuation * lights.intensity[0][i];
+			pG[i] = attenuation * lights.intensity[1][i];
+			pB[i] = attenuation * lights.intensity[2][i];
+		}
+	}
+
+	void CLightArrays::illuminate(const Vec3f& point, LightArraySamples& samples) const
+	{
+		samples.resize(m_vpLights.size());
+
+		// ------ omnidirectional light sources ------
+		illuminate(m_omni, point, samples, 0);
+
+		// ------ spot light sources: the omnidirectional light, attenuated by the cones ------
+		const size_t offset = m_omni.range.size();
+		illuminate(m_spot, point, samples, offset);
+		const size_t n = m_spot.range.size();
+		const float* pDirX = samples.dir[0].data() + offset;
+		const float* pDirY = samples.dir[1].data() + offset;
+		const float* pDirZ = samples.dir[2].data() + offset;
+		float* pR = samples.radiance[0].data() + offset;
+		float* pG = samples.radiance[1].data() + offset;
+		float* pB = samples.radiance[2].data() + offset;
+		for (size_t i = 0; i < n; i++) {
+			const float cosAngle = -(m_spot.dir[0][i] * pDirX[i] + m_spot.dir[1][i] * pDirY[i] + m_spot.dir[2][i] * pDirZ[i]);
+			float scale = 1;																			// 100% light
+			if (cosAngle < m_spot.cosAlphaBeta[i]) scale = 0;											// no light
+			else if (cosAngle < m_spot.cosAlpha[i]) {
+				const float k = (acosf(cosAngle) * 180 / Pif - m_spot.alpha[i]) / m_spot.beta[i];		// k \in (0, 1]
+				scale = (1 + cosf(Pif * k)) / 2;														// attenuated light
+			}
+			pR[i] *= scale;
+			pG[i] *= scale;
+			pB[i] *= scale;
+		}
+	}
+}
@@ -0,0 +1,112 @@
+// Type-grouped Light Arrays class
+#pragma once
+
+#include "ILight.h"
+
+namespace rt {
+	// ================================ Light Array Samples Structure ================================
+	/**
+	 * @brief The light, arriving at a point from the light sources of @ref CLightArrays, in the Structure of Arrays (SoA) layout
+	 * @details The i-th element describes the i-th light source of the arrays (see CLightArrays::getLight()). The light sources, which do not illuminate the point, have zero radiance
+	 */
+	struct LightArraySamples
+	{
+		std::vector<float>	dir[3];				///< The normalized directions from the point towards the light sources: dir[axis][light]
+		std::vector<float>	distance;			///< The distances from the point to the light sources
+		std::vector<float>	radiance[3];		///< The light, arriving at the point: radiance[channel][light]
+
+		/**
+		 * @brief Resizes the arrays
+		 * @param n The number of the light sources
+		 */
+		void	resize(size_t n)
+		{
+			for (int i = 0; i < 3; i++) {
+				dir[i].resize(n);
+				radiance[i].resize(n);
+			}
+			distance.resize(n);
+		}
+	};
+
+	// ================================ Light Arrays Class ================================
+	/**
+	 * @brief Type-grouped arrays of the point light sources
+	 * @details The point light sources (@ref CLightOmni, @ref CLightSpot and @ref CLightSpotTarget) are compiled into the Structure of Arrays (SoA) layout: the positions, the intensities, the ranges
+	 * and the spot cones of every type are stored in separate contiguous arrays. Thus all the light sources of a type are evaluated in one loop without virtual calls, which the compiler may vectorize.
+	 * The other light sources, including the ones derived from the point light sources (\a e.g. @ref CLightArea), are not grouped and are evaluated through the ILight interface.
+	 * @note The arrays are a snapshot of the light sources: they are compiled by CScene at the start of every render
+	 * @ingroup moduleLight
+	 */
+	class CLightArrays
+	{
+	public:
+		DllExport CLightArrays(void) = default;
+		DllExport CLightArrays(const CLightArrays&) = delete;
+		DllExport ~CLightArrays(void) = default;
+		DllExport const CLightArrays& operator=(const CLightArrays&) = delete;
+
+		/**
+		 * @brief Compiles the arrays
+		 * @param vpLights The light sources
+		 */
+		DllExport void		build(const std::vector<ptr_light_t>& vpLights);
+		/**
+		 * @brief Evaluates the light, arriving at the point from all the grouped light sources
+		 * @param point The point to be illuminated
+		 * @param[out] samples The light samples, one per grouped light source
+		 */
+		DllExport void		illuminate(const Vec3f& point, LightArraySamples& samples) const;
+		/**
+		 * @brief Returns the number of the grouped light sources
+		 * @return The number of the grouped light sources
+		 */
+		DllExport size_t	size(void) const { return m_vpLights.size(); }
+		/**
+		 * @brief Returns the grouped light source
+		 * @param i The index of the light source: the omnidirectional light sources go first, followed by the spot light sources
+		 * @return The light source
+		 */
+		DllExport const ILight&	getLight(size_t i) const { return *m_vpLights[i]; }
+		/**
+		 * @brief Returns the light sources, which are not grouped
+		 * @return The vector of pairs: the pointer to the light source and the weight 1 of its illumination (see CScene::getLights(const Vec3f&, const Vec3f&) const)
+		 */
+		DllExport const std::vector<std::pair<ILight*, float>>&	getOtherLights(void) const { return m_vOtherLights; }
+
+
+	private:
+		/// The omnidirectional light sources
+		struct OmniLights
+		{
+			std::vector<float>	org[3];				///< The positions: org[axis][light]
+			std::vector<float>	intensity[3];		///< The intensities: intensity[channel][light]
+			std::vector<float>	range;				///< The ranges
+		};
+		/// The spot light sources
+		struct SpotLights : OmniLights
+		{
+			std::vector<float>	dir[3];				///< The directions of the cones: dir[axis][light]
+			std::vector<float>	alpha;				///< The half-opening angles of the cones with constant illumination in degrees
+			std::vector<float>	beta;				///< The additional half-opening angles for the attenuated illumination in degrees
+			std::vector<float>	cosAlpha;			///< Cosines of the half-opening angles of the cones with constant illumination
+			std::vector<float>	cosAlphaBeta;		///< Cosines of the half-opening angles of the whole illuminated cones
+		};
+
+		/**
+		 * @brief Evaluates the omnidirectional light sources
+		 * @param lights The light sources
+		 * @param point The point to be illuminated
+		 * @param[out] samples The light samples
+		 * @param offset The index of the first light source in \b samples
+		 */
+		static void	illuminate(const OmniLights& lights, const Vec3f& point, LightArraySamples& samples, size_t offset);
+
+
+	private:
+		OmniLights									m_omni;				///< The omnidirectional light sources
+		SpotLights									m_spot;				///< The spot light sources
+		std::vector<const ILight*>					m_vpLights;			///< The grouped light sources in the order of the samples
+		std::vector<std::pair<ILight*, float>>		m_vOtherLights;		///< The light sources, which are not grouped, with the weight 1
+	};
+}
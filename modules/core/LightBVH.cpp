@@ -0,0 +1,260 @@
+#include "LightBVH.h"
+#include "macroses.h"
+
+namespace rt {
+	namespace {
+		const size_t	nBins				= 12;								// Number of bins for the SAOH evaluation
+		const float		oneMinusEpsilon		= 0x1.fffffep-1f;					// The largest float below 1
+
+		inline float safeSqrt(float x) { return sqrtf(MAX(x, 0.0f)); }
+		inline float safeAcos(float x) { return acosf(MIN(MAX(x, -1.0f), 1.0f)); }
+
+		// Returns cos(a - b) for the angles a and b, or 1 if a < b
+		inline float cosSubClamped(float sinA, float cosA, float sinB, float cosB)
+		{
+			if (cosA > cosB) return 1;
+			return cosA * cosB + sinA * sinB;
+		}
+
+		// Returns sin(a - b) for the angles a and b, or 0 if a < b
+		inline float sinSubClamped(float sinA, float cosA, float sinB, float cosB)
+		{
+			if (cosA > cosB) return 0;
+			return sinA * cosB - cosA * sinB;
+		}
+
+		// Returns the smallest cone, containing the cones (axisA, cosA) and (axisB, cosB)
+		std::pair<Vec3f, float> coneUnion(const Vec3f& axisA, float cosA, const Vec3f& axisB, float cosB)
+		{
+			const float thetaA = safeAcos(cosA);
+			const float thetaB = safeAcos(cosB);
+			const float thetaD = safeAcos(axisA.dot(axisB));
+			if (MIN(thetaD + thetaB, Pif) <= thetaA) return std::make_pair(axisA, cosA);
+			if (MIN(thetaD + thetaA, Pif) <= thetaB) return std::make_pair(axisB, cosB);
+
+			const float thetaO = (thetaA + thetaD + thetaB) / 2;
+			if (thetaO >= Pif) return std::make_pair(axisA, -1.0f);
+
+			// rotate axisA towards axisB
+			Vec3f k = axisA.cross(axisB);
+			if (k.dot(k) == 0) return std::make_pair(axisA, -1.0f);
+			k = normalize(k);
+			const float thetaR = thetaO - thetaA;
+			return std::make_pair(normalize(cosf(thetaR) * axisA + sinf(thetaR) * k.cross(axisA)), cosf(thetaO));
+		}
+
+		// Returns the bounds of the union of the lights
+		LightBounds merge(const LightBounds& a, const LightBounds& b)
+		{
+			if (a.power == 0) return b;
+			if (b.power == 0) return a;
+			LightBounds res;
+			res.box = a.box;
+			res.box.extend(b.box);
+			std::tie(res.axis, res.cosThetaO) = coneUnion(a.axis, a.cosThetaO, b.axis, b.cosThetaO);
+			res.cosThetaE	= MIN(a.cosThetaE, b.cosThetaE);
+			res.power		= a.power + b.power;
+			return res;
+		}
+
+		// Returns the conservative estimate of the illumination of the point (with the normal) by the lights within the bounds
+		float importance(const LightBounds& bounds, const Vec3f& point, const Vec3f& normal)
+		{
+			const Vec3f minPoint	= bounds.box.getMinPoint();
+			const Vec3f maxPoint	= bounds.box.getMaxPoint();
+			const Vec3f center		= bounds.box.getCenter();
+			const float radius		= static_cast<float>(norm(maxPoint - minPoint)) / 2;
+
+			// clamp the squared distance to avoid the singularity for the points close to the lights
+			Vec3f wi = point - center;
+			const float d2	= MAX(wi.dot(wi), radius);
+			const float d	= sqrtf(wi.dot(wi));
+			if (d > 0) wi = (1 / d) * wi;
+
+			// the angle, subtended by the bounding sphere of the box
+			const float cosThetaB = d > radius ? safeSqrt(1 - radius * radius / (d * d)) : -1.0f;
+			const float sinThetaB = safeSqrt(1 - cosThetaB * cosThetaB);
+
+			// the minimal angle between the emission cone and the direction to the point
+			const float cosThetaW	= bounds.axis.dot(wi);
+			const float sinThetaW	= safeSqrt(1 - cosThetaW * cosThetaW);
+			const float sinThetaO	= safeSqrt(1 - bounds.cosThetaO * bounds.cosThetaO);
+			const float cosThetaX	= cosSubClamped(sinThetaW, cosThetaW, sinThetaO, bounds.cosThetaO);
+			const float sinThetaX	= sinSubClamped(sinThetaW, cosThetaW, sinThetaO, bounds.cosThetaO);
+			const float cosThetaP	= cosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+			if (cosThetaP < bounds.cosThetaE) return 0;
+
+			float res = bounds.power * cosThetaP / d2;
+
+			// the minimal angle between the normal and the direction to the lights
+			if (normal.dot(normal) > 0) {
+				const float cosThetaI	= fabsf(normal.dot(wi));
+				const float sinThetaI	= safeSqrt(1 - cosThetaI * cosThetaI);
+				res *= cosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+			}
+			return MAX(res, 0.0f);
+		}
+
+		// Returns the SAOH cost of the lights within the bounds: the power times the measures of the bounds in the space of positions and directions
+		// The squared diagonal of the box is used instead of its surface area, since the boxes of the point lights are degenerate
+		float cost(const LightBounds& bounds)
+		{
+			if (bounds.power == 0) return 0;
+			const float thetaO		= safeAcos(bounds.cosThetaO);
+			const float thetaE		= safeAcos(bounds.cosThetaE);
+			const float thetaW		= MIN(thetaO + thetaE, Pif);
+			const float sinThetaO	= safeSqrt(1 - bounds.cosThetaO * bounds.cosThetaO);
+			const float omega		= 2 * Pif * (1 - bounds.cosThetaO) + Pif / 2 * (2 * thetaW * sinThetaO - cosf(thetaO - 2 * thetaW) - 2 * thetaO * sinThetaO + bounds.cosThetaO);
+			const Vec3f diagonal	= bounds.box.getMaxPoint() - bounds.box.getMinPoint();
+			return bounds.power * omega * diagonal.dot(diagonal);
+		}
+	}
+
+	void CLightBVH::build(const std::vector<ptr_light_t>& vpLights)
+	{
+		m_vNodes.clear();
+		m_vLightNodes.assign(vpLights.size(), -1);
+		m_vUnboundedLights.clear();
+
+		std::vector<std::pair<size_t, LightBounds>> vLights;
+		vLights.reserve(vpLights.size());
+		for (size_t i = 0; i < vpLights.size(); i++) {
+			auto bounds = vpLights[i]->getBounds();
+			if (!bounds)				m_vUnboundedLights.push_back(i);
+			else if (bounds->power > 0)	vLights.emplace_back(i, bounds.value());
+		}
+		if (vLights.empty()) return;
+
+		m_vNodes.reserve(2 * vLights.size() - 1);
+		buildRecursive(vLights, 0, vLights.size(), -1);
+#ifdef DEBUG_PRINT_INFO
+		std::cout << "Light BVH: " << vLights.size() << " lights, " << m_vNodes.size() << " nodes" << std::endl;
+#endif
+	}
+
+	std::optional<std::pair<size_t, float>> CLightBVH::sample(const Vec3f& point, const Vec3f& normal, float u) const
+	{
+		if (m_vNodes.empty() || importance(m_vNodes[0].bounds, point, normal) == 0) return std::nullopt;
+
+		u = MIN(u, oneMinusEpsilon);
+		float pdf = 1;
+		int node = 0;
+		while (!m_vNodes[node].isLeaf()) {
+			// choose the child proportionally to its importance and re-use the random number for the next level
+			const int left	= node + 1;
+			const int right	= m_vNodes[node].right;
+			const float importanceLeft	= importance(m_vNodes[left].bounds, point, normal);
+			const float importanceRight	= importance(m_vNodes[right].bounds, point, normal);
+			if (importanceLeft == 0 && importanceRight == 0) return std::nullopt;
+
+			const float p = importanceLeft / (importanceLeft + importanceRight);
+			if (u < p) {
+				node = left;
+				u = MIN(u / p, oneMinusEpsilon);
+				pdf *= p;
+			} else {
+				node = right;
+				u = MIN((u - p) / (1 - p), oneMinusEpsilon);
+				pdf *= 1 - p;
+			}
+		}
+		return std::make_pair(m_vNodes[node].light, pdf);
+	}
+
+	float CLightBVH::pdf(const Vec3f& point, const Vec3f& normal, size_t light) const
+	{
+		if (light >= m_vLightNodes.size() || m_vLightNodes[light] < 0) return 0;
+		if (importance(m_vNodes[0].bounds, point, normal) == 0) return 0;
+
+		// the product of the probabilities of choosing the nodes on the path from the root to the leaf
+		float res = 1;
+		int node = m_vLightNodes[light];
+		while (m_vNodes[node].parent >= 0) {
+			const int parent = m_vNodes[node].parent;
+			const float importanceLeft	= importance(m_vNodes[parent + 1].bounds, point, normal);
+			const float importanceRight	= importance(m_vNodes[m_vNodes[parent].right].bounds, point, normal);
+			if (importanceLeft == 0 && importanceRight == 0) return 0;
+			res *= (node == parent + 1 ? importanceLeft : importanceRight) / (importanceLeft + importanceRight);
+			node = parent;
+		}
+		return res;
+	}
+
+	// ---------------------- private ----------------------
+	int CLightBVH::buildRecursive(std::vector<std::pair<size_t, LightBounds>>& vLights, size_t begin, size_t end, int parent)
+	{
+		const int res = static_cast<int>(m_vNodes.size());
+		m_vNodes.emplace_back();
+		m_vNodes[res].parent = parent;
+
+		if (end - begin == 1) {
+			m_vNodes[res].bounds	= vLights[begin].second;
+			m_vNodes[res].light		= vLights[begin].first;
+			m_vLightNodes[vLights[begin].first] = res;
+			return res;
+		}
+
+		CBoundingBox centroidBox;
+		for (size_t i = begin; i < end; i++)
+			centroidBox.extend(vLights[i].second.box.getCenter());
+		const Vec3f minPoint	= centroidBox.getMinPoint();
+		const Vec3f extent		= centroidBox.getMaxPoint() - minPoint;
+		const float maxExtent	= MAX(MAX(extent[0], extent[1]), extent[2]);
+
+		auto getBin = [&](const LightBounds& bounds, int dim) { return MIN(static_cast<size_t>(nBins * (bounds.box.getCenter()[dim] - minPoint[dim]) / extent[dim]), nBins - 1); };
+
+		// Binned SAOH: the cost of a split is the sum of the children's costs; the splits along the thin dimensions are penalized
+		int		splitDim	= -1;
+		size_t	splitBin	= 0;
+		float	minCost		= Infty;
+		for (int dim = 0; dim < 3; dim++) {
+			if (extent[dim] <= 0) continue;
+
+			LightBounds vBins[nBins];
+			for (size_t i = begin; i < end; i++) {
+				LightBounds& bin = vBins[getBin(vLights[i].second, dim)];
+				bin = merge(bin, vLights[i].second);
+			}
+
+			// costs of the bins above every split, accumulated from the right
+			float vAboveCost[nBins];
+			LightBounds above;
+			for (size_t b = nBins - 1; b > 0; b--) {
+				above = merge(above, vBins[b]);
+				vAboveCost[b] = cost(above);
+			}
+
+			const float kr = maxExtent / extent[dim];
+			LightBounds below;
+			for (size_t b = 1; b < nBins; b++) {
+				below = merge(below, vBins[b - 1]);
+				const float c = kr * (cost(below) + vAboveCost[b]);
+				if (c < minCost) {
+					minCost		= c;
+					splitDim	= dim;
+					splitBin	= b;
+				}
+			}
+		}
+
+		size_t mid = begin;
+		if (splitDim >= 0) {
+			auto it = std::partition(vLights.begin() + begin, vLights.begin() + end, [&](const std::pair<size_t, LightBounds>& light) { return getBin(light.second, splitDim) < splitBin; });
+			mid = static_cast<size_t>(it - vLights.begin());
+		}
+		if (mid == begin || mid == end) {
+			// all the lights fall into one bin, or they share the same position: split them in halves
+			mid = (begin + end) / 2;
+			int dim = extent[0] >= extent[1] ? (extent[0] >= extent[2] ? 0 : 2) : (extent[1] >= extent[2] ? 1 : 2);
+			std::nth_element(vLights.begin() + begin, vLights.begin() + mid, vLights.begin() + end, [dim](const std::pair<size_t, LightBounds>& a, const std::pair<size_t, LightBounds>& b) {
+				return a.second.box.getCenter()[dim] < b.second.box.getCenter()[dim];
+			});
+		}
+
+		buildRecursive(vLights, begin, mid, res);
+		const int right = buildRecursive(vLights, mid, end, res);
+		m_vNodes[res].right		= right;
+		m_vNodes[res].bounds	= merge(m_vNodes[res + 1].bounds, m_vNodes[right].bounds);
+		return res;
+	}
+}
@@ -0,0 +1,90 @@
+// Light Bounding Volume Hierarchy (BVH) class
+#pragma once
+
+#include "ILight.h"
+
+namespace rt {
+	// ================================ Light BVH Node Structure ================================
+	/**
+	 * @brief Node of the light BVH
+	 * @details The left child of a branch node immediately follows the node in the array of nodes
+	 */
+	struct LightBVHNode
+	{
+		LightBounds	bounds;				///< The bounds of all the lights in the sub-tree
+		int			parent	= -1;		///< Index of the parent node (-1 for the root node)
+		int			right	= -1;		///< Index of the right child node (-1 for leaf nodes)
+		size_t		light	= 0;		///< Index of the light of a leaf node
+
+		/**
+		 * @brief Checks whether the node is either leaf or branch node
+		 * @retval true if the node is the leaf-node
+		 * @retval false if the node is a branch-node
+		 */
+		bool isLeaf(void) const { return right < 0; }
+	};
+
+	// ================================ Light BVH Class ================================
+	/**
+	 * @brief Bounding Volume Hierarchy (BVH) over the light sources for the importance sampling of many lights
+	 * @details Illuminating a point with every light costs one shadow ray per light. Instead, the light BVH picks a light stochastically with the probability,
+	 * proportional to the estimate of its contribution to the point: the tree is traversed from the root, and at every node a child is chosen with the probability,
+	 * proportional to the importance of its bounds (@ref LightBounds), which accounts for the power, the distance and the orientation of all the lights in the sub-tree.
+	 * Thus a light is picked in O(log N), and its illumination, weighted with the reciprocal of the pick probability, is an unbiased estimate of the illumination by all the lights.
+	 *
+	 * The tree is built top-down with the binned Surface Area Orientation Heuristic (SAOH) and every leaf holds exactly one light.
+	 * The unbounded lights (\a e.g. @ref CLightSky) and the lights, emitting no power, are not stored in the tree.
+	 * @ingroup moduleLight
+	 */
+	class CLightBVH
+	{
+	public:
+		DllExport CLightBVH(void) = default;
+		DllExport CLightBVH(const CLightBVH&) = delete;
+		DllExport ~CLightBVH(void) = default;
+		DllExport const CLightBVH& operator=(const CLightBVH&) = delete;
+
+		/**
+		 * @brief Builds the tree
+		 * @param vpLights The light sources
+		 */
+		DllExport void								build(const std::vector<ptr_light_t>& vpLights);
+		/**
+		 * @brief Picks a light source for illuminating a point
+		 * @param point The point to be illuminated
+		 * @param normal The normal at the point. The zero vector may be used for the points, which are illuminated from all directions
+		 * @param u The random number, uniformly distributed in [0; 1)
+		 * @return The pair: the index of the picked light in the vector passed to build() and the probability of picking it,
+		 * or std::nullopt if none of the lights in the tree may illuminate the point
+		 */
+		DllExport std::optional<std::pair<size_t, float>>	sample(const Vec3f& point, const Vec3f& normal, float u) const;
+		/**
+		 * @brief Returns the probability of picking the light source with sample()
+		 * @param point The point to be illuminated
+		 * @param normal The normal at the point
+		 * @param light The index of the light in the vector passed to build()
+		 * @return The probability of picking the light, which is 0 for the lights not stored in the tree
+		 */
+		DllExport float								pdf(const Vec3f& point, const Vec3f& normal, size_t light) const;
+		/**
+		 * @brief Returns the indices of the unbounded lights, which are not stored in the tree
+		 * @return The indices of the unbounded lights in the vector passed to build()
+		 */
+		DllExport const std::vector<size_t>&		getUnboundedLights(void) const { return m_vUnboundedLights; }
+		/**
+		 * @brief Returns the nodes of the tree
+		 * @return The nodes of the tree; the first node is the root node
+		 */
+		DllExport const std::vector<LightBVHNode>&	getNodes(void) const { return m_vNodes; }
+
+
+	private:
+		int											buildRecursive(std::vector<std::pair<size_t, LightBounds>>& vLights, size_t begin, size_t end, int parent);	///< Helper method to build the sub-tree over the lights [begin; end)
+
+
+	private:
+		std::vector<LightBVHNode>					m_vNodes;				///< The nodes of the tree
+		std::vector<int>							m_vLightNodes;			///< The index of the leaf node of every light (-1 for the lights not stored in the tree)
+		std::vector<size_t>							m_vUnboundedLights;		///< The indices of the unbounded lights
+	};
+}
@@ -0,0 +1,128 @@
+#include "LightEnvironment.h"
+#include "macroses.h"
+
+namespace rt {
+	namespace {
+		// Returns the scalar brightness of the color
+		float luminance(const Vec3f& color) { return (color[0] + color[1] + color[2]) / 3; }
+
+		// Samples the piecewise-constant 1D distribution, given by its normalized cdf with n + 1 values; returns the continuous sample in [0; 1) and the index of the segment
+		float sampleCdf(const float* cdf, size_t n, float u, size_t& idx)
+		{
+			idx = static_cast<size_t>(std::upper_bound(cdf, cdf + n + 1, u) - cdf);
+			idx = MIN(MAX(idx, 1), n) - 1;
+			const float width = cdf[idx + 1] - cdf[idx];
+			const float du = width > 0 ? (u - cdf[idx]) / width : 0.5f;
+			return MIN((idx + MIN(MAX(du, 0.0f), 1.0f)) / n, 1.0f - std::numeric_limits<float>::epsilon());
+		}
+
+		// Builds the normalized cdf with n + 1 values of the function with n values; returns the integral of the function over [0; 1]
+		float buildCdf(const float* func, size_t n, float* cdf)
+		{
+			cdf[0] = 0;
+			for (size_t i = 0; i < n; i++)
+				cdf[i + 1] = cdf[i] + func[i] / n;
+			const float integral = cdf[n];
+			for (size_t i = 1; i <= n; i++)
+				cdf[i] = integral > 0 ? cdf[i] / integral : static_cast<float>(i) / n;
+			return integral;
+		}
+	}
+
+	CLightEnvironment::CLightEnvironment(const ptr_texture_t pMap, const Vec3f& intensity, size_t nSamples, bool castShadow)
+		: ILight(castShadow)
+		, m_pMap(pMap)
+		, m_intensity(intensity)
+		, m_nSamples(nSamples)
+	{
+		RT_ASSERT_MSG(m_pMap && !m_pMap->empty(), "The environment map is empty");
+		const size_t rows = static_cast<size_t>(m_pMap->rows);
+		const size_t cols = static_cast<size_t>(m_pMap->cols);
+
+		// the function: luminance, weighted with the solid angle of the texel rows
+		m_vFunc.resize(rows * cols);
+		for (size_t y = 0; y < rows; y++) {
+			const float sinTheta = sinf(Pif * (y + 0.5f) / rows);
+			const Vec3f* pRow = m_pMap->ptr<Vec3f>(static_cast<int>(y));
+			for (size_t x = 0; x < cols; x++)
+				m_vFunc[y * cols + x] = MAX(luminance(pRow[x]), 0.0f) * sinTheta;
+		}
+
+		// conditional and marginal distributions
+		m_vConditionalCdf.resize(rows * (cols + 1));
+		m_vRowIntegrals.resize(rows);
+		for (size_t y = 0; y < rows; y++)
+			m_vRowIntegrals[y] = buildCdf(m_vFunc.data() + y * cols, cols, m_vConditionalCdf.data() + y * (cols + 1));
+		m_vMarginalCdf.resize(rows + 1);
+		m_integral = buildCdf(m_vRowIntegrals.data(), rows, m_vMarginalCdf.data());
+		if (m_integral <= 0) RT_WARNING("The environment map is black");
+	}
+
+	Vec3f CLightEnvironment::getDirection(const Vec2f& uv)
+	{
+		const float theta	= Pif * uv[1];
+		const float phi		= Pif * (2 * uv[0] - 1);
+		const float sinTheta = sinf(theta);
+		return Vec3f(-sinTheta * sinf(phi), cosf(theta), sinTheta * cosf(phi));
+	}
+
+	Vec2f CLightEnvironment::getTextureCoords(const Vec3f& direction)
+	{
+		const float theta	= acosf(MIN(MAX(direction[1], -1.0f), 1.0f));
+		const float phi		= atan2f(-direction[0], direction[2]);
+		return Vec2f(0.5f * (phi / Pif + 1), theta / Pif);
+	}
+
+	Vec3f CLightEnvironment::getRadiance(const Vec2f& uv, float& pdf) const
+	{
+		const int x = MIN(MAX(static_cast<int>(uv[0] * m_pMap->cols), 0), m_pMap->cols - 1);
+		const int y = MIN(MAX(static_cast<int>(uv[1] * m_pMap->rows), 0), m_pMap->rows - 1);
+		pdf = m_integral > 0 ? m_vFunc[static_cast<size_t>(y) * m_pMap->cols + x] / m_integral : 0;
+		return m_intensity.mul(m_pMap->at<Vec3f>(y, x));
+	}
+
+	Vec3f CLightEnvironment::getRadiance(const Vec3f& direction) const
+	{
+		float pdf;
+		return getRadiance(getTextureCoords(direction), pdf);
+	}
+
+	std::optional<LightSample> CLightEnvironment::sample(const Vec3f&, const Vec3f& normal, const Vec2f& u) const
+	{
+		if (m_integral <= 0) return std::nullopt;
+		const size_t cols = static_cast<size_t>(m_pMap->cols);
+
+		size_t y, x;
+		Vec2f uv;
+		uv[1] = sampleCdf(m_vMarginalCdf.data(), m_vRowIntegrals.size(), u[1], y);
+		uv[0] = sampleCdf(m_vConditionalCdf.data() + y * (cols + 1), cols, u[0], x);
+
+		LightSample res;
+		res.direction = getDirection(uv);
+		if (normal != Vec3f::all(0) && res.direction.dot(normal) <= 0) return std::nullopt;
+
+		// the density on [0; 1]^2 is converted to the solid angle: dw = 2 Pi^2 sin(theta) du dv
+		const float sinTheta = sinf(Pif * uv[1]);
+		float pdf;
+		res.radiance	= getRadiance(uv, pdf);
+		res.distance	= Infty;
+		res.pdf			= sinTheta > 0 ? pdf / (2 * Pif * Pif * sinTheta) : 0;
+		if (res.pdf <= 0) return std::nullopt;
+		return res;
+	}
+
+	std::optional<LightSample> CLightEnvironment::evaluate(const Vec3f&, const Vec3f& normal, const Vec3f& direction) const
+	{
+		if (normal != Vec3f::all(0) && direction.dot(normal) <= 0) return std::nullopt;
+		const Vec2f uv = getTextureCoords(direction);
+		const float sinTheta = sinf(Pif * uv[1]);
+
+		float pdf;
+		LightSample res;
+		res.direction	= direction;
+		res.radiance	= getRadiance(uv, pdf);
+		res.distance	= Infty;
+		res.pdf			= sinTheta > 0 ? pdf / (2 * Pif * Pif * sinTheta) : 0;
+		return res;
+	}
+}
@@ -0,0 +1,78 @@
+// Environment Light Source class
+#pragma once
+
+#include "ILight.h"
+#include "Texture.h"
+
+namespace rt {
+	// ================================ Environment Light Class ================================
+	/**
+	 * @brief Environment light source class
+	 * @details The light arrives at the scene from the infinitely distant sphere, textured with the equirectangular (latitude-longitude) map.
+	 * The texture coordinate \a u corresponds to the longitude and \a v - to the polar angle, measured from the up direction (+y), so that the top row of the map is the zenith.
+	 * The mapping is the same as of the @ref CCameraEnvironment, placed in the origin, looking along the +z axis with the up vector +y: thus the panoramas rendered with this camera may be used directly.
+	 *
+	 * The directions are sampled proportionally to the brightness of the map: the luminance of the texels, weighted with the solid angle they cover, defines the piecewise-constant 2D distribution,
+	 * which is sampled with the marginal distribution of the rows and the conditional distributions of the texels within the rows. The distributions are built in the constructor.
+	 * Thus a small and bright sun is hit by the majority of the samples, and the HDR environments converge with far fewer samples than with the hemisphere sampling of @ref CLightSky.
+	 * @ingroup moduleLight
+	 */
+	class CLightEnvironment : public ILight
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 * @param pMap Pointer to the equirectangular environment map. Use the floating-point textures for the high dynamic range
+		 * @param intensity The scale of the emission
+		 * @param nSamples The number of samples
+		 * @param castShadow Flag indicatin whether the light source casts shadow
+		 */
+		DllExport CLightEnvironment(const ptr_texture_t pMap, const Vec3f& intensity = Vec3f::all(1), size_t nSamples = 16, bool castShadow = true);
+		DllExport virtual ~CLightEnvironment(void) = default;
+
+		DllExport virtual std::optional<LightSample>	sample(const Vec3f& point, const Vec3f& normal, const Vec2f& u) const override;
+		DllExport virtual std::optional<LightSample>	evaluate(const Vec3f& point, const Vec3f& normal, const Vec3f& direction) const override;
+		DllExport virtual size_t						getNumSamples(void) const override { return m_nSamples; }
+
+		/**
+		 * @brief Returns the radiance, arriving from the direction
+		 * @param direction The normalized direction towards the environment
+		 * @return The emitted radiance
+		 */
+		DllExport Vec3f			getRadiance(const Vec3f& direction) const;
+
+		/**
+		 * @brief Returns the direction, corresponding to the texture coordinates
+		 * @param uv The texture coordinates in [0; 1]^2
+		 * @return The normalized direction
+		 */
+		DllExport static Vec3f	getDirection(const Vec2f& uv);
+		/**
+		 * @brief Returns the texture coordinates, corresponding to the direction
+		 * @param direction The normalized direction
+		 * @return The texture coordinates in [0; 1]^2
+		 */
+		DllExport static Vec2f	getTextureCoords(const Vec3f& direction);
+
+
+	private:
+		/**
+		 * @brief Returns the emitted radiance and the density of sampling the texture coordinates
+		 * @param uv The texture coordinates
+		 * @param[out] pdf The probability density with respect to the area of the texture domain [0; 1]^2
+		 * @return The emitted radiance
+		 */
+		Vec3f					getRadiance(const Vec2f& uv, float& pdf) const;
+
+
+	private:
+		ptr_texture_t		m_pMap;				///< Pointer to the environment map
+		Vec3f				m_intensity;		///< The scale of the emission
+		size_t				m_nSamples;			///< The number of samples
+		std::vector<float>	m_vFunc;			///< The sampled function: the luminance of the texels, weighted with the sine of the polar angle (rows x cols)
+		std::vector<float>	m_vConditionalCdf;	///< The cumulative distributions of the texels within every row: rows x (cols + 1)
+		std::vector<float>	m_vRowIntegrals;	///< The integrals of the function over every row
+		std::vector<float>	m_vMarginalCdf;		///< The cumulative distribution of the rows (rows + 1)
+		float				m_integral	= 0;	///< The integral of the function over the whole map
+	};
+}
@@ -0,0 +1,84 @@
+#include "LightGrid.h"
+#include "macroses.h"
+
+namespace rt {
+	void CLightGrid::build(const std::vector<ptr_light_t>& vpLights, int maxResolution)
+	{
+		RT_ASSERT(maxResolution > 0);
+		m_boundingBox	= CBoundingBox();
+		m_resolution	= Vec3i::all(0);
+		m_vOffsets.clear();
+		m_vLights.clear();
+		m_vGlobalLights.clear();
+
+		std::vector<std::optional<CBoundingBox>> vBoxes(vpLights.size());
+		size_t nBoundedLights = 0;
+		for (size_t i = 0; i < vpLights.size(); i++) {
+			vBoxes[i] = vpLights[i]->getInfluenceBox();
+			if (vBoxes[i]) {
+				m_boundingBox.extend(vBoxes[i].value());
+				nBoundedLights++;
+			}
+			else m_vGlobalLights.push_back(i);
+		}
+		if (!nBoundedLights) return;
+
+		// Nearly cubic cells
+		const Vec3f minPoint	= m_boundingBox.getMinPoint();
+		const Vec3f extent		= m_boundingBox.getMaxPoint() - minPoint;
+		const float maxExtent	= MAX(MAX(extent[0], extent[1]), extent[2]);
+		const float volume		= extent[0] * extent[1] * extent[2];
+		const float nCells		= MIN(static_cast<float>(8 * nBoundedLights), powf(static_cast<float>(maxResolution), 3));
+		const float cellSize	= volume > 0 ? cbrtf(volume / nCells) : maxExtent / cbrtf(nCells);
+		for (int i = 0; i < 3; i++) {
+			m_resolution[i]	= cellSize > 0 ? MIN(MAX(static_cast<int>(ceilf(extent[i] / cellSize)), 1), maxResolution) : 1;
+			m_cellSize[i]	= extent[i] / m_resolution[i];
+		}
+
+		// The references (cell, light): the lights are processed in ascending order, thus the lists of the cells are sorted
+		auto getCell = [&](float x, int dim) { return m_cellSize[dim] > 0 ? MIN(MAX(static_cast<int>((x - minPoint[dim]) / m_cellSize[dim]), 0), m_resolution[dim] - 1) : 0; };
+		std::vector<std::pair<size_t, size_t>> vRefs;
+		for (size_t l = 0; l < vpLights.size(); l++) {
+			const CBoundingBox box = vBoxes[l] ? vBoxes[l].value() : m_boundingBox;
+			int from[3], to[3];
+			for (int i = 0; i < 3; i++) {
+				from[i]	= getCell(box.getMinPoint()[i], i);
+				to[i]	= getCell(box.getMaxPoint()[i], i);
+			}
+			for (int z = from[2]; z <= to[2]; z++)
+				for (int y = from[1]; y <= to[1]; y++)
+					for (int x = from[0]; x <= to[0]; x++) {
+						// the cell is slightly enlarged to cover the rounding errors of the point-to-cell mapping
+						const Vec3f cellMin(minPoint[0] + x * m_cellSize[0], minPoint[1] + y * m_cellSize[1], minPoint[2] + z * m_cellSize[2]);
+						if (vpLights[l]->influences(CBoundingBox(cellMin - Vec3f::all(Epsilon), cellMin + m_cellSize + Vec3f::all(Epsilon))))
+							vRefs.emplace_back((static_cast<size_t>(z) * m_resolution[1] + y) * m_resolution[0] + x, l);
+					}
+		}
+
+		// Counting sort of the references by cell
+		const size_t nGridCells = static_cast<size_t>(m_resolution[0]) * m_resolution[1] * m_resolution[2];
+		m_vOffsets.assign(nGridCells + 1, 0);
+		for (const auto& ref : vRefs) m_vOffsets[ref.first + 1]++;
+		for (size_t c = 0; c < nGridCells; c++) m_vOffsets[c + 1] += m_vOffsets[c];
+		m_vLights.resize(vRefs.size());
+		std::vector<size_t> vNext(m_vOffsets.begin(), m_vOffsets.end() - 1);
+		for (const auto& ref : vRefs) m_vLights[vNext[ref.first]++] = ref.second;
+
+#ifdef DEBUG_PRINT_INFO
+		std::cout << "Light grid: " << m_resolution[0] << " x " << m_resolution[1] << " x " << m_resolution[2] << " cells, "
+			<< static_cast<float>(m_vLights.size()) / nGridCells << " lights per cell" << std::endl;
+#endif
+	}
+
+	std::span<const size_t> CLightGrid::getLights(const Vec3f& point) const
+	{
+		if (m_vOffsets.empty() || m_boundingBox.getSquaredDistance(point) > 0) return m_vGlobalLights;
+
+		const Vec3f minPoint = m_boundingBox.getMinPoint();
+		int cell[3];
+		for (int i = 0; i < 3; i++)
+			cell[i] = m_cellSize[i] > 0 ? MIN(static_cast<int>((point[i] - minPoint[i]) / m_cellSize[i]), m_resolution[i] - 1) : 0;
+		const size_t c = (static_cast<size_t>(cell[2]) * m_resolution[1] + cell[1]) * m_resolution[0] + cell[0];
+		return std::span<const size_t>(m_vLights.data() + m_vOffsets[c], m_vOffsets[c + 1] - m_vOffsets[c]);
+	}
+}
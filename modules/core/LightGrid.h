@@ -0,0 +1,53 @@
+// Light Culling Grid class
+#pragma once
+
+#include "ILight.h"
+#include <span>
+
+namespace rt {
+	// ================================ Light Grid Class ================================
+	/**
+	 * @brief Uniform grid for culling the light sources
+	 * @details The grid covers the union of the influence volumes of the light sources (ILight::getInfluenceBox()) and lists in every cell the light sources,
+	 * which may illuminate any point of the cell (ILight::influences()). Thus a point is illuminated only by the lights of its cell instead of all the lights in scene.
+	 * The light sources with unlimited influence are listed in every cell, which they may illuminate, and they are the only lights for the points outside of the grid.
+	 * The lists of all the cells are stored one after another in one array.
+	 * @ingroup moduleLight
+	 */
+	class CLightGrid
+	{
+	public:
+		DllExport CLightGrid(void) = default;
+		DllExport CLightGrid(const CLightGrid&) = delete;
+		DllExport ~CLightGrid(void) = default;
+		DllExport const CLightGrid& operator=(const CLightGrid&) = delete;
+
+		/**
+		 * @brief Builds the grid
+		 * @details The resolution of the grid is chosen such that the cells are nearly cubic and their number is about 8 times the number of the light sources with limited influence
+		 * @param vpLights The light sources
+		 * @param maxResolution The maximal number of cells along every axis
+		 */
+		DllExport void						build(const std::vector<ptr_light_t>& vpLights, int maxResolution = 64);
+		/**
+		 * @brief Returns the light sources, which may illuminate the point
+		 * @param point The point
+		 * @return The indices of the light sources in the vector passed to build(), in ascending order
+		 */
+		DllExport std::span<const size_t>	getLights(const Vec3f& point) const;
+		/**
+		 * @brief Returns the resolution of the grid
+		 * @return The number of cells along every axis; 0 if none of the light sources has a limited influence
+		 */
+		DllExport Vec3i						getResolution(void) const { return m_resolution; }
+
+
+	private:
+		CBoundingBox						m_boundingBox;							///< The bounding box of the grid
+		Vec3i								m_resolution	= Vec3i::all(0);		///< The number of cells along every axis
+		Vec3f								m_cellSize		= Vec3f::all(0);		///< The size of a cell
+		std::vector<size_t>					m_vOffsets;								///< The offsets of the cells' lists in m_vLights; the list of the i-th cell is [m_vOffsets[i]; m_vOffsets[i + 1])
+		std::vector<size_t>					m_vLights;								///< The lists of the light sources of all the cells
+		std::vector<size_t>					m_vGlobalLights;						///< The light sources with unlimited influence
+	};
+}
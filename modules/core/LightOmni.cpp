@@ -2,14 +2,54 @@
 #include "Ray.h"
 
 namespace rt {
-	std::optional<Vec3f> CLightOmni::illuminate(Ray& ray)
-	{
-		// ray towards point light position
-		ray.dir	= m_org - ray.org;
-		ray.t	= norm(ray.dir);
-		ray.dir = normalize(ray.dir);
-		ray.hit = nullptr;
-		double attenuation = 1 / (ray.t * ray.t);
-		return attenuation * m_intensity;
+	std::optional<LightSample> CLightOmni::sample(const Vec3f& point, const Vec3f&, const Vec2f&) const
+	{
+		// direction towards point light position
+		LightSample res;
+		res.direction	= m_org - point;
+		res.distance	= norm(res.direction);
+		if (res.distance > m_range) return std::nullopt;		// outside of the influence volume
+		res.direction	= normalize(res.direction);
+		double attenuation = 1 / (res.distance * res.distance);
+		res.radiance	= attenuation * m_intensity;
+		res.pdf			= 1;
+		return res;
+	}
+
+	void CLightOmni::buildShadowMap(const CScene& scene)
+	{
+		m_pShadowMap = getShadowMapResolution() ? createShadowMap(getShadowMapResolution()) : nullptr;
+		if (m_pShadowMap) m_pShadowMap->build(scene);
+	}
+
+	std::optional<float> CLightOmni::getShadowMapVisibility(const Vec3f& point) const
+	{
+		if (!m_pShadowMap) return std::nullopt;
+		return m_pShadowMap->getVisibility(point);
+	}
+
+	ptr_shadowmap_t CLightOmni::createShadowMap(size_t resolution) const
+	{
+		return std::make_shared<CShadowMap>(m_org, resolution);
+	}
+
+	std::optional<LightBounds> CLightOmni::getBounds(void) const
+	{
+		// isotropic emission from a point
+		LightBounds res;
+		res.box		= CBoundingBox(m_org, m_org);
+		res.power	= 4 * Pif * MAX(MAX(m_intensity[0], m_intensity[1]), m_intensity[2]);
+		return res;
+	}
+
+	std::optional<CBoundingBox> CLightOmni::getInfluenceBox(void) const
+	{
+		if (m_range == Infty) return std::nullopt;
+		return CBoundingBox(m_org - Vec3f::all(m_range), m_org + Vec3f::all(m_range));
+	}
+
+	bool CLightOmni::influences(const CBoundingBox& box) const
+	{
+		return m_range == Infty || box.getSquaredDistance(m_org) <= m_range * m_range;
 	}
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "ILight.h"
+#include "ShadowMap.h"
 
 namespace rt {
 	// ================================ Point Light Class ================================
@@ -24,23 +25,40 @@ namespace rt {
 			: ILight(castShadow)
 			, m_intensity(intensity)
 			, m_org(org)
+			, m_range(Infty)
 		{}
 		DllExport virtual ~CLightOmni(void) = default;
 
-		DllExport virtual std::optional<Vec3f>	illuminate(Ray& ray) override;
+		DllExport virtual std::optional<LightSample>	sample(const Vec3f& point, const Vec3f& normal, const Vec2f& u) const override;
+		DllExport virtual bool							isDelta(void) const override { return true; }
 		DllExport virtual size_t				getNumSamples(void) const override { return 1; }
+		DllExport virtual std::optional<LightBounds>	getBounds(void) const override;
+		DllExport virtual std::optional<CBoundingBox>	getInfluenceBox(void) const override;
+		DllExport virtual bool							influences(const CBoundingBox& box) const override;
+		DllExport virtual void							buildShadowMap(const CScene& scene) override;
+		DllExport virtual std::optional<float>			getShadowMapVisibility(const Vec3f& point) const override;
 		
 		// Accessors
 		/**
 		 * @brief Sets light source intensity
 		 * @param intensity The emission color and strength of the light source
+		 * @note The scene light structures are not invalidated: call CScene::updateLightStructures() before querying the lights outside of CScene::render()
 		 */
 		DllExport virtual void	setIntensity(const Vec3f& intensity) { m_intensity = intensity; }
 		/**
 		 * @brief Sets light source position (origin)
 		 * @param org The position (origin) of the light source
+		 * @note The scene light structures are not invalidated: call CScene::updateLightStructures() before querying the lights outside of CScene::render()
 		 */
 		DllExport virtual void	setOrigin(const Vec3f& org) { m_org = org; }
+		/**
+		 * @brief Sets the range of the light source
+		 * @details The illumination of the points farther than \b range from the light source is neglected, which allows to cull the light source for these points (@ref CLightGrid).
+		 * The range, at which the illumination falls below the threshold \a e, is given by \a sqrt(I / e), where \a I is the maximal component of the intensity.
+		 * @param range The range of the light source. Infinity (default) for the unlimited range
+		 * @note The scene light structures are not invalidated: call CScene::updateLightStructures() before querying the lights outside of CScene::render()
+		 */
+		DllExport void			setRange(float range) { m_range = range; }
 		/**
 		 * @brief Returns the intensity of the light source
 		 * @return The emission color and strength of the light source
@@ -51,11 +69,28 @@ namespace rt {
 		 * @return The position (origin) of the light source
 		 */
 		DllExport Vec3f			getOrigin(void) const { return m_org; }
+		/**
+		 * @brief Returns the range of the light source
+		 * @return The range of the light source
+		 */
+		DllExport float			getRange(void) const { return m_range; }
+
+
+	protected:
+		/**
+		 * @brief Creates the empty shadow map of the light source
+		 * @details The point light source uses the cube shadow map
+		 * @param resolution The resolution of the shadow map in texels
+		 * @return Pointer to the shadow map, or nullptr if the light source does not support the shadow maps
+		 */
+		DllExport virtual ptr_shadowmap_t	createShadowMap(size_t resolution) const;
 
 
 	private:
 		Vec3f m_intensity;	///< The emission (red, green, blue)
 		Vec3f m_org;		///< The light source origin
+		float m_range;		///< The distance, beyond which the illumination is neglected
+		ptr_shadowmap_t m_pShadowMap = nullptr;	///< The shadow map (nullptr if the shadow map fast mode is off)
 	};
 }
 
@@ -3,21 +3,42 @@
 #include "Ray.h"
 
 namespace rt{
-	std::optional<Vec3f> CLightSky::illuminate(Ray& ray) 
+	std::optional<LightSample> CLightSky::sample(const Vec3f&, const Vec3f& normal, const Vec2f& u) const
+	{
+		// sample the hemisphere in respect to the object's normal
+		Vec3f hemisphereSample	= CSampler::cosineSampleHemisphere(u);
+		LightSample res;
+		res.direction	= CSampler::transformSampleToWCS(hemisphereSample, normal);
+		res.distance	= m_maxDistance;
+
+		float cosN = res.direction.dot(normal);												// angle between the object's normal and sample ray
+		if (cosN <= 0) return std::nullopt;
+		res.pdf			= cosN / Pif;														// cosine-weighted density
+		res.radiance	= m_intensity / Pif;
+		return res;
+	}
+
+	std::optional<LightSample> CLightSky::evaluate(const Vec3f&, const Vec3f& normal, const Vec3f& direction) const
+	{
+		float cosN = direction.dot(normal);
+		if (cosN <= 0) return std::nullopt;
+		LightSample res;
+		res.direction	= direction;
+		res.distance	= m_maxDistance;
+		res.pdf			= cosN / Pif;
+		res.radiance	= m_intensity / Pif;
+		return res;
+	}
+
+	std::optional<Vec3f> CLightSky::illuminate(Ray& ray, const Vec2f& u) const
 	{
 		ray.t = 0;
 		Vec3f normal = ray.hit->getNormal(ray);												// normal to the object from which the ray was casted
-		
-		Vec2f squareSample		= m_pSampler->getNextSample();
-		Vec3f hemisphereSample	= CSampler::cosineSampleHemisphere(squareSample);		
-		ray.dir					= CSampler::transformSampleToWCS(hemisphereSample, normal);	// sample the hemisphere in respect to the object's normal
-
-		// ray towards point light position
-		ray.t = m_maxDistance;
+		auto res = sample(ray.org, normal, u);
+		if (!res) return std::nullopt;
+		ray.dir	= res->direction;
+		ray.t	= res->distance;
 		ray.hit = nullptr;
-
-		float cosN = ray.dir.dot(normal);													// angle between the object's normal and sample ray
-		if (cosN > 0)	return m_intensity / cosN;
-		else			return std::nullopt;
+		return (1.0f / res->pdf) * res->radiance;
 	}
-}
\ No newline at end of file
+}
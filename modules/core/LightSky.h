@@ -20,7 +20,7 @@ namespace rt {
 		 * @param intensity The emission color and strength of the light source
 		 * @param maxDistance Defines the radius within which the renderer looks for occluding objects. 
 		 * Smaller values restrict the AO effect to small crevices only but are much faster to render. Larger values cover larger areas but render more slowly. 
-		 * @param pSampler Pointer to the sampler to be used with the sky light
+		 * @param pSampler Pointer to the sampler, defining the number of samples of the sky light (see getNumSamples())
 		 * @param castShadow Flag indicatin whether the light source casts shadow
 		 */
 		DllExport CLightSky(Vec3f intensity, float maxDistance = 4, ptr_sampler_t pSampler = std::make_shared<CSamplerStratified>(4, true, true), bool castShadow = true)
@@ -30,7 +30,14 @@ namespace rt {
 			, m_pSampler(pSampler)
 		{}
 
-		DllExport virtual std::optional<Vec3f>	illuminate(Ray& ray) override;
+		using ILight::illuminate;
+		DllExport virtual std::optional<LightSample>	sample(const Vec3f& point, const Vec3f& normal, const Vec2f& u) const override;
+		DllExport virtual std::optional<LightSample>	evaluate(const Vec3f& point, const Vec3f& normal, const Vec3f& direction) const override;
+		/**
+		 * @copydoc ILight::illuminate(Ray&, const Vec2f&) const
+		 * @note The hemisphere is sampled around the normal of the primitive \b ray.hit, from which the ray was casted
+		 */
+		DllExport virtual std::optional<Vec3f>	illuminate(Ray& ray, const Vec2f& u) const override;
 		DllExport virtual size_t				getNumSamples(void) const override { return m_pSampler->getNumSamples(); }
 
 
@@ -38,6 +45,6 @@ namespace rt {
 	private:
 		Vec3f			m_intensity;	///< The emission (red, green, blue)
 		float			m_maxDistance;	///< The radius within which the renderer looks for occluding objects
-		ptr_sampler_t	m_pSampler;		///< Pointer to the sampler ref @ref CSampler
+		ptr_sampler_t	m_pSampler;		///< Pointer to the sampler ref @ref CSampler (only its number of samples is used, the samples are passed to sample())
 	};
 }
@@ -2,13 +2,16 @@
 #include "Ray.h"
 
 namespace rt {
-	std::optional<Vec3f> CLightSpot::illuminate(Ray& ray) {
-		auto res = CLightOmni::illuminate(ray);
+	std::optional<LightSample> CLightSpot::sample(const Vec3f& point, const Vec3f& normal, const Vec2f& u) const {
+		auto res = CLightOmni::sample(point, normal, u);
+		if (!res) return std::nullopt;
 
-		float angle = acosf(m_dir.dot(-ray.dir)) * 180 / Pif;
-		if (angle > (m_alpha + m_beta)) return std::nullopt;	// no light
-		if (angle <= m_alpha) return res;						// 100% light
+		// compare the cosines first, so that the angle is computed only within the attenuated border
+		float cosAngle = m_dir.dot(-res->direction);
+		if (cosAngle < m_cosAlphaBeta) return std::nullopt;		// no light
+		if (cosAngle >= m_cosAlpha) return res;					// 100% light
 
+		float angle = acosf(cosAngle) * 180 / Pif;
 		// angle \in (m_alpha; m_alpha + m_beta]
 		float k = (angle - m_alpha) / m_beta;					// k \in (0, 1]
 		float scale;
@@ -18,6 +21,39 @@ namespace rt {
 			case 2: scale = (1 + cosf(Pif * k)) / 2; break;
 			default: scale = 1;
 		}
-		return (res.value() * scale);				// attenuated light
+		res->radiance *= scale;						// attenuated light
+		return res;
+	}
+
+	ptr_shadowmap_t CLightSpot::createShadowMap(size_t resolution) const
+	{
+		const float angle = m_alpha + m_beta;					// half-opening angle of the whole illuminated cone
+		if (angle > 60) return CLightOmni::createShadowMap(resolution);
+		return std::make_shared<CShadowMap>(getOrigin(), m_dir, angle, resolution);
+	}
+
+	std::optional<LightBounds> CLightSpot::getBounds(void) const
+	{
+		// the full-intensity cone plays the role of the normals' spread, the attenuated border - of the emission angle
+		auto res = CLightOmni::getBounds();
+		res->axis		= normalize(m_dir);
+		res->cosThetaO	= cosf(MIN(m_alpha, 180.0f) * Pif / 180);
+		res->cosThetaE	= cosf(MIN(m_beta, 180.0f) * Pif / 180);
+		return res;
+	}
+
+	bool CLightSpot::influences(const CBoundingBox& box) const
+	{
+		if (!CLightOmni::influences(box)) return false;
+
+		// the cone intersects the bounding sphere of the box, if the angle between the cone axis and the direction to the sphere does not exceed the cone angle plus the angle subtended by the sphere
+		Vec3f center = box.getCenter();
+		float radius = static_cast<float>(norm(box.getMaxPoint() - box.getMinPoint())) / 2;
+		Vec3f v = center - getOrigin();
+		float d = static_cast<float>(norm(v));
+		if (d <= radius) return true;
+		float maxAngle = acosf(MIN(MAX(m_cosAlphaBeta, -1.0f), 1.0f)) + asinf(radius / d);
+		if (maxAngle >= Pif) return true;
+		return normalize(m_dir).dot(v) / d >= cosf(maxAngle);
 	}
 }
\ No newline at end of file
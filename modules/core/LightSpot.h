@@ -26,15 +26,20 @@ namespace rt {
 			, m_dir(normalize(dir))
 			, m_alpha(alpha/2)
 			, m_beta(beta/2)
+			, m_cosAlpha(cosf(MIN(alpha / 2, 180.0f) * Pif / 180))
+			, m_cosAlphaBeta(cosf(MIN((alpha + beta) / 2, 180.0f) * Pif / 180))
 		{}
 		DllExport virtual ~CLightSpot(void) = default;
 
-		DllExport virtual std::optional<Vec3f>	illuminate(Ray& ray) override;
+		DllExport virtual std::optional<LightSample>	sample(const Vec3f& point, const Vec3f& normal, const Vec2f& u) const override;
+		DllExport virtual std::optional<LightBounds>	getBounds(void) const override;
+		DllExport virtual bool							influences(const CBoundingBox& box) const override;
 
 		// Accessors
 		/**
 		 * @brief Sets new light direction
 		 * @param dir he direction of the light source
+		 * @note The scene light structures are not invalidated: call CScene::updateLightStructures() before querying the lights outside of CScene::render()
 		 */
 		DllExport virtual void	setDirection(const Vec3f& dir) { m_dir = dir; }
 		/**
@@ -42,12 +47,32 @@ namespace rt {
 		 * @return The light direction
 		 */
 		DllExport Vec3f			getDirection(void) const { return m_dir; }
+		/**
+		 * @brief Returns the half-opening angle of the cone with constant surface illumination
+		 * @return The angle in degrees
+		 */
+		DllExport float			getAlpha(void) const { return m_alpha; }
+		/**
+		 * @brief Returns the additional half-opening angle for attenuated illumination
+		 * @return The angle in degrees
+		 */
+		DllExport float			getBeta(void) const { return m_beta; }
+
+
+	protected:
+		/**
+		 * @copydoc CLightOmni::createShadowMap()
+		 * @details The spot light source with the cone narrower than 120 degrees uses one shadow map, covering the cone, and the wider one - the cube shadow map
+		 */
+		DllExport virtual ptr_shadowmap_t	createShadowMap(size_t resolution) const override;
 
 
 	private:
 		Vec3f m_dir;		///< The direction of the light source
 		float m_alpha;		///< The opening angle of the cone with constant surface illumination
 		float m_beta;		///< The additional opening angle for attenuted illumination
+		float m_cosAlpha;		///< Cosine of the opening angle of the cone with constant surface illumination
+		float m_cosAlphaBeta;	///< Cosine of the opening angle of the whole illuminated cone
 	};
 }
 
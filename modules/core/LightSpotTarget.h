@@ -33,6 +33,7 @@ namespace rt {
 		/**
 		 * @brief Sets light target point
 		 * @param target The target point
+		 * @note The scene light structures are not invalidated: call CScene::updateLightStructures() before querying the lights outside of CScene::render()
 		 */
 		DllExport virtual void	setTarget(const Vec3f& target) {
 			m_target = target;
@@ -1,6 +1,7 @@
 //  Created by Mahmoud El Bergui on 07.08.22.
 
 #include "Prim.h"
+#include "Ray.h"
 #include "Transform.h"
 
 namespace rt {
@@ -36,6 +37,31 @@ namespace rt {
 		doTransform(T);
 	}
 	
+	void CPrim::intersectAll(const Ray& ray, std::vector<RayHit>& vHits) const
+	{
+		const size_t maxHits = 16;		// protects from the endless loops at degenerate geometry
+		double t = 0;
+		for (size_t i = 0; i < maxHits; i++) {
+			Ray r(ray.org + static_cast<float>(t) * ray.dir, ray.dir);
+			r.t = ray.t - t;
+			if (!intersect(r)) break;
+			t += r.t;
+			vHits.push_back({ t, r.hit, r.instHit, r.b1, r.b2 });
+		}
+	}
+
+	CBoundingBox CPrim::getClippedBoundingBox(const CBoundingBox& box) const
+	{
+		CBoundingBox primBox = getBoundingBox();
+		Vec3f minPoint, maxPoint;
+		for (int i = 0; i < 3; i++) {
+			minPoint[i] = MAX(primBox.getMinPoint()[i], box.getMinPoint()[i]);
+			maxPoint[i] = MIN(primBox.getMaxPoint()[i], box.getMaxPoint()[i]);
+			if (minPoint[i] > maxPoint[i]) return CBoundingBox();
+		}
+		return CBoundingBox(minPoint, maxPoint);
+	}
+
 	Vec3f CPrim::wcs2ocs(const Vec3f& p) const 
 	{
 		return CTransform::point(p, m_t.inv());
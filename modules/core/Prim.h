@@ -8,6 +8,7 @@
 
 namespace rt {
 	//struct Ray;
+	struct RayHit;
 	
 	// ================================ Primitive Interface Class ================================
 	/**
@@ -46,6 +47,14 @@ namespace rt {
 		 * @retval false Otherwise
 		 */
 		DllExport virtual bool						if_intersect(const Ray& ray) const = 0;
+		/**
+		 * @brief Finds all the intersections between ray \b ray and the primitive
+		 * @details The intersections in the interval (epsilon; Ray::t) are appended to \b vHits in the order of increasing distance.
+		 * The default implementation calls intersect() repeatedly, moving the ray origin to the previous hitpoint; the primitives may override it with a direct computation.
+		 * @param ray The ray (Ref. @ref Ray for details)
+		 * @param[in,out] vHits The vector of the intersections
+		 */
+		DllExport virtual void						intersectAll(const Ray& ray, std::vector<RayHit>& vHits) const;
 		/**
 		 * @brief Returns the texture coordinates in the ray - primitive intersection point
 		 * @param ray Ray, which has hit the geometry. 
@@ -63,6 +72,14 @@ namespace rt {
 		 * @return The bounding box, which contain the primitive
 		 */
 		DllExport virtual CBoundingBox				getBoundingBox(void) const = 0;
+		/**
+		 * @brief Returns the bounding box of the part of the primitive, which lies inside the box \b box
+		 * @details This method is used by the spatial splits of the acceleration structures.
+		 * The default implementation returns the intersection of the primitive's bounding box with \b box
+		 * @param box The clipping box
+		 * @return The bounding box of the clipped primitive. The box is empty if the primitive does not intersect \b box
+		 */
+		DllExport virtual CBoundingBox				getClippedBoundingBox(const CBoundingBox& box) const;
 		/**
 		 * @brief Flips the normal of the primitive.
 		 */
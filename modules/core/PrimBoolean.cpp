@@ -14,49 +14,48 @@ namespace rt {
 #ifdef ENABLE_BSP
 		, m_maxDepth(maxDepth)
 		, m_maxPrimitives(maxPrimitives)
-		, m_pBSPTree1(new CBSPTree())
-		, m_pBSPTree2(new CBSPTree())
+		, m_pBVHTree1(new CBVHTree())
+		, m_pBVHTree2(new CBVHTree())
 #endif
     {
         if (operation == BoolOp::Substraction)
 			for (auto& pPrim : m_vpPrims2) pPrim->flipNormal();
 		computeBoundingBox();;
 #ifdef ENABLE_BSP
-        m_pBSPTree1->build(m_vpPrims1, m_maxDepth, m_maxPrimitives);
-        m_pBSPTree2->build(m_vpPrims2, m_maxDepth, m_maxPrimitives);
+        m_pBVHTree1->build(m_vpPrims1, m_maxDepth, m_maxPrimitives);
+        m_pBVHTree2->build(m_vpPrims2, m_maxDepth, m_maxPrimitives);
 #endif
     }
 
     bool CPrimBoolean::intersect(Ray &ray) const 
 	{
-		std::optional<Ray> res;
-		switch (m_operation) {
-			case BoolOp::Union: 		res = computeUnion(ray); 		break;
-			case BoolOp::Intersection: 	res = computeIntersection(ray); break;
-			case BoolOp::Substraction:	res = computeSubstraction(ray);	break;
-			default: RT_ASSERT_MSG(false, "Unknown boolean operation");
-        }
-		if (!res) return false;
-		
-		RT_ASSERT(res.value().hit);
-
-		double t = norm(ray.org - res.value().hitPoint());
-		if (t > ray.t) return false;
-
-		ray.t = t;
-		ray.hit = res.value().hit;
-		ray.b1 = res.value().b1;
-		ray.b2 = res.value().b2;
+		std::vector<RayHit> vHits;
+		computeHits(ray, vHits, true);
+		if (vHits.empty()) return false;
+
+		const RayHit& hit = vHits.front();
+		ray.t = hit.t;
+		ray.hit = hit.hit;
+		ray.instHit = hit.instHit;
+		ray.b1 = hit.b1;
+		ray.b2 = hit.b2;
 		
 		return true;
     }
 
-    // TODO: This can be greatly improved. To be optimized further.
     bool CPrimBoolean::if_intersect(const Ray &ray) const 
 	{
-        return intersect(lvalue_cast(Ray(ray)));
+		// the interval merge stops at the first boundary of the result, and the ray is not updated
+		std::vector<RayHit> vHits;
+		computeHits(ray, vHits, true);
+		return !vHits.empty();
     }
 
+	void CPrimBoolean::intersectAll(const Ray& ray, std::vector<RayHit>& vHits) const
+	{
+		computeHits(ray, vHits, false);
+	}
+
     Vec3f CPrimBoolean::doGetNormal(const Ray &ray) const 
 	{
         RT_ASSERT_MSG(false, "This method should never be called. Aborting...");
@@ -73,8 +72,12 @@ namespace rt {
 		// recompute the bounding box
 		computeBoundingBox();
 #ifdef ENABLE_BSP
-		m_pBSPTree1->build(m_vpPrims1, m_maxDepth, m_maxPrimitives);
-		m_pBSPTree2->build(m_vpPrims2, m_maxDepth, m_maxPrimitives);
+		// refit the trees, since the topology of the geometry does not change; re-build them only if they have degraded too much
+		const float maxDegradation = 1.5f;
+		m_pBVHTree1->refit();
+		m_pBVHTree2->refit();
+		if (m_pBVHTree1->getDegradation() > maxDegradation) m_pBVHTree1->build(m_vpPrims1, m_maxDepth, m_maxPrimitives);
+		if (m_pBVHTree2->getDegradation() > maxDegradation) m_pBVHTree2->build(m_vpPrims2, m_maxDepth, m_maxPrimitives);
 #endif
 	}
 
@@ -104,140 +107,64 @@ namespace rt {
 		else								return IntersectionState::Exit;
 	}
 
-	std::optional<Ray> CPrimBoolean::computeUnion(const Ray &ray) const 
-	{
-		Ray minRay(ray.org, ray.dir);
-        for (int iteration = 0; iteration < 100; iteration++) {
-            RT_ASSERT(!minRay.hit);
-            Ray minA = minRay;
-            Ray minB = minRay;
-#ifdef ENABLE_BSP
-            m_pBSPTree1->intersect(minA);
-            m_pBSPTree2->intersect(minB);
-#else
-            for (const auto &pPrim : m_vpPrims1) pPrim->intersect(minA);
-            for (const auto &pPrim : m_vpPrims2) pPrim->intersect(minB);
-#endif
-            auto stateA = classifyRay(minA);
-            auto stateB = classifyRay(minB);
-            
-			if (stateA == IntersectionState::Miss && stateB == IntersectionState::Miss) return std::nullopt;
-            if (stateA == IntersectionState::Miss || stateB == IntersectionState::Miss) return stateA == IntersectionState::Miss ? minB : minA;
-            if (stateA == stateB) {
-                if (stateA == IntersectionState::Enter)	return minA.t < minB.t ? minA : minB;
-				else									return minA.t > minB.t ? minA : minB;
-            }
-            if (stateA == IntersectionState::Enter && stateB == IntersectionState::Exit) {
-                if (minB.t < minA.t) return minB;
-                minRay.org = minA.hitPoint();
-                continue;
-            }
-            if (stateA == IntersectionState::Exit && stateB == IntersectionState::Enter) {
-                if (minA.t < minB.t) return minA;
-                minRay.org = minB.hitPoint();
-                continue;
-            }
-        } // iteration
-		RT_WARNING("The maximum depth of calculations is reached.");
-		return std::nullopt;
-    }
-
-	std::optional<Ray> CPrimBoolean::computeIntersection(const Ray &ray) const 
+	void CPrimBoolean::computeHits(const Ray& ray, std::vector<RayHit>& vHits, bool closestOnly) const
 	{
-		Ray minRay(ray.org, ray.dir);
-		for (int iteration = 0; iteration < 100; iteration++) {
-            RT_ASSERT(!minRay.hit);
-            Ray minA = minRay;
-            Ray minB = minRay;
+		// All the intersections of the whole ray with the operands: the first intersection tells whether the ray origin lies inside the operand
+		Ray fullRay(ray.org, ray.dir);
 #ifdef ENABLE_BSP
-            m_pBSPTree1->intersect(minA);
-            m_pBSPTree2->intersect(minB);
+		std::vector<RayHit> vHitsA = m_pBVHTree1->intersectAll(fullRay);
+		std::vector<RayHit> vHitsB = m_pBVHTree2->intersectAll(fullRay);
 #else
-            for (const auto &pPrim : m_vpPrims1) pPrim->intersect(minA);
-            for (const auto &pPrim : m_vpPrims2) pPrim->intersect(minB);
+		std::vector<RayHit> vHitsA, vHitsB;
+		for (const auto& pPrim : m_vpPrims1) pPrim->intersectAll(fullRay, vHitsA);
+		for (const auto& pPrim : m_vpPrims2) pPrim->intersectAll(fullRay, vHitsB);
+		auto isCloser = [](const RayHit& a, const RayHit& b) { return a.t < b.t; };
+		std::sort(vHitsA.begin(), vHitsA.end(), isCloser);
+		std::sort(vHitsB.begin(), vHitsB.end(), isCloser);
 #endif
-            auto stateA = classifyRay(minA);
-            auto stateB = classifyRay(minB);
-            if (stateA == IntersectionState::Miss || stateB == IntersectionState::Miss) return std::nullopt;
-            if (stateA == IntersectionState::Enter && stateB == IntersectionState::Enter) {
-                minRay.org = minA.t < minB.t ? minA.hitPoint() : minB.hitPoint();
-                continue;
-            }
-            if (stateA == IntersectionState::Exit && stateB == IntersectionState::Exit) return minA.t < minB.t ? minA : minB;
 
-            if (stateA == IntersectionState::Enter && stateB == IntersectionState::Exit) {
-                if (minA.t < minB.t) return minA;
-                minRay.org = minB.hitPoint();
-                continue;
-            }
-            if (stateA == IntersectionState::Exit && stateB == IntersectionState::Enter) {
-                if (minB.t < minA.t) return minB;
-                minRay.org = minA.hitPoint();
-                continue;
-            }
-        } // iteration
-		RT_WARNING("The maximum depth of calculations is reached.");
-		return std::nullopt;
-    }
+		// Returns true if the ray enters the operand at the hit
+		auto isEntering = [&](const RayHit& hit, bool first) {
+			Ray hitRay(ray.org, ray.dir);
+			hitRay.t		= hit.t;
+			hitRay.hit		= hit.hit;
+			hitRay.instHit	= hit.instHit;
+			hitRay.b1		= hit.b1;
+			hitRay.b2		= hit.b2;
+			bool res = classifyRay(hitRay) == IntersectionState::Enter;
+			// Since the normal of object B is inverted in constructor
+			return (!first && m_operation == BoolOp::Substraction) ? !res : res;
+		};
+
+		// Merge the intervals: the surface of the result is where its inside state changes
+		bool insideA = !vHitsA.empty() && !isEntering(vHitsA.front(), true);
+		bool insideB = !vHitsB.empty() && !isEntering(vHitsB.front(), false);
+		bool inside = isInside(insideA, insideB);
+		size_t a = 0, b = 0;
+		while (a < vHitsA.size() || b < vHitsB.size()) {
+			const bool first = b == vHitsB.size() || (a < vHitsA.size() && vHitsA[a].t <= vHitsB[b].t);
+			const RayHit& hit = first ? vHitsA[a++] : vHitsB[b++];
+			if (hit.t > ray.t) break;
+
+			(first ? insideA : insideB) = isEntering(hit, first);
+			if (isInside(insideA, insideB) != inside) {
+				inside = !inside;
+				vHits.push_back(hit);
+				if (closestOnly) break;
+			}
+		}
+	}
 
-	std::optional<Ray> CPrimBoolean::computeSubstraction(const Ray &ray) const 
+	bool CPrimBoolean::isInside(bool insideA, bool insideB) const
 	{
-		Ray minRay(ray.org, ray.dir);
-		for (int iteration = 0; iteration < 100; iteration++) {
-            RT_ASSERT(!minRay.hit);
-			// --------- RAY A ---------
-			Ray minA = minRay;
-#ifdef ENABLE_BSP
-			m_pBSPTree1->intersect(minA);
-#else
-			for (const auto &pPrim : m_vpPrims1) pPrim->intersect(minA);
-#endif
-			auto stateA = classifyRay(minA);
-
-			// Miss A
-			if (stateA == IntersectionState::Miss) return std::nullopt;
-			
-			// --------- RAY B ---------
-			Ray minB = minRay;
-#ifdef ENABLE_BSP
-            m_pBSPTree2->intersect(minB);
-#else
-            for (const auto &pPrim : m_vpPrims2) pPrim->intersect(minB);
-#endif
-            auto stateB = classifyRay(minB);
-			// Since the normal of object B is inverted in constructor			
-			stateB = stateB == IntersectionState::Enter ? IntersectionState::Exit : IntersectionState::Enter;
-		
-			// hit A, but miss B
-            if (stateB == IntersectionState::Miss) return minA;
-
-			// ray enters A and B
-            if (stateA == IntersectionState::Enter && stateB == IntersectionState::Enter) {
-                if (minA.t < minB.t) return minA;
-                minRay.org = minB.hitPoint();
-                continue;
-            }
-			
-			// ray enters A and exits B
-			if (stateA == IntersectionState::Enter && stateB == IntersectionState::Exit) {
-				minRay.org = minA.t < minB.t ? minA.hitPoint() : minB.hitPoint();
-				continue;
-			}
-			
-			// ray leaves A and B
-            if (stateA == IntersectionState::Exit && stateB == IntersectionState::Exit) {
-                if (minB.t < minA.t) return minB;
-                minRay.org = minA.hitPoint();
-                continue;
-            }
-			
-			// ray leaves A but enters B
-			if (stateA == IntersectionState::Exit && stateB == IntersectionState::Enter) 
-                return minA.t < minB.t ? minA : minB;
-        } // iteration
-		RT_WARNING("The maximum depth of calculations is reached.");
-		return std::nullopt;
-    }
+		switch (m_operation) {
+			case BoolOp::Union:			return insideA || insideB;
+			case BoolOp::Intersection:	return insideA && insideB;
+			case BoolOp::Substraction:	return insideA && !insideB;
+			default: RT_ASSERT_MSG(false, "Unknown boolean operation");
+		}
+		return false;
+	}
 
     void CPrimBoolean::computeBoundingBox() 
 	{
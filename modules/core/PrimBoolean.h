@@ -5,7 +5,7 @@
 #include "Prim.h"
 #include "Solid.h"
 #ifdef ENABLE_BSP
-#include "BSPTree.h"
+#include "BVHTree.h"
 #endif
 
 namespace rt {
@@ -23,6 +23,7 @@ namespace rt {
 	 * @brief Boolean Compound Primitive class
 	 * @details This calss implements <a href="https://en.wikipedia.org/wiki/Constructive_solid_geometry" target="_blank">Constructive solid geometry (CSG)</a> technique for solid modeling. 
 	 * CSG allows for creating complex surfaces or objects by using Boolean operators to combine simpler objects, potentially generating visually complex objects by combining a few primitive ones.
+	 * All the intersections of a ray with both operands are found in one traversal of their trees and the resulting surface is found by merging the intervals of the ray inside the operands.
 	 * @ingroup modulePrimitive
 	 * @author Otmane Sabir, o.sabir@jacobs-university.de
 	 */
@@ -34,14 +35,15 @@ namespace rt {
          * @param A The first operand
          * @param B THe second operand
          * @param operation The boolean operation on operands \b A and \b B
-         * @param maxDepth The max depth of the BSP tree of the solids. Only used if BSP support is enabled
-         * @param maxDepth The max number of primitives in the leaf nodes of the BSP tree of the solids. Only used if BSP support is enabled
+         * @param maxDepth The max depth of the BVH trees of the solids. Only used if BSP support is enabled
+         * @param maxDepth The max number of primitives in the leaf nodes of the BVH trees of the solids. Only used if BSP support is enabled
 		 */
         DllExport explicit CPrimBoolean(const CSolid& A, const CSolid& B, BoolOp operation, int maxDepth = 20, int maxPrimitives = 3);
         DllExport virtual ~CPrimBoolean(void) override = default;
         
 		DllExport virtual bool						intersect(Ray &ray) const override;
 		DllExport virtual bool						if_intersect(const Ray &ray) const override;
+		DllExport virtual void						intersectAll(const Ray& ray, std::vector<RayHit>& vHits) const override;
 		DllExport virtual Vec2f						getTextureCoords(const Ray &ray) const override;
 		DllExport virtual std::pair<Vec3f, Vec3f>	dp(const Vec3f& p) const;
 		DllExport virtual CBoundingBox				getBoundingBox(void) const override { return m_boundingBox; }
@@ -52,9 +54,8 @@ namespace rt {
 		DllExport virtual Vec3f						doGetNormal(const Ray &) const override;
 		DllExport virtual void						doTransform(const Mat& T) override;
 		
-		std::optional<Ray>							computeUnion(const Ray &ray) const;			///< Helper method to perform union logic
-		std::optional<Ray>							computeIntersection(const Ray& ray) const;	///< Helper method to perform intersection logic
-		std::optional<Ray>							computeSubstraction(const Ray &ray) const;	///< Helper method to perform substraction logic
+		void										computeHits(const Ray& ray, std::vector<RayHit>& vHits, bool closestOnly) const;	///< Helper method to merge the intervals of the ray inside the operands
+		bool										isInside(bool insideA, bool insideB) const;	///< Helper method to apply the boolean operation to the states of the operands
         void 										computeBoundingBox(void);					///< Helper method to recompute the composite
 		IntersectionState 							classifyRay(const Ray& ray) const;			///< Helper method to classify if a ray is entering, exiting, or missing a solid
 
@@ -68,8 +69,8 @@ namespace rt {
 #ifdef ENABLE_BSP
 		int											m_maxDepth;					///< The maximum allowed depth of the trees
 		int											m_maxPrimitives;			///< The minimum number of primitives in a leaf-node
-		std::unique_ptr<CBSPTree>					m_pBSPTree1		= nullptr;	///< Pointer to the spatial index structure for left geometry
-        std::unique_ptr<CBSPTree>					m_pBSPTree2		= nullptr;	///< Pointer to the spatial index structure for right geometry
+		std::unique_ptr<CBVHTree>					m_pBVHTree1		= nullptr;	///< Pointer to the spatial index structure for left geometry
+        std::unique_ptr<CBVHTree>					m_pBVHTree2		= nullptr;	///< Pointer to the spatial index structure for right geometry
 #endif
     };
 
@@ -0,0 +1,266 @@
+#include "PrimCSG.h"
+#include "Ray.h"
+#include "macroses.h"
+
+namespace rt {
+	CPrimCSG::CPrimCSG(const ptr_csgnode_t pRoot, int maxDepth, int maxPrimitives)
+		: CPrim(nullptr, Vec3f::all(0))
+		, m_pRoot(pRoot)
+#ifdef ENABLE_BSP
+		, m_maxDepth(maxDepth)
+		, m_maxPrimitives(maxPrimitives)
+#endif
+	{
+		RT_ASSERT(pRoot);
+		prepare(*m_pRoot, false);
+		computeBoundingBox(*m_pRoot);
+	}
+
+	ptr_csgnode_t CPrimCSG::solid(const CSolid& solid)
+	{
+		auto res = std::make_shared<CSGNode>();
+		res->vpPrims = solid.getPrims();
+		return res;
+	}
+
+	ptr_csgnode_t CPrimCSG::operation(BoolOp operation, const std::vector<ptr_csgnode_t>& vpOperands)
+	{
+		RT_ASSERT_MSG(!vpOperands.empty(), "The boolean operation needs at least one operand");
+		auto res = std::make_shared<CSGNode>();
+		res->operation	= operation;
+		res->vpOperands	= vpOperands;
+		return res;
+	}
+
+	bool CPrimCSG::intersect(Ray& ray) const
+	{
+		double t0 = 0;
+		double t1 = ray.t;
+		m_pRoot->boundingBox.clip(ray, t0, t1);
+		if (t1 < t0) return false;
+
+		// The first boundary of the result, which is closer than the current hit
+		Span span = evaluate(*m_pRoot, Ray(ray.org, ray.dir));
+		if (span.vHits.empty() || span.vHits.front().t > ray.t) return false;
+
+		const RayHit& hit = span.vHits.front();
+		ray.t		= hit.t;
+		ray.hit		= hit.hit;
+		ray.instHit	= hit.instHit;
+		ray.b1		= hit.b1;
+		ray.b2		= hit.b2;
+		return true;
+	}
+
+	bool CPrimCSG::if_intersect(const Ray& ray) const
+	{
+		return intersect(lvalue_cast(Ray(ray)));
+	}
+
+	void CPrimCSG::intersectAll(const Ray& ray, std::vector<RayHit>& vHits) const
+	{
+		double t0 = 0;
+		double t1 = ray.t;
+		m_pRoot->boundingBox.clip(ray, t0, t1);
+		if (t1 < t0) return;
+
+		Span span = evaluate(*m_pRoot, Ray(ray.org, ray.dir));
+		for (const RayHit& hit : span.vHits) {
+			if (hit.t > ray.t) break;
+			vHits.push_back(hit);
+		}
+	}
+
+	Vec2f CPrimCSG::getTextureCoords(const Ray& ray) const
+	{
+		RT_ASSERT_MSG(false, "This method should never be called. Aborting...");
+		return Vec2f::all(0);
+	}
+
+	std::pair<Vec3f, Vec3f> CPrimCSG::dp(const Vec3f& p) const
+	{
+		RT_ASSERT_MSG(false, "This method should never be called. Aborting...");
+		return std::make_pair(Vec3f::all(0), Vec3f::all(0));
+	}
+
+	void CPrimCSG::flipNormal(void)
+	{
+		for (CSGNode* pLeaf : m_vpLeaves)
+			for (auto& pPrim : pLeaf->vpPrims) pPrim->flipNormal();
+		m_flippedNormal = !m_flippedNormal;
+	}
+
+	Vec3f CPrimCSG::doGetNormal(const Ray&) const
+	{
+		RT_ASSERT_MSG(false, "This method should never be called. Aborting...");
+		return Vec3f::all(0);
+	}
+
+	void CPrimCSG::doTransform(const Mat& T)
+	{
+		for (CSGNode* pLeaf : m_vpLeaves) {
+			for (auto& pPrim : pLeaf->vpPrims) pPrim->transform(T);
+#ifdef ENABLE_BSP
+			// refit the trees, since the topology of the geometry does not change; re-build them only if they have degraded too much
+			const float maxDegradation = 1.5f;
+			pLeaf->pBVHTree->refit();
+			if (pLeaf->pBVHTree->getDegradation() > maxDegradation) pLeaf->pBVHTree->build(pLeaf->vpPrims, m_maxDepth, m_maxPrimitives);
+#endif
+		}
+		computeBoundingBox(*m_pRoot);
+	}
+
+	// ---------------------- private ----------------------
+	void CPrimCSG::prepare(CSGNode& node, bool flipped)
+	{
+		if (node.isLeaf()) {
+			// The normals of the subtracted solids point inside the result
+			node.flipped = flipped;
+			if (flipped)
+				for (auto& pPrim : node.vpPrims) pPrim->flipNormal();
+#ifdef ENABLE_BSP
+			node.pBVHTree = std::make_shared<CBVHTree>();
+			node.pBVHTree->build(node.vpPrims, m_maxDepth, m_maxPrimitives);
+#endif
+			m_vpLeaves.push_back(&node);
+			return;
+		}
+		for (size_t i = 0; i < node.vpOperands.size(); i++)
+			prepare(*node.vpOperands[i], flipped != (node.operation == BoolOp::Substraction && i > 0));
+	}
+
+	void CPrimCSG::computeBoundingBox(CSGNode& node) const
+	{
+		node.boundingBox = CBoundingBox();
+		if (node.isLeaf()) {
+			for (const auto& pPrim : node.vpPrims)
+				node.boundingBox.extend(pPrim->getBoundingBox());
+			return;
+		}
+
+		for (auto& pOperand : node.vpOperands)
+			computeBoundingBox(*pOperand);
+
+		switch (node.operation) {
+			case BoolOp::Union:
+				for (const auto& pOperand : node.vpOperands)
+					node.boundingBox.extend(pOperand->boundingBox);
+				break;
+			case BoolOp::Intersection: {
+				Vec3f minPoint = node.vpOperands.front()->boundingBox.getMinPoint();
+				Vec3f maxPoint = node.vpOperands.front()->boundingBox.getMaxPoint();
+				for (const auto& pOperand : node.vpOperands)
+					for (int i = 0; i < 3; i++) {
+						minPoint[i] = MAX(minPoint[i], pOperand->boundingBox.getMinPoint()[i]);
+						maxPoint[i] = MIN(maxPoint[i], pOperand->boundingBox.getMaxPoint()[i]);
+					}
+				bool empty = false;
+				for (int i = 0; i < 3; i++)
+					if (minPoint[i] > maxPoint[i]) empty = true;
+				if (!empty) node.boundingBox = CBoundingBox(minPoint, maxPoint);
+				break;
+			}
+			case BoolOp::Substraction:
+				node.boundingBox = node.vpOperands.front()->boundingBox;
+				break;
+			default: RT_ASSERT_MSG(false, "Unknown boolean operation");
+		}
+	}
+
+	CPrimCSG::Span CPrimCSG::evaluate(const CSGNode& node, const Ray& ray) const
+	{
+		if (node.isLeaf()) return evaluateLeaf(node, ray);
+
+		// An operand is empty along the ray if the ray misses its bounding box
+		// Such an operand of an intersection, as well as the first operand of a substraction, empties the whole node; otherwise it is skipped
+		auto isEssential = [&](size_t i) { return node.operation == BoolOp::Intersection || (node.operation == BoolOp::Substraction && i == 0); };
+		const RayData r(ray);
+		std::vector<size_t> vOperands;
+		vOperands.reserve(node.vpOperands.size());
+		for (size_t i = 0; i < node.vpOperands.size(); i++) {
+			double t0 = 0;
+			double t1 = Infty;
+			node.vpOperands[i]->boundingBox.clip(r, t0, t1);
+			if (t0 <= t1)				vOperands.push_back(i);
+			else if (isEssential(i))	return Span();
+		}
+
+		std::vector<Span> vSpans;
+		vSpans.reserve(vOperands.size());
+		for (size_t i : vOperands) {
+			Span span = evaluate(*node.vpOperands[i], ray);
+			if (span.inside || !span.vHits.empty())	vSpans.push_back(std::move(span));
+			else if (isEssential(i))					return Span();
+		}
+		if (vSpans.size() <= 1) return vSpans.empty() ? Span() : std::move(vSpans.front());
+
+		// Merge the intervals of the operands: the state of the node changes only at the hits of the operands
+		std::vector<bool> vInside(vSpans.size());
+		for (size_t k = 0; k < vSpans.size(); k++)
+			vInside[k] = vSpans[k].inside;
+		auto isInside = [&]() {
+			switch (node.operation) {
+				case BoolOp::Union:			return std::find(vInside.begin(), vInside.end(), true) != vInside.end();
+				case BoolOp::Intersection:	return std::find(vInside.begin(), vInside.end(), false) == vInside.end();
+				case BoolOp::Substraction:	return vInside.front() && std::find(vInside.begin() + 1, vInside.end(), true) == vInside.end();
+				default: RT_ASSERT_MSG(false, "Unknown boolean operation");
+			}
+			return false;
+		};
+
+		Span res;
+		res.inside = isInside();
+		bool inside = res.inside;
+		std::vector<size_t> vNext(vSpans.size(), 0);
+		for (;;) {
+			// The closest of the next hits of the operands
+			size_t k = vSpans.size();
+			for (size_t i = 0; i < vSpans.size(); i++)
+				if (vNext[i] < vSpans[i].vHits.size() && (k == vSpans.size() || vSpans[i].vHits[vNext[i]].t < vSpans[k].vHits[vNext[k]].t))
+					k = i;
+			if (k == vSpans.size()) break;
+
+			RayHit& hit = vSpans[k].vHits[vNext[k]++];
+			vInside[k] = !vInside[k];
+			if (isInside() != inside) {
+				inside = !inside;
+				res.vHits.push_back(std::move(hit));
+			}
+		}
+		return res;
+	}
+
+	CPrimCSG::Span CPrimCSG::evaluateLeaf(const CSGNode& node, const Ray& ray) const
+	{
+#ifdef ENABLE_BSP
+		std::vector<RayHit> vHits = node.pBVHTree->intersectAll(ray);
+#else
+		std::vector<RayHit> vHits;
+		for (const auto& pPrim : node.vpPrims) pPrim->intersectAll(ray, vHits);
+		std::sort(vHits.begin(), vHits.end(), [](const RayHit& a, const RayHit& b) { return a.t < b.t; });
+#endif
+		// Returns true if the ray enters the solid at the hit
+		auto isEntering = [&](const RayHit& hit) {
+			Ray hitRay(ray.org, ray.dir);
+			hitRay.t		= hit.t;
+			hitRay.hit		= hit.hit;
+			hitRay.instHit	= hit.instHit;
+			hitRay.b1		= hit.b1;
+			hitRay.b2		= hit.b2;
+			bool flipped = node.flipped != m_flippedNormal;
+			return (hit.hit->getNormal(hitRay).dot(ray.dir) < 0) != flipped;
+		};
+
+		// Keep only the hits, where the state changes: this filters out the duplicated hits at the shared edges of the primitives
+		Span res;
+		if (vHits.empty()) return res;
+		res.inside = !isEntering(vHits.front());
+		bool inside = res.inside;
+		for (RayHit& hit : vHits) {
+			if (isEntering(hit) == inside) continue;
+			inside = !inside;
+			res.vHits.push_back(std::move(hit));
+		}
+		return res;
+	}
+}
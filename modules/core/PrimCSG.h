@@ -0,0 +1,110 @@
+// Constructive Solid Geometry (CSG) Tree class
+#pragma once
+
+#include "PrimBoolean.h"
+
+namespace rt {
+	struct CSGNode;
+	using ptr_csgnode_t = std::shared_ptr<CSGNode>;
+
+	// ================================ CSG Tree Node Structure ================================
+	/**
+	 * @brief Node of the CSG expression tree
+	 * @details A leaf node holds the primitives of a solid, a branch node combines any number of operands with one boolean operation.
+	 * The nodes are created with CPrimCSG::solid() and CPrimCSG::operation() and every node may be used in the expression only once.
+	 */
+	struct CSGNode
+	{
+		BoolOp						operation	= BoolOp::Union;	///< The boolean operation on the operands (branch nodes only)
+		std::vector<ptr_csgnode_t>	vpOperands;						///< The operands (branch nodes only)
+		std::vector<ptr_prim_t>		vpPrims;						///< The primitives of the solid (leaf nodes only)
+		CBoundingBox				boundingBox;					///< The bounding box of the sub-tree, computed by CPrimCSG
+		bool						flipped		= false;			///< Flag indicating that the normals of the leaf's primitives are inverted, since the solid is subtracted
+#ifdef ENABLE_BSP
+		std::shared_ptr<CBVHTree>	pBVHTree	= nullptr;			///< Pointer to the spatial index structure of the leaf's primitives
+#endif
+
+		/**
+		 * @brief Checks whether the node is a leaf node
+		 * @retval true if the node holds the primitives of a solid
+		 * @retval false if the node is a branch node
+		 */
+		bool isLeaf(void) const { return vpOperands.empty(); }
+	};
+
+	// ================================ CSG Tree Primitive Class ================================
+	/**
+	 * @brief Constructive Solid Geometry (CSG) tree primitive class
+	 * @details In contrast to @ref CPrimBoolean, which combines two solids, this class evaluates an arbitrary expression of solids and boolean operations.
+	 * Every branch node of the expression may have any number of operands: the union and the intersection are applied to all of them,
+	 * and the substraction subtracts all the following operands from the first one.
+	 *
+	 * For every ray, the lists of the intervals inside the operands are evaluated bottom-up and merged according to the operations.
+	 * The sub-trees, which bounding boxes are missed by the ray are not evaluated: a missed operand of an intersection (or the first operand of a substraction) empties the whole node.
+	 * @code
+	 * auto expr = CPrimCSG::operation(BoolOp::Substraction, { CPrimCSG::solid(CSolidBox(pShader, Vec3f::all(0), 2)), CPrimCSG::solid(hole1), CPrimCSG::solid(hole2) });
+	 * scene.add(std::make_shared<CPrimCSG>(expr));
+	 * @endcode
+	 * @ingroup modulePrimitive
+	 */
+	class CPrimCSG : public CPrim
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 * @param pRoot The root node of the CSG expression
+		 * @param maxDepth The max depth of the BVH trees of the solids. Only used if BSP support is enabled
+		 * @param maxPrimitives The max number of primitives in the leaf nodes of the BVH trees of the solids. Only used if BSP support is enabled
+		 */
+		DllExport explicit CPrimCSG(const ptr_csgnode_t pRoot, int maxDepth = 20, int maxPrimitives = 3);
+		DllExport virtual ~CPrimCSG(void) override = default;
+
+		/**
+		 * @brief Creates the leaf node of the CSG expression
+		 * @param solid The solid
+		 * @return Pointer to the new node
+		 */
+		DllExport static ptr_csgnode_t				solid(const CSolid& solid);
+		/**
+		 * @brief Creates the branch node of the CSG expression
+		 * @param operation The boolean operation
+		 * @param vpOperands The operands (at least one)
+		 * @return Pointer to the new node
+		 */
+		DllExport static ptr_csgnode_t				operation(BoolOp operation, const std::vector<ptr_csgnode_t>& vpOperands);
+
+		DllExport virtual bool						intersect(Ray& ray) const override;
+		DllExport virtual bool						if_intersect(const Ray& ray) const override;
+		DllExport virtual void						intersectAll(const Ray& ray, std::vector<RayHit>& vHits) const override;
+		DllExport virtual Vec2f						getTextureCoords(const Ray& ray) const override;
+		DllExport virtual std::pair<Vec3f, Vec3f>	dp(const Vec3f& p) const override;
+		DllExport virtual CBoundingBox				getBoundingBox(void) const override { return m_pRoot->boundingBox; }
+		DllExport virtual void						flipNormal(void) override;
+
+
+	private:
+		/// Intervals of a ray inside a sub-tree: the state at the ray origin and the hits, where the state changes
+		struct Span {
+			bool				inside = false;		///< Flag indicating that the ray origin lies inside the sub-tree
+			std::vector<RayHit>	vHits;				///< The hits, where the ray enters or exits the sub-tree, sorted by distance
+		};
+
+		DllExport virtual Vec3f						doGetNormal(const Ray&) const override;
+		DllExport virtual void						doTransform(const Mat& T) override;
+
+		void										prepare(CSGNode& node, bool flipped);				///< Helper method to flip the subtracted solids and to build the trees of the leaves
+		void										computeBoundingBox(CSGNode& node) const;				///< Helper method to recompute the bounding boxes of the sub-tree
+		Span										evaluate(const CSGNode& node, const Ray& ray) const;	///< Helper method to compute the intervals of the ray inside the sub-tree
+		Span										evaluateLeaf(const CSGNode& node, const Ray& ray) const;	///< Helper method to compute the intervals of the ray inside the solid
+
+
+	private:
+		ptr_csgnode_t								m_pRoot;					///< The root node of the CSG expression
+		std::vector<CSGNode*>						m_vpLeaves;					///< The leaf nodes of the CSG expression
+		bool										m_flippedNormal	= false;	///< Flag indicating whether the normals were flipped
+#ifdef ENABLE_BSP
+		int											m_maxDepth;					///< The maximum allowed depth of the trees
+		int											m_maxPrimitives;			///< The minimum number of primitives in a leaf-node
+#endif
+	};
+}
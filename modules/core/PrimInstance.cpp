@@ -0,0 +1,154 @@
+#include "PrimInstance.h"
+#include "Ray.h"
+
+namespace rt {
+	namespace {
+		// Applies the affine transformation matrix t (size: 4 x 4; type: CV_32FC1) to the point p
+		inline Vec3f transformPoint(const Mat& t, const Vec3f& p)
+		{
+			const float* T = t.ptr<float>(0);
+			return Vec3f(T[0] * p[0] + T[1] * p[1] + T[2]  * p[2] + T[3],
+						 T[4] * p[0] + T[5] * p[1] + T[6]  * p[2] + T[7],
+						 T[8] * p[0] + T[9] * p[1] + T[10] * p[2] + T[11]);
+		}
+
+		// Applies the affine transformation matrix t (size: 4 x 4; type: CV_32FC1) to the vector v
+		inline Vec3f transformVector(const Mat& t, const Vec3f& v)
+		{
+			const float* T = t.ptr<float>(0);
+			return Vec3f(T[0] * v[0] + T[1] * v[1] + T[2]  * v[2],
+						 T[4] * v[0] + T[5] * v[1] + T[6]  * v[2],
+						 T[8] * v[0] + T[9] * v[1] + T[10] * v[2]);
+		}
+
+		// Applies the transposed matrix t (size: 4 x 4; type: CV_32FC1) to the vector v. Used for transforming normals with the inverse matrix
+		inline Vec3f transformNormal(const Mat& t, const Vec3f& n)
+		{
+			const float* T = t.ptr<float>(0);
+			return normalize(Vec3f(T[0] * n[0] + T[4] * n[1] + T[8]  * n[2],
+								   T[1] * n[0] + T[5] * n[1] + T[9]  * n[2],
+								   T[2] * n[0] + T[6] * n[1] + T[10] * n[2]));
+		}
+	}
+
+	// ================================ Instance Geometry Class ================================
+	// Constructor
+	CInstanceGeometry::CInstanceGeometry(const CSolid& solid, size_t maxDepth, size_t minPrimitives)
+		: m_vpPrims(solid.getPrims())
+#ifdef ENABLE_BSP
+		, m_pBSPTree(new CBSPTree())
+#endif
+	{
+		for (const auto& pPrim : m_vpPrims)
+			m_boundingBox.extend(pPrim->getBoundingBox());
+#ifdef ENABLE_BSP
+		m_pBSPTree->build(m_vpPrims, maxDepth, minPrimitives);
+#endif
+	}
+
+	bool CInstanceGeometry::intersect(Ray& ray) const
+	{
+#ifdef ENABLE_BSP
+		return m_pBSPTree->intersect(ray);
+#else
+		bool hit = false;
+		for (const auto& pPrim : m_vpPrims)
+			hit |= pPrim->intersect(ray);
+		return hit;
+#endif
+	}
+
+	bool CInstanceGeometry::if_intersect(const Ray& ray) const
+	{
+#ifdef ENABLE_BSP
+		return m_pBSPTree->intersect(lvalue_cast(Ray(ray)));
+#else
+		for (const auto& pPrim : m_vpPrims)
+			if (pPrim->if_intersect(ray)) return true;
+		return false;
+#endif
+	}
+
+	// ================================ Instance Primitive Class ================================
+	// Constructor
+	CPrimInstance::CPrimInstance(const ptr_instance_geometry_t pGeometry, const Mat& t, const ptr_shader_t pShader)
+		: CPrim(pShader, Vec3f::all(0))
+		, m_pGeometry(pGeometry)
+		, m_T(Mat::eye(4, 4, CV_32FC1))
+	{
+		transform(t);
+	}
+
+	bool CPrimInstance::intersect(Ray& ray) const
+	{
+		auto [r, k] = toOCS(ray);
+		if (!m_pGeometry->intersect(r)) return false;
+
+		ray.t		= r.t / k;
+		ray.hit		= shared_from_this();
+		ray.instHit	= r.hit;
+		ray.b1		= r.b1;
+		ray.b2		= r.b2;
+		return true;
+	}
+
+	bool CPrimInstance::if_intersect(const Ray& ray) const
+	{
+		return m_pGeometry->if_intersect(toOCS(ray).first);
+	}
+
+	Vec2f CPrimInstance::getTextureCoords(const Ray& ray) const
+	{
+		return ray.instHit->getTextureCoords(toOCS(ray).first);
+	}
+
+	std::pair<Vec3f, Vec3f> CPrimInstance::dp(const Vec3f&) const
+	{
+		// The primitive at point p is not known here, thus we return the OCS axes of the instance
+		return std::make_pair(transformVector(m_T, Vec3f(1, 0, 0)), transformVector(m_T, Vec3f(0, 0, 1)));
+	}
+
+	Vec3f CPrimInstance::doGetNormal(const Ray& ray) const
+	{
+		return transformNormal(m_invT, ray.instHit->getNormal(toOCS(ray).first));
+	}
+
+	Vec3f CPrimInstance::doGetShadingNormal(const Ray& ray) const
+	{
+		return transformNormal(m_invT, ray.instHit->getShadingNormal(toOCS(ray).first));
+	}
+
+	void CPrimInstance::doTransform(const Mat& T)
+	{
+		m_T = T * m_T;
+		update();
+	}
+
+	// ---------------------- private ----------------------
+	std::pair<Ray, float> CPrimInstance::toOCS(const Ray& ray) const
+	{
+		Ray res(transformPoint(m_invT, ray.org), transformVector(m_invT, ray.dir), ray.ndc, ray.counter);
+		float k = static_cast<float>(norm(res.dir));	// OCS distance per unit of WCS distance
+		res.dir	= res.dir / k;
+		res.t	= ray.t * k;
+		res.b1	= ray.b1;
+		res.b2	= ray.b2;
+		return std::make_pair(res, k);
+	}
+
+	void CPrimInstance::update(void)
+	{
+		m_invT = m_T.inv();
+
+		// Bounding box of the transformed corners of the geometry's bounding box
+		m_boundingBox = CBoundingBox();
+		if (m_pGeometry->getPrims().empty()) return;
+		const CBoundingBox box = m_pGeometry->getBoundingBox();
+		for (int c = 0; c < 8; c++) {
+			Vec3f corner(c & 1 ? box.getMaxPoint()[0] : box.getMinPoint()[0],
+						 c & 2 ? box.getMaxPoint()[1] : box.getMinPoint()[1],
+						 c & 4 ? box.getMaxPoint()[2] : box.getMinPoint()[2]);
+			m_boundingBox.extend(transformPoint(m_T, corner));
+		}
+	}
+}
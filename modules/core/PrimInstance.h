@@ -0,0 +1,132 @@
+// Instanced Geometry Primitive class
+#pragma once
+
+#include "Prim.h"
+#include "Solid.h"
+#ifdef ENABLE_BSP
+#include "BSPTree.h"
+#endif
+
+namespace rt {
+	// ================================ Instance Geometry Class ================================
+	/**
+	 * @brief Geometry shared among instances
+	 * @details This class holds the primitives of a solid together with their own (bottom-level) acceleration structure.
+	 * The structure is built only once, in the constructor, and is shared by all the instances (@ref CPrimInstance) referring to this geometry.
+	 * @note The primitives must not be transformed after the geometry has been created. Transform the instances instead.
+	 * @ingroup moduleGeometry
+	 */
+	class CInstanceGeometry
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 * @param solid The solid whose primitives build the geometry
+		 * @param maxDepth The maximum allowed depth of the bottom-level tree. Only used if BSP support is enabled
+		 * @param minPrimitives The minimum number of primitives in a leaf-node of the bottom-level tree. Only used if BSP support is enabled
+		 */
+		DllExport CInstanceGeometry(const CSolid& solid, size_t maxDepth = 20, size_t minPrimitives = 3);
+		DllExport CInstanceGeometry(const CInstanceGeometry&) = delete;
+		DllExport ~CInstanceGeometry(void) = default;
+		DllExport const CInstanceGeometry& operator=(const CInstanceGeometry&) = delete;
+
+		/**
+		 * @brief Checks for intersection between ray \b ray and the geometry
+		 * @param[in,out] ray The ray in the Object Coordinate System (OCS) of the geometry
+		 * @retval true If ray \b ray intersects any primitive of the geometry
+		 * @retval false otherwise
+		 */
+		DllExport bool								intersect(Ray& ray) const;
+		/**
+		 * @brief Checks for intersection between ray \b ray and the geometry without modifying the ray
+		 * @param ray The ray in the Object Coordinate System (OCS) of the geometry
+		 * @retval true If ray \b ray intersects any primitive of the geometry
+		 * @retval false otherwise
+		 */
+		DllExport bool								if_intersect(const Ray& ray) const;
+		/**
+		 * @brief Returns the bounding box of the geometry in its own Object Coordinate System (OCS)
+		 * @return The bounding box, which contain all the primitives of the geometry
+		 */
+		DllExport CBoundingBox						getBoundingBox(void) const { return m_boundingBox; }
+		/**
+		 * @brief Returns the primitives which build the geometry
+		 * @return The vector with pointers to the primitives which build the geometry
+		 */
+		DllExport const std::vector<ptr_prim_t>&	getPrims(void) const { return m_vpPrims; }
+
+
+	private:
+		std::vector<ptr_prim_t>		m_vpPrims;					///< The primitives of the geometry
+		CBoundingBox				m_boundingBox;				///< The bounding box of the geometry in OCS
+#ifdef ENABLE_BSP
+		std::unique_ptr<CBSPTree>	m_pBSPTree		= nullptr;	///< The bottom-level acceleration structure
+#endif
+	};
+
+	using ptr_instance_geometry_t = std::shared_ptr<const CInstanceGeometry>;
+
+
+	// ================================ Instance Primitive Class ================================
+	/**
+	 * @brief Instance Primitive class
+	 * @details An instance places a shared geometry (@ref CInstanceGeometry) into the scene with its own affine transformation and, optionally, its own shader.
+	 * The geometry itself is never copied nor modified: the rays are transformed into the Object Coordinate System (OCS) of the geometry instead.
+	 * Thus, the memory consumption and the building time of the acceleration structures depend only on the amount of unique geometry, and not on the number of instances.
+	 * The scene acceleration structure built over the instances serves as the top-level structure.
+	 * @code
+	 * auto pTeapot = std::make_shared<CInstanceGeometry>(CSolid(pShader, dataPath + "teapot.obj"));
+	 * for (int i = 0; i < 100; i++)
+	 *     scene.add(std::make_shared<CPrimInstance>(pTeapot, T.translate(i * 10.0f, 0, 0).get()));
+	 * @endcode
+	 * @ingroup modulePrimitive
+	 */
+	class CPrimInstance : public CPrim
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 * @param pGeometry Pointer to the shared geometry
+		 * @param t The affine transformation matrix from the geometry's OCS to WCS (size: 4 x 4; type: CV_32FC1)
+		 * @param pShader Pointer to the shader overriding the shaders of the geometry primitives. If nullptr, the primitives' own shaders are used
+		 */
+		DllExport CPrimInstance(const ptr_instance_geometry_t pGeometry, const Mat& t = Mat::eye(4, 4, CV_32FC1), const ptr_shader_t pShader = nullptr);
+		DllExport virtual ~CPrimInstance(void) = default;
+
+		DllExport virtual bool						intersect(Ray& ray) const override;
+		DllExport virtual bool						if_intersect(const Ray& ray) const override;
+		DllExport virtual Vec2f						getTextureCoords(const Ray& ray) const override;
+		DllExport virtual std::pair<Vec3f, Vec3f>	dp(const Vec3f& p) const override;
+		DllExport virtual CBoundingBox				getBoundingBox(void) const override { return m_boundingBox; }
+
+		/**
+		 * @brief Returns the shared geometry of the instance
+		 * @return The pointer to the shared geometry
+		 */
+		DllExport ptr_instance_geometry_t			getGeometry(void) const { return m_pGeometry; }
+
+
+	private:
+		DllExport virtual Vec3f						doGetNormal(const Ray& ray) const override;
+		DllExport virtual Vec3f						doGetShadingNormal(const Ray& ray) const override;
+		DllExport virtual void						doTransform(const Mat& T) override;
+		/**
+		 * @brief Transforms the ray \b ray from WCS to the geometry's OCS
+		 * @details The direction of the resulting ray is normalized and its Ray::t is scaled accordingly
+		 * @param ray The ray in WCS
+		 * @return The pair: the ray in OCS and the ratio between the OCS and WCS distances along the ray
+		 */
+		std::pair<Ray, float>						toOCS(const Ray& ray) const;
+		/**
+		 * @brief Recomputes the inverse transformation matrix and the bounding box of the instance
+		 */
+		void										update(void);
+
+
+	private:
+		const ptr_instance_geometry_t	m_pGeometry;		///< Pointer to the shared geometry
+		Mat								m_T;				///< The transformation matrix from OCS to WCS (size: 4 x 4)
+		Mat								m_invT;				///< The transformation matrix from WCS to OCS (size: 4 x 4)
+		CBoundingBox					m_boundingBox;		///< The bounding box of the instance in WCS
+	};
+}
@@ -1,25 +1,29 @@
 #include "PrimSphere.h"
 #include "Ray.h"
 #include "Transform.h"
+#include "simd.h"
 #include "macroses.h"
 
 namespace rt {
 	bool CPrimSphere::intersect(Ray& ray) const
 	{
-		double r2 = static_cast<double>(m_radius) * static_cast<double>(m_radius);
+		const float r2 = m_radius * m_radius;
 #if 1
 		// geometrical derivation
-		Vec3f L = getOrigin() - ray.org;
+		const simd::float4 dir = simd::load3(ray.dir);
+		const simd::float4 L = simd::load3(getOrigin()) - simd::load3(ray.org);
 
-		double tb = static_cast<double>(L.dot(ray.dir));
+		const float tb = simd::dot3(L, dir);
 
-		double h2 = static_cast<double>(L.dot(L)) - tb * tb;
+		// the squared distance from the center to the ray, computed as the length of the perpendicular: this is more precise in float than |L|^2 - tb^2
+		const simd::float4 h = L - tb * dir;
+		const float h2 = simd::dot3(h, h);
 		if (h2 > r2)					// no intersection
 			return false;
 
-		double delta = sqrt(r2 - h2);
-		double t0 = tb - delta;
-		double t1 = tb + delta;
+		const float delta = sqrtf(r2 - h2);
+		float t0 = tb - delta;
+		float t1 = tb + delta;
 #else
 		// analytical derivation, numerically not very stable, but simple
 		// --> find roots of f(t) = ((R+tD)-C)^2 - r^2
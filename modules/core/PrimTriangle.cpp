@@ -1,6 +1,7 @@
 #include "PrimTriangle.h"
 #include "Ray.h"
 #include "Transform.h"
+#include "simd.h"
 
 namespace rt {
 	bool CPrimTriangle::intersect(Ray& ray) const
@@ -17,6 +18,12 @@ namespace rt {
 			return false;
 	}
 
+	void CPrimTriangle::intersectAll(const Ray& ray, std::vector<RayHit>& vHits) const
+	{
+		auto t = MoellerTrumbore(ray);
+		if (t) vHits.push_back({ t.value().val[0], shared_from_this(), nullptr, t.value().val[1], t.value().val[2] });
+	}
+
 	Vec3f CPrimTriangle::doGetNormal(const Ray& ray) const
 	{
 			return m_normal;
@@ -86,29 +93,67 @@ namespace rt {
 		res.extend(m_c);
 		return res;
 	}
+
+	CBoundingBox CPrimTriangle::getClippedBoundingBox(const CBoundingBox& box) const
+	{
+		// Sutherland-Hodgman clipping of the triangle by the 6 planes of the box: every plane adds at most one vertex
+		Vec3f	polygon[2][9] = { { m_a, m_b, m_c } };
+		size_t	nVertices = 3;
+		int		cur = 0;
+		for (int dim = 0; dim < 3; dim++)
+			for (int side = 0; side < 2; side++) {
+				const float plane = side ? box.getMaxPoint()[dim] : box.getMinPoint()[dim];
+				auto isInside = [&](const Vec3f& p) { return side ? p[dim] <= plane : p[dim] >= plane; };
+				const Vec3f* src = polygon[cur];
+				Vec3f* dst = polygon[1 - cur];
+				size_t n = 0;
+				for (size_t i = 0; i < nVertices; i++) {
+					const Vec3f& p = src[i];
+					const Vec3f& q = src[(i + 1) % nVertices];
+					if (isInside(p)) dst[n++] = p;
+					if (isInside(p) != isInside(q)) {
+						Vec3f x = p + (plane - p[dim]) / (q[dim] - p[dim]) * (q - p);
+						x[dim] = plane;
+						dst[n++] = x;
+					}
+				}
+				if (n == 0) return CBoundingBox();
+				nVertices = n;
+				cur = 1 - cur;
+			}
+
+		CBoundingBox res;
+		for (size_t i = 0; i < nVertices; i++)
+			res.extend(polygon[cur][i]);
+		return res;
+	}
 	
 	// ---------------------- private ----------------------
 	std::optional<Vec3f> CPrimTriangle::MoellerTrumbore(const Ray& ray) const
 	{
-		const Vec3f pvec = ray.dir.cross(m_edge2);
-		const float det = m_edge1.dot(pvec);
+		const simd::float4 dir		= simd::load3(ray.dir);
+		const simd::float4 edge1	= simd::load3(m_edge1);
+		const simd::float4 edge2	= simd::load3(m_edge2);
+
+		const simd::float4 pvec = simd::cross3(dir, edge2);
+		const float det = simd::dot3(edge1, pvec);
 		if (fabs(det) < std::numeric_limits<float>::epsilon())
 			return std::nullopt;
 
 		const float inv_det = 1.0f / det;
-		const Vec3f tvec = ray.org - m_a;
-		float lambda = tvec.dot(pvec);
+		const simd::float4 tvec = simd::load3(ray.org) - simd::load3(m_a);
+		float lambda = simd::dot3(tvec, pvec);
 		lambda *= inv_det;
 		if (lambda < 0.0f || lambda > 1.0f)
 			return std::nullopt;
 
-		const Vec3f qvec = tvec.cross(m_edge1);
-		float mue = ray.dir.dot(qvec);
+		const simd::float4 qvec = simd::cross3(tvec, edge1);
+		float mue = simd::dot3(dir, qvec);
 		mue *= inv_det;
 		if (mue < 0.0f || mue + lambda > 1.0f)
 			return std::nullopt;
 
-		float t = m_edge2.dot(qvec);
+		float t = simd::dot3(edge2, qvec);
 		t *= inv_det;
 		if (ray.t <= t || t < Epsilon)
 			return std::nullopt;
@@ -116,4 +161,3 @@ namespace rt {
 		return Vec3f(t, lambda, mue);
 	}
 }
-
@@ -77,9 +77,16 @@ namespace rt {
 		
 		DllExport virtual bool						intersect(Ray& ray) const override;
 		DllExport virtual bool						if_intersect(const Ray& ray) const override { return MoellerTrumbore(ray).has_value(); }
+		DllExport virtual void						intersectAll(const Ray& ray, std::vector<RayHit>& vHits) const override;
 		DllExport virtual Vec2f						getTextureCoords(const Ray& ray) const override;
 		DllExport virtual std::pair<Vec3f, Vec3f>	dp(const Vec3f& p) const;
 		DllExport CBoundingBox						getBoundingBox(void) const override;
+		DllExport CBoundingBox						getClippedBoundingBox(const CBoundingBox& box) const override;
+		/**
+		 * @brief Returns the positions of the vertices
+		 * @return The array with the positions of the three vertices
+		 */
+		DllExport std::array<Vec3f, 3>				getVertices(void) const { return { m_a, m_b, m_c }; }
 		
 		
 	private:
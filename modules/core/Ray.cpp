@@ -37,6 +37,7 @@ namespace rt {
 	Vec3f Ray::reTrace(const CScene& scene)
 	{
 		if (hit) hit = nullptr;
+		if (instHit) instHit = nullptr;
 		t = std::numeric_limits<double>::infinity();
 
 		if (counter++ >= maxRayCounter)	return exitColor;
@@ -20,6 +20,7 @@ namespace rt {
 		
 		double							t		= std::numeric_limits<double>::infinity();	///< Current/maximum hit distance
 		std::shared_ptr<const CPrim>	hit		= nullptr;									///< Pointer to currently closest primitive
+		std::shared_ptr<const CPrim>	instHit	= nullptr;									///< Pointer to the closest primitive within the instance pointed by Ray::hit (if any)
 		float							b1		= 0;										///< Barycentric coordinate
 		float							b2		= 0;										///< Barycentric coordinate
 		
@@ -78,4 +79,116 @@ namespace rt {
 		 */
 		Vec3f				reTrace(const CScene& scene);
 	};
+
+	// ================================ Ray Data Structure ================================
+	/**
+	 * @brief Ray data, precomputed for the slab tests of the acceleration structures
+	 * @details The traversal of a tree tests a ray against many boxes and split planes. This structure is computed once per ray,
+	 * so that every such test needs only a multiplication and a subtraction per axis: \f$ t = p \cdot d^{-1} - o \cdot d^{-1} \f$.
+	 * The direction components, which are (close to) zero, are replaced by a tiny value of the same sign before the inversion: thus the inverse direction is always finite,
+	 * and no NaNs appear for the rays, parallel to an axis: these rays get huge distances to the planes of the parallel slabs, which is equivalent to the infinite ones,
+	 * so the slab tests need no branches for these cases. A ray lying exactly in the plane of a slab gets zero distance to it, \a i.e. it only touches the slab at its origin.
+	 */
+	struct RayData
+	{
+		float	org[3];				///< %Ray origin
+		float	invDir[3];			///< Inverse of the ray direction
+		float	orgInvDir[3];		///< %Ray origin multiplied component-wise with the inverse direction
+		byte	sign[3];			///< Signs of the direction components: 1 for negative (including -0) and 0 for positive. The near planes of a box are the maximum points along the negative directions
+
+		/**
+		 * @brief Constructor
+		 * @param ray The ray
+		 */
+		explicit RayData(const Ray& ray)
+		{
+			for (int i = 0; i < 3; i++) {
+				org[i]			= ray.org[i];
+				invDir[i]		= inverse(ray.dir[i]);
+				orgInvDir[i]	= org[i] * invDir[i];
+				sign[i]			= std::signbit(ray.dir[i]) ? 1 : 0;
+			}
+		}
+		/**
+		 * @brief Returns the inverse of a direction component
+		 * @details The components, which magnitude is less than 1e-20 are replaced by \f$ \pm 10^{-20} \f$, keeping the sign, so that the result is always finite
+		 * @param d The direction component
+		 * @return The finite inverse value
+		 */
+		static float inverse(float d)
+		{
+			const float minDir = 1e-20f;
+			return 1.0f / (fabsf(d) < minDir ? copysignf(minDir, d) : d);
+		}
+	};
+
+	// ================================ Ray Hit Structure ================================
+	/**
+	 * @brief Intersection of a ray with a primitive
+	 * @details This structure is returned by the queries for all the intersections along a ray, \a e.g. CPrim::intersectAll()
+	 */
+	struct RayHit
+	{
+		double							t;					///< Distance from the ray origin to the hitpoint
+		std::shared_ptr<const CPrim>	hit;				///< Pointer to the intersected primitive
+		std::shared_ptr<const CPrim>	instHit;			///< Pointer to the intersected primitive within the instance pointed by RayHit::hit (if any)
+		float							b1;					///< Barycentric coordinate
+		float							b2;					///< Barycentric coordinate
+	};
+
+	// ================================ Ray Batch Structure ================================
+	/**
+	 * @brief Batch of rays in the Structure of Arrays (SoA) layout
+	 * @details This structure is the input of the batch intersection queries, \a e.g. CScene::intersect(const RayBatch&, std::vector<RayHit>&) const.
+	 * The directions of the rays do not need to be normalized: the hit distances are measured in the units of the direction length.
+	 */
+	struct RayBatch
+	{
+		std::vector<float>				org[3];				///< Origins of the rays: org[axis][ray]
+		std::vector<float>				dir[3];				///< Directions of the rays: dir[axis][ray]
+		std::vector<float>				tMax;				///< Maximum hit distances of the rays
+
+		/**
+		 * @brief Adds a new ray to the batch
+		 * @param _org %Ray origin
+		 * @param _dir %Ray direction
+		 * @param _tMax Maximum hit distance
+		 */
+		void	push_back(const Vec3f& _org, const Vec3f& _dir, float _tMax = Infty)
+		{
+			for (int i = 0; i < 3; i++) {
+				org[i].push_back(_org[i]);
+				dir[i].push_back(_dir[i]);
+			}
+			tMax.push_back(_tMax);
+		}
+		/**
+		 * @brief Returns the number of rays in the batch
+		 * @return The number of rays
+		 */
+		size_t	size(void) const { return tMax.size(); }
+		/**
+		 * @brief Removes all the rays from the batch
+		 * @details The allocated memory is kept, thus the batch may be re-filled without re-allocations
+		 */
+		void	clear(void)
+		{
+			for (int i = 0; i < 3; i++) {
+				org[i].clear();
+				dir[i].clear();
+			}
+			tMax.clear();
+		}
+		/**
+		 * @brief Returns the ray with index \b i
+		 * @param i The index of the ray
+		 * @return The ray
+		 */
+		Ray		getRay(size_t i) const
+		{
+			Ray res(Vec3f(org[0][i], org[1][i], org[2][i]), Vec3f(dir[0][i], dir[1][i], dir[2][i]));
+			res.t = tMax[i];
+			return res;
+		}
+	};
 }
@@ -0,0 +1,104 @@
+#include "ReSTIR.h"
+#include "Scene.h"
+#include "Ray.h"
+#include "random.h"
+#include "macroses.h"
+
+namespace rt {
+	namespace {
+		const float	maxTemporalM		= 20;		// The maximal number of candidates of the previous pass, relative to the number of candidates per point
+		const float	minNormalSimilarity	= 0.9f;		// The minimal cosine between the normals of the merged reservoirs
+		const float	maxPointDistance	= 0.1f;		// The maximal distance between the points of the merged reservoirs, relative to the distance to the viewer
+
+		// Returns the scalar value of the target function
+		float luminance(const Vec3f& color) { return (color[0] + color[1] + color[2]) / 3; }
+	}
+
+	void CReSTIR::setParameters(size_t nCandidates, size_t nPasses, size_t nNeighbours, int radius)
+	{
+		RT_ASSERT(radius >= 0);
+		m_nCandidates	= nCandidates;
+		m_nPasses		= MAX(nPasses, 1);
+		m_nNeighbours	= nNeighbours;
+		m_radius		= radius;
+		m_resolution	= Size(0, 0);
+		m_vCurrent.clear();
+		m_vPrevious.clear();
+	}
+
+	void CReSTIR::beginPass(const Size& resolution)
+	{
+		const size_t nPixels = static_cast<size_t>(resolution.width) * resolution.height;
+		if (resolution != m_resolution) {
+			m_resolution = resolution;
+			m_vPrevious.assign(nPixels, LightReservoir());
+		}
+		else std::swap(m_vCurrent, m_vPrevious);
+		m_vCurrent.assign(nPixels, LightReservoir());
+	}
+
+	Vec3f CReSTIR::illuminate(const CScene& scene, const std::vector<ptr_light_t>& vpLights, const Ray& ray, Ray& I, const Vec3f& normal, const reflectance_function_t& reflectance)
+	{
+		if (vpLights.empty()) return Vec3f::all(0);
+
+		// Evaluates the unshadowed contribution of a light sample and returns the target function
+		auto evaluate = [&](size_t light, const Vec2f& sample, Vec3f& contribution) {
+			I.hit = ray.hit;
+			I.instHit = ray.instHit;
+			auto radiance = vpLights[light]->illuminate(I, sample);
+			if (!radiance) return 0.0f;
+			contribution = reflectance(I.dir, radiance.value());
+			return MAX(luminance(contribution), 0.0f);
+		};
+
+		// ------ candidates ------
+		LightReservoir reservoir;
+		reservoir.point		= I.org;
+		reservoir.normal	= normal;
+		Vec3f contribution;
+		const float nLights = static_cast<float>(vpLights.size());
+		for (size_t c = 0; c < m_nCandidates; c++) {
+			const size_t light	= MIN(static_cast<size_t>(random::U<float>() * nLights), vpLights.size() - 1);
+			const Vec2f sample(random::U<float>(), random::U<float>());
+			const float targetPdf = evaluate(light, sample, contribution);
+			reservoir.update(light, sample, targetPdf, targetPdf * nLights, random::U<float>());		// the pick probability of the light is 1 / nLights
+		}
+
+		// ------ temporal and spatial reuse ------
+		LightReservoir* pPixelReservoir = nullptr;
+		if (ray.counter == 0 && !m_vCurrent.empty()) {
+			const int x = static_cast<int>(ray.ndc[0] * m_resolution.width);
+			const int y = static_cast<int>(ray.ndc[1] * m_resolution.height);
+			if (x >= 0 && x < m_resolution.width && y >= 0 && y < m_resolution.height) {
+				pPixelReservoir = &m_vCurrent[static_cast<size_t>(y) * m_resolution.width + x];
+
+				const float maxM		= maxTemporalM * m_nCandidates;
+				const float maxDistance	= maxPointDistance * static_cast<float>(ray.t);
+				auto reuse = [&](int nx, int ny) {
+					if (nx < 0 || nx >= m_resolution.width || ny < 0 || ny >= m_resolution.height) return;
+					const LightReservoir& other = m_vPrevious[static_cast<size_t>(ny) * m_resolution.width + nx];
+					if (other.M == 0 || other.light >= vpLights.size()) return;
+					if (other.normal.dot(normal) < minNormalSimilarity || norm(other.point - I.org) > maxDistance) return;
+					Vec3f otherContribution;
+					reservoir.merge(other, evaluate(other.light, other.sample, otherContribution), maxM, random::U<float>());
+				};
+				reuse(x, y);
+				for (size_t n = 0; n < m_nNeighbours; n++)
+					reuse(x + random::u<int>(-m_radius, m_radius), y + random::u<int>(-m_radius, m_radius));
+			}
+		}
+
+		// ------ shading with one shadow ray ------
+		Vec3f res = Vec3f::all(0);
+		if (reservoir.targetPdf > 0) {
+			evaluate(reservoir.light, reservoir.sample, contribution);
+			const float visibility = scene.getVisibility(I, *vpLights[reservoir.light]);
+			if (visibility > 0)
+				res = visibility * reservoir.getWeight() * contribution;
+			else
+				reservoir.weightSum = 0;		// the occluded samples are not reused
+		}
+		if (pPixelReservoir) *pPixelReservoir = reservoir;
+		return res;
+	}
+}
@@ -0,0 +1,144 @@
+// Reservoir-based Spatiotemporal Importance Resampling (ReSTIR) class
+#pragma once
+
+#include "ILight.h"
+#include <functional>
+
+namespace rt {
+	class CScene;
+
+	/**
+	 * @brief The reflectance function of a shaded point
+	 * @details The function returns the light, reflected towards the viewer, for the light coming from the direction \b dir with the intensity \b radiance
+	 */
+	using reflectance_function_t = std::function<Vec3f(const Vec3f& dir, const Vec3f& radiance)>;
+
+	// ================================ Light Reservoir Structure ================================
+	/**
+	 * @brief Weighted reservoir, holding one light sample chosen out of a stream of candidates
+	 * @details A candidate replaces the held sample with the probability, proportional to its resampling weight, thus after processing the stream
+	 * the held sample is distributed approximately proportionally to the target function \f$ \hat{p} \f$
+	 */
+	struct LightReservoir
+	{
+		size_t	light		= 0;					///< Index of the light source of the held sample
+		Vec2f	sample		= Vec2f::all(0);		///< The sample on the light source (see ILight::illuminate(Ray&, const Vec2f&) const)
+		float	targetPdf	= 0;					///< The value of the target function for the held sample at the point, where the reservoir was created
+		float	weightSum	= 0;					///< The sum of the resampling weights of all the processed candidates
+		float	M			= 0;					///< The number of the processed candidates
+		Vec3f	point		= Vec3f::all(0);		///< The point, where the reservoir was created
+		Vec3f	normal		= Vec3f::all(0);		///< The normal at the point, where the reservoir was created
+
+		/**
+		 * @brief Processes one candidate
+		 * @param _light Index of the light source of the candidate
+		 * @param _sample The sample on the light source
+		 * @param _targetPdf The value of the target function for the candidate
+		 * @param weight The resampling weight of the candidate
+		 * @param u The random number, uniformly distributed in [0; 1)
+		 * @retval true if the candidate was chosen
+		 * @retval false otherwise
+		 */
+		bool	update(size_t _light, const Vec2f& _sample, float _targetPdf, float weight, float u)
+		{
+			weightSum += weight;
+			M += 1;
+			if (weight <= 0 || u * weightSum >= weight) return false;
+			light		= _light;
+			sample		= _sample;
+			targetPdf	= _targetPdf;
+			return true;
+		}
+		/**
+		 * @brief Merges another reservoir into this one
+		 * @details The sample of the other reservoir is treated as one candidate, which represents all the candidates processed by that reservoir
+		 * @param other The other reservoir
+		 * @param _targetPdf The value of the target function for the sample of the other reservoir, evaluated at the point of this reservoir
+		 * @param maxM The maximal number of candidates, which the other reservoir may represent. It limits the influence of the outdated reservoirs
+		 * @param u The random number, uniformly distributed in [0; 1)
+		 * @retval true if the sample of the other reservoir was chosen
+		 * @retval false otherwise
+		 */
+		bool	merge(const LightReservoir& other, float _targetPdf, float maxM, float u)
+		{
+			const float otherM = MIN(other.M, maxM);
+			bool res = update(other.light, other.sample, _targetPdf, _targetPdf * other.getWeight() * otherM, u);
+			M += otherM - 1;
+			return res;
+		}
+		/**
+		 * @brief Returns the unbiased contribution weight of the held sample
+		 * @details The weight \f$ W = \frac{w_{sum}}{M \hat{p}} \f$ plays the role of the reciprocal probability density of the held sample
+		 * @return The contribution weight; 0 if the reservoir is empty
+		 */
+		float	getWeight(void) const { return M > 0 && targetPdf > 0 ? weightSum / (M * targetPdf) : 0; }
+	};
+
+	// ================================ ReSTIR Class ================================
+	/**
+	 * @brief Reservoir-based Spatiotemporal Importance Resampling (ReSTIR) of the direct illumination
+	 * @details Instead of tracing a shadow ray to every light source, a shaded point draws a number of cheap candidate samples from uniformly picked light sources,
+	 * and resamples one of them proportionally to its unshadowed contribution with a @ref LightReservoir. For the primary rays, the reservoir is then merged with the reservoirs of
+	 * the same pixel from the previous pass (temporal reuse) and of a few random neighbouring pixels (spatial reuse), which describe similar points. Thus every pixel
+	 * effectively chooses its light sample out of thousands of candidates, while only one shadow ray is traced for the chosen sample.
+	 * The reservoirs of the current pass are stored per pixel and are reused by the next pass; the spatial neighbours are always taken from the previous pass,
+	 * so that the passes may be rendered in parallel. The reuse between the neighbours is biased at the geometric discontinuities, which is reduced by rejecting dissimilar neighbours.
+	 * @note This class is used by CScene, see CScene::setReSTIR()
+	 * @ingroup moduleLight
+	 */
+	class CReSTIR
+	{
+	public:
+		DllExport CReSTIR(void) = default;
+		DllExport CReSTIR(const CReSTIR&) = delete;
+		DllExport ~CReSTIR(void) = default;
+		DllExport const CReSTIR& operator=(const CReSTIR&) = delete;
+
+		/**
+		 * @brief Sets the parameters of the resampling
+		 * @param nCandidates The number of the candidate samples per shaded point. 0 disables the resampling
+		 * @param nPasses The number of the progressive passes per render
+		 * @param nNeighbours The number of the spatial neighbours, merged per pixel
+		 * @param radius The radius of the neighbourhood in pixels
+		 */
+		DllExport void		setParameters(size_t nCandidates, size_t nPasses, size_t nNeighbours, int radius);
+		/**
+		 * @brief Checks whether the resampling is enabled
+		 * @retval true if the number of the candidates is positive
+		 * @retval false otherwise
+		 */
+		DllExport bool		isEnabled(void) const { return m_nCandidates > 0; }
+		/**
+		 * @brief Returns the number of the progressive passes per render
+		 * @return The number of passes
+		 */
+		DllExport size_t	getNumPasses(void) const { return m_nPasses; }
+		/**
+		 * @brief Starts a new pass
+		 * @details The reservoirs of the finished pass become the previous ones. If the resolution has changed, all the reservoirs are discarded
+		 * @param resolution The resolution of the rendered image
+		 */
+		DllExport void		beginPass(const Size& resolution);
+		/**
+		 * @brief Estimates the direct illumination of a point
+		 * @param scene The scene
+		 * @param vpLights The light sources of the scene
+		 * @param ray The ray, hitting the shaded point
+		 * @param I The shadow ray with the origin at the shaded point
+		 * @param normal The shading normal at the point
+		 * @param reflectance The reflectance function of the point
+		 * @return The reflected light
+		 */
+		DllExport Vec3f		illuminate(const CScene& scene, const std::vector<ptr_light_t>& vpLights, const Ray& ray, Ray& I, const Vec3f& normal, const reflectance_function_t& reflectance);
+
+
+	private:
+		size_t						m_nCandidates	= 0;				///< The number of the candidate samples per shaded point
+		size_t						m_nPasses		= 1;				///< The number of the progressive passes per render
+		size_t						m_nNeighbours	= 3;				///< The number of the spatial neighbours
+		int							m_radius		= 8;				///< The radius of the neighbourhood in pixels
+		Size						m_resolution	= Size(0, 0);		///< The resolution of the reservoir buffers
+		std::vector<LightReservoir>	m_vCurrent;							///< The reservoirs of the current pass
+		std::vector<LightReservoir>	m_vPrevious;						///< The reservoirs of the previous pass
+	};
+}
@@ -1,5 +1,6 @@
 #include "Sampler.h"
 #include "macroses.h"
+#include "random.h"
 
 namespace rt {
 #ifdef ENABLE_PDP
@@ -109,6 +110,14 @@ namespace rt {
 		return Vec3f(s[0], s[1], z);
 	}
 
+	Vec2f CSampler::stratifiedSample(size_t idx, size_t nSamples)
+	{
+		const Vec2f jitter(random::U<float>(), random::U<float>());
+		const size_t n = static_cast<size_t>(sqrtf(static_cast<float>(nSamples)) + 0.5f);
+		if (n * n != nSamples) return jitter;
+		return (1.0f / n) * (Vec2f(static_cast<float>(idx % n), static_cast<float>((idx / n) % n)) + jitter);
+	}
+
 	Vec2f CSampler::uniformSampleRegularNgon(const Vec2f& s, size_t nSides, size_t side)
 	{
 		if (nSides == 0) return CSampler::concentricSampleDisk(s);
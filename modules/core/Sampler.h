@@ -93,6 +93,17 @@ namespace rt {
 		* @return Sample
 		*/
 		DllExport static Vec3f	transformSampleToWCS(const Vec3f& sample, const Vec3f& normal);
+		/**
+		* @brief Returns a jittered stratified sample
+		* @details The unit square is divided into \f$ n \times n \f$ strata with \f$ n = \sqrt{nSamples} \f$ and the sample is placed randomly within the stratum \b idx.
+		* In contrast to getNextSample() method, this function has no state, thus it may be called from several threads at once, \a e.g. to sample the light sources (ILight::illuminate()).
+		* If \b nSamples is not a square number, the sample is uniformly distributed over the whole square.
+		* > This function is thread-safe
+		* @param idx The index of the sample in a series: \b idx < \b nSamples
+		* @param nSamples The number of samples in a series
+		* @return The sample in square \f$[0; 1)^2\f$
+		*/
+		DllExport static Vec2f	stratifiedSample(size_t idx, size_t nSamples);
 
 
 	protected:
@@ -1,32 +1,164 @@
 #include "Scene.h"
 #include "Ray.h"
 #include "Solid.h"
+#include "PrimTriangle.h"
+#include "BVHTree.h"
+#include "LightEnvironment.h"
+#include "random.h"
 #include "macroses.h"
+#include <unordered_set>
+#include <unordered_map>
+#include <iomanip>
+#include <numeric>
 
 namespace rt {
+	namespace {
+		const size_t batchChunkSize = 1024;		// Number of rays of the batch, processed by one thread at once
+
+		// The power heuristic of multiple importance sampling for the equal numbers of samples from two distributions
+		float powerHeuristic(float pdf, float otherPdf) { return pdf * pdf / (pdf * pdf + otherPdf * otherPdf); }
+
+		// The last occluders of the shadow rays of the current thread towards the light sources
+		struct OccluderCache
+		{
+			const CScene*														pScene	= nullptr;	// The scene of the cached occluders
+			size_t																version	= 0;		// The version of the scene's occluders
+			std::unordered_map<const ILight*, std::shared_ptr<const CPrim>>	occluders;			// The last occluder per light source
+		};
+		thread_local OccluderCache occluderCache;
+		std::atomic<size_t> occluderCacheVersion = 0;		// The last version of the occluder caches of all the scenes
+
+		std::atomic<size_t> nThreadSlots = 0;
+		thread_local const size_t threadSlot = nThreadSlots++;	// The index of the current thread, which maps it to its own slot of the per-thread counters
+
+		// Returns the stride, co-prime with n, which visits all the n strata in the well-spread order (close to the golden ratio), so that the first samples cover the whole light source
+		size_t getStride(size_t n)
+		{
+			size_t res = MAX(static_cast<size_t>(0.618f * n), 1);
+			while (std::gcd(res, n) != 1) res++;
+			return res;
+		}
+	}
+
+#if defined(ENABLE_CACHE) && defined(ENABLE_BSP)
+	namespace {
+		// Computes the FNV-1a hash of the primitives' bounding boxes and of the build parameters
+		// The bounding boxes of the primitives are the only input of the BSP, SAH and LBVH builders, thus equal hashes lead to equal structures.
+		// The SBVH builder also clips the primitives by the split planes (see CPrim::getClippedBoundingBox()), thus for it \b hashShapes adds the vertices of the triangles:
+		// the other primitives are clipped by their bounding boxes only
+		qword hashGeometry(const std::vector<ptr_prim_t>& vpPrims, size_t maxDepth, size_t minPrimitives, bool hashShapes)
+		{
+			qword res = 14695981039346656037ULL;
+			auto hash = [&res](const void* pData, size_t size) {
+				const byte* pBytes = static_cast<const byte*>(pData);
+				for (size_t i = 0; i < size; i++) {
+					res ^= pBytes[i];
+					res *= 1099511628211ULL;
+				}
+			};
+			qword params[3] = { vpPrims.size(), maxDepth, minPrimitives };
+			hash(params, sizeof(params));
+			for (const auto& pPrim : vpPrims) {
+				CBoundingBox box = pPrim->getBoundingBox();
+				hash(box.getMinPoint().val, 3 * sizeof(float));
+				hash(box.getMaxPoint().val, 3 * sizeof(float));
+				if (!hashShapes) continue;
+				auto pTriangle = std::dynamic_pointer_cast<const CPrimTriangle>(pPrim);
+				if (pTriangle)
+					for (const Vec3f& vertex : pTriangle->getVertices())
+						hash(vertex.val, 3 * sizeof(float));
+			}
+			return res;
+		}
+	}
+#endif
 
 	void CScene::clear(void) 
 	{
 		m_vpPrims.clear();
+		m_vpUnboundedPrims.clear();
 		m_vpLights.clear();
+		m_pBgLight = nullptr;
+		m_lightsDirty = true;
+		m_occluderCacheVersion = ++occluderCacheVersion;
 		m_vpCameras.clear();
 		m_activeCamera = 0;
+#ifdef ENABLE_BSP
+		m_pAccelStructure->build(m_vpPrims, m_maxDepth, m_minPrimitives);
+		m_accelDirty = false;
+#endif
 	}
 	
 	void CScene::add(const ptr_prim_t pPrim) 
 	{ 
-		m_vpPrims.push_back(pPrim);
+#ifdef ENABLE_BSP
+		if (!addPrim(pPrim)) m_pAccelStructure->build(m_vpPrims, m_maxDepth, m_minPrimitives);
+#else
+		addPrim(pPrim);
+#endif
 	}
 
 	void CScene::add(const CSolid& solid)
 	{
+		// one re-build for all the primitives of the solid, which could not be inserted
+		bool rebuild = false;
 		for (const auto& pPrim : solid.getPrims())
-			add(pPrim);
+			rebuild |= !addPrim(pPrim);
+#ifdef ENABLE_BSP
+		if (rebuild) m_pAccelStructure->build(m_vpPrims, m_maxDepth, m_minPrimitives);
+#endif
+	}
+
+	void CScene::remove(const ptr_prim_t pPrim)
+	{
+		auto itUnbounded = std::find(m_vpUnboundedPrims.begin(), m_vpUnboundedPrims.end(), pPrim);
+		if (itUnbounded != m_vpUnboundedPrims.end()) {
+			m_vpUnboundedPrims.erase(itUnbounded);
+			m_occluderCacheVersion = ++occluderCacheVersion;
+			return;
+		}
+		auto it = std::find(m_vpPrims.begin(), m_vpPrims.end(), pPrim);
+		if (it == m_vpPrims.end()) return;
+		m_vpPrims.erase(it);
+		m_occluderCacheVersion = ++occluderCacheVersion;
+#ifdef ENABLE_BSP
+		// the built structure is kept consistent with the scene for the queries, which do not re-build it
+		if (!m_accelDirty && !m_pAccelStructure->remove(pPrim))
+			m_pAccelStructure->build(m_vpPrims, m_maxDepth, m_minPrimitives);
+#endif
+	}
+
+	void CScene::remove(const CSolid& solid)
+	{
+		// Remove all the primitives of the solid in one pass over the scene primitives
+		std::unordered_set<ptr_prim_t> sPrims(solid.getPrims().begin(), solid.getPrims().end());
+		auto isSolidPrim = [&sPrims](const ptr_prim_t& pPrim) { return sPrims.count(pPrim) > 0; };
+		auto itRemoved = std::stable_partition(m_vpPrims.begin(), m_vpPrims.end(), [&isSolidPrim](const ptr_prim_t& pPrim) { return !isSolidPrim(pPrim); });
+#ifdef ENABLE_BSP
+		// only the bounded primitives, which were present in scene, are stored in the acceleration structure
+		bool rebuild = false;
+		for (auto it = itRemoved; it != m_vpPrims.end() && !m_accelDirty && !rebuild; it++)
+			rebuild = !m_pAccelStructure->remove(*it);
+#endif
+		m_vpPrims.erase(itRemoved, m_vpPrims.end());
+#ifdef ENABLE_BSP
+		if (rebuild) m_pAccelStructure->build(m_vpPrims, m_maxDepth, m_minPrimitives);
+#endif
+		m_vpUnboundedPrims.erase(std::remove_if(m_vpUnboundedPrims.begin(), m_vpUnboundedPrims.end(), isSolidPrim), m_vpUnboundedPrims.end());
+		m_occluderCacheVersion = ++occluderCacheVersion;
 	}
 
 	void CScene::add(const ptr_light_t pLight) 
 	{ 
 		m_vpLights.push_back(pLight); 
+		m_lightsDirty = true;
+	}
+
+	void CScene::addBackgroundLight(const Vec3f& intensity, size_t nSamples, bool castShadow)
+	{
+		RT_ASSERT_MSG(m_bgMap && !m_bgMap->empty(), "The scene has no background texture map");
+		m_pBgLight = std::make_shared<CLightEnvironment>(m_bgMap, intensity, nSamples, castShadow);
+		add(m_pBgLight);
 	}
 
 	void CScene::add(const ptr_camera_t pCamera) 
@@ -46,7 +178,115 @@ namespace rt {
 	void CScene::buildAccelStructure(size_t maxDepth, size_t minPrimitives)
 	{ 
 #ifdef ENABLE_BSP
-		m_pBSPTree->build(m_vpPrims, maxDepth, minPrimitives);
+		m_maxDepth		= maxDepth;
+		m_minPrimitives	= minPrimitives;
+		m_accelDirty	= false;
+#ifdef ENABLE_CACHE
+		if (!m_accelCachePath.empty()) {
+			auto pBVH = std::dynamic_pointer_cast<CBVHTree>(m_pAccelStructure);
+			qword hash = hashGeometry(m_vpPrims, maxDepth, minPrimitives, pBVH && pBVH->getBuilder() == BVHBuilder::SBVH);
+			std::stringstream fileName;
+			fileName << m_accelCachePath << "/accel_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+			if (m_pAccelStructure->load(fileName.str(), m_vpPrims, hash)) {
+#ifdef DEBUG_PRINT_INFO
+				std::cout << "Acceleration structure is loaded from " << fileName.str() << std::endl;
+#endif
+				return;
+			}
+			m_pAccelStructure->build(m_vpPrims, maxDepth, minPrimitives);
+			m_pAccelStructure->save(fileName.str(), m_vpPrims, hash);
+			return;
+		}
+#endif
+		m_pAccelStructure->build(m_vpPrims, maxDepth, minPrimitives);
+#else 
+		RT_WARNING("BSP support is not enabled");
+#endif		
+	}
+
+	void CScene::updateAccelStructure(float maxDegradation)
+	{
+#ifdef ENABLE_BSP
+		if (m_accelDirty || !m_pAccelStructure->refit() || m_pAccelStructure->getDegradation() > maxDegradation) {
+			m_pAccelStructure->build(m_vpPrims, m_maxDepth, m_minPrimitives);
+			m_accelDirty = false;
+		}
+#else 
+		RT_WARNING("BSP support is not enabled");
+#endif		
+	}
+
+	void CScene::setAccelStructureCachePath(const std::string& path)
+	{
+#if defined(ENABLE_CACHE) && defined(ENABLE_BSP)
+		m_accelCachePath = path;
+#else
+		RT_WARNING("Caching support is not enabled");
+#endif
+	}
+
+	void CScene::updateLightStructures(void)
+	{
+		std::lock_guard<std::mutex> lock(m_lightsMutex);
+		buildLightStructures();
+	}
+
+	void CScene::setLightSampling(size_t nLights)
+	{
+		m_nLightSamples	= nLights;
+		m_lightsDirty	= true;
+	}
+
+	void CScene::setLightCulling(bool enable)
+	{
+		m_lightCulling	= enable;
+		m_lightsDirty	= true;
+	}
+
+	void CScene::setReSTIR(size_t nCandidates, size_t nPasses, size_t nNeighbours, int radius)
+	{
+		m_reSTIR.setParameters(nCandidates, nPasses, nNeighbours, radius);
+	}
+
+	void CScene::setAdaptiveLightSampling(size_t nTestSamples)
+	{
+		m_nTestLightSamples = nTestSamples;
+	}
+
+	void CScene::setOccluderCache(bool enable)
+	{
+		m_occluderCache			= enable;
+		m_occluderCacheVersion	= ++occluderCacheVersion;
+	}
+
+	size_t CScene::getNumOccluderTests(void) const
+	{
+		size_t res = 0;
+		for (const auto& counters : m_vOccluderCacheCounters) res += counters.nTests.load(std::memory_order_relaxed);
+		return res;
+	}
+
+	size_t CScene::getNumOccluderCacheHits(void) const
+	{
+		size_t res = 0;
+		for (const auto& counters : m_vOccluderCacheCounters) res += counters.nHits.load(std::memory_order_relaxed);
+		return res;
+	}
+
+	void CScene::resetOccluderCacheCounters(void)
+	{
+		for (auto& counters : m_vOccluderCacheCounters) {
+			counters.nTests = 0;
+			counters.nHits = 0;
+		}
+	}
+
+	void CScene::setAccelStructure(const ptr_accelstructure_t pAccelStructure)
+	{
+#ifdef ENABLE_BSP
+		RT_ASSERT(pAccelStructure);
+		m_pAccelStructure	= pAccelStructure;
+		m_accelDirty		= true;
 #else 
 		RT_WARNING("BSP support is not enabled");
 #endif		
@@ -56,10 +296,13 @@ namespace rt {
 	{
 		ptr_camera_t activeCamera = getActiveCamera();
 		RT_ASSERT_MSG(activeCamera, "Camera is not found. Add at least one camera to the scene.");
+		prepareAccelStructure();
+		buildLightStructures();
+		for (auto& pLight : m_vpLights) pLight->buildShadowMap(*this);
 		Mat img(activeCamera->getResolution(), CV_32FC3, Scalar(0)); 	// image array
 		
 #ifdef DEBUG_PRINT_INFO
-		std::cout << "\nNumber of Primitives: " << m_vpPrims.size() << std::endl;
+		std::cout << "\nNumber of Primitives: " << m_vpPrims.size() + m_vpUnboundedPrims.size() << " (" << m_vpUnboundedPrims.size() << " unbounded)" << std::endl;
 		std::cout << "Number of light sources: " << m_vpLights.size() << std::endl;
 		size_t nSamples = 0;
 		for (const auto& pLight : m_vpLights) nSamples += pLight->getNumSamples();
@@ -67,26 +310,32 @@ namespace rt {
 		std::cout << "Rays per Pixel: " << nSamples << std::endl;
 #endif
 		
+		// progressive passes: every ReSTIR pass reuses the reservoirs of the previous one
+		const size_t nPasses = m_reSTIR.isEnabled() ? m_reSTIR.getNumPasses() : 1;
+		for (size_t pass = 0; pass < nPasses; pass++) {
+			if (m_reSTIR.isEnabled()) m_reSTIR.beginPass(img.size());
 #ifdef ENABLE_PDP
-		parallel_for_(Range(0, img.rows), [&](const Range& range) {
+			parallel_for_(Range(0, img.rows), [&](const Range& range) {
 #else
-		const Range range(0, img.rows);
+			const Range range(0, img.rows);
 #endif
-		Ray ray;
-		for (int y = range.start; y < range.end; y++) {
-			Vec3f* pImg = img.ptr<Vec3f>(y);
-			for (int x = 0; x < img.cols; x++) {
-				size_t nSamples = pSampler ? pSampler->getNumSamples() : 1;
-				for (size_t s = 0; s < nSamples; s++) {
-					activeCamera->InitRay(ray, x, y, pSampler ? pSampler->getNextSample() : Vec2f::all(0.5f));
-					pImg[x] += rayTrace(ray);
+			Ray ray;
+			for (int y = range.start; y < range.end; y++) {
+				Vec3f* pImg = img.ptr<Vec3f>(y);
+				for (int x = 0; x < img.cols; x++) {
+					size_t nSamples = pSampler ? pSampler->getNumSamples() : 1;
+					Vec3f sum = Vec3f::all(0);
+					for (size_t s = 0; s < nSamples; s++) {
+						activeCamera->InitRay(ray, x, y, pSampler ? pSampler->getNextSample() : Vec2f::all(0.5f));
+						sum += rayTrace(ray);
+					}
+					pImg[x] += (1.0f / (nSamples * nPasses)) * sum;
 				}
-				pImg[x] = (1.0f / nSamples) * pImg[x];
 			}
-		}
 #ifdef ENABLE_PDP
-		});
+			});
 #endif
+		}
 		img.convertTo(img, CV_8UC3, 255);
 #ifdef ENABLE_CACHE
 		imwrite(m_lriFileName, img);
@@ -98,6 +347,7 @@ namespace rt {
 	{
 		ptr_camera_t activeCamera = getActiveCamera();
 		RT_ASSERT_MSG(activeCamera, "Camera is not found. Add at least one camera to the scene.");
+		prepareAccelStructure();
 		Mat depth(activeCamera->getResolution(), CV_64FC1, Scalar(0)); 	// depth-image array
 
 #ifdef ENABLE_PDP
@@ -123,6 +373,87 @@ namespace rt {
 		return depth;
 	}
 
+	void CScene::intersect(const RayBatch& rays, std::vector<RayHit>& vHits) const
+	{
+		prepareAccelStructure();
+		const size_t nRays = rays.size();
+		vHits.resize(nRays);
+
+#ifdef ENABLE_PDP
+		parallel_for_(Range(0, static_cast<int>((nRays + batchChunkSize - 1) / batchChunkSize)), [&](const Range& range) {
+#else
+		const Range range(0, static_cast<int>((nRays + batchChunkSize - 1) / batchChunkSize));
+#endif
+		for (int c = range.start; c < range.end; c++) {
+			const size_t begin	= c * batchChunkSize;
+			const size_t end	= MIN(begin + batchChunkSize, nRays);
+#ifdef ENABLE_BSP
+			m_pAccelStructure->intersect(rays, begin, end, &vHits[begin]);
+#else
+			for (size_t i = begin; i < end; i++) {
+				Ray ray = rays.getRay(i);
+				for (auto& pPrim : m_vpPrims) pPrim->intersect(ray);
+				vHits[i] = { ray.hit ? ray.t : std::numeric_limits<double>::infinity(), ray.hit, ray.instHit, ray.b1, ray.b2 };
+			}
+#endif
+			if (m_vpUnboundedPrims.empty()) continue;
+			for (size_t i = begin; i < end; i++) {
+				Ray ray = rays.getRay(i);
+				if (vHits[i].hit) ray.t = vHits[i].t;
+				bool hit = false;
+				for (auto& pPrim : m_vpUnboundedPrims)
+					hit |= pPrim->intersect(ray);
+				if (hit) vHits[i] = { ray.t, ray.hit, ray.instHit, ray.b1, ray.b2 };
+			}
+		}
+#ifdef ENABLE_PDP
+		});
+#endif
+	}
+
+	void CScene::if_intersect(const RayBatch& rays, std::vector<byte>& vOccluded) const
+	{
+		prepareAccelStructure();
+		const size_t nRays = rays.size();
+		vOccluded.resize(nRays);
+
+#ifdef ENABLE_PDP
+		parallel_for_(Range(0, static_cast<int>((nRays + batchChunkSize - 1) / batchChunkSize)), [&](const Range& range) {
+#else
+		const Range range(0, static_cast<int>((nRays + batchChunkSize - 1) / batchChunkSize));
+#endif
+		for (int c = range.start; c < range.end; c++) {
+			const size_t begin	= c * batchChunkSize;
+			const size_t end	= MIN(begin + batchChunkSize, nRays);
+			if_intersect(rays, begin, end, &vOccluded[begin]);
+		}
+#ifdef ENABLE_PDP
+		});
+#endif
+	}
+
+	void CScene::if_intersect(const RayBatch& rays, size_t begin, size_t end, byte* pOccluded) const
+	{
+#ifdef ENABLE_BSP
+		m_pAccelStructure->if_intersect(rays, begin, end, pOccluded);
+#else
+		for (size_t i = begin; i < end; i++) {
+			const Ray ray = rays.getRay(i);
+			pOccluded[i - begin] = std::any_of(m_vpPrims.begin(), m_vpPrims.end(), [&ray](const ptr_prim_t& pPrim) { return pPrim->if_intersect(ray); }) ? 1 : 0;
+		}
+#endif
+		if (m_vpUnboundedPrims.empty()) return;
+		for (size_t i = begin; i < end; i++) {
+			if (pOccluded[i - begin]) continue;
+			const Ray ray = rays.getRay(i);
+			for (auto& pPrim : m_vpUnboundedPrims)
+				if (pPrim->if_intersect(ray)) {
+					pOccluded[i - begin] = 1;
+					break;
+				}
+		}
+	}
+
 	Mat CScene::getLastRenderedImage(void) const
 	{
 #ifdef ENABLE_CACHE
@@ -137,36 +468,296 @@ namespace rt {
 
 
 	// -------------------------------------- Service Methods --------------------------------------
-	bool CScene::intersect(Ray& ray) const
+	const ptr_prim_t* CScene::findOccluder(const Ray& ray) const
 	{
+		for (auto& pPrim : m_vpUnboundedPrims)
+			if (pPrim->if_intersect(ray)) return &pPrim;
 #ifdef ENABLE_BSP
-	    return m_pBSPTree->intersect(ray);
+		return m_pAccelStructure->findOccluder(ray);
 #else
-        bool hit = false;
 		for (auto& pPrim : m_vpPrims)
-			hit |= pPrim->intersect(ray);
-		
-		
+			if (pPrim->if_intersect(ray)) return &pPrim;
+		return nullptr;
+#endif
+	}
 
-		return hit;
+	bool CScene::addPrim(const ptr_prim_t pPrim)
+	{
+		if (pPrim->getBoundingBox().isInfinite()) {
+			m_vpUnboundedPrims.push_back(pPrim);
+			return true;
+		}
+		m_vpPrims.push_back(pPrim);
+#ifdef ENABLE_BSP
+		return m_accelDirty || m_pAccelStructure->insert(pPrim);
+#else
+		return true;
 #endif
 	}
 
-	bool CScene::if_intersect(const Ray& ray) const 
+	void CScene::prepareAccelStructure(void) const
+	{
+#ifdef ENABLE_BSP
+		if (m_accelDirty) {
+#ifdef DEBUG_PRINT_INFO
+			std::cout << "Re-building the acceleration structure" << std::endl;
+#endif
+			m_pAccelStructure->build(m_vpPrims, m_maxDepth, m_minPrimitives);
+			m_accelDirty = false;
+		}
+#endif
+	}
+
+	void CScene::buildLightStructures(void) const
+	{
+		if (m_nLightSamples)		m_lightBVH.build(m_vpLights);
+		else if (m_lightCulling)	m_lightGrid.build(m_vpLights);
+		m_lightArrays.build(m_vpLights);
+		m_vAllLights.clear();
+		for (const auto& pLight : m_vpLights)
+			m_vAllLights.emplace_back(pLight.get(), 1.0f);
+		m_lightsDirty.store(false, std::memory_order_release);
+	}
+
+	void CScene::prepareLightStructures(void) const
+	{
+		if (!m_lightsDirty.load(std::memory_order_acquire)) return;
+		std::lock_guard<std::mutex> lock(m_lightsMutex);
+		if (m_lightsDirty.load(std::memory_order_relaxed)) buildLightStructures();
+	}
+
+	Vec3f CScene::illuminate(const Ray& ray, Ray& I, const Vec3f& normal, const reflectance_function_t& reflectance) const
+	{
+		if (m_nLightSamples || m_lightCulling) return illuminate(ray, I, getLights(I.org, normal), reflectance);
+
+		// all the lights illuminate every point: the point light sources are evaluated at once from the light arrays
+		prepareLightStructures();
+		Vec3f res = illuminateLightArrays(I, reflectance);
+		res += illuminate(ray, I, m_lightArrays.getOtherLights(), reflectance);
+		return res;
+	}
+
+	Vec3f CScene::illuminate(const Ray& ray, Ray& I, std::span<const std::pair<ILight*, float>> vpLights, const reflectance_function_t& reflectance) const
+	{
+		Vec3f res = Vec3f::all(0);
+		for (auto& [pLight, weight] : vpLights) {
+			Vec3f L = Vec3f::all(0);
+			const size_t nSamples	= getNumLightSamples(*pLight, I.org);
+			const size_t stride		= getStride(nSamples);
+			size_t nLit = 0;
+			size_t s = 0;
+			while (s < nSamples) {
+				// get direction to light, and intensity
+				I.hit = ray.hit;
+				I.instHit = ray.instHit;
+				auto radiance = pLight->illuminate(I, CSampler::stratifiedSample(s * stride % nSamples, nSamples));
+				const float visibility = radiance ? getVisibility(I, *pLight) : 0.0f;
+				if (visibility > 0) {
+					L += visibility * reflectance(I.dir, radiance.value());
+					nLit++;
+				}
+				s++;
+				if (s == m_nTestLightSamples && (nLit == 0 || nLit == s)) break;		// the test samples agree
+			} // s
+			res += (weight / s) * L;
+		} // pLight
+		return res;
+	}
+
+	Vec3f CScene::illuminateLightArrays(Ray& I, const reflectance_function_t& reflectance) const
+	{
+		// per-thread scratch storage, re-used between the shaded points
+		thread_local LightArraySamples	samples;
+		thread_local RayBatch			shadowRays;
+		thread_local std::vector<size_t>	vShadowLights;
+		thread_local std::vector<byte>	vOccluded;
+
+		m_lightArrays.illuminate(I.org, samples);
+		shadowRays.clear();
+		vShadowLights.clear();
+
+		Vec3f res = Vec3f::all(0);
+		for (size_t i = 0; i < m_lightArrays.size(); i++) {
+			const Vec3f radiance(samples.radiance[0][i], samples.radiance[1][i], samples.radiance[2][i]);
+			if (radiance[0] == 0 && radiance[1] == 0 && radiance[2] == 0) continue;		// no light
+			const Vec3f dir(samples.dir[0][i], samples.dir[1][i], samples.dir[2][i]);
+			const ILight& light = m_lightArrays.getLight(i);
+
+			// the shadow rays, which are not resolved otherwise, are queued for the batch
+			if (light.shadow() && !m_occluderCache && !light.getShadowMapResolution()) {
+				shadowRays.push_back(I.org, dir, samples.distance[i]);
+				vShadowLights.push_back(i);
+				continue;
+			}
+			I.dir	= dir;
+			I.t		= samples.distance[i];
+			I.hit	= nullptr;
+			const float visibility = getVisibility(I, light);
+			if (visibility > 0) res += visibility * reflectance(dir, radiance);
+		}
+		if (!shadowRays.size()) return res;
+
+		// the shadow rays of one point are traced on the current thread: the render already runs in parallel
+		vOccluded.resize(shadowRays.size());
+		if_intersect(shadowRays, 0, shadowRays.size(), vOccluded.data());
+		for (size_t k = 0; k < vShadowLights.size(); k++) {
+			if (vOccluded[k]) continue;
+			const size_t i = vShadowLights[k];
+			const Vec3f dir(samples.dir[0][i], samples.dir[1][i], samples.dir[2][i]);
+			const Vec3f radiance(samples.radiance[0][i], samples.radiance[1][i], samples.radiance[2][i]);
+			res += reflectance(dir, radiance);
+		}
+		return res;
+	}
+
+	std::optional<Vec3f> CScene::illuminateReSTIR(const Ray& ray, Ray& I, const Vec3f& normal, const reflectance_function_t& reflectance) const
+	{
+		if (!m_reSTIR.isEnabled()) return std::nullopt;
+		return m_reSTIR.illuminate(*this, m_vpLights, ray, I, normal, reflectance);
+	}
+
+	Vec3f CScene::illuminateMIS(Ray& I, const Vec3f& normal, const IBRDF& brdf, const reflectance_function_t& reflectance) const
+	{
+		if (m_nLightSamples || m_lightCulling) return illuminateMIS(I, normal, brdf, getLights(I.org, normal), reflectance);
+
+		// the point light sources are sampled only from the light sources, which is what the light arrays evaluate at once
+		prepareLightStructures();
+		Vec3f res = illuminateLightArrays(I, reflectance);
+		res += illuminateMIS(I, normal, brdf, m_lightArrays.getOtherLights(), reflectance);
+		return res;
+	}
+
+	Vec3f CScene::illuminateMIS(Ray& I, const Vec3f& normal, const IBRDF& brdf, std::span<const std::pair<ILight*, float>> vpLights, const reflectance_function_t& reflectance) const
+	{
+		Vec3f res = Vec3f::all(0);
+		for (auto& [pLight, weight] : vpLights) {
+			Vec3f L = Vec3f::all(0);
+			const size_t nSamples = getNumLightSamples(*pLight, I.org);
+			for (size_t s = 0; s < nSamples; s++) {
+				// ------ light sampling ------
+				auto lightSample = pLight->sample(I.org, normal, CSampler::stratifiedSample(s, nSamples));
+				if (lightSample) {
+					I.dir	= lightSample->direction;
+					I.t		= lightSample->distance;
+					I.hit	= nullptr;
+					const float visibility = getVisibility(I, *pLight);
+					if (visibility > 0) {
+						float w = pLight->isDelta() ? 1.0f : powerHeuristic(lightSample->pdf, brdf.pdf(I.dir));
+						L += (visibility * w / lightSample->pdf) * reflectance(I.dir, lightSample->radiance);
+					}
+				}
+				if (pLight->isDelta()) continue;
+
+				// ------ BRDF sampling ------
+				auto dir = brdf.sample(CSampler::stratifiedSample(s, nSamples));
+				if (!dir) continue;
+				auto hit = pLight->evaluate(I.org, normal, dir.value());
+				if (!hit) continue;
+				I.dir	= dir.value();
+				I.t		= hit->distance;
+				I.hit	= nullptr;
+				const float visibility = getVisibility(I, *pLight);
+				if (visibility > 0) {
+					float pdf = brdf.pdf(I.dir);
+					if (pdf > 0) L += (visibility * powerHeuristic(pdf, hit->pdf) / pdf) * reflectance(I.dir, hit->radiance);
+				}
+			} // s
+			res += (weight / nSamples) * L;
+		} // pLight
+		return res;
+	}
+
+	std::span<const std::pair<ILight*, float>> CScene::getLights(const Vec3f& point, const Vec3f& normal) const
+	{
+		prepareLightStructures();
+		if (!m_nLightSamples && !m_lightCulling) return m_vAllLights;
+
+		// per-thread storage, re-used between the shaded points
+		thread_local std::vector<std::pair<ILight*, float>> res;
+		res.clear();
+		if (!m_nLightSamples) {
+			for (size_t i : m_lightGrid.getLights(point))
+				res.emplace_back(m_vpLights[i].get(), 1.0f);
+			return res;
+		}
+
+		for (size_t i : m_lightBVH.getUnboundedLights())
+			res.emplace_back(m_vpLights[i].get(), 1.0f);
+
+		// stratified picks: the k-th light is picked with the random number from [k / n; (k + 1) / n)
+		const float u = random::U<float>();
+		for (size_t k = 0; k < m_nLightSamples; k++) {
+			auto light = m_lightBVH.sample(point, normal, (k + u) / m_nLightSamples);
+			if (light) res.emplace_back(m_vpLights[light->first].get(), 1.0f / (m_nLightSamples * light->second));
+		}
+		return res;
+	}
+
+	bool CScene::intersect(Ray& ray) const
 	{
 #ifdef ENABLE_BSP
-		return m_pBSPTree->intersect(lvalue_cast(Ray(ray)));
+		bool hit = m_pAccelStructure->intersect(ray);
 #else
+        bool hit = false;
 		for (auto& pPrim : m_vpPrims)
-            if (pPrim->if_intersect(ray)) return true;
-		return false;
+			hit |= pPrim->intersect(ray);
 #endif
+		for (auto& pPrim : m_vpUnboundedPrims)
+			hit |= pPrim->intersect(ray);
+		return hit;
+	}
+
+	bool CScene::if_intersect(const Ray& ray) const 
+	{
+		return findOccluder(ray) != nullptr;
+	}
+
+	bool CScene::if_intersect(const Ray& ray, const ILight& light) const
+	{
+		if (!m_occluderCache) return if_intersect(ray);
+
+		// the cache of another scene or of the outdated primitives is discarded
+		OccluderCache& cache = occluderCache;
+		if (cache.pScene != this || cache.version != m_occluderCacheVersion) {
+			cache.pScene	= this;
+			cache.version	= m_occluderCacheVersion;
+			cache.occluders.clear();
+		}
+
+		OccluderCacheCounters& counters = m_vOccluderCacheCounters[threadSlot % std::size(m_vOccluderCacheCounters)];
+		counters.nTests.fetch_add(1, std::memory_order_relaxed);
+		std::shared_ptr<const CPrim>& pOccluder = cache.occluders[&light];
+		if (pOccluder && pOccluder->if_intersect(ray)) {
+			counters.nHits.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		// the any-hit query reports the scene primitive (not its part, e.g. an operand of a CSG primitive), which occludes the next rays as a whole
+		const ptr_prim_t* pHit = findOccluder(ray);
+		if (!pHit) return false;
+		pOccluder = *pHit;
+		return true;
+	}
+
+	float CScene::getVisibility(const Ray& ray, const ILight& light) const
+	{
+		if (!light.shadow()) return 1;
+		if (light.getShadowMapResolution()) {
+			auto visibility = light.getShadowMapVisibility(ray.org);
+			if (visibility) return visibility.value();
+		}
+		return if_intersect(ray, light) ? 0.0f : 1.0f;
 	}
 
 	Vec3f CScene::rayTrace(Ray& ray) const 
 	{ 
-		if (intersect(ray)) return ray.hit->getShader()->shade(ray);	// intersection -> return color of the hit object
-		return m_bgMap ? m_bgMap->getTexel(ray) : m_bgColor;			// No intersection -> return scene background
+		if (intersect(ray)) {																	// intersection -> return color of the hit object
+			ptr_shader_t pShader = ray.hit->getShader();
+			if (!pShader && ray.instHit) pShader = ray.instHit->getShader();					// instance without shader override
+			return pShader->shade(ray);
+		}
+		if (m_pBgLight) return m_pBgLight->getRadiance(ray.dir);								// No intersection -> return the environment
+		return m_bgMap ? m_bgMap->getTexel(ray) : m_bgColor;									// No intersection -> return scene background
 	}
 
 	double CScene::rayTraceDepth(Ray& ray) const 
@@ -5,14 +5,35 @@
 #include "Prim.h"
 #include "Texture.h"
 #include "ILight.h"
+#include "LightBVH.h"
+#include "LightGrid.h"
+#include "LightArrays.h"
+#include "ReSTIR.h"
+#include "BRDF.h"
 #include "ICamera.h"
 #include "Sampler.h"
+#include "IAccelStructure.h"
 #ifdef ENABLE_BSP
 #include "BSPTree.h"
 #endif
+#include <atomic>
+#include <mutex>
+#include <span>
 
 namespace rt {
 	class CSolid;
+	class CLightEnvironment;
+
+	// ================================ Occluder Cache Counters Structure ================================
+	/**
+	 * @brief The counters of the occluder cache of one rendering thread (see CScene::setOccluderCache())
+	 * @details Every counter slot occupies its own cache line, thus the threads, counting every shadow ray, do not contend for the same memory
+	 */
+	struct alignas(64) OccluderCacheCounters
+	{
+		std::atomic<size_t>	nTests	= 0;		///< Number of the shadow rays, tested with the occluder cache
+		std::atomic<size_t>	nHits	= 0;		///< Number of the shadow rays, occluded by the cached occluder
+	};
 	
 	// ================================ Scene Class ================================
 	/**
@@ -29,7 +50,7 @@ namespace rt {
 		DllExport CScene(const Vec3f& bgColor = RGB(0,0,0))
 			: m_bgColor(bgColor)
 #ifdef ENABLE_BSP	
-			, m_pBSPTree(new CBSPTree())
+			, m_pAccelStructure(std::make_shared<CBSPTree>())
 #endif
 		{}
 		/**
@@ -39,7 +60,7 @@ namespace rt {
 		DllExport CScene(const ptr_texture_t bgMap)
 			: m_bgMap(bgMap)
 #ifdef ENABLE_BSP	
-			, m_pBSPTree(new CBSPTree())
+			, m_pAccelStructure(std::make_shared<CBSPTree>())
 #endif
 		{}
 		DllExport CScene(const CScene&) = delete;
@@ -55,10 +76,15 @@ namespace rt {
 
 		/**
 		 * @brief Clears the scene from geometry, lights and cameras (if any)
+		 * @details The acceleration structure is reset as well
 		 */
 		DllExport void					clear(void);
 		/**
 		 * @brief Adds a new primitive to the scene
+		 * @details If the acceleration structure is already built, the primitive is inserted into it incrementally.
+		 * If the structure does not support that, it is marked to be re-built before the next render.
+		 * Unbounded primitives (\a e.g. @ref CPrimPlane) are kept outside of the acceleration structure and are tested with every ray directly,
+		 * so that the structure is built over the bounded geometry only.
 		 * @param pPrim Pointer to the primitive
 		 */
 		DllExport void					add(const ptr_prim_t pPrim);
@@ -67,11 +93,31 @@ namespace rt {
 		 * @param solid The reference to the solid
 		 */
 		DllExport void					add(const CSolid& solid);
+		/**
+		 * @brief Removes the primitive from the scene
+		 * @param pPrim Pointer to the primitive
+		 */
+		DllExport void					remove(const ptr_prim_t pPrim);
+		/**
+		 * @brief Removes the solid from the scene
+		 * @param solid The reference to the solid
+		 */
+		DllExport void					remove(const CSolid& solid);
 		/**
 		 * @brief Adds a new light to the scene
 		 * @param pLight Pointer to the light
 		 */
 		DllExport void					add(const ptr_light_t pLight);
+		/**
+		 * @brief Adds the background texture map to the scene as a light source
+		 * @details The background map is treated as the equirectangular environment (see @ref CLightEnvironment), which illuminates the scene and is sampled proportionally to its brightness.
+		 * The rays, which do not hit the geometry, look up the same environment by their direction, so that the background and the reflections are consistent with the lighting.
+		 * @note The scene must be constructed with the background map
+		 * @param intensity The scale of the emission
+		 * @param nSamples The number of samples of the environment
+		 * @param castShadow Flag indicatin whether the light source casts shadow
+		 */
+		DllExport void					addBackgroundLight(const Vec3f& intensity = Vec3f::all(1), size_t nSamples = 16, bool castShadow = true);
 		/**
 		 * @brief Adds a new camera to the scene and makes it to ba active
 		 * @param pCamera Pointer to the camera
@@ -83,15 +129,112 @@ namespace rt {
 		 */
 		DllExport void					setActiveCamera(size_t activeCamera);
 		/**
-		 * @brief (Re-) Build the BSP tree for the current geometry present in scene
-		 * @details This function takes into accound all the primitives in scene and builds the BSP tree with the root node in \b m_pBSPTree variable.
-		 * If the geometry in the scene was updated the BSP tree should be re-built
+		 * @brief (Re-) Build the acceleration structure for the current geometry present in scene
+		 * @details This function takes into accound all the primitives in scene and builds the acceleration structure (by default the BSP tree) in \b m_pAccelStructure variable.
+		 * If the geometry in the scene was updated the structure should be re-built or updated with updateAccelStructure()
 		 * @param maxDepth The maximum allowed depth of the tree.
 		 * Increasing the depth of the tree may speed-up rendering, but increse the memory consumption.
 		 * @param minPrimitives The minimum number of primitives in a leaf-node.
 		 * This parameters should be alway above 1.
 		 */
 		DllExport void					buildAccelStructure(size_t maxDepth = 20, size_t minPrimitives = 3);
+		/**
+		 * @brief Updates the acceleration structure after the geometry present in scene was transformed
+		 * @details This function refits the acceleration structure to the new positions of the primitives, if the structure supports it (@ref CBVHTree).
+		 * The structure is re-built with the parameters of the last buildAccelStructure() call, if it does not support refitting or if its quality 
+		 * has degraded by more than \b maxDegradation times since the last build.
+		 * The primitives, added to or removed from the scene after the structure was built, are inserted into it directly, or, if it is not possible
+		 * (\a e.g. the added primitive lies outside of the BSP tree bounds), the structure is re-built at once by add() or remove(). Thus this method is needed only after transformations
+		 * @param maxDegradation The maximal allowed ratio between the current and the freshly built SAH costs of the structure
+		 */
+		DllExport void					updateAccelStructure(float maxDegradation = 1.5f);
+		/**
+		 * @brief Re-builds the light arrays, and the light BVH and the light grid, if they are used, for the current state of the scene light sources
+		 * @details The light sources do not know the scenes they belong to, thus modifying a light source (\a e.g. CLightOmni::setOrigin(), CLightOmni::setIntensity() or CLightOmni::setRange())
+		 * does not invalidate these structures. render() re-builds them at its beginning, thus this method is needed only if the lights are queried directly after such modification,
+		 * \a e.g. with illuminate() or getLights(const Vec3f&, const Vec3f&) const. Adding lights and changing the light sampling or culling settings does not require this call
+		 * @note This method must not be called concurrently with rendering
+		 */
+		DllExport void					updateLightStructures(void);
+		/**
+		 * @brief Sets the acceleration structure used for the scene geometry
+		 * @details By default, the scene uses the @ref CBSPTree. The new structure is not built until buildAccelStructure() is called.
+		 * @param pAccelStructure Pointer to the acceleration structure
+		 */
+		DllExport void					setAccelStructure(const ptr_accelstructure_t pAccelStructure);
+		/**
+		 * @brief Sets the directory for caching the acceleration structures
+		 * @details If the path is set, buildAccelStructure() hashes the scene geometry together with the build parameters and looks for the cached structure
+		 * with this hash in the directory \b path. If the cached structure is found, it is loaded instead of being built; otherwise the newly built structure is saved there.
+		 * @note This method can only be used if ENABLE_CACHE is on. Only the structures which support serialization (@ref CBVHTree) are cached.
+		 * @param path The path to the cache directory. An empty string disables caching
+		 */
+		DllExport void					setAccelStructureCachePath(const std::string& path);
+		/**
+		 * @brief Enables the importance sampling of the light sources
+		 * @details By default, every shaded point is illuminated by all the light sources in scene, which costs at least one shadow ray per light.
+		 * If the light sampling is enabled, only \b nLights light sources are picked at every shaded point with the light BVH (@ref CLightBVH), proportionally to their
+		 * estimated contribution to the point, and their illumination is weighted with the reciprocal of the pick probability. This keeps the rendering time nearly independent
+		 * of the number of lights at the price of noise, which is averaged out by the anti-aliasing samples. The unbounded lights (\a e.g. @ref CLightSky) are not sampled and always illuminate the points.
+		 * @param nLights The number of lights picked per shaded point. 0 disables the light sampling
+		 */
+		DllExport void					setLightSampling(size_t nLights);
+		/**
+		 * @brief Enables the culling of the light sources
+		 * @details If the light culling is enabled, every shaded point is illuminated only by the light sources, which influence volumes contain the point (see ILight::influences()).
+		 * The light sources are found with the uniform grid (@ref CLightGrid), thus the scenes with many local lights (\a e.g. @ref CLightOmni with limited range) are rendered
+		 * without paying for every light at every point. In contrast to the light sampling, the culling does not change the rendered image.
+		 * @note The light culling is only used if the light sampling is disabled (see setLightSampling())
+		 * @param enable Flag indicating whether the light culling is enabled
+		 */
+		DllExport void					setLightCulling(bool enable);
+		/**
+		 * @brief Enables the reservoir-based spatiotemporal importance resampling (ReSTIR) of the direct illumination
+		 * @details If ReSTIR is enabled, the shaders estimate the direct illumination with only one shadow ray per shaded point: the light sample is resampled out of \b nCandidates
+		 * cheap candidates and out of the samples of the neighbouring pixels and of the previous pass (see @ref CReSTIR). The image is rendered in \b nPasses progressive passes,
+		 * which are averaged, and every pass reuses the samples of the previous one. The number of samples of the light sources (ILight::getNumSamples()) is ignored in this mode.
+		 * @note ReSTIR replaces the light sampling and the light culling (see setLightSampling() and setLightCulling())
+		 * @param nCandidates The number of the candidate samples per shaded point. 0 disables ReSTIR
+		 * @param nPasses The number of the progressive passes per render
+		 * @param nNeighbours The number of the neighbouring pixels, which samples are reused per pixel
+		 * @param radius The radius of the neighbourhood in pixels
+		 */
+		DllExport void					setReSTIR(size_t nCandidates, size_t nPasses = 4, size_t nNeighbours = 3, int radius = 8);
+		/**
+		 * @brief Enables the adaptive number of samples of the light sources
+		 * @details By default, every light source is sampled ILight::getNumSamples() times at every shaded point. If the adaptive sampling is enabled, the number of samples is chosen per point:
+		 * ILight::estimateNumSamples() reduces it for the light sources, which subtend a small solid angle (\a e.g. the distant area lights), and the sampling stops after the first \b nTestSamples samples,
+		 * if all of them agree: all lit or all unlit (occluded or facing away). Thus the fully lit and the fully shadowed regions cost only \b nTestSamples shadow rays per light and
+		 * only the penumbrae are sampled with all the samples. The test samples are spread over the light source, but the penumbrae, narrower than the strata of the test samples, may be missed.
+		 * @note The adaptive sampling is used by illuminate() and illuminateMIS() (the latter uses only the solid angle criterion)
+		 * @param nTestSamples The number of the samples, which visibility is tested before stopping. 0 disables the adaptive sampling
+		 */
+		DllExport void					setAdaptiveLightSampling(size_t nTestSamples);
+		/**
+		 * @brief Enables the cache of the shadow occluders
+		 * @details The neighbouring shaded points usually see the same occluder towards a light source. If the cache is enabled, every rendering thread remembers
+		 * the last scene primitive, which occluded a shadow ray towards every light source, and if_intersect(const Ray&, const ILight&) const tests it first,
+		 * before traversing the acceleration structure. The cache does not change the rendered image. Its efficiency is measured with getNumOccluderTests() and getNumOccluderCacheHits()
+		 * @param enable Flag indicating whether the occluder cache is enabled
+		 */
+		DllExport void					setOccluderCache(bool enable);
+		/**
+		 * @brief Returns the number of the shadow rays, tested with the occluder cache since the last call of resetOccluderCacheCounters()
+		 * @details Every thread counts the tests in its own slot of the counters (see OccluderCacheCounters), which are summed up here
+		 * @return The number of tests
+		 */
+		DllExport size_t				getNumOccluderTests(void) const;
+		/**
+		 * @brief Returns the number of the shadow rays, found occluded by the cached occluder since the last call of resetOccluderCacheCounters()
+		 * @details Every cache hit saves one traversal of the acceleration structure
+		 * @return The number of cache hits
+		 */
+		DllExport size_t				getNumOccluderCacheHits(void) const;
+		/**
+		 * @brief Resets the counters of the occluder cache
+		 * @note This method is not to be called during rendering
+		 */
+		DllExport void					resetOccluderCacheCounters(void);
 		/**
 		 * @brief Renders the view from the active camera
 		 * @param pSampler Pointer to the sampler to be used for anti-aliasing.
@@ -110,6 +253,21 @@ namespace rt {
 		 * @return The last cached render.
 		 */
 		DllExport Mat					getLastRenderedImage(void) const;
+		/**
+		 * @brief Finds the closest intersections of a batch of rays with the geometry present in scene
+		 * @details The batch is split into chunks, which are processed in parallel (if ENABLE_PDP is on). Within a chunk, the acceleration structure traverses the rays in packets (@ref CBVHTree),
+		 * which removes most of the per-ray overhead of intersect(Ray&) const. This method is intended for the visibility queries outside of the shaders, \a e.g. for lidar or sensor simulation.
+		 * @param rays The batch of rays in the SoA layout
+		 * @param[out] vHits The hit records, one per ray. For the rays, which hit nothing, RayHit::hit is \b nullptr and RayHit::t is infinity
+		 */
+		DllExport void					intersect(const RayBatch& rays, std::vector<RayHit>& vHits) const;
+		/**
+		 * @brief Checks whether the rays of a batch intersect the geometry present in scene
+		 * @details This is the batch version of if_intersect(const Ray&) const, see intersect(const RayBatch&, std::vector<RayHit>&) const for details
+		 * @param rays The batch of rays in the SoA layout
+		 * @param[out] vOccluded The occlusion mask: 1 for the rays intersecting any object within their RayBatch::tMax, 0 otherwise
+		 */
+		DllExport void					if_intersect(const RayBatch& rays, std::vector<byte>& vOccluded) const;
 
 	public:
 		/**
@@ -117,7 +275,64 @@ namespace rt {
 		 * @note This method is to be used only in OpenRT shaders
 		 * @return The vector with pointers to the scene light sources
 		 */
-		const std::vector<ptr_light_t>	getLights(void) const { return m_vpLights; }
+		const std::vector<ptr_light_t>&	getLights(void) const { return m_vpLights; }
+		/**
+		 * @brief Returns the light sources, illuminating the point, together with the weights of their illumination
+		 * @details If the light sampling is disabled (default), all the scene light sources (or only the ones, influencing the point, if the light culling is enabled) are returned with the weight 1. Otherwise the unbounded lights are returned with the weight 1,
+		 * followed by the sampled lights with the weights, such that the weighted sum of their illumination is an unbiased estimate of the illumination by all the lights (see setLightSampling())
+		 * @note This method is to be used only in OpenRT shaders. No memory is allocated per point: the returned span refers to the list of all the lights, kept by the scene,
+		 * or to the per-thread storage, which is valid until the next call of this method from the same thread
+		 * @param point The point to be illuminated
+		 * @param normal The shading normal at the point
+		 * @return The span of pairs: the pointer to the light source and the weight of its illumination
+		 */
+		std::span<const std::pair<ILight*, float>>	getLights(const Vec3f& point, const Vec3f& normal) const;
+		/**
+		 * @brief Returns the number of samples of the light source at the point
+		 * @details If the adaptive light sampling is enabled, the number is estimated for the point (see setAdaptiveLightSampling())
+		 * @note This method is to be used only in OpenRT shaders
+		 * @param light The light source
+		 * @param point The point to be illuminated
+		 * @return The number of samples
+		 */
+		size_t							getNumLightSamples(const ILight& light, const Vec3f& point) const { return m_nTestLightSamples ? light.estimateNumSamples(point) : light.getNumSamples(); }
+		/**
+		 * @brief Estimates the direct illumination of a point
+		 * @details Every light source, returned by getLights(const Vec3f&, const Vec3f&) const, is sampled getNumLightSamples() times, unless the adaptive light sampling stops earlier (see setAdaptiveLightSampling()).
+		 * If neither the light sampling nor the light culling is enabled, the point light sources are evaluated at once from the type-grouped light arrays (see @ref CLightArrays) and their shadow rays are traced as one batch
+		 * @note This method is to be used only in OpenRT shaders
+		 * @param ray The ray, hitting the shaded point
+		 * @param I The shadow ray with the origin at the shaded point
+		 * @param normal The shading normal at the point
+		 * @param reflectance The reflectance function of the point: the reflected light for the given direction to the light source and the light intensity
+		 * @return The reflected light
+		 */
+		Vec3f							illuminate(const Ray& ray, Ray& I, const Vec3f& normal, const reflectance_function_t& reflectance) const;
+		/**
+		 * @brief Estimates the direct illumination of a point with ReSTIR
+		 * @details This method traces at most one shadow ray (see setReSTIR())
+		 * @note This method is to be used only in OpenRT shaders
+		 * @param ray The ray, hitting the shaded point
+		 * @param I The shadow ray with the origin at the shaded point
+		 * @param normal The shading normal at the point
+		 * @param reflectance The reflectance function of the point: the reflected light for the given direction to the light source and the light intensity
+		 * @return The reflected light, or std::nullopt if ReSTIR is disabled
+		 */
+		std::optional<Vec3f>			illuminateReSTIR(const Ray& ray, Ray& I, const Vec3f& normal, const reflectance_function_t& reflectance) const;
+		/**
+		 * @brief Estimates the direct illumination of a point with multiple importance sampling (MIS)
+		 * @details Every light source, returned by getLights(const Vec3f&, const Vec3f&) const, is sampled getNumLightSamples() times from the light source
+		 * and the same number of times from the BRDF \b brdf. The samples are weighted with the power heuristic, thus the estimate has low noise for both the
+		 * small light sources, which are hard to hit with the BRDF samples, and the large light sources, seen in the narrow glossy lobes, which are hard to hit with the light samples.
+		 * The point light sources are sampled only from the light sources: if neither the light sampling nor the light culling is enabled, they are evaluated at once from the light arrays, like in illuminate().
+		 * @note This method is to be used only in OpenRT shaders
+		 * @param I The shadow ray with the origin at the shaded point
+		 * @param normal The shading normal at the point
+		 * @param brdf The sampling distribution of the BRDF at the point
+		 * @param reflectance The reflectance function of the point: the reflected light for the given direction to the light source and the light intensity
+		 * @return The reflected light
+		 */
+		Vec3f							illuminateMIS(Ray& I, const Vec3f& normal, const IBRDF& brdf, const reflectance_function_t& reflectance) const;
 		/**
 		 * @brief Returns the ambient
 		 */
@@ -126,7 +341,8 @@ namespace rt {
 		 * @brief Checks intersection between ray \b ray and the geometry present in scene
 		 * @details This function calls \b CPrim::intersect() method for all scene's primitives. If valid intersecton(s) is(are) found, the argument \b ray is updated:
 		 * Ray::t will be set to the distance to the closest intersection point and Ray::hit will point to the closest primitive intersected by the ray.
-		 * @note This method is to be used only in OpenRT shaders
+		 * @note This method is to be used only in OpenRT shaders. It does not re-build the acceleration structure: once built, the structure is kept up to date by add() and remove(),
+		 * while the transformed primitives require updateAccelStructure()
 		 * @param[in,out] ray The ray (Ref. @ref Ray for details)
 		 * @retval true If ray \b ray intersects any object
 		 * @retval false otherwise
@@ -136,12 +352,32 @@ namespace rt {
 		 * @brief Checks intersection between ray \b ray and the geometry present in scene
 		 * @details In contrast to the intersect() method, this method does not modify argument \b ray and returns once the first intersection found. Thus this method
 		 * is faster then intersect() and may be used to check occlusions.
-		 * @note This method is to be used only in OpenRT shaders
+		 * @note This method is to be used only in OpenRT shaders. Like intersect(), it does not re-build the acceleration structure
 		 * @param ray The ray (Ref. @ref Ray for details)
 		 * @retval true If point \b ray.org is occluded
 		 * @retval false otherwise
 		 */
 		bool							if_intersect(const Ray& ray) const;
+		/**
+		 * @brief Checks whether the shadow ray towards the light source is occluded
+		 * @details If the occluder cache is enabled, the last occluder of the shadow rays of the current thread towards the light source is tested first (see setOccluderCache())
+		 * @note This method is to be used only in OpenRT shaders
+		 * @param ray The shadow ray
+		 * @param light The light source, which the shadow ray is casted to
+		 * @retval true If \b ray intersects any object within its maximum distance \b ray.t
+		 * @retval false otherwise
+		 */
+		bool							if_intersect(const Ray& ray, const ILight& light) const;
+		/**
+		 * @brief Returns the visibility of the light source along the shadow ray
+		 * @details If the light source is in the shadow map fast mode (see ILight::turnShadowMapOn()), the visibility of the point \b ray.org is looked up in its shadow map.
+		 * Otherwise the shadow ray is traced with if_intersect(const Ray&, const ILight&) const
+		 * @note This method is to be used only in OpenRT shaders
+		 * @param ray The shadow ray
+		 * @param light The light source, which the shadow ray is casted to
+		 * @return The visibility in [0; 1]: 1 if the light source does not cast shadows or is not occluded, 0 if it is occluded
+		 */
+		float							getVisibility(const Ray& ray, const ILight& light) const;
 		/**
 		 * @brief Traces the given ray and shades it
 		 * @note This method is to be used only in OpenRT shaders
@@ -159,6 +395,74 @@ namespace rt {
 
 	
 	private:
+		/**
+		 * @brief Adds the primitive to the scene and inserts it into the acceleration structure, if the structure is built
+		 * @param pPrim Pointer to the primitive
+		 * @retval true If the acceleration structure does not need to be re-built
+		 * @retval false If the primitive could not be inserted into the built structure
+		 */
+		bool							addPrim(const ptr_prim_t pPrim);
+		/**
+		 * @brief Builds the acceleration structure, if it has not been built yet (\a e.g. after setAccelStructure())
+		 * @details This method is called at the beginning of rendering and at the batch intersection queries. The single-ray queries intersect() and if_intersect() do not check the structure,
+		 * since they are issued concurrently from all the render threads. Once built, the structure is kept up to date by add() and remove()
+		 */
+		void							prepareAccelStructure(void) const;
+		/**
+		 * @brief Re-builds the light arrays, and the light BVH and the light grid, if they are used
+		 * @details This method is called at the beginning of rendering, since the light sources may be moved between the renders, and by updateLightStructures()
+		 */
+		void							buildLightStructures(void) const;
+		/**
+		 * @brief Builds the light arrays, and the light BVH and the light grid, if they are used, unless they are up to date
+		 * @details This method is called at the light queries, which are issued concurrently from all the render threads: only the first thread re-builds the structures
+		 * after new lights have been added or the light settings have been changed, while the other threads wait for it
+		 */
+		void							prepareLightStructures(void) const;
+		/**
+		 * @brief Estimates the direct illumination of a point by the given light sources
+		 * @param ray The ray, hitting the shaded point
+		 * @param I The shadow ray with the origin at the shaded point
+		 * @param vpLights The light sources together with the weights of their illumination
+		 * @param reflectance The reflectance function of the point
+		 * @return The reflected light
+		 */
+		Vec3f							illuminate(const Ray& ray, Ray& I, std::span<const std::pair<ILight*, float>> vpLights, const reflectance_function_t& reflectance) const;
+		/**
+		 * @brief Estimates the direct illumination of a point by the given light sources with multiple importance sampling (MIS)
+		 * @param I The shadow ray with the origin at the shaded point
+		 * @param normal The shading normal at the point
+		 * @param brdf The sampling distribution of the BRDF at the point
+		 * @param vpLights The light sources together with the weights of their illumination
+		 * @param reflectance The reflectance function of the point
+		 * @return The reflected light
+		 */
+		Vec3f							illuminateMIS(Ray& I, const Vec3f& normal, const IBRDF& brdf, std::span<const std::pair<ILight*, float>> vpLights, const reflectance_function_t& reflectance) const;
+		/**
+		 * @brief Estimates the direct illumination of a point by the light sources of the light arrays
+		 * @details The light sources are evaluated in the SoA loops of CLightArrays::illuminate() and the shadow rays, which are not resolved by the shadow maps or the occluder cache, are traced as one batch
+		 * @param I The shadow ray with the origin at the shaded point
+		 * @param reflectance The reflectance function of the point
+		 * @return The reflected light
+		 */
+		Vec3f							illuminateLightArrays(Ray& I, const reflectance_function_t& reflectance) const;
+		/**
+		 * @brief Finds a primitive of the scene, intersected by the ray \b ray
+		 * @details This is the any-hit query of if_intersect(const Ray&) const, which also reports the intersected scene primitive (see IAccelStructure::findOccluder())
+		 * @param ray The ray
+		 * @return Pointer to the stored pointer to the intersected primitive, or \b nullptr if ray \b ray intersects no primitive
+		 */
+		const ptr_prim_t*				findOccluder(const Ray& ray) const;
+		/**
+		 * @brief Checks whether the rays of a range of the batch intersect the geometry present in scene
+		 * @details In contrast to if_intersect(const RayBatch&, std::vector<byte>&) const, the rays are traced on the calling thread and the acceleration structure is not checked,
+		 * thus this method may be called from the shaders
+		 * @param rays The batch of rays in the SoA layout
+		 * @param begin The index of the first ray of the range
+		 * @param end The index after the last ray of the range
+		 * @param[out] pOccluded The occlusion mask of the range: \b pOccluded[i - begin] is 1 if the i-th ray intersects any object within its RayBatch::tMax, 0 otherwise
+		 */
+		void							if_intersect(const RayBatch& rays, size_t begin, size_t end, byte* pOccluded) const;
 		/**
 		 * @brief Returns the active camera
 		 * @retval ptr_camera_t The pointer to active camera 
@@ -171,12 +475,33 @@ namespace rt {
 		const Vec3f					m_bgColor		= Vec3f::all(0);		///< background color
 		const Vec3f					m_ambientColor	= Vec3f::all(1);		///< ambient color
 		const ptr_texture_t			m_bgMap			= nullptr;				///< background texture map
-		std::vector<ptr_prim_t>		m_vpPrims;								///< Primitives
+		std::shared_ptr<CLightEnvironment>	m_pBgLight	= nullptr;			///< The light source, emitted by the background texture map
+		std::vector<ptr_prim_t>		m_vpPrims;								///< Bounded primitives, stored in the acceleration structure
+		std::vector<ptr_prim_t>		m_vpUnboundedPrims;						///< Unbounded primitives, tested with every ray directly
 		std::vector<ptr_light_t>	m_vpLights;								///< Lights
 		std::vector<ptr_camera_t>	m_vpCameras;							///< Cameras
 		size_t						m_activeCamera	= 0;					///< The index of the active camera
+		size_t						m_nLightSamples	= 0;					///< The number of lights picked per shaded point (0 for all the lights)
+		bool						m_lightCulling	= false;				///< Flag indicating whether the light culling is enabled
+		size_t						m_nTestLightSamples	= 0;				///< The number of the light samples, tested before the adaptive stopping (0 if the adaptive light sampling is disabled)
+		bool						m_occluderCache	= false;				///< Flag indicating whether the occluder cache is enabled
+		size_t						m_occluderCacheVersion	= 0;			///< The version of the cached occluders, changed when the cached primitives may become invalid
+		mutable OccluderCacheCounters	m_vOccluderCacheCounters[64];		///< The counters of the occluder cache, one slot per thread (the threads beyond 64 share the slots)
+		mutable CLightBVH			m_lightBVH;								///< The light BVH for the light sampling
+		mutable CLightGrid			m_lightGrid;							///< The light grid for the light culling
+		mutable CLightArrays		m_lightArrays;							///< The type-grouped light arrays for the evaluation of all the lights
+		mutable std::vector<std::pair<ILight*, float>>	m_vAllLights;		///< All the light sources with the weight 1, returned by getLights(const Vec3f&, const Vec3f&) const
+		mutable std::atomic<bool>	m_lightsDirty	= true;					///< Flag indicating that the light arrays, the light BVH and the light grid need to be re-built
+		mutable std::mutex			m_lightsMutex;							///< The mutex, guarding the re-build of the light structures at the concurrent light queries
+		mutable CReSTIR				m_reSTIR;								///< The reservoirs for ReSTIR
 #ifdef ENABLE_BSP
-		std::unique_ptr<CBSPTree>	m_pBSPTree		= nullptr;				///< Pointer to the acceleration structure
+		ptr_accelstructure_t		m_pAccelStructure	= nullptr;			///< Pointer to the acceleration structure
+		size_t						m_maxDepth			= 20;			///< The maximum allowed depth of the acceleration structure
+		size_t						m_minPrimitives		= 3;			///< The minimum number of primitives in a leaf-node of the acceleration structure
+		mutable bool				m_accelDirty		= true;			///< Flag indicating that the acceleration structure has not been built yet
+#ifdef ENABLE_CACHE
+		std::string					m_accelCachePath;						///< The path to the directory for caching the acceleration structures
+#endif
 #endif
 #ifdef ENABLE_CACHE
 		const std::string			m_lriFileName	= "last_render.png";	///< Last rendered image filename
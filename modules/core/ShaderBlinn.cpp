@@ -34,31 +34,29 @@ namespace rt {
 		if (m_kd > 0 || m_ke > 0) {
 			Ray I(ray.hitPoint(shadingNormal));
 
-			for (auto& pLight : m_scene.getLights()) {
+			// light, reflected towards the viewer, for the light coming from the direction dir
+			auto reflectance = [&](const Vec3f& dir, const Vec3f& radiance) {
 				Vec3f L = Vec3f::all(0);
-				const size_t nSamples = pLight->getNumSamples();
-				for (size_t s = 0; s < nSamples; s++) {
-					// get direction to light, and intensity
-					I.hit = ray.hit;	// TODO: double check
-					auto radiance = pLight->illuminate(I);
-					if (radiance && (!pLight->shadow() || !m_scene.if_intersect(I))) {
-						// ------ diffuse ------
-						if (m_kd > 0) {
-							float cosLightNormal = I.dir.dot(shadingNormal);
-							if (cosLightNormal > 0)
-								L += m_kd * opacity * cosLightNormal * diffuseColor.mul(radiance.value());
-						}
-						// ------ specular ------
-						if (ks > 0) {
-							Vec3f H = normalize(I.dir - ray.dir);
-							float cosHalfwayNormal = H.dot(shadingNormal);
-							if (cosHalfwayNormal > 0)
-								L += ks * powf(cosHalfwayNormal, m_ke) * radiance.value();
-						}
-					}
-				} // s
-				res += (1.0f / nSamples) * L;
-			} // pLight
+				// ------ diffuse ------
+				if (m_kd > 0) {
+					float cosLightNormal = dir.dot(shadingNormal);
+					if (cosLightNormal > 0)
+						L += m_kd * opacity * cosLightNormal * diffuseColor.mul(radiance);
+				}
+				// ------ specular ------
+				if (ks > 0) {
+					Vec3f H = normalize(dir - ray.dir);
+					float cosHalfwayNormal = H.dot(shadingNormal);
+					if (cosHalfwayNormal > 0)
+						L += ks * powf(cosHalfwayNormal, m_ke) * radiance;
+				}
+				return L;
+			};
+
+			// one shadow ray per point, if ReSTIR is enabled
+			auto direct = m_scene.illuminateReSTIR(ray, I, shadingNormal, reflectance);
+			if (direct) res += direct.value();
+			else res += m_scene.illuminate(ray, I, shadingNormal, reflectance);
 		}
 		
 		return res;
@@ -15,7 +15,7 @@ namespace rt {
 
 			Vec3f n = normal;
 			if (m_pSampler) {
-				n = CSampler::transformSampleToWCS(CSampler::uniformSampleHemisphere(m_pSampler->getNextSample(), 25), n);
+				n = CSampler::transformSampleToWCS(CSampler::uniformSampleHemisphere(m_pSampler->getNextSample(), glossiness), n);
 			}
 
 			Ray reflected = ray.reflected(n);
@@ -27,6 +27,13 @@ namespace rt {
 		}
 		if (k != 0)
 			res = (1.0f / k) * res;
+
+		// the light sources are not seen by the reflected rays: they are sampled explicitly within the glossy lobe, which reflects the light proportionally to its density
+		if (m_lightReflection && m_pSampler) {
+			Ray I(ray.hitPoint(normal));
+			CBRDFGlossy brdf(normal, ray.dir, glossiness);
+			res += m_scene.illuminateMIS(I, normal, brdf, [&brdf](const Vec3f& dir, const Vec3f& radiance) { return brdf.pdf(dir) * radiance; });
+		}
 		
 		const float q = 0.8f;
 		res = q * res + (1 - q) * getDiffuseColor(ray);
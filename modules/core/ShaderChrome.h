@@ -29,11 +29,20 @@ namespace rt {
 		DllExport virtual ~CShaderChrome(void) = default;
 		
 		DllExport virtual Vec3f shade(const Ray& ray) const override;
-		
+		/**
+		 * @brief Enables or disables the glossy reflection of the light sources
+		 * @details The reflected rays, perturbed with the sampler, do not see the point light sources. If enabled, the light sources are sampled explicitly within the glossy lobe
+		 * of the perturbed reflection (see CScene::illuminateMIS()), which adds highlights of the point light sources to the reflection. This has effect only if the sampler is set
+		 * @param enable The flag, indicating whether the glossy reflection of the light sources is enabled (disabled by default)
+		 */
+		DllExport void	setLightReflection(bool enable) { m_lightReflection = enable; }
 		
 	private:
 		const CScene& 	m_scene;		///< Reference to the scene object
 		ptr_sampler_t	m_pSampler;		///< Pointer to the sampler to be used for perturbing the shape normal during shading
+		bool			m_lightReflection = false;	///< Flag indicating whether the light sources are reflected within the glossy lobe
+
+		static constexpr float glossiness = 25;	///< The exponent of the normal perturbation, which is also the exponent of the glossy lobe of the light reflection
 	};
 }
 
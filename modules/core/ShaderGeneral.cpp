@@ -27,7 +27,7 @@ namespace rt {
 			// Distort the normal vector
 			Vec3f n = shadingNormal;
 			if (m_pSampler) {
-				n = CSampler::transformSampleToWCS(CSampler::uniformSampleHemisphere(m_pSampler->getNextSample(), 10), n);
+				n = CSampler::transformSampleToWCS(CSampler::uniformSampleHemisphere(m_pSampler->getNextSample(), glossiness), n);
 			}
 
 			// Needed by ks, km, kt
@@ -47,30 +47,32 @@ namespace rt {
 			if (m_kd > 0 || m_ke > 0) {
 				Ray I(ray.hitPoint(shadingNormal));
 
-				for (auto& pLight : m_scene.getLights()) {
+				// light, reflected towards the viewer, for the light coming from the direction dir
+				auto reflectance = [&](const Vec3f& dir, const Vec3f& radiance) {
 					Vec3f L = Vec3f::all(0);
-					const size_t nSamples = pLight->getNumSamples();
-					for (size_t s = 0; s < nSamples; s++) {
-						// get direction to light, and intensity
-						I.hit = ray.hit;	// TODO: double check
-						auto radiance = pLight->illuminate(I);
-						if (radiance && (!pLight->shadow() || !m_scene.if_intersect(I))) {
-							// ------ diffuse ------
-							if (m_kd > 0) {
-								float cosLightNormal = I.dir.dot(n);
-								if (cosLightNormal > 0)
-									L += m_kd * opacity * cosLightNormal * diffuseColor.mul(radiance.value());
-							}
-							// ------ specular ------
-							if (ks > 0) {
-								float cosLightReflect = I.dir.dot(reflected.dir);
-								if (cosLightReflect > 0)
-									L += ks * powf(cosLightReflect, m_ke) * radiance.value();
-							}
-						}
-					} // s
-					res += (1.0f / nSamples) * L;
-				} // pLight
+					// ------ diffuse ------
+					if (m_kd > 0) {
+						float cosLightNormal = dir.dot(n);
+						if (cosLightNormal > 0)
+							L += m_kd * opacity * cosLightNormal * diffuseColor.mul(radiance);
+					}
+					// ------ specular ------
+					if (ks > 0) {
+						float cosLightReflect = dir.dot(reflected.dir);
+						if (cosLightReflect > 0)
+							L += ks * powf(cosLightReflect, m_ke) * radiance;
+					}
+					return L;
+				};
+
+				// one shadow ray per point, if ReSTIR is enabled
+				auto direct = m_scene.illuminateReSTIR(ray, I, n, reflectance);
+				if (direct) res += direct.value();
+				else {
+					// light and BRDF sampling, combined with MIS
+					const float kd = m_kd * opacity * (diffuseColor[0] + diffuseColor[1] + diffuseColor[2]) / 3;
+					res += m_scene.illuminateMIS(I, n, CBRDFPhong(n, reflected.dir, kd, ks, m_ke), reflectance);
+				}
 			}
 
 			// ------ reflection ------
@@ -90,6 +92,13 @@ namespace rt {
 		} // ns
 		
 		res = (1.0f / nNormalSamples) * res;
+
+		// ------ glossy reflection of the light sources ------
+		if (m_lightReflection && m_pSampler && m_km > 0) {
+			Ray I(ray.hitPoint(shadingNormal));
+			CBRDFGlossy brdf(shadingNormal, ray.dir, glossiness);
+			res += m_km * m_scene.illuminateMIS(I, shadingNormal, brdf, [&brdf](const Vec3f& dir, const Vec3f& radiance) { return brdf.pdf(dir) * radiance; });
+		}
 		return res;
 	}
 }
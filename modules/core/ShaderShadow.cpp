@@ -15,20 +15,20 @@ namespace rt {
 		Ray I(ray.hitPoint(shadingNormal));				// shadow ray
 		Vec3f L_possible = Vec3f::all(0);
 		Vec3f L_actual = Vec3f::all(0);
-		for (auto& pLight : m_scene.getLights()) {
-			const size_t nSamples = pLight->getNumSamples();
-			const float avg = 1.0f / nSamples;
+		for (auto& [pLight, weight] : m_scene.getLights(I.org, shadingNormal)) {
+			const size_t nSamples = m_scene.getNumLightSamples(*pLight, I.org);
+			const float avg = weight / nSamples;
 			for (size_t s = 0; s < nSamples; s++) {
 				// get direction to light, and intensity
 				I.hit = ray.hit;	// TODO: double check
-				auto radiance = pLight->illuminate(I);
+				I.instHit = ray.instHit;
+				auto radiance = pLight->illuminate(I, CSampler::stratifiedSample(s, nSamples));
 				if (radiance) {
 					float cosLightNormal = I.dir.dot(shadingNormal);
 					if (cosLightNormal > 0) {
 						Vec3f L = avg * cosLightNormal * radiance.value();
 						L_possible += L;
-						if (!pLight->shadow() || !m_scene.if_intersect(I))
-							L_actual += L;
+						L_actual += m_scene.getVisibility(I, *pLight) * L;
 					}
 				}
 			} // s
@@ -0,0 +1,109 @@
+#include "ShadowMap.h"
+#include "Scene.h"
+#include "Ray.h"
+#include "macroses.h"
+
+namespace rt {
+	namespace {
+		const int	pcfRadius	= 1;		// The radius of the percentage-closer filter in texels
+		const float	depthBias	= 3;		// The depth bias in the sizes of the texel footprint, which compensates the sloped surfaces within the filter
+	}
+
+	CShadowMap::CShadowMap(const Vec3f& org, size_t resolution)
+		: m_org(org)
+		, m_tanHalfAngle(1)
+		, m_resolution(resolution)
+	{
+		RT_ASSERT(resolution > 0);
+		m_vFaces = {
+			{ Vec3f(0, 0, -1), Vec3f(0, 1, 0), Vec3f( 1, 0, 0) },
+			{ Vec3f(0, 0,  1), Vec3f(0, 1, 0), Vec3f(-1, 0, 0) },
+			{ Vec3f(1, 0,  0), Vec3f(0, 0,-1), Vec3f(0,  1, 0) },
+			{ Vec3f(1, 0,  0), Vec3f(0, 0, 1), Vec3f(0, -1, 0) },
+			{ Vec3f(1, 0,  0), Vec3f(0, 1, 0), Vec3f(0, 0,  1) },
+			{ Vec3f(-1, 0, 0), Vec3f(0, 1, 0), Vec3f(0, 0, -1) }
+		};
+	}
+
+	CShadowMap::CShadowMap(const Vec3f& org, const Vec3f& dir, float angle, size_t resolution)
+		: m_org(org)
+		, m_tanHalfAngle(tanf(angle * Pif / 180))
+		, m_resolution(resolution)
+	{
+		RT_ASSERT(resolution > 0);
+		RT_ASSERT(angle > 0 && angle < 90);
+		Face face;
+		face.forward	= normalize(dir);
+		face.right		= normalize(face.forward.cross(fabs(face.forward[1]) < 0.9f ? Vec3f(0, 1, 0) : Vec3f(1, 0, 0)));
+		face.up			= face.right.cross(face.forward);
+		m_vFaces = { face };
+	}
+
+	Vec3f CShadowMap::getDirection(const Face& face, float x, float y) const
+	{
+		const float u = m_tanHalfAngle * (2 * x / m_resolution - 1);
+		const float v = m_tanHalfAngle * (2 * y / m_resolution - 1);
+		return normalize(face.forward + u * face.right + v * face.up);
+	}
+
+	void CShadowMap::build(const CScene& scene)
+	{
+		const int nRows = static_cast<int>(m_vFaces.size() * m_resolution);
+		m_vDepth.resize(m_vFaces.size() * m_resolution * m_resolution);
+#ifdef ENABLE_PDP
+		parallel_for_(Range(0, nRows), [&](const Range& range) {
+#else
+		const Range range(0, nRows);
+#endif
+		for (int row = range.start; row < range.end; row++) {
+			const Face& face = m_vFaces[row / m_resolution];
+			const size_t y = row % m_resolution;
+			float* pDepth = m_vDepth.data() + row * m_resolution;
+			for (size_t x = 0; x < m_resolution; x++) {
+				Ray ray(m_org, getDirection(face, x + 0.5f, y + 0.5f));
+				pDepth[x] = scene.intersect(ray) ? static_cast<float>(ray.t) : Infty;
+			}
+		}
+#ifdef ENABLE_PDP
+		});
+#endif
+	}
+
+	float CShadowMap::getVisibility(const Vec3f& point) const
+	{
+		if (m_vDepth.empty()) return 1;
+
+		// the face, which the point projects to
+		const Vec3f d = point - m_org;
+		size_t f = 0;
+		for (size_t i = 1; i < m_vFaces.size(); i++)
+			if (d.dot(m_vFaces[i].forward) > d.dot(m_vFaces[f].forward)) f = i;
+		const Face& face = m_vFaces[f];
+		const float z = d.dot(face.forward);
+		if (z <= 0) return 1;
+
+		// the texel coordinates of the projection
+		const float res = static_cast<float>(m_resolution);
+		const float x = (d.dot(face.right) / (z * m_tanHalfAngle) + 1) * res / 2;
+		const float y = (d.dot(face.up) / (z * m_tanHalfAngle) + 1) * res / 2;
+		if (x < 0 || x >= res || y < 0 || y >= res) return 1;
+
+		// percentage-closer filtering
+		const float distance = static_cast<float>(norm(d));
+		const float bias = depthBias * distance * 2 * m_tanHalfAngle / res + Epsilon;
+		const int cx = static_cast<int>(x);
+		const int cy = static_cast<int>(y);
+		const float* pDepth = m_vDepth.data() + f * m_resolution * m_resolution;
+		int nVisible = 0;
+		int nTexels = 0;
+		for (int j = cy - pcfRadius; j <= cy + pcfRadius; j++) {
+			if (j < 0 || j >= static_cast<int>(m_resolution)) continue;
+			for (int i = cx - pcfRadius; i <= cx + pcfRadius; i++) {
+				if (i < 0 || i >= static_cast<int>(m_resolution)) continue;
+				nTexels++;
+				if (distance <= pDepth[j * m_resolution + i] + bias) nVisible++;
+			}
+		}
+		return static_cast<float>(nVisible) / nTexels;
+	}
+}
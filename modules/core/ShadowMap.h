@@ -0,0 +1,81 @@
+// Shadow Map class
+#pragma once
+
+#include "types.h"
+
+namespace rt {
+	class CScene;
+
+	// ================================ Shadow Map Class ================================
+	/**
+	 * @brief Depth shadow map of a point light source
+	 * @details The shadow map stores the distances from the light source to the closest geometry along the rays through its texels. The map consists either of 6 faces of the cube around the light source
+	 * (for @ref CLightOmni), or of one face, covering the cone of a spot light source (@ref CLightSpot). The map is built by tracing one ray per texel, thus it costs as many rays, as there are texels,
+	 * and replaces all the shadow rays of the frame by the percentage-closer filtered (PCF) lookups. The shadows are approximate: their edges are blurred over a few texels and the depth bias
+	 * may detach them slightly from the contact points.
+	 * @ingroup moduleLight
+	 */
+	class CShadowMap
+	{
+	public:
+		/**
+		 * @brief Constructor of the cube shadow map
+		 * @param org The position of the light source
+		 * @param resolution The resolution of every face of the cube in texels
+		 */
+		DllExport CShadowMap(const Vec3f& org, size_t resolution);
+		/**
+		 * @brief Constructor of the shadow map, covering a cone
+		 * @param org The position of the light source
+		 * @param dir The direction of the axis of the cone
+		 * @param angle The half-opening angle of the cone in degrees. It must be smaller than 90 degrees
+		 * @param resolution The resolution of the map in texels
+		 */
+		DllExport CShadowMap(const Vec3f& org, const Vec3f& dir, float angle, size_t resolution);
+		DllExport CShadowMap(const CShadowMap&) = delete;
+		DllExport ~CShadowMap(void) = default;
+		DllExport const CShadowMap& operator=(const CShadowMap&) = delete;
+
+		/**
+		 * @brief Builds the shadow map by tracing the rays from the light source
+		 * @param scene The scene
+		 */
+		DllExport void		build(const CScene& scene);
+		/**
+		 * @brief Returns the visibility of the point from the light source
+		 * @details The visibility is the fraction of the 3 x 3 texels around the projection of the point, which geometry is not closer to the light source than the point (percentage-closer filtering)
+		 * @param point The point
+		 * @return The visibility in [0; 1]. The points outside of the map are visible
+		 */
+		DllExport float		getVisibility(const Vec3f& point) const;
+
+
+	private:
+		/// The face of the shadow map: the pyramid with the apex at the light source
+		struct Face
+		{
+			Vec3f right;		///< The horizontal axis of the face
+			Vec3f up;			///< The vertical axis of the face
+			Vec3f forward;		///< The axis of the pyramid
+		};
+
+		/**
+		 * @brief Returns the direction from the light source through the point on the face
+		 * @param face The face
+		 * @param x The horizontal coordinate of the point in texels
+		 * @param y The vertical coordinate of the point in texels
+		 * @return The normalized direction
+		 */
+		Vec3f				getDirection(const Face& face, float x, float y) const;
+
+
+	private:
+		Vec3f				m_org;				///< The position of the light source
+		float				m_tanHalfAngle;		///< The tangent of the half-opening angle of the faces
+		size_t				m_resolution;		///< The resolution of the faces in texels
+		std::vector<Face>	m_vFaces;			///< The faces of the shadow map
+		std::vector<float>	m_vDepth;			///< The distances to the closest geometry: faces x resolution x resolution
+	};
+
+	using ptr_shadowmap_t = std::shared_ptr<CShadowMap>;
+}
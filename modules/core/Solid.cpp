@@ -114,9 +114,9 @@ namespace rt {
 		Mat T1 = tr.translate(-m_pivot).get();
 		Mat T2 = tr.translate(m_pivot).get();
 		
-		// Apply transformation
-		for (auto& pPrim : m_vpPrims) pPrim->transform(t * T1);
-		for (auto& pPrim : m_vpPrims) pPrim->transform(T2);
+		// Apply transformation relative to the pivot point in a single pass
+		Mat T = T2 * t * T1;
+		for (auto& pPrim : m_vpPrims) pPrim->transform(T);
 		
 		// Update pivot point
 		for (int i = 0; i < 3; i++)
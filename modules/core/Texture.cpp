@@ -6,7 +6,7 @@
 
 namespace rt{
 	// Constructor
-	CTexture::CTexture(const std::string& fileName) : CTexture(imread(fileName, 1))
+	CTexture::CTexture(const std::string& fileName) : CTexture(imread(fileName, IMREAD_ANYDEPTH | IMREAD_COLOR))
 	{
 		RT_ASSERT_MSG(!empty(), "Can't read file %s", fileName.c_str());
 	}
@@ -17,8 +17,12 @@ namespace rt{
 	{
 		if (!empty()) {
 			RT_ASSERT_MSG(img.channels() == 3, "Can't create texture from %d-channels images. A 3-channels image is needed.", img.channels());
-			if (img.type() != CV_32FC3)
-				(*this).convertTo(*this, CV_32FC3, 1.0 / 255);
+			if (img.type() != CV_32FC3) {	// the integer images are normalized to [0; 1], the floating-point (HDR) images are kept as they are
+				double scale = 1;
+				if (img.depth() == CV_8U)		scale = 1.0 / 255;
+				else if (img.depth() == CV_16U)	scale = 1.0 / 65535;
+				(*this).convertTo(*this, CV_32FC3, scale);
+			}
 		}
 	}
 
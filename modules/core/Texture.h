@@ -20,6 +20,7 @@ namespace rt {
 		DllExport CTexture(void) : Mat() {}
 		/**
 		 * @brief Constructor
+		 * @details The high dynamic range images (\a e.g. *.hdr or *.exr) are loaded with the floating-point precision
 		 * @param fileName The path to the texture file
 		 */
 		DllExport CTexture(const std::string& fileName);
@@ -0,0 +1,223 @@
+#include "WideBVHTree.h"
+#include "Prim.h"
+#include "Ray.h"
+#include "macroses.h"
+#if defined(ENABLE_AVX)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+namespace rt {
+	namespace {
+		// Entry of the traversal stack
+		struct StackEntry {
+			dword	node;				// Index of the node
+			float	tEntry;				// Distance to the entry point of the ray into the node's box
+		};
+
+		// Tests the ray against all the children boxes of the node, returning the bit mask of the hit children and the distances \b tEntry to the entry points
+		// The inverse direction of the ray is finite, thus the distances to the planes are never NaN
+		template <size_t N>
+		inline unsigned testChildren(const WideBVHNode<N>& node, const RayData& r, float tMax, float* tEntry)
+		{
+			unsigned res = 0;
+			for (size_t c = 0; c < N; c++) {
+				float t0 = 0;
+				float t1 = tMax;
+				for (int i = 0; i < 3; i++) {
+					float tNear	= (r.sign[i] ? node.maxPoint[i][c] : node.minPoint[i][c]) * r.invDir[i] - r.orgInvDir[i];
+					float tFar	= (r.sign[i] ? node.minPoint[i][c] : node.maxPoint[i][c]) * r.invDir[i] - r.orgInvDir[i];
+					if (tNear > t0) t0 = tNear;
+					if (tFar < t1) t1 = tFar;
+				}
+				tEntry[c] = t0;
+				if (t0 <= t1) res |= 1u << c;
+			}
+			return res;
+		}
+
+#if defined(ENABLE_AVX)
+		template <>
+		inline unsigned testChildren<8>(const WideBVHNode<8>& node, const RayData& r, float tMax, float* tEntry)
+		{
+			__m256 t0 = _mm256_setzero_ps();
+			__m256 t1 = _mm256_set1_ps(tMax);
+			for (int i = 0; i < 3; i++) {
+				const __m256 invDir		= _mm256_set1_ps(r.invDir[i]);
+				const __m256 orgInvDir	= _mm256_set1_ps(r.orgInvDir[i]);
+				const __m256 tNear		= _mm256_sub_ps(_mm256_mul_ps(_mm256_load_ps(r.sign[i] ? node.maxPoint[i] : node.minPoint[i]), invDir), orgInvDir);
+				const __m256 tFar		= _mm256_sub_ps(_mm256_mul_ps(_mm256_load_ps(r.sign[i] ? node.minPoint[i] : node.maxPoint[i]), invDir), orgInvDir);
+				t0 = _mm256_max_ps(tNear, t0);
+				t1 = _mm256_min_ps(tFar, t1);
+			}
+			_mm256_store_ps(tEntry, t0);
+			return static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ)));
+		}
+#endif
+
+#if defined(ENABLE_AVX) || defined(__SSE2__) || defined(_M_X64)
+		template <>
+		inline unsigned testChildren<4>(const WideBVHNode<4>& node, const RayData& r, float tMax, float* tEntry)
+		{
+			__m128 t0 = _mm_setzero_ps();
+			__m128 t1 = _mm_set1_ps(tMax);
+			for (int i = 0; i < 3; i++) {
+				const __m128 invDir		= _mm_set1_ps(r.invDir[i]);
+				const __m128 orgInvDir	= _mm_set1_ps(r.orgInvDir[i]);
+				const __m128 tNear		= _mm_sub_ps(_mm_mul_ps(_mm_load_ps(r.sign[i] ? node.maxPoint[i] : node.minPoint[i]), invDir), orgInvDir);
+				const __m128 tFar		= _mm_sub_ps(_mm_mul_ps(_mm_load_ps(r.sign[i] ? node.minPoint[i] : node.maxPoint[i]), invDir), orgInvDir);
+				t0 = _mm_max_ps(tNear, t0);
+				t1 = _mm_min_ps(tFar, t1);
+			}
+			_mm_store_ps(tEntry, t0);
+			return static_cast<unsigned>(_mm_movemask_ps(_mm_cmple_ps(t0, t1)));
+		}
+#endif
+	}
+
+	template <size_t N>
+	void CWideBVHTree<N>::build(const std::vector<ptr_prim_t>& vpPrims, size_t maxDepth, size_t minPrimitives)
+	{
+		CBVHTree bvh(m_builder);
+		bvh.build(vpPrims, maxDepth, minPrimitives);
+		const std::vector<BVHNode>& vBinaryNodes = bvh.getNodes();
+
+		m_vpPrims		= bvh.getPrims();
+		m_boundingBox	= vBinaryNodes[0].box;
+		m_vNodes.clear();
+		if (vBinaryNodes[0].isLeaf() && vBinaryNodes[0].count == 0) return;		// empty tree
+
+		m_vNodes.reserve(vBinaryNodes.size() / (N - 1) + 1);
+		convert(bvh, 0);
+		m_vNodes.shrink_to_fit();
+#ifdef DEBUG_PRINT_INFO
+		std::cout << "BVH" << N << ": " << m_vNodes.size() << " nodes, " << getMemoryUsage() / 1024 << " KB" << std::endl;
+#endif
+	}
+
+	template <size_t N>
+	bool CWideBVHTree<N>::intersect(Ray& ray) const
+	{
+		if (m_vNodes.empty()) return false;
+
+		const RayData r(ray);
+		double t0 = 0;
+		double t1 = ray.t;
+		m_boundingBox.clip(r, t0, t1);
+		if (t1 < t0) return false;
+
+		StackEntry stack[(N - 1) * 64 + 1];				// every level of the tree may postpone up to N - 1 children
+		size_t top = 0;
+		stack[top++] = { 0, static_cast<float>(t0) };
+
+		bool hit = false;
+		while (top) {
+			const StackEntry entry = stack[--top];
+			if (entry.tEntry > ray.t) continue;		// a closer intersection has been found meanwhile
+
+			const WideBVHNode<N>& node = m_vNodes[entry.node];
+			alignas(32) float tEntry[N];
+			unsigned mask = testChildren(node, r, static_cast<float>(ray.t), tEntry);
+			if (!mask) continue;
+
+			// Sort the hit children from the closest to the farthest one
+			size_t	children[N];
+			size_t	nHits = 0;
+			for (size_t c = 0; c < N; c++) {
+				if (!(mask & (1u << c))) continue;
+				size_t k = nHits++;
+				for (; k > 0 && tEntry[children[k - 1]] > tEntry[c]; k--)
+					children[k] = children[k - 1];
+				children[k] = c;
+			}
+
+			// Intersect the leaf children from front to back, and push the branch children from back to front, so that the closest one is traversed first
+			for (size_t k = 0; k < nHits; k++) {
+				const size_t c = children[k];
+				if (tEntry[c] > ray.t) break;
+				for (dword i = node.child[c]; i < node.child[c] + node.count[c]; i++)
+					hit |= m_vpPrims[i]->intersect(ray);
+			}
+			for (size_t k = nHits; k-- > 0; ) {
+				const size_t c = children[k];
+				if (node.count[c] == 0 && tEntry[c] <= ray.t)
+					stack[top++] = { node.child[c], tEntry[c] };
+			}
+		}
+		return hit;
+	}
+
+	template <size_t N>
+	const ptr_prim_t* CWideBVHTree<N>::findOccluder(const Ray& ray) const
+	{
+		if (m_vNodes.empty()) return nullptr;
+
+		const RayData r(ray);
+		double t0 = 0;
+		double t1 = ray.t;
+		m_boundingBox.clip(r, t0, t1);
+		if (t1 < t0) return nullptr;
+
+		const float tMax = static_cast<float>(ray.t);
+		dword stack[(N - 1) * 64 + 1];
+		size_t top = 0;
+		stack[top++] = 0;
+
+		while (top) {
+			const WideBVHNode<N>& node = m_vNodes[stack[--top]];
+			alignas(32) float tEntry[N];
+			unsigned mask = testChildren(node, r, tMax, tEntry);
+			for (size_t c = 0; c < N; c++) {
+				if (!(mask & (1u << c))) continue;
+				if (node.count[c]) {
+					for (dword i = node.child[c]; i < node.child[c] + node.count[c]; i++)
+						if (m_vpPrims[i]->if_intersect(ray)) return &m_vpPrims[i];
+				}
+				else stack[top++] = node.child[c];
+			}
+		}
+		return nullptr;
+	}
+
+	// ---------------------- private ----------------------
+	template <size_t N>
+	dword CWideBVHTree<N>::convert(const CBVHTree& bvh, int node)
+	{
+		const std::vector<BVHNode>& vBinaryNodes = bvh.getNodes();
+		const std::vector<int> vChildren = bvh.collapse(node, N);
+
+		const dword res = static_cast<dword>(m_vNodes.size());
+		m_vNodes.emplace_back();
+		WideBVHNode<N> wNode = {};
+		for (int i = 0; i < 3; i++)
+			for (size_t k = 0; k < N; k++) {				// empty boxes
+				wNode.minPoint[i][k] = Infty;
+				wNode.maxPoint[i][k] = -Infty;
+			}
+
+		size_t k = 0;
+		for (int c : vChildren) {
+			const BVHNode& child = vBinaryNodes[c];
+			if (child.isLeaf() && child.count == 0) continue;				// empty leaf
+
+			for (int i = 0; i < 3; i++) {
+				wNode.minPoint[i][k] = child.box.getMinPoint()[i];
+				wNode.maxPoint[i][k] = child.box.getMaxPoint()[i];
+			}
+			if (child.isLeaf()) {
+				wNode.child[k] = static_cast<dword>(child.first);
+				wNode.count[k] = static_cast<dword>(child.count);
+			}
+			else
+				wNode.child[k] = convert(bvh, c);
+			k++;
+		}
+
+		m_vNodes[res] = wNode;
+		return res;
+	}
+
+	template class CWideBVHTree<4>;
+	template class CWideBVHTree<8>;
+}
@@ -0,0 +1,82 @@
+// Wide Bounding Volume Hierarchy (BVH) class
+#pragma once
+
+#include "BVHTree.h"
+
+namespace rt {
+	// ================================ Wide BVH Node Structure ================================
+	/**
+	 * @brief Node of the wide (N-ary) BVH
+	 * @details The bounding boxes of the children are stored in the Structure of Arrays (SoA) layout, so that all of them may be tested against a ray with a few SIMD instructions.
+	 * The unused children slots have empty bounding boxes, which are never hit.
+	 * @tparam N The number of children (4 or 8)
+	 */
+	template <size_t N>
+	struct alignas(32) WideBVHNode
+	{
+		float	minPoint[3][N];			///< The minimum points of the children boxes: minPoint[axis][child]
+		float	maxPoint[3][N];			///< The maximum points of the children boxes: maxPoint[axis][child]
+		dword	child[N];				///< Index of the child node for branch children, or the index of the first primitive for leaf children
+		dword	count[N];				///< Number of primitives for leaf children, or 0 for branch children and unused slots
+	};
+
+	// ================================ Wide BVH Tree Class ================================
+	/**
+	 * @brief Wide Bounding Volume Hierarchy (BVH) class
+	 * @details The tree is built as the binary @ref CBVHTree, which is then collapsed into the N-ary tree of @ref WideBVHNode nodes.
+	 * During traversal, all the children boxes of a node are tested at once: with one AVX instruction sequence for BVH8 (if ENABLE_AVX is set) and with SSE instructions for BVH4.
+	 * The hit children are traversed from front to back using a compact stack of (node, distance) pairs.
+	 * Wide trees have several times fewer nodes than the binary ones, thus a ray visits fewer nodes and causes less memory traffic.
+	 * @code
+	 * scene.setAccelStructure(std::make_shared<CBVH8Tree>());
+	 * @endcode
+	 * @tparam N The number of children of every node (4 or 8)
+	 */
+	template <size_t N>
+	class CWideBVHTree : public IAccelStructure
+	{
+		static_assert(N == 4 || N == 8, "Only 4-ary and 8-ary BVH trees are supported");
+
+	public:
+		/**
+		 * @brief Constructor
+		 * @param builder The algorithm used for building the underlying binary tree
+		 */
+		DllExport explicit CWideBVHTree(BVHBuilder builder = BVHBuilder::SAH) : m_builder(builder) {}
+		DllExport CWideBVHTree(const CWideBVHTree&) = delete;
+		DllExport virtual ~CWideBVHTree(void) = default;
+		DllExport const CWideBVHTree& operator=(const CWideBVHTree&) = delete;
+
+		DllExport virtual void		build(const std::vector<ptr_prim_t>& vpPrims, size_t maxDepth = 20, size_t minPrimitives = 3) override;
+		DllExport virtual bool		intersect(Ray& ray) const override;
+		DllExport virtual bool		if_intersect(const Ray& ray) const override { return findOccluder(ray) != nullptr; }
+		DllExport virtual const ptr_prim_t*	findOccluder(const Ray& ray) const override;
+		DllExport virtual size_t	getMemoryUsage(void) const override { return sizeof(CWideBVHTree) + m_vNodes.capacity() * sizeof(WideBVHNode<N>) + m_vpPrims.capacity() * sizeof(ptr_prim_t); }
+
+		/**
+		 * @brief Returns the nodes of the tree
+		 * @return The vector of nodes. The root node has index 0
+		 */
+		DllExport const std::vector<WideBVHNode<N>>&	getNodes(void) const { return m_vNodes; }
+
+
+	private:
+		/**
+		 * @brief Recursively converts the sub-tree of the binary tree into the wide nodes
+		 * @param bvh The binary tree
+		 * @param node Index of the root node of the binary sub-tree
+		 * @return Index of the wide node
+		 */
+		dword	convert(const CBVHTree& bvh, int node);
+
+
+	private:
+		std::vector<WideBVHNode<N>>		m_vNodes;			///< The nodes of the tree
+		std::vector<ptr_prim_t>			m_vpPrims;			///< The primitives, referenced by the leaf children
+		CBoundingBox					m_boundingBox;		///< The bounding box of the root node
+		const BVHBuilder				m_builder;			///< The algorithm used for building the underlying binary tree
+	};
+
+	using CBVH4Tree = CWideBVHTree<4>;
+	using CBVH8Tree = CWideBVHTree<8>;
+}
@@ -0,0 +1,118 @@
+// SIMD Vector Math
+#pragma once
+
+#include "types.h"
+#if defined(ENABLE_AVX)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#if defined(ENABLE_AVX) || defined(__SSE2__) || defined(_M_X64)
+#define RT_SIMD_SSE
+#endif
+
+namespace rt {
+	// ================================ SIMD Namespace ==============================
+	/**
+	 * @brief Internal vector math for the hot paths of the ray tracer
+	 * @details The 3-component vectors are stored in one 128-bit SSE register with the 4-th component set to 0, so that the arithmetics,
+	 * the dot and the cross products need only a few instructions and never promote to double.
+	 * If SSE is not available, the same interface is implemented with scalar code.
+	 * The OpenCV types remain at the API boundary: use simd::load3() and simd::toVec3f() for the conversion.
+	 */
+	namespace simd {
+		/// 4-component float vector
+		struct float4
+		{
+#ifdef RT_SIMD_SSE
+			__m128	v;
+
+			float4(void) = default;
+			float4(__m128 _v) : v(_v) {}
+			explicit float4(float a) : v(_mm_set1_ps(a)) {}
+			float4(float x, float y, float z, float w) : v(_mm_setr_ps(x, y, z, w)) {}
+			float	x(void) const { return _mm_cvtss_f32(v); }
+			float	y(void) const { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))); }
+			float	z(void) const { return _mm_cvtss_f32(_mm_movehl_ps(v, v)); }
+#else
+			float	v[4];
+
+			float4(void) = default;
+			explicit float4(float a) : v{ a, a, a, a } {}
+			float4(float x, float y, float z, float w) : v{ x, y, z, w } {}
+			float	x(void) const { return v[0]; }
+			float	y(void) const { return v[1]; }
+			float	z(void) const { return v[2]; }
+#endif
+		};
+
+#ifdef RT_SIMD_SSE
+		inline float4	operator+(const float4& a, const float4& b) { return _mm_add_ps(a.v, b.v); }
+		inline float4	operator-(const float4& a, const float4& b) { return _mm_sub_ps(a.v, b.v); }
+		inline float4	operator*(const float4& a, const float4& b) { return _mm_mul_ps(a.v, b.v); }
+		inline float4	operator/(const float4& a, const float4& b) { return _mm_div_ps(a.v, b.v); }
+		inline float4	operator*(const float4& a, float s) { return _mm_mul_ps(a.v, _mm_set1_ps(s)); }
+		inline float4	operator*(float s, const float4& a) { return _mm_mul_ps(a.v, _mm_set1_ps(s)); }
+		/// Component-wise minimum. If any of the components is NaN, the component of \b b is returned
+		inline float4	min(const float4& a, const float4& b) { return _mm_min_ps(a.v, b.v); }
+		/// Component-wise maximum. If any of the components is NaN, the component of \b b is returned
+		inline float4	max(const float4& a, const float4& b) { return _mm_max_ps(a.v, b.v); }
+
+		/// Dot product of the first 3 components
+		inline float	dot3(const float4& a, const float4& b)
+		{
+			const __m128 m = _mm_mul_ps(a.v, b.v);
+			const __m128 s = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+			return _mm_cvtss_f32(_mm_add_ss(s, _mm_movehl_ps(m, m)));
+		}
+		/// Cross product of the first 3 components: a.yzx * b.zxy - a.zxy * b.yzx, computed with 3 shuffles only
+		inline float4	cross3(const float4& a, const float4& b)
+		{
+			const __m128 a_yzx = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m128 b_yzx = _mm_shuffle_ps(b.v, b.v, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m128 c = _mm_sub_ps(_mm_mul_ps(a.v, b_yzx), _mm_mul_ps(a_yzx, b.v));
+			return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+		}
+		/// Returns the components of \b b, where the components of \b m are zero, and the components of \b a otherwise
+		inline float4	selectZero(const float4& m, const float4& a, const float4& b)
+		{
+			const __m128 zero = _mm_cmpeq_ps(m.v, _mm_setzero_ps());
+			return _mm_or_ps(_mm_andnot_ps(zero, a.v), _mm_and_ps(zero, b.v));
+		}
+		/// Maximum of the first 3 components
+		inline float	hmax3(const float4& a) { return _mm_cvtss_f32(_mm_max_ss(_mm_max_ss(a.v, _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(1, 1, 1, 1))), _mm_movehl_ps(a.v, a.v))); }
+		/// Minimum of the first 3 components
+		inline float	hmin3(const float4& a) { return _mm_cvtss_f32(_mm_min_ss(_mm_min_ss(a.v, _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(1, 1, 1, 1))), _mm_movehl_ps(a.v, a.v))); }
+#else
+		inline float4	operator+(const float4& a, const float4& b) { return float4(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]); }
+		inline float4	operator-(const float4& a, const float4& b) { return float4(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]); }
+		inline float4	operator*(const float4& a, const float4& b) { return float4(a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]); }
+		inline float4	operator/(const float4& a, const float4& b) { return float4(a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]); }
+		inline float4	operator*(const float4& a, float s) { return float4(a.v[0] * s, a.v[1] * s, a.v[2] * s, a.v[3] * s); }
+		inline float4	operator*(float s, const float4& a) { return a * s; }
+		/// Component-wise minimum. If any of the components is NaN, the component of \b b is returned
+		inline float4	min(const float4& a, const float4& b) { return float4(a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1], a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3]); }
+		/// Component-wise maximum. If any of the components is NaN, the component of \b b is returned
+		inline float4	max(const float4& a, const float4& b) { return float4(a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1], a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3]); }
+
+		/// Dot product of the first 3 components
+		inline float	dot3(const float4& a, const float4& b) { return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]; }
+		/// Cross product of the first 3 components
+		inline float4	cross3(const float4& a, const float4& b) { return float4(a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2], a.v[0] * b.v[1] - a.v[1] * b.v[0], 0); }
+		/// Returns the components of \b b, where the components of \b m are zero, and the components of \b a otherwise
+		inline float4	selectZero(const float4& m, const float4& a, const float4& b) { return float4(m.v[0] == 0 ? b.v[0] : a.v[0], m.v[1] == 0 ? b.v[1] : a.v[1], m.v[2] == 0 ? b.v[2] : a.v[2], m.v[3] == 0 ? b.v[3] : a.v[3]); }
+		/// Maximum of the first 3 components
+		inline float	hmax3(const float4& a) { return MAX(MAX(a.v[0], a.v[1]), a.v[2]); }
+		/// Minimum of the first 3 components
+		inline float	hmin3(const float4& a) { return MIN(MIN(a.v[0], a.v[1]), a.v[2]); }
+#endif
+
+		/// Loads the 3-component vector, setting the 4-th component to 0
+		inline float4	load3(const Vec3f& a) { return float4(a.val[0], a.val[1], a.val[2], 0); }
+		/// Loads the 3 floats from the array \b a, setting the 4-th component to 0
+		inline float4	load3(const float* a) { return float4(a[0], a[1], a[2], 0); }
+		/// Converts the first 3 components back to the OpenCV vector
+		inline Vec3f	toVec3f(const float4& a) { return Vec3f(a.x(), a.y(), a.z()); }
+	}
+}
@@ -0,0 +1,130 @@
+#include "TestBRDF.h"
+#include "core/Ray.h"
+#include <random>
+
+using namespace rt;
+
+namespace {
+    // Checks that the pdf of the BRDF is normalized and consistent with its sampling
+    void testBRDF(const IBRDF& brdf, const Vec3f& axis)
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> u(0, 1);
+
+        // the integral of the pdf over the sphere and over the cone of 30 degrees around the axis
+        const size_t nDirections = 400000;
+        const float cosCone = cosf(30 * Pif / 180);
+        float integral = 0, coneIntegral = 0;
+        for (size_t i = 0; i < nDirections; i++) {
+            float z = 2 * u(rng) - 1, phi = 2 * Pif * u(rng), r = sqrtf(MAX(0.0f, 1 - z * z));
+            Vec3f dir(r * cosf(phi), r * sinf(phi), z);
+            float pdf = brdf.pdf(dir);
+            integral += pdf;
+            if (dir.dot(axis) >= cosCone) coneIntegral += pdf;
+        }
+        integral *= 4 * Pif / nDirections;
+        coneIntegral *= 4 * Pif / nDirections;
+        EXPECT_LE(integral, 1.02f);
+        EXPECT_GT(integral, 0.9f);
+
+        // the fraction of the samples within the cone
+        const size_t nSamples = 100000;
+        size_t nCone = 0;
+        for (size_t s = 0; s < nSamples; s++) {
+            auto dir = brdf.sample(Vec2f(u(rng), u(rng)));
+            if (!dir) continue;
+            EXPECT_NEAR(norm(dir.value()), 1, Epsilon);
+            EXPECT_GT(brdf.pdf(dir.value()), 0);
+            if (dir.value().dot(axis) >= cosCone) nCone++;
+        }
+        EXPECT_NEAR(static_cast<float>(nCone) / nSamples, coneIntegral, 0.01f);
+    }
+}
+
+TEST_F(CTestBRDF, phong) {
+    const Vec3f normal(0, 1, 0);
+    const Vec3f reflected = normalize(Vec3f(0.2f, 1, 0));
+    testBRDF(CBRDFPhong(normal, reflected, 0, 1, 20), reflected);
+    testBRDF(CBRDFPhong(normal, reflected, 1, 0, 20), normal);
+    testBRDF(CBRDFPhong(normal, reflected, 0.5f, 0.5f, 50), reflected);
+}
+
+TEST_F(CTestBRDF, glossy) {
+    const Vec3f normal(0, 1, 0);
+    const Vec3f dir = normalize(Vec3f(-0.2f, -1, 0));
+    testBRDF(CBRDFGlossy(normal, dir, 25), normalize(Vec3f(-0.2f, 1, 0)));
+}
+
+TEST_F(CTestBRDF, area_light_solid_angle) {
+    CLightArea area(Vec3f::all(5), Vec3f(-2, 8, -2), Vec3f(2, 8, -2), Vec3f(2, 8, 2), Vec3f(-2, 8, 2));
+    const Vec3f point(1, 0, -0.5f);
+    const Vec3f normal(0, 1, 0);
+
+    // the samples lie on the area and are found by evaluate() with the same pdf
+    const size_t nSamples = 64 * 64;
+    Vec3f sum = Vec3f::all(0);
+    for (size_t s = 0; s < nSamples; s++) {
+        auto res = area.sample(point, normal, CSampler::stratifiedSample(s, nSamples));
+        ASSERT_TRUE(res.has_value());
+        Vec3f p = point + static_cast<float>(res->distance) * res->direction;
+        EXPECT_NEAR(p[1], 8, 1e-3f);
+        EXPECT_LE(fabs(p[0]), 2 + 1e-3f);
+        EXPECT_LE(fabs(p[2]), 2 + 1e-3f);
+        auto hit = area.evaluate(point, normal, res->direction);
+        ASSERT_TRUE(hit.has_value());
+        EXPECT_NEAR(hit->distance, res->distance, 1e-3);
+        EXPECT_NEAR(hit->pdf, res->pdf, 1e-3f * res->pdf);
+        sum += (1.0f / res->pdf) * res->radiance;
+    }
+    sum = (1.0f / nSamples) * sum;
+
+    // the same estimate as the uniform sampling of the area
+    Vec3f reference = Vec3f::all(0);
+    const float a = 4;
+    const size_t n = 512;
+    for (size_t y = 0; y < n; y++)
+        for (size_t x = 0; x < n; x++) {
+            Vec3f p(-2 + a * (x + 0.5f) / n, 8, -2 + a * (y + 0.5f) / n);
+            Vec3f d = p - point;
+            float t = static_cast<float>(norm(d));
+            float cosN = d[1] / t;
+            reference += (a * a / (n * n)) * (cosN / (t * t * t)) * Vec3f::all(5);
+        }
+    for (int i = 0; i < 3; i++)
+        EXPECT_NEAR(sum[i], reference[i], 2e-3f * reference[i]);
+
+    // no light behind the area
+    EXPECT_FALSE(area.sample(Vec3f(0, 10, 0), normal, Vec2f::all(0.5f)).has_value());
+    EXPECT_FALSE(area.evaluate(Vec3f(0, 10, 0), normal, Vec3f(0, -1, 0)).has_value());
+    EXPECT_FALSE(area.evaluate(point, normal, Vec3f(1, 0, 0)).has_value());
+}
+
+TEST_F(CTestBRDF, mis) {
+    CScene scene;
+    auto pArea = std::make_shared<CLightArea>(Vec3f::all(5), Vec3f(-2, 8, -2), Vec3f(2, 8, -2), Vec3f(2, 8, 2), Vec3f(-2, 8, 2), std::make_shared<CSamplerStratified>(32));
+    scene.add(pArea);
+    scene.add(std::make_shared<CLightOmni>(Vec3f::all(20), Vec3f(3, 5, 0)));
+
+    const Vec3f normal(0, 1, 0);
+    const Vec3f reflected = normalize(Vec3f(0.3f, 1, 0.1f));
+    const float ke = 30;
+    auto reflectance = [&](const Vec3f& dir, const Vec3f& radiance) {
+        return (0.3f * MAX(dir.dot(normal), 0.0f) + powf(MAX(dir.dot(reflected), 0.0f), ke)) * radiance;
+    };
+
+    // reference: light sampling only
+    Vec3f reference = Vec3f::all(0);
+    for (auto pLight : scene.getLights()) {
+        const size_t nSamples = pLight == pArea ? 256 * 256 : 1;
+        for (size_t s = 0; s < nSamples; s++) {
+            Ray I(Vec3f::all(0));
+            auto radiance = pLight->illuminate(I, CSampler::stratifiedSample(s, nSamples));
+            if (radiance) reference += (1.0f / nSamples) * reflectance(I.dir, radiance.value());
+        }
+    }
+
+    Ray I(Vec3f::all(0));
+    Vec3f res = scene.illuminateMIS(I, normal, CBRDFPhong(normal, reflected, 0.3f, 1, ke), reflectance);
+    for (int i = 0; i < 3; i++)
+        EXPECT_NEAR(res[i], reference[i], 0.02f * reference[i]);
+}
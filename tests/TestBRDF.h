@@ -0,0 +1,11 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "openrt.h"
+
+class CTestBRDF : public ::testing::Test {
+public:
+    CTestBRDF(void) = default;
+    ~CTestBRDF(void) = default;
+};
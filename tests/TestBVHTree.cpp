@@ -0,0 +1,523 @@
+#include "TestBVHTree.h"
+#include "core/Ray.h"
+#include <random>
+#include <filesystem>
+#include <fstream>
+
+using namespace rt;
+
+namespace {
+    // Checks that the acceleration structure finds the same intersections as the brute-force search
+    void checkIntersections(const IAccelStructure& accel, const std::vector<ptr_prim_t>& vpPrims, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> u(-1, 1);
+        for (int i = 0; i < 500; i++) {
+            Vec3f org(20 * u(rng), 20 * u(rng), 20 * u(rng));
+            Vec3f dir = normalize(Vec3f(u(rng), u(rng), u(rng)));
+
+            Ray gt(org, dir);
+            for (const auto& pPrim : vpPrims) pPrim->intersect(gt);
+            Ray ray(org, dir);
+            bool hit = accel.intersect(ray);
+
+            ASSERT_EQ(hit, gt.hit != nullptr);
+            EXPECT_EQ(accel.if_intersect(Ray(org, dir)), hit);
+            const ptr_prim_t* pOccluder = accel.findOccluder(Ray(org, dir));
+            ASSERT_EQ(pOccluder != nullptr, hit);
+            if (hit) {
+                EXPECT_EQ(ray.hit, gt.hit);
+                EXPECT_DOUBLE_EQ(ray.t, gt.t);
+                EXPECT_TRUE((*pOccluder)->if_intersect(Ray(org, dir)));     // any intersected primitive, not necessarily the closest one
+            }
+        }
+    }
+}
+
+TEST_F(CTestBVHTree, bvh_tree) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(-10, 10);
+
+    std::vector<ptr_prim_t> vpPrims;
+    for (int i = 0; i < 300; i++)
+        vpPrims.push_back(std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 0.5f));
+
+    CBVHTree bvh;
+    bvh.build(vpPrims, 20, 2);
+    EXPECT_EQ(bvh.getPrims().size(), vpPrims.size());
+    EXPECT_FLOAT_EQ(bvh.getDegradation(), 1.0f);
+    for (const auto& node : bvh.getNodes())
+        if (node.isLeaf()) EXPECT_LE(node.count, 2);
+    checkIntersections(bvh, vpPrims, rng);
+
+    // Small motion: the refitted tree stays correct and close to the freshly built one
+    CTransform T;
+    for (auto& pPrim : vpPrims)
+        pPrim->transform(T.translate(0.1f * Vec3f(u(rng), u(rng), u(rng))).get());
+    ASSERT_TRUE(bvh.refit());
+    EXPECT_LT(bvh.getDegradation(), 1.5f);
+    checkIntersections(bvh, vpPrims, rng);
+
+    // Large motion: the refitted tree stays correct, but degrades
+    for (auto& pPrim : vpPrims)
+        pPrim->transform(T.translate(Vec3f(u(rng), u(rng), u(rng))).get());
+    ASSERT_TRUE(bvh.refit());
+    EXPECT_GT(bvh.getDegradation(), 1.5f);
+    checkIntersections(bvh, vpPrims, rng);
+
+    bvh.build(vpPrims, 20, 2);
+    EXPECT_FLOAT_EQ(bvh.getDegradation(), 1.0f);
+    checkIntersections(bvh, vpPrims, rng);
+}
+
+TEST_F(CTestBVHTree, lbvh) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> u(-10, 10);
+
+    // 30-bit Morton codes; enough primitives for the radix sort to work on several chunks
+    std::vector<ptr_prim_t> vpPrims;
+    for (int i = 0; i < 5000; i++)
+        vpPrims.push_back(std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 0.1f));
+    CBVHTree lbvh(BVHBuilder::LBVH);
+    lbvh.build(vpPrims, 30, 4);
+    EXPECT_EQ(lbvh.getPrims().size(), vpPrims.size());
+    for (const auto& node : lbvh.getNodes())
+        if (node.isLeaf()) EXPECT_LE(node.count, 4);
+    checkIntersections(lbvh, vpPrims, rng);
+
+    // The tree is refittable as the one built with SAH
+    CTransform T;
+    for (auto& pPrim : vpPrims)
+        pPrim->transform(T.translate(0.1f * Vec3f(u(rng), u(rng), u(rng))).get());
+    ASSERT_TRUE(lbvh.refit());
+    checkIntersections(lbvh, vpPrims, rng);
+
+    // 63-bit Morton codes
+    for (int i = 0; i < 70000; i++)
+        vpPrims.push_back(std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 0.01f));
+    lbvh.build(vpPrims);
+    checkIntersections(lbvh, vpPrims, rng);
+
+    // Coinciding centroids lead to duplicate Morton codes; the depth limit collapses the deep subtrees
+    vpPrims.clear();
+    for (int i = 0; i < 100; i++)
+        vpPrims.push_back(std::make_shared<CPrimSphere>(shader, Vec3f::all(0), 0.05f * (i + 1)));
+    for (int i = 0; i < 100; i++)
+        vpPrims.push_back(std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 0.5f));
+    lbvh.build(vpPrims, 5, 1);
+    checkIntersections(lbvh, vpPrims, rng);
+
+    // Degenerate trees
+    lbvh.build(std::vector<ptr_prim_t>(vpPrims.begin(), vpPrims.begin() + 1));
+    checkIntersections(lbvh, std::vector<ptr_prim_t>(vpPrims.begin(), vpPrims.begin() + 1), rng);
+    lbvh.build(std::vector<ptr_prim_t>());
+    EXPECT_FALSE(lbvh.intersect(lvalue_cast(Ray(Vec3f::all(0), Vec3f(0, 0, 1)))));
+}
+
+TEST_F(CTestBVHTree, sbvh) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> u(-10, 10);
+
+    // Clipping of a triangle: only the part with x + y <= 10 lies inside the box
+    CPrimTriangle triangle(shader, Vec3f(0, 0, 0), Vec3f(10, 0, 0), Vec3f(0, 10, 0));
+    CBoundingBox clipped = triangle.getClippedBoundingBox(CBoundingBox(Vec3f(4, 4, -1), Vec3f(8, 8, 1)));
+    for (int i = 0; i < 2; i++) {
+        EXPECT_NEAR(clipped.getMinPoint()[i], 4, Epsilon);
+        EXPECT_NEAR(clipped.getMaxPoint()[i], 6, Epsilon);
+    }
+    clipped = triangle.getClippedBoundingBox(CBoundingBox(Vec3f(6, 6, -1), Vec3f(8, 8, 1)));
+    EXPECT_GT(clipped.getMinPoint()[0], clipped.getMaxPoint()[0]);         // empty box
+
+    // Long, thin and diagonal triangles, which overlap each other's bounding boxes
+    std::vector<ptr_prim_t> vpPrims;
+    for (int i = 0; i < 400; i++) {
+        Vec3f a(u(rng), u(rng), u(rng));
+        Vec3f b(u(rng), u(rng), u(rng));
+        vpPrims.push_back(std::make_shared<CPrimTriangle>(shader, a, b, b + 0.05f * Vec3f(u(rng), u(rng), u(rng))));
+    }
+    for (int i = 0; i < 100; i++)
+        vpPrims.push_back(std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 0.5f));
+
+    CBVHTree bvh(BVHBuilder::SAH);
+    bvh.build(vpPrims);
+    CBVHTree sbvh(BVHBuilder::SBVH);
+    sbvh.build(vpPrims);
+    EXPECT_LT(sbvh.getSAHCost(), bvh.getSAHCost());
+    EXPECT_GT(sbvh.getPrims().size(), vpPrims.size());      // some primitives are referenced by several leaves
+    EXPECT_LE(sbvh.getPrims().size(), 2 * vpPrims.size());
+    checkIntersections(sbvh, vpPrims, rng);
+
+    // All the references to a primitive are removed
+    std::vector<ptr_prim_t> vpRemaining;
+    for (size_t i = 0; i < vpPrims.size(); i++)
+        if (i % 2) vpRemaining.push_back(vpPrims[i]);
+        else ASSERT_TRUE(sbvh.remove(vpPrims[i]));
+    EXPECT_FALSE(sbvh.remove(vpPrims[0]));
+    checkIntersections(sbvh, vpRemaining, rng);
+}
+
+TEST_F(CTestBVHTree, compressed_bvh) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<float> u(-10, 10);
+
+    std::vector<ptr_prim_t> vpPrims;
+    for (int i = 0; i < 1000; i++) {
+        Vec3f a(u(rng), u(rng), u(rng));
+        vpPrims.push_back(std::make_shared<CPrimTriangle>(shader, a, a + 0.1f * Vec3f(u(rng), u(rng), u(rng)), a + 0.1f * Vec3f(u(rng), u(rng), u(rng))));
+    }
+    for (int i = 0; i < 1000; i++)
+        vpPrims.push_back(std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 0.2f));
+
+    for (BVHBuilder builder : { BVHBuilder::SAH, BVHBuilder::LBVH }) {
+        CBVHTree bvh(builder);
+        bvh.build(vpPrims, 30, 2);
+        CCompressedBVHTree cbvh(builder);
+        cbvh.build(vpPrims, 30, 2);
+        // Every compressed node replaces up to 3 branch nodes of the binary tree
+        EXPECT_LT(cbvh.getNodes().size(), bvh.getNodes().size() / 2);
+        EXPECT_LT(cbvh.getMemoryUsage(), bvh.getMemoryUsage());
+        for (const auto& node : cbvh.getNodes()) {
+            EXPECT_GE(node.nChildren, 1);
+            EXPECT_LE(node.nChildren, 4);
+        }
+        checkIntersections(cbvh, vpPrims, rng);
+    }
+
+    // Degenerate trees
+    CCompressedBVHTree cbvh;
+    cbvh.build(std::vector<ptr_prim_t>(vpPrims.begin(), vpPrims.begin() + 1));
+    checkIntersections(cbvh, std::vector<ptr_prim_t>(vpPrims.begin(), vpPrims.begin() + 1), rng);
+    cbvh.build(std::vector<ptr_prim_t>());
+    EXPECT_FALSE(cbvh.intersect(lvalue_cast(Ray(Vec3f::all(0), Vec3f(0, 0, 1)))));
+}
+
+TEST_F(CTestBVHTree, wide_bvh) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> u(-10, 10);
+
+    std::vector<ptr_prim_t> vpPrims;
+    for (int i = 0; i < 1000; i++) {
+        Vec3f a(u(rng), u(rng), u(rng));
+        vpPrims.push_back(std::make_shared<CPrimTriangle>(shader, a, a + 0.1f * Vec3f(u(rng), u(rng), u(rng)), a + 0.1f * Vec3f(u(rng), u(rng), u(rng))));
+    }
+    for (int i = 0; i < 1000; i++)
+        vpPrims.push_back(std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 0.2f));
+    CBVHTree bvh;
+    bvh.build(vpPrims, 30, 2);
+    CBVH4Tree bvh4;
+    bvh4.build(vpPrims, 30, 2);
+    CBVH8Tree bvh8;
+    bvh8.build(vpPrims, 30, 2);
+    EXPECT_LT(bvh4.getNodes().size(), bvh.getNodes().size() / 2);
+    EXPECT_LT(bvh8.getNodes().size(), bvh4.getNodes().size());
+    checkIntersections(bvh4, vpPrims, rng);
+    checkIntersections(bvh8, vpPrims, rng);
+
+    // Rays with zero direction components
+    for (int i = 0; i < 100; i++) {
+        Vec3f org(u(rng), u(rng), -20);
+        Vec3f dir = i % 2 ? Vec3f(0, 0, 1) : normalize(Vec3f(0, u(rng), 20));
+        Ray gt(org, dir);
+        for (const auto& pPrim : vpPrims) pPrim->intersect(gt);
+        for (const IAccelStructure* pAccel : std::initializer_list<const IAccelStructure*>{ &bvh4, &bvh8 }) {
+            Ray ray(org, dir);
+            ASSERT_EQ(pAccel->intersect(ray), gt.hit != nullptr);
+            EXPECT_EQ(ray.hit, gt.hit);
+            EXPECT_EQ(pAccel->if_intersect(Ray(org, dir)), gt.hit != nullptr);
+        }
+    }
+
+    // Degenerate trees
+    bvh8.build(std::vector<ptr_prim_t>(vpPrims.begin(), vpPrims.begin() + 1));
+    checkIntersections(bvh8, std::vector<ptr_prim_t>(vpPrims.begin(), vpPrims.begin() + 1), rng);
+    bvh8.build(std::vector<ptr_prim_t>());
+    EXPECT_FALSE(bvh8.intersect(lvalue_cast(Ray(Vec3f::all(0), Vec3f(0, 0, 1)))));
+}
+
+TEST_F(CTestBVHTree, bsp_mailbox) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(-10, 10);
+
+    // Large spheres straddle many leaves of the BSP tree
+    std::vector<ptr_prim_t> vpPrims;
+    for (int i = 0; i < 100; i++)
+        vpPrims.push_back(std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 3.0f));
+
+    CBSPTree bsp;
+    bsp.build(vpPrims, 20, 2);
+    EXPECT_EQ(bsp.getNumPrimTests(), 0);
+    checkIntersections(bsp, vpPrims, rng);
+#ifdef DEBUG_PRINT_INFO
+    EXPECT_GT(bsp.getNumPrimTests(), 0);
+    EXPECT_GT(bsp.getNumSkippedTests(), 0);
+
+    // Every primitive is tested at most once per ray
+    bsp.resetCounters();
+    Ray ray(Vec3f(-20, 0, 0), Vec3f(1, 0, 0));
+    ray.t = 40;
+    bsp.intersect(ray);
+    EXPECT_LE(bsp.getNumPrimTests(), vpPrims.size());
+#endif
+}
+
+TEST_F(CTestBVHTree, bvh_insert_remove) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> u(-10, 10);
+    auto randomSphere = [&]() { return std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 0.5f); };
+
+    std::vector<ptr_prim_t> vpPrims;
+    for (int i = 0; i < 100; i++) vpPrims.push_back(randomSphere());
+
+    CBVHTree bvh;
+    bvh.build(vpPrims);
+
+    // Insert new primitives into the built tree
+    for (int i = 0; i < 100; i++) {
+        vpPrims.push_back(randomSphere());
+        ASSERT_TRUE(bvh.insert(vpPrims.back()));
+    }
+    checkIntersections(bvh, vpPrims, rng);
+
+    // Remove every third primitive
+    for (size_t i = 0; i < vpPrims.size(); i += 3)
+        ASSERT_TRUE(bvh.remove(vpPrims[i]));
+    std::vector<ptr_prim_t> vpRemaining;
+    for (size_t i = 0; i < vpPrims.size(); i++)
+        if (i % 3) vpRemaining.push_back(vpPrims[i]);
+    EXPECT_FALSE(bvh.remove(vpPrims[0]));
+    checkIntersections(bvh, vpRemaining, rng);
+
+    // Remove all the primitives and start from the empty tree
+    for (auto& pPrim : vpRemaining)
+        ASSERT_TRUE(bvh.remove(pPrim));
+    EXPECT_FALSE(bvh.intersect(lvalue_cast(Ray(Vec3f::all(0), Vec3f(0, 0, 1)))));
+    for (int i = 0; i < 50; i++)
+        ASSERT_TRUE(bvh.insert(vpRemaining[i]));
+    vpRemaining.resize(50);
+    checkIntersections(bvh, vpRemaining, rng);
+}
+
+TEST_F(CTestBVHTree, scene_edit) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    auto pAccelStructures = { ptr_accelstructure_t(std::make_shared<CBSPTree>()), ptr_accelstructure_t(std::make_shared<CBVHTree>()) };
+    for (const auto& pAccelStructure : pAccelStructures) {
+        CScene scene;
+        scene.setAccelStructure(pAccelStructure);
+        scene.add(CSolidSphere(shader, Vec3f(5, 0, 10), 1.0f));
+        scene.add(CSolidSphere(shader, Vec3f(-5, 0, 20), 1.0f));
+        scene.buildAccelStructure();
+
+        // Primitive added after the build, inside the scene bounds
+        auto pSphere = std::make_shared<CPrimSphere>(shader, Vec3f(0, 0, 15), 1.0f);
+        scene.add(pSphere);
+        Ray ray(Vec3f::all(0), Vec3f(0, 0, 1));
+        ray.t = 12;
+        EXPECT_FALSE(scene.if_intersect(ray));
+        ray.t = 17;
+        EXPECT_TRUE(scene.if_intersect(ray));
+
+        // Removed primitive
+        scene.remove(pSphere);
+        EXPECT_FALSE(scene.if_intersect(ray));
+
+        // Added and removed solid: the solid lies outside of the BSP tree bounds, thus the tree is re-built by the edits at once
+        auto solid = CSolidSphere(shader, Vec3f(0, 0, 5), 1.0f);
+        scene.add(solid);
+        EXPECT_TRUE(scene.if_intersect(ray));
+        Ray closest(Vec3f::all(0), Vec3f(0, 0, 1));
+        EXPECT_TRUE(scene.intersect(closest));
+        EXPECT_NEAR(closest.t, 4, 1e-3);
+        scene.remove(solid);
+        EXPECT_FALSE(scene.if_intersect(ray));
+
+        // Cleared scene
+        scene.clear();
+        ray.t = Infty;
+        EXPECT_FALSE(scene.if_intersect(ray));
+    }
+}
+
+TEST_F(CTestBVHTree, scene_unbounded) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    auto pAccelStructures = { ptr_accelstructure_t(std::make_shared<CBSPTree>()), ptr_accelstructure_t(std::make_shared<CBVHTree>()) };
+    for (const auto& pAccelStructure : pAccelStructures) {
+        CScene scene;
+        scene.setAccelStructure(pAccelStructure);
+        auto pPlane = std::make_shared<CPrimPlane>(shader, Vec3f(0, -1, 0), Vec3f(0, 1, 0));
+        scene.add(pPlane);
+        scene.add(CSolidSphere(shader, Vec3f(0, 0, 10), 1.0f));
+        scene.buildAccelStructure();
+
+        // The sphere in front of the plane
+        Ray ray(Vec3f::all(0), Vec3f(0, 0, 1));
+        EXPECT_TRUE(scene.intersect(ray));
+        EXPECT_NEAR(ray.t, 9, 1e-4);
+
+        // The plane far outside of the bounded geometry
+        Ray rayDown(Vec3f(100, 0, 0), normalize(Vec3f(1, -1, 0)));
+        EXPECT_TRUE(scene.intersect(rayDown));
+        EXPECT_EQ(rayDown.hit, pPlane);
+        EXPECT_NEAR(rayDown.t, sqrtf(2), 1e-4);
+        EXPECT_TRUE(scene.if_intersect(Ray(Vec3f(100, 0, 0), Vec3f(0, -1, 0))));
+
+        // Removed plane
+        scene.remove(pPlane);
+        EXPECT_FALSE(scene.if_intersect(Ray(Vec3f(100, 0, 0), Vec3f(0, -1, 0))));
+    }
+}
+
+TEST_F(CTestBVHTree, ray_batch) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(-10, 10);
+
+    CScene scene;
+    for (int i = 0; i < 300; i++)
+        scene.add(std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 0.5f));
+    scene.add(std::make_shared<CPrimPlane>(shader, Vec3f(0, -12, 0), Vec3f(0, 1, 0)));
+
+    // A lidar-like sweep from the center, with a few rays parallel to the axes and a partial last packet
+    RayBatch rays;
+    for (int i = 0; i < 1003; i++) {
+        float phi = 2 * Pif * i / 1003;
+        float theta = 0.25f * Pif * sinf(7 * phi);
+        Vec3f dir = i % 100 == 0 ? Vec3f(0, 0, 1) : Vec3f(cosf(phi) * cosf(theta), sinf(theta), sinf(phi) * cosf(theta));
+        rays.push_back(Vec3f(0.1f, 0.2f, 0.3f), dir, i % 3 ? Infty : 5.0f);
+    }
+
+    auto pAccelStructures = { ptr_accelstructure_t(std::make_shared<CBVHTree>()), ptr_accelstructure_t(std::make_shared<CBSPTree>()) };
+    for (const auto& pAccelStructure : pAccelStructures) {
+        scene.setAccelStructure(pAccelStructure);
+        scene.buildAccelStructure(20, 2);
+
+        std::vector<RayHit> vHits;
+        std::vector<byte> vOccluded;
+        scene.intersect(rays, vHits);
+        scene.if_intersect(rays, vOccluded);
+        ASSERT_EQ(vHits.size(), rays.size());
+        ASSERT_EQ(vOccluded.size(), rays.size());
+        size_t nHits = 0;
+        for (size_t i = 0; i < rays.size(); i++) {
+            Ray ray = rays.getRay(i);
+            bool hit = scene.intersect(ray);
+            EXPECT_EQ(vHits[i].hit, ray.hit);
+            EXPECT_EQ(vOccluded[i], hit ? 1 : 0);
+            if (hit) {
+                EXPECT_DOUBLE_EQ(vHits[i].t, ray.t);
+                nHits++;
+            }
+            else EXPECT_EQ(vHits[i].t, std::numeric_limits<double>::infinity());
+        }
+        EXPECT_GT(nHits, 0);
+        EXPECT_LT(nHits, rays.size());
+    }
+}
+
+TEST_F(CTestBVHTree, bvh_cache) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> u(-10, 10);
+
+    std::vector<ptr_prim_t> vpPrims;
+    for (int i = 0; i < 200; i++)
+        vpPrims.push_back(std::make_shared<CPrimSphere>(shader, Vec3f(u(rng), u(rng), u(rng)), 0.5f));
+
+    const std::string fileName = (std::filesystem::temp_directory_path() / "openrt_test_bvh.bin").string();
+    CBVHTree bvh;
+    bvh.build(vpPrims);
+    ASSERT_TRUE(bvh.save(fileName, vpPrims, 42));
+
+    CBVHTree cached;
+    EXPECT_FALSE(cached.load(fileName, vpPrims, 43));             // hash mismatch
+    EXPECT_FALSE(CBVHTree(BVHBuilder::LBVH).load(fileName, vpPrims, 42));  // builder mismatch
+    ASSERT_TRUE(cached.load(fileName, vpPrims, 42));
+    ASSERT_EQ(cached.getNodes().size(), bvh.getNodes().size());
+    for (size_t i = 0; i < bvh.getPrims().size(); i++)
+        EXPECT_EQ(cached.getPrims()[i], bvh.getPrims()[i]);
+    EXPECT_FLOAT_EQ(cached.getSAHCost(), bvh.getSAHCost());
+    checkIntersections(cached, vpPrims, rng);
+
+    // corrupted child index of the root node: the file has the valid size, but the tree is rejected
+    {
+        const size_t nodeSize = 6 * sizeof(float) + 3 * sizeof(int) + 2 * sizeof(dword);
+        const size_t headerSize = std::filesystem::file_size(fileName) - bvh.getNodes().size() * nodeSize - bvh.getPrims().size() * sizeof(dword);
+        std::fstream file(fileName, std::ios::in | std::ios::out | std::ios::binary);
+        const int left = static_cast<int>(bvh.getNodes().size());
+        file.seekp(headerSize + 6 * sizeof(float) + sizeof(int));
+        file.write(reinterpret_cast<const char*>(&left), sizeof(left));
+    }
+    EXPECT_FALSE(cached.load(fileName, vpPrims, 42));
+
+    // a leaf, referencing a missing primitive, is rejected, since the traversal would dereference it
+    ASSERT_TRUE(bvh.save(fileName, vpPrims, 42));
+    {
+        const dword noPrim = std::numeric_limits<dword>::max();
+        std::fstream file(fileName, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(std::filesystem::file_size(fileName) - sizeof(dword));
+        file.write(reinterpret_cast<const char*>(&noPrim), sizeof(noPrim));
+    }
+    EXPECT_FALSE(cached.load(fileName, vpPrims, 42));
+
+    // the nodes, freed by the removals, are re-used by the insertions after loading
+    for (int i = 0; i < 20; i++) ASSERT_TRUE(bvh.remove(vpPrims[i]));
+    ASSERT_TRUE(bvh.save(fileName, vpPrims, 42));
+    ASSERT_TRUE(cached.load(fileName, vpPrims, 42));
+    ASSERT_EQ(cached.getNodes().size(), bvh.getNodes().size());
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(bvh.insert(vpPrims[i]));
+        ASSERT_TRUE(cached.insert(vpPrims[i]));
+    }
+    EXPECT_EQ(cached.getNodes().size(), bvh.getNodes().size());
+    checkIntersections(cached, vpPrims, rng);
+
+    std::filesystem::remove(fileName);
+    EXPECT_FALSE(cached.load(fileName, vpPrims, 42));             // no file
+}
+
+TEST_F(CTestBVHTree, sbvh_cache) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> u(-10, 10);
+
+    // two meshes with the same bounding boxes of the triangles, but with mirrored triangles inside of them
+    std::vector<ptr_prim_t> vpPrims, vpMirrored;
+    for (int i = 0; i < 200; i++) {
+        const Vec3f a(u(rng), u(rng), u(rng));
+        const Vec3f b = a + Vec3f(3, 0, 0.2f);
+        const Vec3f c = a + Vec3f(0, 3, 0.1f);
+        vpPrims.push_back(std::make_shared<CPrimTriangle>(shader, a, b, c));
+        auto mirror = [&](const Vec3f& v) { return Vec3f(2 * a[0] + 3 - v[0], v[1], v[2]); };
+        vpMirrored.push_back(std::make_shared<CPrimTriangle>(shader, mirror(a), mirror(b), mirror(c)));
+    }
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "openrt_test_sbvh_cache";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    for (const auto& vp : { vpPrims, vpMirrored }) {
+        CScene scene;
+        scene.setAccelStructure(std::make_shared<CBVHTree>(BVHBuilder::SBVH));
+        scene.setAccelStructureCachePath(path.string());
+        for (const auto& pPrim : vp) scene.add(pPrim);
+        scene.buildAccelStructure();
+
+        // the mirrored mesh does not load the tree of the first one
+        std::uniform_real_distribution<float> v(-1, 1);
+        for (int i = 0; i < 500; i++) {
+            Vec3f org(20 * v(rng), 20 * v(rng), 20 * v(rng));
+            Vec3f dir = normalize(Vec3f(v(rng), v(rng), v(rng)));
+            Ray gt(org, dir);
+            for (const auto& pPrim : vp) pPrim->intersect(gt);
+            Ray ray(org, dir);
+            ASSERT_EQ(scene.intersect(ray), gt.hit != nullptr);
+            if (gt.hit) EXPECT_EQ(ray.hit, gt.hit);
+        }
+    }
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(path), std::filesystem::directory_iterator()), 2);
+    std::filesystem::remove_all(path);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "openrt.h"
+
+class CTestBVHTree : public ::testing::Test {
+public:
+    CTestBVHTree(void) = default;
+    ~CTestBVHTree(void) = default;
+};
@@ -1,5 +1,6 @@
 #include "TestBoundingBox.h"
 #include "core/BoundingBox.h"
+#include "core/Ray.h"
 
 using namespace rt;
 
@@ -26,3 +27,49 @@ TEST_F(CTestBoundingBox, solid_sphere) {
     EXPECT_NEAR(boxCenter[1], 0, Epsilon);
     EXPECT_NEAR(boxCenter[2], 0, Epsilon);
 }
+
+TEST_F(CTestBoundingBox, clip) {
+    auto box = rt::CBoundingBox(Vec3f(-1, -1, -1), Vec3f(1, 1, 1));
+    auto clip = [&](const Vec3f& org, const Vec3f& dir) {
+        double t0 = 0;
+        double t1 = Infty;
+        box.clip(Ray(org, dir), t0, t1);
+        // the precomputed ray data gives the same result
+        double d0 = 0;
+        double d1 = Infty;
+        box.clip(RayData(Ray(org, dir)), d0, d1);
+        EXPECT_EQ(t0, d0);
+        EXPECT_EQ(t1, d1);
+        return std::make_pair(t0, t1);
+    };
+
+    // oblique ray
+    auto [t0, t1] = clip(Vec3f(-3, -2, -3), normalize(Vec3f(1, 1, 1)));
+    EXPECT_NEAR(t0, 2 * sqrtf(3), 1e-5);
+    EXPECT_NEAR(t1, 3 * sqrtf(3), 1e-5);
+    std::tie(t0, t1) = clip(Vec3f(-3, 0, 0), normalize(Vec3f(1, 1, 0)));
+    EXPECT_LT(t1, t0);
+
+    // rays parallel to the slabs: inside, outside, on the border and with negative zero components
+    std::tie(t0, t1) = clip(Vec3f(-5, 0.5f, 0.5f), Vec3f(1, 0, 0));
+    EXPECT_NEAR(t0, 4, Epsilon);
+    EXPECT_NEAR(t1, 6, Epsilon);
+    std::tie(t0, t1) = clip(Vec3f(-5, 2, 0.5f), Vec3f(1, 0, 0));
+    EXPECT_LT(t1, t0);
+    std::tie(t0, t1) = clip(Vec3f(-5, 1, -1), Vec3f(1, 0, 0));
+    EXPECT_FALSE(std::isnan(t0) || std::isnan(t1));
+    std::tie(t0, t1) = clip(Vec3f(5, 0, 0), Vec3f(-1, -0.0f, -0.0f));
+    EXPECT_NEAR(t0, 4, Epsilon);
+    EXPECT_NEAR(t1, 6, Epsilon);
+    std::tie(t0, t1) = clip(Vec3f(5, -1, 2), Vec3f(-1, -0.0f, -0.0f));
+    EXPECT_LT(t1, t0);
+
+    // empty boxes are never hit
+    for (const CBoundingBox& empty : { CBoundingBox(), CBoundingBox(Vec3f(1, -1, -1), Vec3f(-1, 1, 1)) }) {
+        box = empty;
+        for (const Vec3f& dir : { Vec3f(1, 0, 0), Vec3f(-1, 0, 0), normalize(Vec3f(1, -1, 1)) }) {
+            std::tie(t0, t1) = clip(Vec3f(0, 0, 0), dir);
+            EXPECT_LT(t1, t0);
+        }
+    }
+}
@@ -0,0 +1,340 @@
+#include "TestLight.h"
+#include "core/Ray.h"
+#include <thread>
+
+using namespace rt;
+
+TEST_F(CTestLight, light_sample) {
+    std::vector<ptr_light_t> vpLights;
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f(10, 5, 1), Vec3f(1, 6, 2)));
+    vpLights.push_back(std::make_shared<CLightSpot>(Vec3f(10, 5, 1), Vec3f(1, 6, 2), Vec3f(0, -1, 0), 20.0f, 40.0f));
+    vpLights.push_back(std::make_shared<CLightArea>(Vec3f::all(5), Vec3f(-2, 8, -2), Vec3f(2, 8, -2), Vec3f(2, 8, 2), Vec3f(-2, 8, 2)));
+
+    // the intensity is the ratio of the radiance and the pdf
+    const Vec3f point(0.5f, 0, -0.5f);
+    for (auto& pLight : vpLights)
+        for (float u = 0.05f; u < 1; u += 0.1f) {
+            const Vec2f sample(u, 1 - u);
+            auto res = pLight->sample(point, Vec3f(0, 1, 0), sample);
+            Ray ray(point);
+            auto intensity = pLight->illuminate(ray, sample);
+            ASSERT_EQ(res.has_value(), intensity.has_value());
+            if (!res) continue;
+            EXPECT_GT(res->pdf, 0);
+            EXPECT_LT(norm(ray.dir - res->direction), Epsilon);
+            EXPECT_FLOAT_EQ(static_cast<float>(ray.t), static_cast<float>(res->distance));
+            EXPECT_LT(norm(intensity.value() - (1.0f / res->pdf) * res->radiance), 1e-4f);
+        }
+
+    // the pdf of the area light is the density in solid angle: its reciprocal integrates to the solid angle of the square
+    const float a = 4, h = 8;
+    const float solidAngle = 4 * asinf(a * a / (a * a + 4 * h * h));
+    float sum = 0;
+    const size_t nSamples = 64 * 64;
+    for (size_t s = 0; s < nSamples; s++) {
+        auto res = vpLights[2]->sample(Vec3f::all(0), Vec3f(0, 1, 0), CSampler::stratifiedSample(s, nSamples));
+        ASSERT_TRUE(res.has_value());
+        sum += 1 / res->pdf;
+    }
+    EXPECT_NEAR(sum / nSamples, solidAngle, 1e-3f * solidAngle);
+}
+
+TEST_F(CTestLight, stratified_sample) {
+    // every stratum gets exactly one sample
+    const size_t n = 5;
+    std::vector<int> vCounts(n * n, 0);
+    for (size_t s = 0; s < n * n; s++) {
+        Vec2f sample = CSampler::stratifiedSample(s, n * n);
+        ASSERT_GE(sample[0], 0);
+        ASSERT_LT(sample[0], 1);
+        ASSERT_GE(sample[1], 0);
+        ASSERT_LT(sample[1], 1);
+        vCounts[static_cast<size_t>(sample[1] * n) * n + static_cast<size_t>(sample[0] * n)]++;
+    }
+    for (int count : vCounts) EXPECT_EQ(count, 1);
+}
+
+TEST_F(CTestLight, thread_safety) {
+    // several threads sample the same area light; the same samples must give the same results
+    auto pArea = std::make_shared<CLightArea>(Vec3f::all(5), Vec3f(-2, 8, -2), Vec3f(2, 8, -2), Vec3f(2, 8, 2), Vec3f(-2, 8, 2));
+    const size_t nSamples = 1000;
+    auto sampleAll = [&](std::vector<Vec3f>& vRes) {
+        vRes.resize(nSamples);
+        for (size_t s = 0; s < nSamples; s++) {
+            Ray ray(Vec3f(0.1f * (s % 10), 0, 0));
+            auto res = pArea->illuminate(ray, Vec2f(static_cast<float>(s) / nSamples, static_cast<float>((s * 7) % nSamples) / nSamples));
+            vRes[s] = res ? res.value() : Vec3f::all(-1);
+        }
+    };
+    std::vector<Vec3f> vReference;
+    sampleAll(vReference);
+
+    const size_t nThreads = 4;
+    std::vector<std::vector<Vec3f>> vvRes(nThreads);
+    std::vector<std::thread> vThreads;
+    for (size_t t = 0; t < nThreads; t++)
+        vThreads.emplace_back(sampleAll, std::ref(vvRes[t]));
+    for (auto& thread : vThreads) thread.join();
+    for (const auto& vRes : vvRes)
+        for (size_t s = 0; s < nSamples; s++)
+            EXPECT_EQ(vRes[s], vReference[s]);
+}
+
+TEST_F(CTestLight, adaptive_samples) {
+    auto pArea = std::make_shared<CLightArea>(Vec3f::all(5), Vec3f(-2, 8, -2), Vec3f(2, 8, -2), Vec3f(2, 8, 2), Vec3f(-2, 8, 2), std::make_shared<CSamplerStratified>(6));
+    ASSERT_EQ(pArea->getNumSamples(), 36);
+
+    // the near light is sampled fully, the distant one - with fewer samples, keeping the stratification
+    EXPECT_EQ(pArea->estimateNumSamples(Vec3f::all(0)), 36);
+    const size_t nFar = pArea->estimateNumSamples(Vec3f(0, -100, 0));
+    EXPECT_LT(nFar, 36);
+    EXPECT_GE(nFar, 1);
+    const size_t k = static_cast<size_t>(sqrtf(static_cast<float>(nFar)) + 0.5f);
+    EXPECT_EQ(k * k, nFar);
+    EXPECT_EQ(pArea->estimateNumSamples(Vec3f(0, 10, 0)), 1);		// behind the light
+    CLightOmni omni(Vec3f::all(1), Vec3f(0, 8, 0));
+    EXPECT_EQ(omni.estimateNumSamples(Vec3f(0, -100, 0)), 1);
+
+    // the occluder covers the points with x < 0 and casts the penumbra around x = 0
+    CScene scene;
+    scene.add(pArea);
+    scene.add(std::make_shared<CPrimDisc>(std::make_shared<CShaderFlat>(RGB(255, 255, 255)), Vec3f(-100, 4, 0), Vec3f(0, 1, 0), 100.0f));
+    scene.buildAccelStructure();
+    const Vec3f normal(0, 1, 0);
+    auto reflectance = [&](const Vec3f& dir, const Vec3f& radiance) { return MAX(dir.dot(normal), 0.0f) * radiance; };
+    auto illuminate = [&](const Vec3f& point) {
+        const size_t nTrials = 200;
+        float res = 0;
+        for (size_t t = 0; t < nTrials; t++) {
+            Ray ray(point + Vec3f(0, 1, 0), Vec3f(0, -1, 0));
+            ray.t = 1;
+            Ray I(point);
+            res += scene.illuminate(ray, I, normal, reflectance)[0] / nTrials;
+        }
+        return res;
+    };
+
+    const Vec3f lit(3, 0, 0), shadowed(-3, 0, 0), penumbra(0, 0, 0);
+    const float refLit = illuminate(lit), refPenumbra = illuminate(penumbra);
+    EXPECT_GT(refLit, 0);
+    EXPECT_FLOAT_EQ(illuminate(shadowed), 0);
+    EXPECT_GT(refPenumbra, 0);
+    EXPECT_LT(refPenumbra, refLit);
+
+    scene.setAdaptiveLightSampling(4);
+    EXPECT_NEAR(illuminate(lit), refLit, 0.03f * refLit);
+    EXPECT_FLOAT_EQ(illuminate(shadowed), 0);
+    EXPECT_NEAR(illuminate(penumbra), refPenumbra, 0.05f * refLit);
+}
+
+TEST_F(CTestLight, occluder_cache) {
+    auto pShader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    auto pLight = std::make_shared<CLightOmni>(Vec3f::all(1), Vec3f(0, 8, 0));
+    auto pOccluder = std::make_shared<CPrimDisc>(pShader, Vec3f(0, 4, 0), Vec3f(0, 1, 0), 2.0f);
+    CScene scene;
+    scene.add(pLight);
+    scene.add(pOccluder);
+    scene.buildAccelStructure();
+
+    // the shadow rays from the grid of points, partly occluded by the occluder
+    auto test = [&](const CScene& scene) {
+        std::vector<bool> vRes;
+        for (float x = -6; x <= 6; x += 0.5f)
+            for (float z = -6; z <= 6; z += 0.5f) {
+                Ray I(Vec3f(x, 0, z));
+                pLight->illuminate(I);
+                vRes.push_back(scene.if_intersect(I, *pLight));
+            }
+        return vRes;
+    };
+    const std::vector<bool> vReference = test(scene);
+    EXPECT_EQ(scene.getNumOccluderTests(), 0);
+
+    // the cache does not change the results and saves the traversals of the occluded rays
+    scene.setOccluderCache(true);
+    EXPECT_EQ(test(scene), vReference);
+    const size_t nOccluded = std::count(vReference.begin(), vReference.end(), true);
+    EXPECT_GT(nOccluded, 0);
+    EXPECT_EQ(scene.getNumOccluderTests(), vReference.size());
+    EXPECT_EQ(scene.getNumOccluderCacheHits(), nOccluded - 1);
+
+    // every thread has its own cache and counters, which are summed up
+    scene.resetOccluderCacheCounters();
+    EXPECT_EQ(scene.getNumOccluderTests(), 0);
+    std::vector<std::thread> vThreads;
+    for (int t = 0; t < 4; t++)
+        vThreads.emplace_back([&]() { EXPECT_EQ(test(scene), vReference); });
+    for (auto& thread : vThreads) thread.join();
+    EXPECT_EQ(scene.getNumOccluderTests(), 4 * vReference.size());
+    EXPECT_EQ(scene.getNumOccluderCacheHits(), 4 * (nOccluded - 1));
+
+    // the removed occluder is not cached anymore
+    scene.resetOccluderCacheCounters();
+    EXPECT_EQ(scene.getNumOccluderCacheHits(), 0);
+    scene.remove(pOccluder);
+    for (bool occluded : test(scene)) EXPECT_FALSE(occluded);
+    EXPECT_EQ(scene.getNumOccluderCacheHits(), 0);
+
+    // the plates with a hole: the ray hits the face of the plate, which covers the hole, thus only the whole CSG primitive may be cached as the occluder
+    auto plate = [&]() { return CSolidBox(pShader, Vec3f(0, 4, 0), 4, 0.2f, 4); };
+    auto hole = [&]() { return CSolid(std::make_shared<CPrimSphere>(pShader, Vec3f(0, 4, 0), 1.0f)); };
+    std::vector<ptr_prim_t> vpCSGOccluders;
+    vpCSGOccluders.push_back(std::make_shared<CPrimBoolean>(plate(), hole(), BoolOp::Substraction));
+    vpCSGOccluders.push_back(std::make_shared<CPrimCSG>(CPrimCSG::operation(BoolOp::Substraction, { CPrimCSG::solid(plate()), CPrimCSG::solid(hole()) })));
+    for (auto& pCSGOccluder : vpCSGOccluders) {
+        CScene csgScene;
+        csgScene.add(pLight);
+        csgScene.add(pCSGOccluder);
+        csgScene.buildAccelStructure();
+        const std::vector<bool> vCSGReference = test(csgScene);
+        EXPECT_FALSE(vCSGReference[vCSGReference.size() / 2]);        // the ray from the origin passes through the hole
+        EXPECT_GT(std::count(vCSGReference.begin(), vCSGReference.end(), true), 0);
+
+        csgScene.setOccluderCache(true);
+        EXPECT_EQ(test(csgScene), vCSGReference);
+    }
+}
+
+TEST_F(CTestLight, shadow_map) {
+    CScene scene;
+    scene.add(std::make_shared<CPrimDisc>(std::make_shared<CShaderFlat>(RGB(255, 255, 255)), Vec3f(0, 4, 0), Vec3f(0, 1, 0), 2.0f));
+    scene.add(std::make_shared<CPrimSphere>(std::make_shared<CShaderFlat>(RGB(255, 255, 255)), Vec3f(5, 1, 3), 1.0f));
+    scene.buildAccelStructure();
+
+    std::vector<ptr_light_t> vpLights;
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f::all(1), Vec3f(0, 8, 0)));
+    vpLights.push_back(std::make_shared<CLightSpot>(Vec3f::all(1), Vec3f(0, 8, 0), Vec3f(0, -1, 0), 80.0f, 10.0f));
+    vpLights.push_back(std::make_shared<CLightSpot>(Vec3f::all(1), Vec3f(0, 8, 0), Vec3f(0, -1, 0), 170.0f));
+    for (auto& pLight : vpLights) {
+        // the shadow map visibility agrees with the ray-traced one, except the texels around the shadow edges
+        std::vector<std::pair<Ray, float>> vReference;
+        for (float x = -8; x <= 8; x += 0.25f)
+            for (float z = -8; z <= 8; z += 0.25f) {
+                Ray I(Vec3f(x, 0, z));
+                if (!pLight->illuminate(I)) continue;
+                vReference.emplace_back(I, scene.getVisibility(I, *pLight));
+            }
+        ASSERT_FALSE(vReference.empty());
+        EXPECT_TRUE(std::any_of(vReference.begin(), vReference.end(), [](const auto& reference) { return reference.second == 0; }));
+        EXPECT_FALSE(pLight->getShadowMapVisibility(Vec3f::all(0)).has_value());
+
+        pLight->turnShadowMapOn(256);
+        pLight->buildShadowMap(scene);
+        size_t nDisagree = 0;
+        for (auto& [I, visibility] : vReference) {
+            const float v = scene.getVisibility(I, *pLight);
+            EXPECT_GE(v, 0);
+            EXPECT_LE(v, 1);
+            if (fabs(v - visibility) > 0.5f) nDisagree++;
+        }
+        EXPECT_LT(nDisagree, vReference.size() / 50);
+
+        // the shadow map is released when the fast mode is turned off
+        pLight->turnShadowMapOff();
+        pLight->buildShadowMap(scene);
+        EXPECT_FALSE(pLight->getShadowMapVisibility(Vec3f::all(0)).has_value());
+    }
+
+    // the area light keeps tracing the shadow rays
+    CLightArea area(Vec3f::all(5), Vec3f(-2, 8, -2), Vec3f(2, 8, -2), Vec3f(2, 8, 2), Vec3f(-2, 8, 2));
+    area.turnShadowMapOn(256);
+    area.buildShadowMap(scene);
+    EXPECT_FALSE(area.getShadowMapVisibility(Vec3f::all(0)).has_value());
+}
+
+TEST_F(CTestLight, light_arrays) {
+    std::vector<ptr_light_t> vpLights;
+    vpLights.push_back(std::make_shared<CLightSpot>(Vec3f(10, 5, 1), Vec3f(1, 6, 2), Vec3f(0, -1, 0), 60.0f, 40.0f));
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f(10, 5, 1), Vec3f(1, 6, 2)));
+    vpLights.push_back(std::make_shared<CLightArea>(Vec3f::all(5), Vec3f(-2, 8, -2), Vec3f(2, 8, -2), Vec3f(2, 8, 2), Vec3f(-2, 8, 2)));
+    vpLights.push_back(std::make_shared<CLightSpotTarget>(Vec3f::all(20), Vec3f(-3, 5, 0), Vec3f(-3, 0, 0), 30.0f, 30.0f));
+    auto pRanged = std::make_shared<CLightOmni>(Vec3f::all(8), Vec3f(0, 3, -4));
+    pRanged->setRange(5);
+    vpLights.push_back(pRanged);
+
+    // the point light sources are grouped by type, the area light is not
+    CLightArrays arrays;
+    arrays.build(vpLights);
+    ASSERT_EQ(arrays.size(), 4);
+    EXPECT_EQ(&arrays.getLight(0), vpLights[1].get());
+    EXPECT_EQ(&arrays.getLight(1), vpLights[4].get());
+    EXPECT_EQ(&arrays.getLight(2), vpLights[0].get());
+    EXPECT_EQ(&arrays.getLight(3), vpLights[3].get());
+    ASSERT_EQ(arrays.getOtherLights().size(), 1);
+    EXPECT_EQ(arrays.getOtherLights()[0].first, vpLights[2].get());
+
+    // the SoA evaluation agrees with the sampling of every light source
+    LightArraySamples samples;
+    for (float x = -6; x <= 6; x += 0.5f)
+        for (float z = -6; z <= 6; z += 0.5f) {
+            const Vec3f point(x, 0, z);
+            arrays.illuminate(point, samples);
+            for (size_t i = 0; i < arrays.size(); i++) {
+                const Vec3f radiance(samples.radiance[0][i], samples.radiance[1][i], samples.radiance[2][i]);
+                auto res = arrays.getLight(i).sample(point, Vec3f(0, 1, 0), Vec2f::all(0.5f));
+                if (!res) {
+                    EXPECT_EQ(radiance, Vec3f::all(0));
+                    continue;
+                }
+                EXPECT_LT(norm(radiance - res->radiance), 1e-4f);
+                EXPECT_LT(norm(Vec3f(samples.dir[0][i], samples.dir[1][i], samples.dir[2][i]) - res->direction), 1e-5f);
+                EXPECT_NEAR(samples.distance[i], res->distance, 1e-4f);
+            }
+        }
+
+    // the batched shadow rays give the same illumination, as the shadow rays of the light culling path
+    CScene scene;
+    scene.add(std::make_shared<CPrimDisc>(std::make_shared<CShaderFlat>(RGB(255, 255, 255)), Vec3f(0, 3, 0), Vec3f(0, 1, 0), 2.0f));
+    scene.buildAccelStructure();
+    for (size_t i = 0; i < vpLights.size(); i++)
+        if (i != 2) scene.add(vpLights[i]);
+    auto reflectance = [](const Vec3f& dir, const Vec3f& radiance) { return MAX(dir[1], 0.0f) * radiance; };
+    // the point light sources are delta lights: illuminateMIS() samples them only from the light sources
+    auto test = [&](bool mis) {
+        std::vector<Vec3f> vRes;
+        for (float x = -6; x <= 6; x += 0.5f)
+            for (float z = -6; z <= 6; z += 0.5f) {
+                const Ray ray(Vec3f(x, 1, z), Vec3f(0, -1, 0));
+                Ray I(Vec3f(x, 0, z));
+                if (mis) vRes.push_back(scene.illuminateMIS(I, Vec3f(0, 1, 0), CBRDFGlossy(Vec3f(0, 1, 0), Vec3f(0, -1, 0), 0.5f), reflectance));
+                else vRes.push_back(scene.illuminate(ray, I, Vec3f(0, 1, 0), reflectance));
+            }
+        return vRes;
+    };
+    for (bool mis : { false, true }) {
+        const std::vector<Vec3f> vRes = test(mis);
+        EXPECT_TRUE(std::any_of(vRes.begin(), vRes.end(), [](const Vec3f& L) { return L == Vec3f::all(0); }));
+        scene.setLightCulling(true);
+        const std::vector<Vec3f> vReference = test(mis);
+        scene.setLightCulling(false);
+        scene.setOccluderCache(true);
+        const std::vector<Vec3f> vCached = test(mis);
+        scene.setOccluderCache(false);
+        ASSERT_EQ(vRes.size(), vReference.size());
+        for (size_t i = 0; i < vRes.size(); i++) {
+            EXPECT_LT(norm(vRes[i] - vReference[i]), 1e-4f);
+            EXPECT_LT(norm(vCached[i] - vReference[i]), 1e-4f);
+        }
+    }
+
+    // the edited light sources are taken into account after the update of the light structures
+    pRanged->setOrigin(Vec3f(0, 3, 4));
+    scene.updateLightStructures();
+    const std::vector<Vec3f> vMoved = test(false);
+    scene.setLightCulling(true);
+    const std::vector<Vec3f> vMovedReference = test(false);
+    scene.setLightCulling(false);
+    for (size_t i = 0; i < vMoved.size(); i++)
+        EXPECT_LT(norm(vMoved[i] - vMovedReference[i]), 1e-4f);
+
+    // the light structures are built once, when the light sources are queried concurrently after adding a light
+    scene.add(std::make_shared<CLightOmni>(Vec3f::all(5), Vec3f(2, 6, 0)));
+    std::vector<std::vector<Vec3f>> vThreadRes(4);
+    std::vector<std::thread> vThreads;
+    for (auto& vRes : vThreadRes)
+        vThreads.emplace_back([&vRes, &test] { vRes = test(false); });
+    for (auto& thread : vThreads) thread.join();
+    const std::vector<Vec3f> vAdded = test(false);
+    for (const auto& vRes : vThreadRes)
+        EXPECT_EQ(vRes, vAdded);
+}
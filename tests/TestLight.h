@@ -0,0 +1,11 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "openrt.h"
+
+class CTestLight : public ::testing::Test {
+public:
+    CTestLight(void) = default;
+    ~CTestLight(void) = default;
+};
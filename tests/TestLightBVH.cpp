@@ -0,0 +1,108 @@
+#include "TestLightBVH.h"
+#include <random>
+
+using namespace rt;
+
+namespace {
+    // Creates many point lights of random power, scattered over the cube [-10; 10]^3
+    std::vector<ptr_light_t> createLights(size_t nLights, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> u(-10, 10);
+        std::uniform_real_distribution<float> intensity(1, 100);
+        std::vector<ptr_light_t> res;
+        for (size_t i = 0; i < nLights; i++)
+            res.push_back(std::make_shared<CLightOmni>(Vec3f::all(intensity(rng)), Vec3f(u(rng), u(rng), u(rng))));
+        return res;
+    }
+}
+
+TEST_F(CTestLightBVH, pdf) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(0, 1);
+    std::vector<ptr_light_t> vpLights = createLights(200, rng);
+    vpLights.push_back(std::make_shared<CLightSky>(Vec3f::all(0.2f)));
+    vpLights.push_back(std::make_shared<CLightArea>(Vec3f::all(5), Vec3f(-2, 12, -2), Vec3f(2, 12, -2), Vec3f(2, 12, 2), Vec3f(-2, 12, 2)));
+
+    CLightBVH bvh;
+    bvh.build(vpLights);
+    EXPECT_EQ(bvh.getNodes().size(), 2 * (vpLights.size() - 1) - 1);
+    ASSERT_EQ(bvh.getUnboundedLights().size(), 1);
+    EXPECT_EQ(bvh.getUnboundedLights().front(), 200);
+    EXPECT_EQ(bvh.pdf(Vec3f::all(0), Vec3f(0, 1, 0), 200), 0);
+
+    for (int i = 0; i < 20; i++) {
+        const Vec3f point(20 * u(rng) - 10, 20 * u(rng) - 10, 20 * u(rng) - 10);
+        const Vec3f normal = normalize(Vec3f(u(rng) - 0.5f, u(rng) - 0.5f, u(rng) - 0.5f));
+
+        // the probabilities of all the lights sum up to 1
+        float sum = 0;
+        for (size_t l = 0; l < vpLights.size(); l++) sum += bvh.pdf(point, normal, l);
+        EXPECT_NEAR(sum, 1.0f, 1e-4f);
+
+        // the probabilities of the sampled lights are consistent
+        for (int s = 0; s < 20; s++) {
+            auto light = bvh.sample(point, normal, u(rng));
+            ASSERT_TRUE(light.has_value());
+            EXPECT_GT(light->second, 0);
+            EXPECT_NEAR(light->second, bvh.pdf(point, normal, light->first), 1e-5f);
+        }
+    }
+}
+
+TEST_F(CTestLightBVH, importance) {
+    std::vector<ptr_light_t> vpLights;
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f::all(10), Vec3f(0, 1, 0)));                          // close
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f::all(10), Vec3f(0, 50, 0)));                         // far
+    vpLights.push_back(std::make_shared<CLightSpot>(Vec3f::all(1e3f), Vec3f(0, 2, 0), Vec3f(0, 1, 0), 30.0f));    // pointing away
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f::all(0), Vec3f(1, 1, 1)));                           // dark
+
+    CLightBVH bvh;
+    bvh.build(vpLights);
+    const Vec3f point = Vec3f::all(0);
+    const Vec3f normal(0, 1, 0);
+    EXPECT_GT(bvh.pdf(point, normal, 0), 10 * bvh.pdf(point, normal, 1));
+    EXPECT_EQ(bvh.pdf(point, normal, 2), 0);
+    EXPECT_EQ(bvh.pdf(point, normal, 3), 0);
+
+    // no light may illuminate the point from behind the spot light
+    CLightBVH spot;
+    spot.build({ vpLights[2] });
+    EXPECT_FALSE(spot.sample(Vec3f(0, -5, 0), normal, 0.5f).has_value());
+    EXPECT_TRUE(spot.sample(Vec3f(0, 10, 0), -normal, 0.5f).has_value());
+}
+
+TEST_F(CTestLightBVH, scene_light_sampling) {
+    std::mt19937 rng(7);
+    CScene scene;
+    for (auto& pLight : createLights(100, rng)) scene.add(pLight);
+    scene.add(std::make_shared<CLightSky>(Vec3f::all(0.2f)));
+
+    // the illumination of the point, assuming every light is visible
+    const Vec3f point(1, -11, 2);
+    const Vec3f normal(0, 1, 0);
+    auto illumination = [&](std::span<const std::pair<ILight*, float>> vLights) {
+        float res = 0;
+        for (auto& [pLight, weight] : vLights) {
+            auto pOmni = dynamic_cast<CLightOmni*>(pLight);
+            if (!pOmni) continue;
+            Vec3f dir = pOmni->getOrigin() - point;
+            res += weight * pOmni->getIntensity()[0] * normalize(dir).dot(normal) / static_cast<float>(dir.dot(dir));
+        }
+        return res;
+    };
+    const float gt = illumination(scene.getLights(point, normal));
+    EXPECT_EQ(scene.getLights(point, normal).size(), 101);
+
+    // the weighted illumination of the picked lights is an unbiased estimate
+    const size_t nLights = 4;
+    scene.setLightSampling(nLights);
+    const int nTrials = 20000;
+    float sum = 0;
+    for (int i = 0; i < nTrials; i++) {
+        auto vLights = scene.getLights(point, normal);
+        ASSERT_EQ(vLights.size(), nLights + 1);
+        EXPECT_EQ(vLights.front().second, 1.0f);
+        sum += illumination(vLights);
+    }
+    EXPECT_NEAR(sum / nTrials, gt, 0.02f * gt);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "openrt.h"
+
+class CTestLightBVH : public ::testing::Test {
+public:
+    CTestLightBVH(void) = default;
+    ~CTestLightBVH(void) = default;
+};
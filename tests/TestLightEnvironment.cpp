@@ -0,0 +1,98 @@
+#include "TestLightEnvironment.h"
+#include "core/Ray.h"
+#include <random>
+
+using namespace rt;
+
+namespace {
+    // Creates the environment map with the constant background and the small bright sun
+    ptr_texture_t createMap(int sunX, int sunY, float sun = 1000, float background = 0.01f)
+    {
+        Mat img(32, 64, CV_32FC3);
+        for (int y = 0; y < img.rows; y++)
+            for (int x = 0; x < img.cols; x++)
+                img.at<Vec3f>(y, x) = Vec3f::all(x == sunX && y == sunY ? sun : background);
+        return std::make_shared<CTexture>(img);
+    }
+}
+
+TEST_F(CTestLightEnvironment, mapping) {
+    // the zenith is the top row of the map and the center of the map looks along the +z axis
+    EXPECT_LT(norm(CLightEnvironment::getDirection(Vec2f(0.5f, 0)) - Vec3f(0, 1, 0)), Epsilon);
+    EXPECT_LT(norm(CLightEnvironment::getDirection(Vec2f(0.5f, 0.5f)) - Vec3f(0, 0, 1)), Epsilon);
+    EXPECT_LT(norm(CLightEnvironment::getDirection(Vec2f(0.5f, 1)) - Vec3f(0, -1, 0)), Epsilon);
+    for (float u = 0.05f; u < 1; u += 0.1f)
+        for (float v = 0.05f; v < 1; v += 0.1f) {
+            Vec3f dir = CLightEnvironment::getDirection(Vec2f(u, v));
+            EXPECT_NEAR(norm(dir), 1, Epsilon);
+            Vec2f uv = CLightEnvironment::getTextureCoords(dir);
+            EXPECT_NEAR(uv[0], u, 1e-4f);
+            EXPECT_NEAR(uv[1], v, 1e-4f);
+        }
+}
+
+TEST_F(CTestLightEnvironment, pdf) {
+    CLightEnvironment light(createMap(40, 10));
+
+    // the pdf integrates to 1 over the sphere
+    const size_t n = 512;
+    float integral = 0;
+    for (size_t y = 0; y < n; y++)
+        for (size_t x = 0; x < n; x++) {
+            Vec2f uv((x + 0.5f) / n, (y + 0.5f) / n);
+            auto res = light.evaluate(Vec3f::all(0), Vec3f::all(0), CLightEnvironment::getDirection(uv));
+            ASSERT_TRUE(res.has_value());
+            integral += res->pdf * 2 * Pif * Pif * sinf(Pif * uv[1]) / (n * n);
+        }
+    EXPECT_NEAR(integral, 1, 1e-2f);
+
+    // the sampled and the evaluated densities and radiances agree
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(0, 1);
+    for (size_t s = 0; s < 1000; s++) {
+        auto res = light.sample(Vec3f::all(0), Vec3f::all(0), Vec2f(u(rng), u(rng)));
+        ASSERT_TRUE(res.has_value());
+        EXPECT_TRUE(std::isinf(res->distance));
+        auto hit = light.evaluate(Vec3f::all(0), Vec3f::all(0), res->direction);
+        ASSERT_TRUE(hit.has_value());
+        EXPECT_NEAR(hit->pdf, res->pdf, 1e-3f * res->pdf);
+        EXPECT_LT(norm(hit->radiance - res->radiance), 1e-3f * norm(res->radiance));
+    }
+}
+
+TEST_F(CTestLightEnvironment, sun) {
+    // the majority of the samples hit the sun, which emits the majority of the light
+    const int sunX = 40, sunY = 10;
+    CLightEnvironment light(createMap(sunX, sunY));
+    const size_t nSamples = 4096;
+    size_t nSun = 0;
+    for (size_t s = 0; s < nSamples; s++) {
+        auto res = light.sample(Vec3f::all(0), Vec3f::all(0), CSampler::stratifiedSample(s, nSamples));
+        ASSERT_TRUE(res.has_value());
+        Vec2f uv = CLightEnvironment::getTextureCoords(res->direction);
+        if (static_cast<int>(uv[0] * 64) == sunX && static_cast<int>(uv[1] * 32) == sunY) nSun++;
+    }
+    EXPECT_GT(nSun, nSamples * 9 / 10);
+
+    // the samples below the surface are rejected
+    for (size_t s = 0; s < 100; s++) {
+        auto res = light.sample(Vec3f::all(0), Vec3f(0, 1, 0), CSampler::stratifiedSample(s, 100));
+        if (res) EXPECT_GT(res->direction[1], 0);
+    }
+}
+
+TEST_F(CTestLightEnvironment, irradiance) {
+    // the constant environment with the radiance L gives the irradiance Pi * L
+    const float L = 0.5f;
+    CLightEnvironment light(createMap(-1, -1, 0, L), Vec3f::all(2));
+    const Vec3f normal(0, 1, 0);
+    const size_t nSamples = 64 * 64;
+    Vec3f sum = Vec3f::all(0);
+    for (size_t s = 0; s < nSamples; s++) {
+        auto res = light.sample(Vec3f::all(0), normal, CSampler::stratifiedSample(s, nSamples));
+        if (res) sum += (res->direction.dot(normal) / res->pdf) * res->radiance;
+    }
+    sum = (1.0f / nSamples) * sum;
+    for (int c = 0; c < 3; c++)
+        EXPECT_NEAR(sum[c], 2 * Pif * L, 0.02f * 2 * Pif * L);
+}
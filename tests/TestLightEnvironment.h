@@ -0,0 +1,11 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "openrt.h"
+
+class CTestLightEnvironment : public ::testing::Test {
+public:
+    CTestLightEnvironment(void) = default;
+    ~CTestLightEnvironment(void) = default;
+};
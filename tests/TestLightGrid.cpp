@@ -0,0 +1,56 @@
+#include "TestLightGrid.h"
+#include "core/Ray.h"
+#include <random>
+
+using namespace rt;
+
+TEST_F(CTestLightGrid, light_grid) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(-10, 10);
+
+    std::vector<ptr_light_t> vpLights;
+    for (int i = 0; i < 100; i++) {
+        auto pOmni = std::make_shared<CLightOmni>(Vec3f::all(10), Vec3f(u(rng), u(rng), u(rng)));
+        pOmni->setRange(2 + u(rng) / 5);
+        vpLights.push_back(pOmni);
+    }
+    for (int i = 0; i < 20; i++) {
+        auto pSpot = std::make_shared<CLightSpot>(Vec3f::all(10), Vec3f(u(rng), u(rng), u(rng)), Vec3f(u(rng), u(rng), u(rng)), 30.0f, 20.0f);
+        pSpot->setRange(5);
+        vpLights.push_back(pSpot);
+    }
+    vpLights.push_back(std::make_shared<CLightSpot>(Vec3f::all(10), Vec3f::all(0), Vec3f(0, -1, 0), 60.0f));		// unlimited range
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f::all(10), Vec3f(0, 20, 0)));								// unlimited range
+    auto pArea = std::make_shared<CLightArea>(Vec3f::all(5), Vec3f(-2, 8, -2), Vec3f(2, 8, -2), Vec3f(2, 8, 2), Vec3f(-2, 8, 2));
+    pArea->setRange(6);
+    vpLights.push_back(pArea);
+
+    CLightGrid grid;
+    grid.build(vpLights);
+    for (int i = 0; i < 3; i++) EXPECT_GT(grid.getResolution()[i], 1);
+
+    // every light, which illuminates the point, is found in the grid
+    size_t nCulled = 0;
+    for (int i = 0; i < 2000; i++) {
+        const Vec3f point(1.5f * u(rng), 1.5f * u(rng), 1.5f * u(rng));
+        std::span<const size_t> vLights = grid.getLights(point);
+        EXPECT_TRUE(std::is_sorted(vLights.begin(), vLights.end()));
+        for (size_t l = 0; l < vpLights.size(); l++) {
+            bool listed = std::find(vLights.begin(), vLights.end(), l) != vLights.end();
+            bool illuminated = false;
+            for (size_t s = 0; s < vpLights[l]->getNumSamples(); s++) {
+                Ray ray(point);
+                if (vpLights[l]->illuminate(ray)) illuminated = true;
+            }
+            if (illuminated) EXPECT_TRUE(listed);
+            else if (!listed) nCulled++;
+        }
+    }
+    EXPECT_GT(nCulled, 2000 * vpLights.size() / 2);
+
+    // only the lights with unlimited range illuminate the points outside of the grid
+    std::span<const size_t> vLights = grid.getLights(Vec3f(0, -100, 0));
+    ASSERT_EQ(vLights.size(), 2);
+    EXPECT_EQ(vLights[0], 120);
+    EXPECT_EQ(vLights[1], 121);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "openrt.h"
+
+class CTestLightGrid : public ::testing::Test {
+public:
+    CTestLightGrid(void) = default;
+    ~CTestLightGrid(void) = default;
+};
@@ -0,0 +1,122 @@
+#include "TestPrimBoolean.h"
+#include "core/Ray.h"
+#include <random>
+
+using namespace rt;
+
+namespace {
+    // Returns the distance to the closest intersection of the ray with the primitive, or infinity
+    double trace(const CPrim& prim, const Vec3f& org, const Vec3f& dir, double t = std::numeric_limits<double>::infinity())
+    {
+        Ray ray(org, dir);
+        ray.t = t;
+        return prim.intersect(ray) ? ray.t : std::numeric_limits<double>::infinity();
+    }
+}
+
+TEST_F(CTestPrimBoolean, prim_boolean) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    const double infty = std::numeric_limits<double>::infinity();
+    // Two spheres overlapping in the interval x = [0; 1]
+    auto sphereA = [&]() { return CSolid(std::make_shared<CPrimSphere>(shader, Vec3f(0, 0, 0), 1.0f)); };
+    auto sphereB = [&]() { return CSolid(std::make_shared<CPrimSphere>(shader, Vec3f(1, 0, 0), 1.0f)); };
+
+    CPrimBoolean csgUnion(sphereA(), sphereB(), BoolOp::Union);
+    EXPECT_NEAR(trace(csgUnion, Vec3f(-5, 0, 0), Vec3f(1, 0, 0)), 4, Epsilon);
+    EXPECT_NEAR(trace(csgUnion, Vec3f(5, 0, 0), Vec3f(-1, 0, 0)), 3, Epsilon);
+    EXPECT_NEAR(trace(csgUnion, Vec3f(0.5f, 0, 0), Vec3f(1, 0, 0)), 1.5, Epsilon);		// from inside
+    EXPECT_EQ(trace(csgUnion, Vec3f(-5, 3, 0), Vec3f(1, 0, 0)), infty);
+    EXPECT_EQ(trace(csgUnion, Vec3f(-5, 0, 0), Vec3f(1, 0, 0), 3), infty);				// beyond Ray::t
+
+    CPrimBoolean csgIntersection(sphereA(), sphereB(), BoolOp::Intersection);
+    EXPECT_NEAR(trace(csgIntersection, Vec3f(-5, 0, 0), Vec3f(1, 0, 0)), 5, Epsilon);
+    EXPECT_NEAR(trace(csgIntersection, Vec3f(5, 0, 0), Vec3f(-1, 0, 0)), 4, Epsilon);
+    EXPECT_NEAR(trace(csgIntersection, Vec3f(0.5f, 0, 0), Vec3f(1, 0, 0)), 0.5, Epsilon);
+    EXPECT_EQ(trace(csgIntersection, Vec3f(-5, 0, 0.95f), Vec3f(1, 0, 0)), infty);
+
+    CPrimBoolean csgSubstraction(sphereA(), sphereB(), BoolOp::Substraction);
+    EXPECT_NEAR(trace(csgSubstraction, Vec3f(-5, 0, 0), Vec3f(1, 0, 0)), 4, Epsilon);
+    EXPECT_NEAR(trace(csgSubstraction, Vec3f(5, 0, 0), Vec3f(-1, 0, 0)), 5, Epsilon);
+    EXPECT_EQ(trace(csgSubstraction, Vec3f(1.5f, 0, 0), Vec3f(1, 0, 0)), infty);
+}
+
+TEST_F(CTestPrimBoolean, prim_boolean_nested) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    // (A + B) - C, where C is a small sphere inside the union
+    ptr_prim_t pUnion = std::make_shared<CPrimBoolean>(CSolidSphere(shader, Vec3f(0, 0, 0), 1.0f, 48), CSolidSphere(shader, Vec3f(1, 0, 0), 1.0f, 48), BoolOp::Union);
+    CPrimBoolean csg(pUnion, CSolid(std::make_shared<CPrimSphere>(shader, Vec3f(0.5f, 0, 0), 0.5f)), BoolOp::Substraction);
+
+    // All the boundaries of the result along the ray: entering the union, entering the hole, leaving the hole, leaving the union
+    std::vector<RayHit> vHits;
+    csg.intersectAll(Ray(Vec3f(0.5f, -5, 0), Vec3f(0, 1, 0)), vHits);
+    ASSERT_EQ(vHits.size(), 4);
+    const float y = sqrtf(0.75f);
+    EXPECT_NEAR(vHits[0].t, 5 - y, 0.01);
+    EXPECT_NEAR(vHits[1].t, 4.5, Epsilon);
+    EXPECT_NEAR(vHits[2].t, 5.5, Epsilon);
+    EXPECT_NEAR(vHits[3].t, 5 + y, 0.01);
+    for (size_t i = 1; i < vHits.size(); i++)
+        EXPECT_LT(vHits[i - 1].t, vHits[i].t);
+
+    // The closest hit
+    Ray ray(Vec3f(0.5f, -5, 0), Vec3f(0, 1, 0));
+    ASSERT_TRUE(csg.intersect(ray));
+    EXPECT_DOUBLE_EQ(ray.t, vHits[0].t);
+    EXPECT_EQ(ray.hit, vHits[0].hit);
+
+    // Starting inside the hole
+    ray = Ray(Vec3f(0.5f, 0, 0), Vec3f(0, 1, 0));
+    ASSERT_TRUE(csg.intersect(ray));
+    EXPECT_NEAR(ray.t, 0.5, Epsilon);
+}
+
+TEST_F(CTestPrimBoolean, prim_csg) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    auto sphere = [&](const Vec3f& center, float radius) { return CPrimCSG::solid(CSolid(std::make_shared<CPrimSphere>(shader, center, radius))); };
+
+    // Three spheres along the x-axis: the n-ary operations agree with the chains of binary ones
+    CPrimCSG csgUnion(CPrimCSG::operation(BoolOp::Union, { sphere(Vec3f(0, 0, 0), 1), sphere(Vec3f(1, 0, 0), 1), sphere(Vec3f(2, 0, 0), 1) }));
+    EXPECT_NEAR(trace(csgUnion, Vec3f(-5, 0, 0), Vec3f(1, 0, 0)), 4, Epsilon);
+    EXPECT_NEAR(trace(csgUnion, Vec3f(5, 0, 0), Vec3f(-1, 0, 0)), 2, Epsilon);
+    EXPECT_NEAR(trace(csgUnion, Vec3f(0.5f, 0, 0), Vec3f(1, 0, 0)), 2.5, Epsilon);
+
+    CPrimCSG csgIntersection(CPrimCSG::operation(BoolOp::Intersection, { sphere(Vec3f(0, 0, 0), 1), sphere(Vec3f(1, 0, 0), 1), sphere(Vec3f(0.5f, 0, 0), 1) }));
+    EXPECT_NEAR(trace(csgIntersection, Vec3f(-5, 0, 0), Vec3f(1, 0, 0)), 5, Epsilon);
+    EXPECT_NEAR(trace(csgIntersection, Vec3f(5, 0, 0), Vec3f(-1, 0, 0)), 4, Epsilon);
+    EXPECT_EQ(trace(csgIntersection, Vec3f(-5, 0, 0.95f), Vec3f(1, 0, 0)), std::numeric_limits<double>::infinity());
+
+    // A bar with two holes and a missed hole, which is culled by its bounding box
+    CPrimCSG csgBar(CPrimCSG::operation(BoolOp::Substraction, {
+        CPrimCSG::solid(CSolidBox(shader, Vec3f(0, 0, 0), 4, 1, 1)),
+        sphere(Vec3f(-2, 0, 0), 0.5f),
+        sphere(Vec3f(2, 0, 0), 0.5f),
+        sphere(Vec3f(0, 10, 0), 0.5f)
+    }));
+    std::vector<RayHit> vHits;
+    csgBar.intersectAll(Ray(Vec3f(-10, 0, 0), Vec3f(1, 0, 0)), vHits);
+    ASSERT_EQ(vHits.size(), 2);
+    EXPECT_NEAR(vHits[0].t, 8.5, Epsilon);
+    EXPECT_NEAR(vHits[1].t, 11.5, Epsilon);
+    EXPECT_NEAR(trace(csgBar, Vec3f(0, 0, -5), Vec3f(0, 0, 1)), 4.5, Epsilon);
+    EXPECT_EQ(trace(csgBar, Vec3f(0, 3, -5), Vec3f(0, 0, 1)), std::numeric_limits<double>::infinity());
+
+    // Nested expression: (bar - holes) + sphere; the boolean primitive gives the same result
+    auto pSphere = std::make_shared<CPrimSphere>(shader, Vec3f(0, 0.5f, 0), 0.75f);
+    CPrimCSG csgNested(CPrimCSG::operation(BoolOp::Union, {
+        CPrimCSG::operation(BoolOp::Substraction, { CPrimCSG::solid(CSolidBox(shader, Vec3f(0, 0, 0), 4, 1, 1)), sphere(Vec3f(-2, 0, 0), 0.5f) }),
+        CPrimCSG::solid(CSolid(pSphere))
+    }));
+    ptr_prim_t pBar = std::make_shared<CPrimBoolean>(CSolidBox(shader, Vec3f(0, 0, 0), 4, 1, 1), CSolid(std::make_shared<CPrimSphere>(shader, Vec3f(-2, 0, 0), 0.5f)), BoolOp::Substraction);
+    CPrimBoolean boolNested(pBar, CSolid(std::make_shared<CPrimSphere>(shader, Vec3f(0, 0.5f, 0), 0.75f)), BoolOp::Union);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(-1, 1);
+    for (int i = 0; i < 200; i++) {
+        Vec3f org(5 * u(rng), 5 * u(rng), 5 * u(rng));
+        Vec3f dir = normalize(Vec3f(u(rng), u(rng), u(rng)));
+        double t = trace(csgNested, org, dir);
+        double tBool = trace(boolNested, org, dir);
+        if (std::isinf(t) || std::isinf(tBool)) EXPECT_EQ(t, tBool);
+        else EXPECT_NEAR(t, tBool, 1e-4);
+        EXPECT_EQ(boolNested.if_intersect(Ray(org, dir)), !std::isinf(tBool));
+    }
+}
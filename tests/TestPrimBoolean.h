@@ -0,0 +1,11 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "openrt.h"
+
+class CTestPrimBoolean : public ::testing::Test {
+public:
+    CTestPrimBoolean(void) = default;
+	~CTestPrimBoolean(void) = default;
+};
@@ -0,0 +1,49 @@
+#include "TestPrimInstance.h"
+#include "core/Ray.h"
+
+using namespace rt;
+
+TEST_F(CTestPrimInstance, prim_instance) {
+    auto shader = std::make_shared<CShaderFlat>(RGB(255, 255, 255));
+    CTransform T;
+    Mat t = T.scale(2).rotate(Vec3f(0, 1, 0), 30).translate(5, 1, -3).get();
+
+    // Reference: a solid transformed in place
+    auto sphere = CSolidSphere(shader, Vec3f::all(0), 1.0f, 24);
+    sphere.transform(t);
+
+    // Instance of the same, not transformed, solid
+    auto pGeometry = std::make_shared<CInstanceGeometry>(CSolidSphere(shader, Vec3f::all(0), 1.0f, 24));
+    auto pInstance = std::make_shared<CPrimInstance>(pGeometry, t);
+
+    CBoundingBox box;
+    for (const auto& pPrim : sphere.getPrims())
+        box.extend(pPrim->getBoundingBox());
+    // The instance's box is built from the transformed corners of the OCS box, thus it is conservative
+    for (int i = 0; i < 3; i++) {
+        EXPECT_LE(pInstance->getBoundingBox().getMinPoint()[i], box.getMinPoint()[i] + Epsilon);
+        EXPECT_GE(pInstance->getBoundingBox().getMaxPoint()[i], box.getMaxPoint()[i] - Epsilon);
+    }
+
+    for (int i = 0; i < 50; i++) {
+        Vec3f org(5, 1, 10);
+        // Offset the rays slightly, so that they do not hit exactly the edges shared by neighbouring triangles
+        Vec3f dir = normalize(Vec3f(0.02f * (i % 7 - 3) + 0.003f, 0.02f * (i / 7 - 3) + 0.003f, -1));
+
+        Ray gt(org, dir);
+        for (const auto& pPrim : sphere.getPrims()) pPrim->intersect(gt);
+        Ray ray(org, dir);
+        bool hit = pInstance->intersect(ray);
+
+        ASSERT_EQ(hit, gt.hit != nullptr);
+        EXPECT_EQ(pInstance->if_intersect(Ray(org, dir)), hit);
+        if (!hit) continue;
+        EXPECT_NEAR(ray.t, gt.t, 1e-3);
+        EXPECT_EQ(ray.hit, pInstance);
+        EXPECT_EQ(ray.instHit->getShader(), shader);
+        Vec3f n = ray.hit->getNormal(ray);
+        Vec3f gtn = gt.hit->getNormal(gt);
+        for (int j = 0; j < 3; j++)
+            EXPECT_NEAR(n[j], gtn[j], 1e-3);
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "openrt.h"
+
+class CTestPrimInstance : public ::testing::Test {
+public:
+    CTestPrimInstance(void) = default;
+    ~CTestPrimInstance(void) = default;
+};
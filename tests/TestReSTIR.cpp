@@ -0,0 +1,96 @@
+#include "TestReSTIR.h"
+#include "core/Ray.h"
+#include <random>
+
+using namespace rt;
+
+TEST_F(CTestReSTIR, reservoir) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(0, 1);
+
+    // the candidates are chosen proportionally to their weights
+    const float weights[] = { 1, 2, 0, 5 };
+    const size_t nTrials = 20000;
+    size_t counts[4] = { 0 };
+    for (size_t t = 0; t < nTrials; t++) {
+        LightReservoir reservoir;
+        for (size_t i = 0; i < 4; i++)
+            reservoir.update(i, Vec2f::all(0), weights[i], weights[i], u(rng));
+        EXPECT_EQ(reservoir.M, 4);
+        EXPECT_FLOAT_EQ(reservoir.weightSum, 8);
+        EXPECT_FLOAT_EQ(reservoir.getWeight(), 8 / (4 * weights[reservoir.light]));
+        counts[reservoir.light]++;
+    }
+    EXPECT_EQ(counts[2], 0);
+    for (size_t i = 0; i < 4; i++)
+        EXPECT_NEAR(static_cast<float>(counts[i]) / nTrials, weights[i] / 8, 0.02f);
+
+    // merging
+    LightReservoir a, b;
+    a.update(0, Vec2f::all(0), 2, 4, 0.5f);
+    a.update(1, Vec2f::all(0), 4, 4, 0.9f);
+    b.update(2, Vec2f::all(0), 1, 3, 0.5f);
+    const float wB = b.getWeight();
+    a.merge(b, 2, 10, 0.99f);
+    EXPECT_EQ(a.M, 3);
+    EXPECT_FLOAT_EQ(a.weightSum, 8 + 2 * wB * 1);
+    EXPECT_EQ(a.light, 0);
+
+    // the number of candidates of the merged reservoir is limited
+    b.M = 100;
+    a.merge(b, 2, 10, 0.99f);
+    EXPECT_EQ(a.M, 13);
+
+    // empty reservoir
+    EXPECT_EQ(LightReservoir().getWeight(), 0);
+}
+
+TEST_F(CTestReSTIR, const_illuminate) {
+    // the same sample gives the same illumination
+    CLightArea area(Vec3f::all(5), Vec3f(-2, 8, -2), Vec3f(2, 8, -2), Vec3f(2, 8, 2), Vec3f(-2, 8, 2));
+    Ray I1(Vec3f(1, 0, 1)), I2(Vec3f(1, 0, 1));
+    auto r1 = area.illuminate(I1, Vec2f(0.3f, 0.7f));
+    auto r2 = area.illuminate(I2, Vec2f(0.3f, 0.7f));
+    ASSERT_TRUE(r1.has_value());
+    ASSERT_TRUE(r2.has_value());
+    EXPECT_EQ(r1.value(), r2.value());
+    EXPECT_EQ(I1.dir, I2.dir);
+    EXPECT_NEAR((I1.org + static_cast<float>(I1.t) * I1.dir)[1], 8, 1e-4f);		// the sample lies on the area
+}
+
+TEST_F(CTestReSTIR, unbiased) {
+    CScene scene;
+    std::vector<ptr_light_t> vpLights;
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f(10, 0, 0), Vec3f(0, 4, 0)));
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f(0, 40, 0), Vec3f(3, 3, 1)));
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f(5, 5, 5), Vec3f(-4, 6, 2)));
+    vpLights.push_back(std::make_shared<CLightOmni>(Vec3f::all(100), Vec3f(0, -5, 0)));	// below the surface
+    for (auto& pLight : vpLights) scene.add(pLight);
+
+    const Vec3f normal(0, 1, 0);
+    auto reflectance = [&](const Vec3f& dir, const Vec3f& radiance) { return MAX(dir.dot(normal), 0.0f) * radiance; };
+
+    // reference: the sum over all the lights
+    Vec3f reference = Vec3f::all(0);
+    for (auto& pLight : vpLights) {
+        Ray I(Vec3f::all(0));
+        auto radiance = pLight->illuminate(I, Vec2f::all(0.5f));
+        if (radiance) reference += reflectance(I.dir, radiance.value());
+    }
+
+    // resampled estimate of a secondary ray, which does not use the reservoir buffers
+    CReSTIR reSTIR;
+    reSTIR.setParameters(4, 1, 0, 0);
+    EXPECT_TRUE(reSTIR.isEnabled());
+    Ray ray(Vec3f(0, 1, 0), Vec3f(0, -1, 0), Vec2f::all(0.5f), 1);
+    ray.t = 1;
+    const size_t nTrials = 50000;
+    Vec3f estimate = Vec3f::all(0);
+    for (size_t t = 0; t < nTrials; t++) {
+        Ray I(Vec3f::all(0));
+        estimate += reSTIR.illuminate(scene, vpLights, ray, I, normal, reflectance);
+    }
+    estimate = (1.0f / nTrials) * estimate;
+    for (int i = 0; i < 3; i++)
+        EXPECT_NEAR(estimate[i], reference[i], 0.03f * reference[i]);
+}
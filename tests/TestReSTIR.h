@@ -0,0 +1,11 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "openrt.h"
+
+class CTestReSTIR : public ::testing::Test {
+public:
+    CTestReSTIR(void) = default;
+    ~CTestReSTIR(void) = default;
+};
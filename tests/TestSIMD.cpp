@@ -0,0 +1,87 @@
+#include "TestSIMD.h"
+#include "core/simd.h"
+#include <random>
+
+using namespace rt;
+
+namespace {
+    // Checks that the first 3 components of the SIMD vector are equal to the components of the OpenCV vector
+    void expectEqual(const simd::float4& a, const Vec3f& b)
+    {
+        EXPECT_EQ(a.x(), b[0]);
+        EXPECT_EQ(a.y(), b[1]);
+        EXPECT_EQ(a.z(), b[2]);
+    }
+    void expectNear(const simd::float4& a, const Vec3f& b, float eps)
+    {
+        EXPECT_NEAR(a.x(), b[0], eps);
+        EXPECT_NEAR(a.y(), b[1], eps);
+        EXPECT_NEAR(a.z(), b[2], eps);
+    }
+}
+
+TEST_F(CTestSIMD, dot_cross) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(-10, 10);
+    for (int i = 0; i < 1000; i++) {
+        const Vec3f a(u(rng), u(rng), u(rng));
+        const Vec3f b(u(rng), u(rng), u(rng));
+        const simd::float4 a4 = simd::load3(a);
+        const simd::float4 b4 = simd::load3(b);
+
+        EXPECT_NEAR(simd::dot3(a4, b4), a.dot(b), 1e-4f);
+        const simd::float4 c4 = simd::cross3(a4, b4);
+        expectNear(c4, a.cross(b), 1e-4f);
+
+        // the cross product is orthogonal to the operands and keeps the 4-th component zero
+        EXPECT_NEAR(simd::dot3(c4, a4), 0, 1e-2f);
+        EXPECT_NEAR(simd::dot3(c4, b4), 0, 1e-2f);
+        EXPECT_EQ(simd::dot3(c4 * c4, simd::float4(1)), c4.x() * c4.x() + c4.y() * c4.y() + c4.z() * c4.z());
+    }
+
+    // the 4-th component does not contribute to the dot product
+    EXPECT_EQ(simd::dot3(simd::float4(1, 2, 3, 100), simd::float4(4, 5, 6, 100)), 32);
+    expectEqual(simd::cross3(simd::float4(1, 0, 0, 0), simd::float4(0, 1, 0, 0)), Vec3f(0, 0, 1));
+    expectEqual(simd::cross3(simd::float4(0, 1, 0, 0), simd::float4(1, 0, 0, 0)), Vec3f(0, 0, -1));
+}
+
+TEST_F(CTestSIMD, min_max) {
+    const simd::float4 a(1, -2, 3, 0);
+    const simd::float4 b(-1, 5, 3, 0);
+    expectEqual(simd::min(a, b), Vec3f(-1, -2, 3));
+    expectEqual(simd::max(a, b), Vec3f(1, 5, 3));
+    EXPECT_EQ(simd::hmin3(a), -2);
+    EXPECT_EQ(simd::hmax3(a), 3);
+    EXPECT_EQ(simd::hmin3(simd::float4(4, 5, 6, -100)), 4);		// the 4-th component is ignored
+    EXPECT_EQ(simd::hmax3(simd::float4(4, 5, 6, 100)), 6);
+
+    // NaN components select the second operand, which the slab tests rely on
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const simd::float4 n(nan, 1, nan, 0);
+    expectEqual(simd::min(n, b), Vec3f(-1, 1, 3));
+    expectEqual(simd::max(n, b), Vec3f(-1, 5, 3));
+    EXPECT_TRUE(std::isnan(simd::min(b, n).x()));
+    EXPECT_TRUE(std::isnan(simd::max(b, n).z()));
+
+    // infinities are ordered as usual
+    const simd::float4 inf(Infty, -Infty, 0, 0);
+    expectEqual(simd::min(inf, a), Vec3f(1, -Infty, 0));
+    expectEqual(simd::max(inf, a), Vec3f(Infty, -2, 3));
+}
+
+TEST_F(CTestSIMD, arithmetics) {
+    const Vec3f a(1, -2, 3);
+    const Vec3f b(4, 0.5f, -6);
+    const simd::float4 a4 = simd::load3(a);
+    const simd::float4 b4 = simd::load3(b.val);
+    expectEqual(a4 + b4, a + b);
+    expectEqual(a4 - b4, a - b);
+    expectEqual(a4 * b4, Vec3f(4, -1, -18));
+    expectEqual(a4 / b4, Vec3f(0.25f, -4, -0.5f));
+    expectEqual(2.0f * a4, 2 * a);
+    expectEqual(a4 * 2.0f, 2 * a);
+    EXPECT_EQ(simd::toVec3f(a4), a);
+
+    // selectZero() takes the components of the last operand, where the mask is zero
+    expectEqual(simd::selectZero(simd::float4(0, 1, 0, 0), a4, b4), Vec3f(4, -2, -6));
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "openrt.h"
+
+class CTestSIMD : public ::testing::Test {
+public:
+    CTestSIMD(void) = default;
+    ~CTestSIMD(void) = default;
+};